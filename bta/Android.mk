@@ -22,6 +22,7 @@ LOCAL_SRC_FILES:= \
     ./dm/bta_dm_cfg.c \
     ./dm/bta_dm_api.c \
     ./dm/bta_dm_sco.c \
+    ./dm/bta_dm_sdp_sched.c \
     ./gatt/bta_gattc_api.c \
     ./gatt/bta_gatts_act.c \
     ./gatt/bta_gatts_main.c \
@@ -90,6 +91,8 @@ LOCAL_SRC_FILES:= \
     ./sys/bta_sys_ci.c \
     ./sys/bta_sys_conn.c \
     ./sys/bta_sys_cfg.c \
+    ./sys/bta_sys_metrics.c \
+    ./sys/bta_sys_metrics_fmt.c \
     ./sys/ptim.c \
     ./sys/bd.c \
     ./sys/utl.c \
@@ -52,7 +52,6 @@ static void bta_dm_rem_name_cback (BD_ADDR bd_addr, DEV_CLASS dc, BD_NAME bd_nam
 static void bta_dm_remname_cback (tBTM_REMOTE_DEV_NAME *p_remote_name);
 static void bta_dm_find_services ( BD_ADDR bd_addr);
 static void bta_dm_discover_next_device(void);
-static void bta_dm_sdp_callback (UINT16 sdp_status);
 static UINT8 bta_dm_authorize_cback (BD_ADDR bd_addr, DEV_CLASS dev_class, BD_NAME bd_name, UINT8 *service_name, UINT8 service_id, BOOLEAN is_originator);
 static UINT8 bta_dm_pin_cback (BD_ADDR bd_addr, DEV_CLASS dev_class, BD_NAME bd_name, BOOLEAN secure);
 static UINT8 bta_dm_link_key_request_cback (BD_ADDR bd_addr, LINK_KEY key);
@@ -244,7 +243,6 @@ const tBTA_DM_LMP_VER_INFO bta_role_switch_blacklist[BTA_DM_MAX_ROLE_SWITCH_BLAC
         {0x00,0x00,0x00}
 };
 
-#define MAX_DISC_RAW_DATA_BUF       (4096)
 UINT8 g_disc_raw_data_buf[MAX_DISC_RAW_DATA_BUF];
 
 /*******************************************************************************
@@ -1521,6 +1519,9 @@ void bta_dm_di_disc (tBTA_DM_MSG *p_data)
 
     if((bta_dm_search_cb.p_sdp_db = (tSDP_DISCOVERY_DB *)GKI_getbuf(BTA_DM_SDP_DB_SIZE)) != NULL)
     {
+        /* not filled, but freed with SDP_FreeDiscoveryDb like the others */
+        SDP_InitDiscoveryDb (bta_dm_search_cb.p_sdp_db, BTA_DM_SDP_DB_SIZE, 0, NULL, 0, NULL);
+
         if ( SDP_DiDiscover(bta_dm_search_cb.peer_bdaddr, p_data->di_disc.p_sdp_db,
                     p_data->di_disc.len, bta_dm_di_disc_callback) == SDP_SUCCESS)
         {
@@ -1612,6 +1613,9 @@ void bta_dm_inq_cmpl (tBTA_DM_MSG *p_data)
         /* start name and service discovery from the first device on inquiry result */
         bta_dm_search_cb.name_discover_done = FALSE;
         bta_dm_search_cb.peer_name[0]       = 0;
+#if (BTA_DM_SDP_SCHED_MAX > 0)
+        bta_dm_sdp_sched_start();
+#endif
         bta_dm_discover_device(bta_dm_search_cb.p_btm_inq_info->results.remote_bd_addr);
     }
     else
@@ -2042,7 +2046,7 @@ void bta_dm_sdp_result (tBTA_DM_MSG *p_data)
             bta_dm_search_cb.wait_disc = FALSE;
 
         /* not able to connect go to next device */
-        GKI_freebuf(bta_dm_search_cb.p_sdp_db);
+        SDP_FreeDiscoveryDb(bta_dm_search_cb.p_sdp_db);
         bta_dm_search_cb.p_sdp_db = NULL;
 
         BTM_SecDeleteRmtNameNotifyCallback(&bta_dm_service_search_remname_cback);
@@ -2077,6 +2081,10 @@ void bta_dm_search_cmpl (tBTA_DM_MSG *p_data)
 {
     APPL_TRACE_DEBUG("bta_dm_search_cmpl");
 
+#if (BTA_DM_SDP_SCHED_MAX > 0)
+    bta_dm_sdp_sched_stop();
+#endif
+
 #if (BLE_INCLUDED == TRUE && BTA_GATT_INCLUDED == TRUE)
     utl_freebuf((void **)&bta_dm_search_cb.p_srvc_uuid);
 #endif
@@ -2195,7 +2203,7 @@ void bta_dm_free_sdp_db (tBTA_DM_MSG *p_data)
     UNUSED(p_data);
     if(bta_dm_search_cb.p_sdp_db)
     {
-        GKI_freebuf(bta_dm_search_cb.p_sdp_db);
+        SDP_FreeDiscoveryDb(bta_dm_search_cb.p_sdp_db);
         bta_dm_search_cb.p_sdp_db = NULL;
     }
 
@@ -2307,7 +2315,7 @@ void bta_dm_search_cancel_transac_cmpl(tBTA_DM_MSG *p_data)
     UNUSED(p_data);
     if(bta_dm_search_cb.p_sdp_db)
     {
-        GKI_freebuf(bta_dm_search_cb.p_sdp_db);
+        SDP_FreeDiscoveryDb(bta_dm_search_cb.p_sdp_db);
         bta_dm_search_cb.p_sdp_db = NULL;
     }
 
@@ -2337,6 +2345,9 @@ void bta_dm_search_cancel_notify (tBTA_DM_MSG *p_data)
     {
         bta_dm_search_cb.p_search_cback(BTA_DM_SEARCH_CANCEL_CMPL_EVT, NULL);
     }
+#if (BTA_DM_SDP_SCHED_MAX > 0)
+    bta_dm_sdp_sched_stop();
+#endif
     if (!bta_dm_search_cb.name_discover_done)
     {
         BTM_CancelRemoteDeviceName();
@@ -2445,6 +2456,8 @@ static void bta_dm_find_services ( BD_ADDR bd_addr)
                 APPL_TRACE_ERROR("****************search UUID = %04x***********", uuid.uu.uuid16);
                 //SDP_InitDiscoveryDb (bta_dm_search_cb.p_sdp_db, BTA_DM_SDP_DB_SIZE, 1, &uuid, num_attrs, attr_list);
                 SDP_InitDiscoveryDb (bta_dm_search_cb.p_sdp_db, BTA_DM_SDP_DB_SIZE, 1, &uuid, 0, NULL);
+                /* records beyond the buffer get more memory, up to its size again */
+                bta_dm_search_cb.p_sdp_db->grow_size = BTA_DM_SDP_DB_SIZE;
 
 
                 memset(g_disc_raw_data_buf, 0, sizeof(g_disc_raw_data_buf));
@@ -2452,11 +2465,16 @@ static void bta_dm_find_services ( BD_ADDR bd_addr)
 
                 bta_dm_search_cb.p_sdp_db->raw_size = MAX_DISC_RAW_DATA_BUF;
 
-                if (!SDP_ServiceSearchAttributeRequest (bd_addr, bta_dm_search_cb.p_sdp_db, &bta_dm_sdp_callback))
+                if (
+#if (BTA_DM_SDP_SCHED_MAX > 0)
+                    /* the scheduler may have run this search ahead */
+                    !bta_dm_sdp_sched_take (bd_addr, &uuid) &&
+#endif
+                    !SDP_ServiceSearchAttributeRequest (bd_addr, bta_dm_search_cb.p_sdp_db, &bta_dm_sdp_callback))
                 {
                     /* if discovery not successful with this device
                     proceed to next one */
-                    GKI_freebuf(bta_dm_search_cb.p_sdp_db);
+                    SDP_FreeDiscoveryDb(bta_dm_search_cb.p_sdp_db);
                     bta_dm_search_cb.p_sdp_db = NULL;
                     bta_dm_search_cb.service_index = BTA_MAX_SERVICE_ID;
 
@@ -2500,6 +2518,69 @@ static void bta_dm_find_services ( BD_ADDR bd_addr)
     }
 }
 
+#if (BTA_DM_SDP_SCHED_MAX > 0)
+/*******************************************************************************
+**
+** Function         bta_dm_sdp_first_uuid
+**
+** Description      The UUID bta_dm_find_services searches for first on a device
+**                  of the inquiry results, so that the SDP scheduler can run
+**                  the same search ahead of it
+**
+** Returns          TRUE if the device needs a BR/EDR service search
+**
+*******************************************************************************/
+BOOLEAN bta_dm_sdp_first_uuid (tBTM_INQ_INFO *p_inq_info, tSDP_UUID *p_uuid)
+{
+    tBTA_SERVICE_MASK services_to_search = bta_dm_search_cb.services;
+    tBTA_SERVICE_MASK services_found = 0;
+    UINT8             service_index;
+
+#if BLE_INCLUDED == TRUE
+    if (p_inq_info->results.device_type == BT_DEVICE_TYPE_BLE
+     || p_inq_info->results.ble_addr_type == BLE_ADDR_RANDOM)
+        return FALSE;
+#endif
+
+#if ( BTM_EIR_CLIENT_INCLUDED == TRUE )
+    if (bta_dm_search_cb.services != BTA_USER_SERVICE_MASK && !bta_dm_search_cb.sdp_search)
+        bta_dm_eir_search_services(&p_inq_info->results, &services_to_search, &services_found);
+#endif
+
+    for (service_index = 0; service_index < BTA_MAX_SERVICE_ID; service_index++)
+    {
+        if (services_to_search & (tBTA_SERVICE_MASK)(BTA_SERVICE_ID_TO_SERVICE_MASK(service_index)))
+            break;
+    }
+    if (service_index == BTA_MAX_SERVICE_ID)
+        return FALSE;
+
+    memset(p_uuid, 0, sizeof(tSDP_UUID));
+    p_uuid->len = LEN_UUID_16;
+
+    if (bta_dm_search_cb.services == BTA_ALL_SERVICE_MASK)
+    {
+        p_uuid->uu.uuid16 = (services_to_search & BTA_RES_SERVICE_MASK) ?
+                            bta_service_id_to_uuid_lkup_tbl[0] : UUID_PROTOCOL_L2CAP;
+    }
+#if BLE_INCLUDED == TRUE && BTA_GATT_INCLUDED == TRUE
+    else if (service_index == BTA_BLE_SERVICE_ID)
+    {
+        return FALSE;
+    }
+#endif
+    else if (service_index == BTA_USER_SERVICE_ID)
+    {
+        memcpy(p_uuid, &bta_dm_search_cb.uuid, sizeof(tSDP_UUID));
+    }
+    else
+    {
+        p_uuid->uu.uuid16 = bta_service_id_to_uuid_lkup_tbl[service_index];
+    }
+    return TRUE;
+}
+#endif
+
 /*******************************************************************************
 **
 ** Function         bta_dm_discover_next_device
@@ -2516,11 +2597,19 @@ static void bta_dm_discover_next_device(void)
 
     APPL_TRACE_DEBUG("bta_dm_discover_next_device");
 
+#if (BTA_DM_SDP_SCHED_MAX > 0)
+    /* a search run ahead for the device done with is not needed any more */
+    bta_dm_sdp_sched_drop(bta_dm_search_cb.peer_bdaddr);
+#endif
+
     /* searching next device on inquiry result */
     if((bta_dm_search_cb.p_btm_inq_info = BTM_InqDbNext(bta_dm_search_cb.p_btm_inq_info)) != NULL)
     {
         bta_dm_search_cb.name_discover_done = FALSE;
         bta_dm_search_cb.peer_name[0]       = 0;
+#if (BTA_DM_SDP_SCHED_MAX > 0)
+        bta_dm_sdp_sched_fill();
+#endif
         bta_dm_discover_device(bta_dm_search_cb.p_btm_inq_info->results.remote_bd_addr);
     }
     else
@@ -2713,7 +2802,7 @@ static void bta_dm_discover_device(BD_ADDR remote_bd_addr)
 ** Returns          void
 **
 *******************************************************************************/
-static void bta_dm_sdp_callback (UINT16 sdp_status)
+void bta_dm_sdp_callback (UINT16 sdp_status)
 {
 
     tBTA_DM_SDP_RESULT * p_msg;
@@ -3117,6 +3206,23 @@ static UINT8 bta_dm_pin_cback (BD_ADDR bd_addr, DEV_CLASS dev_class, BD_NAME bd_
 *******************************************************************************/
 static UINT8  bta_dm_link_key_request_cback (BD_ADDR bd_addr, LINK_KEY key)
 {
+#if (BTA_DM_LAZY_LINK_KEYS == TRUE)
+    LINK_KEY stored_key;
+    UINT8 key_type;
+    UINT8 pin_len;
+
+    /* Application only passes the keys of dual mode devices to BTM
+    during initialization. Fetch the bond of any other device on its
+    first link key request */
+    if (bta_dm_co_get_link_key(bd_addr, stored_key, &key_type, &pin_len)
+        && BTM_SecAddLinkKey(bd_addr, stored_key, key_type, pin_len))
+    {
+        memcpy(key, stored_key, LINK_KEY_LEN);
+        return BTM_SUCCESS;
+    }
+
+    return BTM_NOT_AUTHORIZED;
+#else
     /* Application passes all link key to
     BTM during initialization using add_device
     API. If BTM doesn't have the link key in it's
@@ -3126,6 +3232,7 @@ static UINT8  bta_dm_link_key_request_cback (BD_ADDR bd_addr, LINK_KEY key)
     UNUSED(key);
 
     return BTM_NOT_AUTHORIZED;
+#endif
 }
 
 
@@ -994,6 +994,9 @@ typedef struct
 #define BTA_DM_SDP_DB_SIZE 250
 #endif
 
+#define MAX_DISC_RAW_DATA_BUF       (4096)
+extern UINT8 g_disc_raw_data_buf[MAX_DISC_RAW_DATA_BUF];
+
 /* DM search control block */
 typedef struct
 {
@@ -1259,6 +1262,15 @@ extern void bta_dm_search_cancel_cmpl (tBTA_DM_MSG *p_data);
 extern void bta_dm_search_cancel_notify (tBTA_DM_MSG *p_data);
 extern void bta_dm_search_cancel_transac_cmpl(tBTA_DM_MSG *p_data);
 extern void bta_dm_disc_rmt_name (tBTA_DM_MSG *p_data);
+extern void bta_dm_sdp_callback (UINT16 sdp_status);
+#if (BTA_DM_SDP_SCHED_MAX > 0)
+extern BOOLEAN bta_dm_sdp_first_uuid (tBTM_INQ_INFO *p_inq_info, tSDP_UUID *p_uuid);
+extern void bta_dm_sdp_sched_start (void);
+extern void bta_dm_sdp_sched_fill (void);
+extern BOOLEAN bta_dm_sdp_sched_take (BD_ADDR bd_addr, tSDP_UUID *p_uuid);
+extern void bta_dm_sdp_sched_drop (BD_ADDR bd_addr);
+extern void bta_dm_sdp_sched_stop (void);
+#endif
 extern tBTA_DM_PEER_DEVICE * bta_dm_find_peer_device(BD_ADDR peer_addr);
 
 extern void bta_dm_ble_config_local_privacy (tBTA_DM_MSG *p_data);
@@ -0,0 +1,395 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  SDP scheduler of the device manager search. BTA_DmSearch with services
+ *  finds the services of the inquiry results one device at a time; most of
+ *  that time goes to paging each device and waiting for SDP. While the
+ *  search works on one device, the scheduler runs the first service search
+ *  of the next BTA_DM_SDP_SCHED_MAX devices, each into a discovery database
+ *  of its own, as long as ACL links are free.
+ *
+ *  When the search gets to a device, bta_dm_find_services takes over the
+ *  session for it: a finished one is reported to bta_dm_sdp_result right
+ *  away, a running one when it completes. The search itself, the remote
+ *  name requests and the results are unchanged and come in inquiry order.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "bt_target.h"
+#include "bt_types.h"
+#include "gki.h"
+#include "bd.h"
+#include "bta_sys.h"
+#include "bta_api.h"
+#include "bta_dm_int.h"
+#include "btm_api.h"
+#include "sdp_api.h"
+#include "l2c_api.h"
+#include "utl.h"
+
+#if (BTA_DM_SDP_SCHED_MAX > 0)
+
+#if (BTA_DM_SDP_SCHED_MAX + 2 > SDP_MAX_CONNECTIONS)
+#error "BTA_DM_SDP_SCHED_MAX leaves no SDP connection for the search and the server"
+#endif
+
+enum
+{
+    BTA_DM_SDP_SESS_FREE,
+    BTA_DM_SDP_SESS_RUNNING,        /* SDP runs, nobody waits for it yet */
+    BTA_DM_SDP_SESS_DONE,           /* SDP is done, the result is kept */
+    BTA_DM_SDP_SESS_CLAIMED,        /* SDP runs, the search waits for it */
+    BTA_DM_SDP_SESS_DISCARD         /* SDP runs, the result is not needed */
+};
+typedef UINT8 tBTA_DM_SDP_SESS_STATE;
+
+typedef struct
+{
+    tBTA_DM_SDP_SESS_STATE  state;
+    BD_ADDR                 bd_addr;
+    tSDP_UUID               uuid;
+    tSDP_DISCOVERY_DB       *p_db;
+    UINT8                   *p_raw;         /* raw data buffer of p_db */
+    UINT16                  sdp_result;
+} tBTA_DM_SDP_SESS;
+
+typedef struct
+{
+    tBTA_DM_SDP_SESS        sess[BTA_DM_SDP_SCHED_MAX];
+    BOOLEAN                 active;
+} tBTA_DM_SDP_SCHED_CB;
+
+static tBTA_DM_SDP_SCHED_CB bta_dm_sdp_sched_cb;
+
+/*******************************************************************************
+**
+** Function         bta_dm_sdp_sched_find
+**
+** Description      Find the session of a device, one being discarded aside
+**
+** Returns          the session, NULL if none
+**
+*******************************************************************************/
+static tBTA_DM_SDP_SESS *bta_dm_sdp_sched_find (BD_ADDR bd_addr)
+{
+    tBTA_DM_SDP_SESS *p_sess = bta_dm_sdp_sched_cb.sess;
+    int              xx;
+
+    for (xx = 0; xx < BTA_DM_SDP_SCHED_MAX; xx++, p_sess++)
+    {
+        if (p_sess->state != BTA_DM_SDP_SESS_FREE && p_sess->state != BTA_DM_SDP_SESS_DISCARD
+         && !bdcmp(p_sess->bd_addr, bd_addr))
+            return p_sess;
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         bta_dm_sdp_sched_free
+**
+** Description      Free a session and what it still owns
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bta_dm_sdp_sched_free (tBTA_DM_SDP_SESS *p_sess)
+{
+    SDP_FreeDiscoveryDb(p_sess->p_db);
+    p_sess->p_db = NULL;
+    utl_freebuf((void **)&p_sess->p_raw);
+    p_sess->state = BTA_DM_SDP_SESS_FREE;
+}
+
+/*******************************************************************************
+**
+** Function         bta_dm_sdp_sched_discard
+**
+** Description      Give up a session that the search has not taken. A running
+**                  one is cancelled and freed when SDP calls back.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bta_dm_sdp_sched_discard (tBTA_DM_SDP_SESS *p_sess)
+{
+    if (p_sess->state == BTA_DM_SDP_SESS_RUNNING)
+    {
+        /* SDP calls back from within the cancel while the link is set up */
+        p_sess->state = BTA_DM_SDP_SESS_DISCARD;
+        if (SDP_CancelServiceSearch(p_sess->p_db))
+            return;
+    }
+    bta_dm_sdp_sched_free(p_sess);
+}
+
+/*******************************************************************************
+**
+** Function         bta_dm_sdp_sched_hand_over
+**
+** Description      Report the result of a session taken by the search as if
+**                  bta_dm_find_services had run it. The database belongs to
+**                  the search from now on; the raw data goes where the
+**                  search keeps its own.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bta_dm_sdp_sched_hand_over (tBTA_DM_SDP_SESS *p_sess)
+{
+    tSDP_DISCOVERY_DB *p_db = p_sess->p_db;
+    UINT16            sdp_result = p_sess->sdp_result;
+
+    memcpy(g_disc_raw_data_buf, p_sess->p_raw, p_db->raw_used);
+    p_db->raw_data = g_disc_raw_data_buf;
+    p_db->raw_size = MAX_DISC_RAW_DATA_BUF;
+
+    p_sess->p_db = NULL;
+    bta_dm_sdp_sched_free(p_sess);
+
+    bta_dm_sdp_callback(sdp_result);
+}
+
+/*******************************************************************************
+**
+** Function         bta_dm_sdp_sched_cback
+**
+** Description      SDP completion of a session
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bta_dm_sdp_sched_cback (UINT16 sdp_result, void *user_data)
+{
+    tBTA_DM_SDP_SESS *p_sess = (tBTA_DM_SDP_SESS *)user_data;
+
+    APPL_TRACE_DEBUG("%s: %02x:%02x:%02x:%02x:%02x:%02x state %d result 0x%x", __FUNCTION__,
+                     p_sess->bd_addr[0], p_sess->bd_addr[1], p_sess->bd_addr[2],
+                     p_sess->bd_addr[3], p_sess->bd_addr[4], p_sess->bd_addr[5],
+                     p_sess->state, sdp_result);
+
+    p_sess->sdp_result = sdp_result;
+
+    switch (p_sess->state)
+    {
+    case BTA_DM_SDP_SESS_RUNNING:
+        p_sess->state = BTA_DM_SDP_SESS_DONE;
+        break;
+
+    case BTA_DM_SDP_SESS_CLAIMED:
+        bta_dm_sdp_sched_hand_over(p_sess);
+        break;
+
+    default:
+        bta_dm_sdp_sched_free(p_sess);
+        break;
+    }
+
+    /* a link may have become free for the next device */
+    bta_dm_sdp_sched_fill();
+}
+
+/*******************************************************************************
+**
+** Function         bta_dm_sdp_sched_run
+**
+** Description      Start the service search of a device in a free session
+**
+** Returns          TRUE if SDP started
+**
+*******************************************************************************/
+static BOOLEAN bta_dm_sdp_sched_run (tBTA_DM_SDP_SESS *p_sess, BD_ADDR bd_addr, tSDP_UUID *p_uuid)
+{
+    if ((p_sess->p_db = (tSDP_DISCOVERY_DB *)GKI_getbuf(BTA_DM_SDP_DB_SIZE)) == NULL)
+        return FALSE;
+
+    SDP_InitDiscoveryDb(p_sess->p_db, BTA_DM_SDP_DB_SIZE, 1, p_uuid, 0, NULL);
+    p_sess->p_db->grow_size = BTA_DM_SDP_DB_SIZE;
+
+    if ((p_sess->p_raw = (UINT8 *)GKI_getbuf(MAX_DISC_RAW_DATA_BUF)) == NULL)
+    {
+        bta_dm_sdp_sched_free(p_sess);
+        return FALSE;
+    }
+    p_sess->p_db->raw_data = p_sess->p_raw;
+    p_sess->p_db->raw_size = MAX_DISC_RAW_DATA_BUF;
+
+    bdcpy(p_sess->bd_addr, bd_addr);
+    memcpy(&p_sess->uuid, p_uuid, sizeof(tSDP_UUID));
+    p_sess->state = BTA_DM_SDP_SESS_RUNNING;
+
+    if (!SDP_ServiceSearchAttributeRequest2(bd_addr, p_sess->p_db, bta_dm_sdp_sched_cback, p_sess))
+    {
+        bta_dm_sdp_sched_free(p_sess);
+        return FALSE;
+    }
+
+    APPL_TRACE_DEBUG("%s: %02x:%02x:%02x:%02x:%02x:%02x uuid 0x%04x", __FUNCTION__,
+                     bd_addr[0], bd_addr[1], bd_addr[2], bd_addr[3], bd_addr[4], bd_addr[5],
+                     p_uuid->uu.uuid16);
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         bta_dm_sdp_sched_start
+**
+** Description      Start running service searches ahead, once the inquiry of
+**                  a search with services is complete
+**
+** Returns          void
+**
+*******************************************************************************/
+void bta_dm_sdp_sched_start (void)
+{
+    bta_dm_sdp_sched_cb.active = (bta_dm_search_cb.services != 0);
+    bta_dm_sdp_sched_fill();
+}
+
+/*******************************************************************************
+**
+** Function         bta_dm_sdp_sched_fill
+**
+** Description      Start the service search of the devices that follow the
+**                  current one of the search, up to BTA_DM_SDP_SCHED_MAX of
+**                  them and while ACL links are free. One link is kept for
+**                  the device the search works on.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bta_dm_sdp_sched_fill (void)
+{
+    tBTM_INQ_INFO    *p_inq_info = bta_dm_search_cb.p_btm_inq_info;
+    tBTA_DM_SDP_SESS *p_sess;
+    tSDP_UUID        uuid;
+    int              num, xx;
+
+    if (!bta_dm_sdp_sched_cb.active || p_inq_info == NULL)
+        return;
+
+    for (num = 0; num < BTA_DM_SDP_SCHED_MAX && (p_inq_info = BTM_InqDbNext(p_inq_info)) != NULL; num++)
+    {
+        if (bta_dm_sdp_sched_find(p_inq_info->results.remote_bd_addr) != NULL)
+            continue;
+
+        for (xx = 0, p_sess = bta_dm_sdp_sched_cb.sess; xx < BTA_DM_SDP_SCHED_MAX; xx++, p_sess++)
+        {
+            if (p_sess->state == BTA_DM_SDP_SESS_FREE)
+                break;
+        }
+
+        if (xx == BTA_DM_SDP_SCHED_MAX || BTM_GetNumAclLinks() + 1 >= MAX_L2CAP_LINKS)
+            return;
+
+        if (bta_dm_sdp_first_uuid(p_inq_info, &uuid)
+         && !bta_dm_sdp_sched_run(p_sess, p_inq_info->results.remote_bd_addr, &uuid))
+            return;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bta_dm_sdp_sched_take
+**
+** Description      Called by bta_dm_find_services before it starts a service
+**                  search. If a session ran the same search for the device,
+**                  its database replaces bta_dm_search_cb.p_sdp_db and its
+**                  result is reported like that of a search just started.
+**
+** Returns          TRUE if the search was taken from a session
+**
+*******************************************************************************/
+BOOLEAN bta_dm_sdp_sched_take (BD_ADDR bd_addr, tSDP_UUID *p_uuid)
+{
+    tBTA_DM_SDP_SESS *p_sess;
+
+    if ((p_sess = bta_dm_sdp_sched_find(bd_addr)) == NULL)
+        return FALSE;
+
+    if (p_sess->uuid.len != p_uuid->len || memcmp(&p_sess->uuid.uu, &p_uuid->uu, p_uuid->len))
+    {
+        bta_dm_sdp_sched_discard(p_sess);
+        return FALSE;
+    }
+
+    SDP_FreeDiscoveryDb(bta_dm_search_cb.p_sdp_db);
+    bta_dm_search_cb.p_sdp_db = p_sess->p_db;
+
+    /* the link was made for the session, not by the search; it goes down when idle
+    ** and bta_dm_sdp_sched_fill counts it until then */
+    bta_dm_search_cb.wait_disc = FALSE;
+
+    if (p_sess->state == BTA_DM_SDP_SESS_DONE)
+    {
+        bta_dm_sdp_sched_hand_over(p_sess);
+    }
+    else
+    {
+        p_sess->state = BTA_DM_SDP_SESS_CLAIMED;
+    }
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         bta_dm_sdp_sched_drop
+**
+** Description      The search is done with a device; give up its session if
+**                  the search did not take it
+**
+** Returns          void
+**
+*******************************************************************************/
+void bta_dm_sdp_sched_drop (BD_ADDR bd_addr)
+{
+    tBTA_DM_SDP_SESS *p_sess;
+
+    if ((p_sess = bta_dm_sdp_sched_find(bd_addr)) != NULL && p_sess->state != BTA_DM_SDP_SESS_CLAIMED)
+        bta_dm_sdp_sched_discard(p_sess);
+}
+
+/*******************************************************************************
+**
+** Function         bta_dm_sdp_sched_stop
+**
+** Description      The search is complete or cancelled; give up the sessions
+**                  it did not take
+**
+** Returns          void
+**
+*******************************************************************************/
+void bta_dm_sdp_sched_stop (void)
+{
+    tBTA_DM_SDP_SESS *p_sess = bta_dm_sdp_sched_cb.sess;
+    int              xx;
+
+    bta_dm_sdp_sched_cb.active = FALSE;
+
+    for (xx = 0; xx < BTA_DM_SDP_SCHED_MAX; xx++, p_sess++)
+    {
+        if (p_sess->state == BTA_DM_SDP_SESS_RUNNING || p_sess->state == BTA_DM_SDP_SESS_DONE)
+            bta_dm_sdp_sched_discard(p_sess);
+    }
+}
+
+#endif /* BTA_DM_SDP_SCHED_MAX > 0 */
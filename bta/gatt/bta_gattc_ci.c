@@ -73,9 +73,10 @@ void bta_gattc_ci_cache_open(BD_ADDR server_bda, UINT16 evt, tBTA_GATT_STATUS st
 **                  load the servere cache and ready to send it to the stack.
 **
 ** Parameters       server_bda - server BDA of this cache.
-**                  num_bytes_read - number of bytes read into the buffer
-**                      specified in the read callout-function.
-**                  status - BTA_GATT_OK if full buffer of data,
+**                  num_attr - number of attributes in p_attr, at most
+**                      BTA_GATTC_NV_LOAD_BULK_MAX.
+**                  status - BTA_GATT_OK if this is the last of the cache,
+**                           BTA_GATT_MORE if more attributes follow,
 **                           BTA_GATT_FAIL if an error has occurred.
 **
 ** Returns          void
@@ -88,7 +89,13 @@ void bta_gattc_ci_cache_load(BD_ADDR server_bda, UINT16 evt, UINT16 num_attr,
     tBTA_GATTC_CI_LOAD  *p_evt;
     UNUSED(server_bda);
 
-    if ((p_evt = (tBTA_GATTC_CI_LOAD *) GKI_getbuf(sizeof(tBTA_GATTC_CI_LOAD))) != NULL)
+    if (num_attr > BTA_GATTC_NV_LOAD_BULK_MAX)
+        num_attr = BTA_GATTC_NV_LOAD_BULK_MAX;
+    if (p_attr == NULL)
+        num_attr = 0;
+
+    if ((p_evt = (tBTA_GATTC_CI_LOAD *) GKI_getbuf((UINT16)(sizeof(tBTA_GATTC_CI_LOAD) +
+                                   num_attr * sizeof(tBTA_GATTC_NV_ATTR)))) != NULL)
     {
         memset(p_evt, 0, sizeof(tBTA_GATTC_CI_LOAD));
 
@@ -96,11 +103,12 @@ void bta_gattc_ci_cache_load(BD_ADDR server_bda, UINT16 evt, UINT16 num_attr,
         p_evt->hdr.layer_specific = conn_id;
 
         p_evt->status    = status;
-        p_evt->num_attr  = (num_attr > BTA_GATTC_NV_LOAD_MAX) ? BTA_GATTC_NV_LOAD_MAX : num_attr;
+        p_evt->num_attr  = num_attr;
+        p_evt->p_attr    = (tBTA_GATTC_NV_ATTR *)(p_evt + 1);
 
-        if (p_evt->num_attr > 0 && p_attr != NULL)
+        if (num_attr > 0)
         {
-            memcpy(p_evt->attr, p_attr, p_evt->num_attr * sizeof(tBTA_GATTC_NV_ATTR));
+            memcpy(p_evt->p_attr, p_attr, num_attr * sizeof(tBTA_GATTC_NV_ATTR));
         }
 
         bta_sys_sendmsg(p_evt);
@@ -1233,6 +1233,17 @@ static void bta_hh_cback (UINT8 dev_handle, BD_ADDR addr, UINT8 event,
         sm_event = BTA_HH_INT_CLOSE_EVT;
         break;
     case HID_HDEV_EVT_INTR_DATA:
+#if (BTA_HH_INTR_FAST_PATH == TRUE)
+        /* reports of an open device skip the trip through the BTA mailbox;
+           in any other state the state machine drops them anyway. This
+           event may come on the BTU data thread, which only reads kdev. */
+        xx = bta_hh_dev_handle_to_cb_idx(dev_handle);
+        if (xx < BTA_HH_MAX_DEVICE && bta_hh_cb.kdev[xx].state == BTA_HH_CONN_ST
+            && bta_hh_co_intr_data(dev_handle, pdata))
+        {
+            break;
+        }
+#endif
         sm_event = BTA_HH_INT_DATA_EVT;
         break;
     case HID_HDEV_EVT_HANDSHAKE:
@@ -273,6 +273,13 @@ void bta_hl_dch_mca_rcv_data(UINT8 app_idx, UINT8 mcl_idx, UINT8 mdl_idx,
     }
     else
     {
+#if (BTA_HL_STREAM_DATA == TRUE)
+        if (bta_hl_co_put_rx_buf(p_acb->app_id, p_dcb->mdl_handle,
+                                 p_data->mca_rcv_data_evt.p_pkt))
+        {
+            return;
+        }
+#endif
         p_dcb->cout_oper |= BTA_HL_CO_PUT_RX_DATA_MASK;
         p_dcb->p_rx_pkt = p_data->mca_rcv_data_evt.p_pkt;
 
@@ -498,7 +505,20 @@ void bta_hl_dch_send_data(UINT8 app_idx, UINT8 mcl_idx, UINT8 mdl_idx,
     APPL_TRACE_DEBUG("bta_hl_dch_send_data");
 #endif
 
-    if (!(p_dcb->cout_oper & BTA_HL_CO_GET_TX_DATA_MASK))
+    if (p_data->api_send_data.p_pkt != NULL)
+    {
+        /* the APDU is already in place, write it as the call-in would */
+        if (!(p_dcb->cout_oper & BTA_HL_CO_GET_TX_DATA_MASK) && p_dcb->p_tx_pkt == NULL)
+        {
+            p_dcb->p_tx_pkt = p_data->api_send_data.p_pkt;
+            bta_hl_dch_ci_get_tx_data(app_idx, mcl_idx, mdl_idx, p_data);
+            return;
+        }
+
+        utl_freebuf((void **) &p_data->api_send_data.p_pkt);
+        success = FALSE;
+    }
+    else if (!(p_dcb->cout_oper & BTA_HL_CO_GET_TX_DATA_MASK))
     {
         if ((p_dcb->p_tx_pkt = bta_hl_get_buf(p_data->api_send_data.pkt_size)) != NULL)
         {
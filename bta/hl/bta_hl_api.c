@@ -432,11 +432,61 @@ void BTA_HlSendData(tBTA_HL_MDL_HANDLE mdl_handle,
         p_buf->hdr.event        = BTA_HL_API_SEND_DATA_EVT;
         p_buf->mdl_handle       = mdl_handle;
         p_buf->pkt_size         = pkt_size;
+        p_buf->p_pkt            = NULL;
         bta_sys_sendmsg(p_buf);
     }
 
 }
 
+/*******************************************************************************
+**
+** Function         BTA_HlGetTxBuf
+**
+** Description      Allocate a buffer for BTA_HlSendDataBuf, with room ahead
+**                  of the data for the MCAP and L2CAP headers.
+**
+** Parameters       data_size   - largest APDU the buffer has to hold
+**
+** Returns          the buffer, its len set to data_size, or NULL
+**
+*******************************************************************************/
+BT_HDR *BTA_HlGetTxBuf(UINT16 data_size)
+{
+    return bta_hl_get_buf(data_size);
+}
+
+/*******************************************************************************
+**
+** Function         BTA_HlSendDataBuf
+**
+** Description      Send an APDU to the peer device without the
+**                  bta_hl_co_get_tx_data round trip
+**
+** Parameters       mdl_handle  - MDL handle
+**                  p_pkt       - buffer from BTA_HlGetTxBuf holding the APDU
+**
+** Returns          void
+**
+*******************************************************************************/
+void BTA_HlSendDataBuf(tBTA_HL_MDL_HANDLE mdl_handle,
+                       BT_HDR           *p_pkt)
+{
+    tBTA_HL_API_SEND_DATA *p_buf = NULL;
+
+    if ((p_buf = (tBTA_HL_API_SEND_DATA *)GKI_getbuf((UINT16)(sizeof(tBTA_HL_API_SEND_DATA)))) != NULL)
+    {
+        p_buf->hdr.event        = BTA_HL_API_SEND_DATA_EVT;
+        p_buf->mdl_handle       = mdl_handle;
+        p_buf->pkt_size         = p_pkt->len;
+        p_buf->p_pkt            = p_pkt;
+        bta_sys_sendmsg(p_buf);
+    }
+    else
+    {
+        GKI_freebuf(p_pkt);
+    }
+}
+
 /*******************************************************************************
 **
 ** Function         BTA_HlDeleteMdl
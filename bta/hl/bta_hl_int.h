@@ -337,6 +337,7 @@ typedef struct
     BT_HDR              hdr;
     tBTA_HL_MDL_HANDLE  mdl_handle;
     UINT16              pkt_size;
+    BT_HDR              *p_pkt;         /* filled APDU, NULL to get it from the callout */
 } tBTA_HL_API_SEND_DATA;
 
 typedef struct
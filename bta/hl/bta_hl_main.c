@@ -2062,6 +2062,7 @@ BOOLEAN bta_hl_hdl_event(BT_HDR *p_msg)
 #else
                     APPL_TRACE_ERROR("unable to find control block indexes for DCH: [event=%d]", p_msg->event);
 #endif
+                    bta_hl_discard_data(p_msg->event, (tBTA_HL_DATA *) p_msg);
                     success = FALSE;
                 }
             }
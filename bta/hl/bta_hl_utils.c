@@ -2497,6 +2497,7 @@ void bta_hl_discard_data(UINT16 event, tBTA_HL_DATA *p_data)
     switch (event)
     {
         case BTA_HL_API_SEND_DATA_EVT:
+            utl_freebuf((void**)&p_data->api_send_data.p_pkt);
             break;
 
         case BTA_HL_MCA_RCV_DATA_EVT:
@@ -106,6 +106,25 @@ BTA_API extern void bta_dm_co_io_rsp(BD_ADDR bd_addr, tBTA_IO_CAP io_cap,
 *******************************************************************************/
 BTA_API extern void  bta_dm_co_lk_upgrade(BD_ADDR bd_addr, BOOLEAN *p_upgrade );
 
+/*******************************************************************************
+**
+** Function         bta_dm_co_get_link_key
+**
+** Description      This callout function is executed by DM when BTM asks for
+**                  the link key of a device it has no record of, to fetch a
+**                  bond that was not added at startup (BTA_DM_LAZY_LINK_KEYS).
+**
+** Parameters       bd_addr  - The peer device
+**                  link_key - Filled with the stored link key
+**                  *p_key_type - Filled with the link key type
+**                  *p_pin_len - Filled with the PIN length used for bonding
+**
+** Returns          TRUE if the platform has a link key for the device.
+**
+*******************************************************************************/
+BTA_API extern BOOLEAN bta_dm_co_get_link_key(BD_ADDR bd_addr, LINK_KEY link_key,
+                                              UINT8 *p_key_type, UINT8 *p_pin_len);
+
 /*******************************************************************************
 **
 ** Function         bta_dm_co_loc_oob
@@ -45,9 +45,13 @@ typedef struct
     BT_HDR              hdr;
     tBTA_GATT_STATUS    status;
     UINT16              num_attr;
-    tBTA_GATTC_NV_ATTR  attr[BTA_GATTC_NV_LOAD_MAX];
+    tBTA_GATTC_NV_ATTR  *p_attr;    /* num_attr entries, stored right after this struct */
 } tBTA_GATTC_CI_LOAD;
 
+/* Most attributes a single load call-in can carry */
+#define BTA_GATTC_NV_LOAD_BULK_MAX  ((GKI_MAX_BUF_SIZE - sizeof(tBTA_GATTC_CI_LOAD)) / \
+                                     sizeof(tBTA_GATTC_NV_ATTR))
+
 
 /*****************************************************************************
 **  Function Declarations
@@ -82,9 +86,10 @@ BTA_API extern void bta_gattc_ci_cache_open(BD_ADDR server_bda, UINT16 evt,
 **                  load the servere cache and ready to send it to the stack.
 **
 ** Parameters       server_bda - server BDA of this cache.
-**                  num_bytes_read - number of bytes read into the buffer
-**                      specified in the read callout-function.
-**                  status - BTA_GATT_OK if full buffer of data,
+**                  num_attr - number of attributes in p_attr, at most
+**                      BTA_GATTC_NV_LOAD_BULK_MAX.
+**                  status - BTA_GATT_OK if this is the last of the cache,
+**                           BTA_GATT_MORE if more attributes follow,
 **                           BTA_GATT_FAIL if an error has occurred.
 **
 ** Returns          void
@@ -32,6 +32,12 @@
 #define BTA_HH_DEBUG    TRUE
 #endif
 
+/* Input reports of an open device are handed to bta_hh_co_intr_data on BTU
+** instead of going through the BTA task */
+#ifndef BTA_HH_INTR_FAST_PATH
+#define BTA_HH_INTR_FAST_PATH   TRUE
+#endif
+
 #ifndef BTA_HH_SSR_MAX_LATENCY_DEF
 #define BTA_HH_SSR_MAX_LATENCY_DEF  800 /* 500 ms*/
 #endif
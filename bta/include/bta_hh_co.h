@@ -50,6 +50,21 @@ BTA_API extern void bta_hh_co_data(UINT8 dev_handle, UINT8 *p_rpt, UINT16 len,
                                    tBTA_HH_PROTO_MODE  mode, UINT8 sub_class,
                                    UINT8 ctry_code, BD_ADDR peer_addr, UINT8 app_id);
 
+/*******************************************************************************
+**
+** Function         bta_hh_co_intr_data
+**
+** Description      This callout function is executed by HH on BTU, or on
+**                  the BTU data thread, when a report is received in
+**                  interrupt channel of an open device, ahead of the BTA
+**                  task. If it returns TRUE it owns
+**                  p_buf, otherwise the report goes on to bta_hh_co_data.
+**
+** Returns          TRUE if the report was taken.
+**
+*******************************************************************************/
+BTA_API extern BOOLEAN bta_hh_co_intr_data(UINT8 dev_handle, BT_HDR *p_buf);
+
 /*******************************************************************************
 **
 ** Function         bta_hh_co_open
@@ -65,6 +65,12 @@
 
 #define BTA_HL_MCAP_RSP_TOUT            2    /* 2 seconds */
 
+/* Received APDUs are handed to bta_hl_co_put_rx_buf by reference instead
+** of being copied out through bta_hl_co_put_rx_data */
+#ifndef BTA_HL_STREAM_DATA
+#define BTA_HL_STREAM_DATA              TRUE
+#endif
+
 #ifndef BTA_HL_CCH_NUM_FILTER_ELEMS
 #define BTA_HL_CCH_NUM_FILTER_ELEMS     3
 #endif
@@ -818,6 +824,41 @@ extern "C"
     BTA_API extern void BTA_HlSendData(tBTA_HL_MDL_HANDLE mdl_handle,
                                        UINT16           pkt_size);
 
+/*******************************************************************************
+**
+** Function         BTA_HlGetTxBuf
+**
+** Description      Allocate a buffer for BTA_HlSendDataBuf, with room ahead
+**                  of the data for the MCAP and L2CAP headers. The APDU is
+**                  written at BTA_HL_TX_BUF_PTR.
+**
+** Parameters       data_size   - largest APDU the buffer has to hold
+**
+** Returns          the buffer, its len set to data_size, or NULL
+**
+*******************************************************************************/
+    BTA_API extern BT_HDR *BTA_HlGetTxBuf(UINT16 data_size);
+
+#define BTA_HL_TX_BUF_PTR(p_buf)    ((UINT8 *)((p_buf) + 1) + (p_buf)->offset)
+
+/*******************************************************************************
+**
+** Function         BTA_HlSendDataBuf
+**
+** Description      Send an APDU to the peer device without the
+**                  bta_hl_co_get_tx_data round trip. The result is reported
+**                  with BTA_HL_DCH_SEND_DATA_CFM_EVT as for BTA_HlSendData.
+**
+** Parameters       mdl_handle  - MDL handle
+**                  p_pkt       - buffer from BTA_HlGetTxBuf, len set to the
+**                                APDU size. BTA owns it from now on.
+**
+** Returns          void
+**
+*******************************************************************************/
+    BTA_API extern void BTA_HlSendDataBuf(tBTA_HL_MDL_HANDLE mdl_handle,
+                                          BT_HDR           *p_pkt);
+
 /*******************************************************************************
 **
 ** Function         BTA_HlDeleteMdl
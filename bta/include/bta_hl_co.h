@@ -193,6 +193,26 @@ BTA_API extern void bta_hl_co_get_tx_data (UINT8 app_id, tBTA_HL_MDL_HANDLE mdl_
 *******************************************************************************/
 BTA_API extern void bta_hl_co_put_rx_data (UINT8 app_id, tBTA_HL_MDL_HANDLE mdl_handle,
                                            UINT16 data_size, UINT8 *p_data, UINT16 evt);
+
+/*******************************************************************************
+**
+** Function        bta_hl_co_put_rx_buf
+**
+** Description     Hand over a received APDU by reference. Used instead of
+**                 bta_hl_co_put_rx_data when BTA_HL_STREAM_DATA is TRUE.
+**                 No call-in and no BTA_HL_DCH_RCV_DATA_IND_EVT follow an
+**                 APDU that was taken.
+**
+** Parameters      app_id - HDP application ID
+**                 mdl_handle - MDL handle
+**                 p_buf - the APDU, from offset for len bytes
+**
+** Returns        TRUE if the callout owns p_buf, FALSE to fall back to
+**                bta_hl_co_put_rx_data
+**
+*******************************************************************************/
+BTA_API extern BOOLEAN bta_hl_co_put_rx_buf (UINT8 app_id, tBTA_HL_MDL_HANDLE mdl_handle,
+                                             BT_HDR *p_buf);
 /*******************************************************************************
 **
 ** Function         bta_hl_co_get_tx_data
@@ -48,6 +48,7 @@
 BTA_API extern int bta_co_rfc_data_incoming(void *user_data, BT_HDR *p_buf);
 BTA_API extern int bta_co_rfc_data_outgoing_size(void *user_data, int *size);
 BTA_API extern int bta_co_rfc_data_outgoing(void *user_data, UINT8* buf, UINT16 size);
+BTA_API extern int bta_co_rfc_data_outgoing_vec(void *user_data, BT_HDR **pp_buf, UINT16 count);
 
 #if (defined(OBX_OVER_L2CAP_INCLUDED) && OBX_OVER_L2CAP_INCLUDED == TRUE)
 BTA_API extern btsock_type_t bta_co_get_sock_type_by_id(uint32_t slot_id);
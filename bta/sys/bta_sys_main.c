@@ -46,6 +46,9 @@
 #include "bta_ar_api.h"
 #endif
 #include "utl.h"
+#if (BTA_SYS_METRICS == TRUE)
+#include "bta_sys_metrics.h"
+#endif
 
 /* protocol timer update period, in milliseconds */
 #ifndef BTA_SYS_TIMER_PERIOD
@@ -174,6 +177,9 @@ const tBTA_SYS_ST_TBL bta_sys_st_tbl[] = {
 BTA_API void bta_sys_init(void)
 {
     memset(&bta_sys_cb, 0, sizeof(tBTA_SYS_CB));
+#if (BTA_SYS_METRICS == TRUE)
+    bta_sys_metrics_init();
+#endif
     ptim_init(&bta_sys_cb.ptim_cb, BTA_SYS_TIMER_PERIOD, p_bta_sys_cfg->timer);
     bta_sys_cb.task_id = GKI_get_taskid();
     appl_trace_level = p_bta_sys_cfg->trace_level;
@@ -500,6 +506,20 @@ BTA_API void bta_sys_event(BT_HDR *p_msg)
 {
     UINT8       id;
     BOOLEAN     freebuf = TRUE;
+#if (BTA_SYS_METRICS == TRUE)
+    /* the handler may free or forward the message */
+    UINT16      event = p_msg->event;
+    UINT32      start = bta_sys_metrics_now();
+    UINT32      wait = 0;
+    BOOLEAN     registered = FALSE;
+#if (GKI_BUF_STAMP == TRUE)
+    /* 0 if the buffer is not from a GKI pool and has no stamp */
+    UINT32      sent = GKI_get_buf_stamp(p_msg);
+
+    if (sent != 0)
+        wait = start - sent;
+#endif
+#endif
 
     APPL_TRACE_EVENT("BTA got event 0x%x", p_msg->event);
 
@@ -510,6 +530,9 @@ BTA_API void bta_sys_event(BT_HDR *p_msg)
     if ((id < BTA_ID_MAX) && (bta_sys_cb.reg[id] != NULL))
     {
         freebuf = (*bta_sys_cb.reg[id]->evt_hdlr)(p_msg);
+#if (BTA_SYS_METRICS == TRUE)
+        registered = TRUE;
+#endif
     }
     else
     {
@@ -521,6 +544,10 @@ BTA_API void bta_sys_event(BT_HDR *p_msg)
         GKI_freebuf(p_msg);
     }
 
+#if (BTA_SYS_METRICS == TRUE)
+    bta_sys_metrics_count(event, registered, wait, bta_sys_metrics_now() - start);
+#endif
+
 }
 
 /*******************************************************************************
@@ -603,6 +630,9 @@ BOOLEAN bta_sys_is_register(UINT8 id)
 *******************************************************************************/
 void bta_sys_sendmsg(void *p_msg)
 {
+#if (BTA_SYS_METRICS == TRUE) && (GKI_BUF_STAMP == TRUE)
+    GKI_set_buf_stamp(p_msg, bta_sys_metrics_now());
+#endif
     GKI_send_msg(bta_sys_cb.task_id, p_bta_sys_cfg->mbox, p_msg);
 }
 
@@ -0,0 +1,316 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Event dispatch metrics of the BTA system manager. The BTU thread is the
+ *  only writer; readers copy the metrics under a sequence counter and retry
+ *  when an update ran concurrently, so the writer never waits.
+ *
+ ******************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bt_target.h"
+#include "gki.h"
+#include "bta_sys.h"
+#include "bta_sys_metrics.h"
+
+/* Copies a snapshot attempts before it settles for one that raced with an
+** update. Each update is a few stores, so this is not expected to hit. */
+#ifndef BTA_SYS_METRICS_SNAP_TRIES
+#define BTA_SYS_METRICS_SNAP_TRIES  16
+#endif
+
+#if (BTA_ID_MAX > BTA_SYS_METRICS_IDS)
+#error "BTA_SYS_METRICS_IDS is smaller than BTA_ID_MAX"
+#endif
+
+static tBTA_SYS_METRICS bta_sys_metrics;
+static UINT32           bta_sys_metrics_seq;        /* odd while an update runs */
+static UINT64           bta_sys_metrics_start_us;
+
+/*******************************************************************************
+**
+** Function         bta_sys_metrics_now_us
+**
+** Description      Monotonic time of the metrics
+**
+** Returns          microseconds
+**
+*******************************************************************************/
+static UINT64 bta_sys_metrics_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UINT64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*******************************************************************************
+**
+** Function         bta_sys_metrics_now
+**
+** Description      Time for the message stamps. Differences of two values
+**                  are correct across the 32 bit wrap.
+**
+** Returns          microseconds, truncated to 32 bits
+**
+*******************************************************************************/
+UINT32 bta_sys_metrics_now(void)
+{
+    return (UINT32)bta_sys_metrics_now_us();
+}
+
+/*******************************************************************************
+**
+** Function         bta_sys_metrics_init
+**
+** Description      Clear the metrics.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bta_sys_metrics_init(void)
+{
+    UINT32 seq = bta_sys_metrics_seq + 1;
+
+    __atomic_store_n(&bta_sys_metrics_seq, seq, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memset(&bta_sys_metrics, 0, sizeof(bta_sys_metrics));
+    bta_sys_metrics_start_us = bta_sys_metrics_now_us();
+
+    __atomic_store_n(&bta_sys_metrics_seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+/*******************************************************************************
+**
+** Function         bta_sys_metrics_bucket
+**
+** Description      Histogram bucket of a duration. Bucket 0 holds everything
+**                  below BTA_SYS_METRICS_MIN_US, each following bucket
+**                  doubles, the last one is open ended.
+**
+** Returns          bucket index
+**
+*******************************************************************************/
+static UINT8 bta_sys_metrics_bucket(UINT32 us)
+{
+    UINT32 b;
+
+    if (us < BTA_SYS_METRICS_MIN_US)
+        return 0;
+
+    /* 16 to 31 us is bucket 1 */
+    b = (31 - __builtin_clz(us)) - 3;
+    return (UINT8)((b < BTA_SYS_METRICS_BUCKETS) ? b : BTA_SYS_METRICS_BUCKETS - 1);
+}
+
+/*******************************************************************************
+**
+** Function         bta_sys_metrics_find_evt
+**
+** Description      Find the slot of an event code, taking a free one for a
+**                  code seen for the first time.
+**
+** Returns          the slot, NULL if the table is full
+**
+*******************************************************************************/
+static tBTA_SYS_METRICS_EVT *bta_sys_metrics_find_evt(UINT16 event)
+{
+    tBTA_SYS_METRICS_EVT *p_evt;
+    UINT32               idx = ((UINT32)event * 2654435761u) >> 16;
+    UINT32               i;
+
+    for (i = 0; i < BTA_SYS_METRICS_EVTS; i++, idx++)
+    {
+        p_evt = &bta_sys_metrics.evt[idx & (BTA_SYS_METRICS_EVTS - 1)];
+
+        if (p_evt->count == 0)
+        {
+            p_evt->event = event;
+            return p_evt;
+        }
+        if (p_evt->event == event)
+            return p_evt;
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         bta_sys_metrics_count
+**
+** Description      Account one message dispatched by bta_sys_event.
+**
+** Parameters       event       - the message event code
+**                  registered  - a subsystem handled the message
+**                  wait_us     - time from bta_sys_sendmsg to dispatch
+**                  hdlr_us     - time the subsystem handler ran
+**
+** Returns          void
+**
+*******************************************************************************/
+void bta_sys_metrics_count(UINT16 event, BOOLEAN registered,
+                           UINT32 wait_us, UINT32 hdlr_us)
+{
+    tBTA_SYS_METRICS_ID  *p_id;
+    tBTA_SYS_METRICS_EVT *p_evt;
+    UINT8                id = (UINT8)(event >> 8);
+    UINT32               seq = bta_sys_metrics_seq + 1;
+
+    __atomic_store_n(&bta_sys_metrics_seq, seq, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if (!registered || id >= BTA_SYS_METRICS_IDS)
+    {
+        bta_sys_metrics.unregistered++;
+    }
+    else
+    {
+        p_id = &bta_sys_metrics.id[id];
+        p_id->count++;
+        p_id->wait_sum_us += wait_us;
+        p_id->hdlr_sum_us += hdlr_us;
+        if (wait_us > p_id->wait_max_us)
+            p_id->wait_max_us = wait_us;
+        if (hdlr_us > p_id->hdlr_max_us)
+            p_id->hdlr_max_us = hdlr_us;
+        p_id->wait_hist[bta_sys_metrics_bucket(wait_us)]++;
+        p_id->hdlr_hist[bta_sys_metrics_bucket(hdlr_us)]++;
+
+        if ((p_evt = bta_sys_metrics_find_evt(event)) != NULL)
+        {
+            p_evt->count++;
+            p_evt->wait_sum_us += wait_us;
+            p_evt->hdlr_sum_us += hdlr_us;
+            if (wait_us > p_evt->wait_max_us)
+                p_evt->wait_max_us = wait_us;
+            if (hdlr_us > p_evt->hdlr_max_us)
+                p_evt->hdlr_max_us = hdlr_us;
+        }
+        else
+        {
+            bta_sys_metrics.evt_overflow++;
+        }
+    }
+
+    __atomic_store_n(&bta_sys_metrics_seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+/*******************************************************************************
+**
+** Function         bta_sys_metrics_snapshot
+**
+** Description      Copy the metrics, from any thread.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bta_sys_metrics_snapshot(tBTA_SYS_METRICS *p_snap)
+{
+    UINT32 seq;
+    int    tries;
+
+    for (tries = 1; ; tries++)
+    {
+        seq = __atomic_load_n(&bta_sys_metrics_seq, __ATOMIC_ACQUIRE);
+        memcpy(p_snap, &bta_sys_metrics, sizeof(tBTA_SYS_METRICS));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if ((!(seq & 1) && __atomic_load_n(&bta_sys_metrics_seq, __ATOMIC_RELAXED) == seq)
+            || tries == BTA_SYS_METRICS_SNAP_TRIES)
+            break;
+    }
+
+    p_snap->magic       = BTA_SYS_METRICS_MAGIC;
+    p_snap->version     = BTA_SYS_METRICS_VERSION;
+    p_snap->num_ids     = BTA_SYS_METRICS_IDS;
+    p_snap->num_evts    = BTA_SYS_METRICS_EVTS;
+    p_snap->num_buckets = BTA_SYS_METRICS_BUCKETS;
+    p_snap->elapsed_us  = bta_sys_metrics_now_us() - bta_sys_metrics_start_us;
+}
+
+/*******************************************************************************
+**
+** Function         bta_sys_metrics_dump
+**
+** Description      Write a snapshot of the metrics as text.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bta_sys_metrics_dump(int fd)
+{
+    tBTA_SYS_METRICS *p_snap;
+
+    if ((p_snap = (tBTA_SYS_METRICS *)GKI_os_malloc(sizeof(tBTA_SYS_METRICS))) == NULL)
+        return;
+
+    bta_sys_metrics_snapshot(p_snap);
+    bta_sys_metrics_print(fd, p_snap);
+    GKI_os_free(p_snap);
+}
+
+/*******************************************************************************
+**
+** Function         bta_sys_metrics_save
+**
+** Description      Write a snapshot of the metrics to a file in the binary
+**                  format. The file is replaced only once the new one is
+**                  complete.
+**
+** Returns          TRUE if the file was written
+**
+*******************************************************************************/
+BOOLEAN bta_sys_metrics_save(const char *p_path)
+{
+    tBTA_SYS_METRICS *p_snap;
+    char             tmp_path[256];
+    BOOLEAN          ok = FALSE;
+    int              fd;
+
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", p_path) >= (int)sizeof(tmp_path))
+        return FALSE;
+
+    if ((p_snap = (tBTA_SYS_METRICS *)GKI_os_malloc(sizeof(tBTA_SYS_METRICS))) == NULL)
+        return FALSE;
+
+    bta_sys_metrics_snapshot(p_snap);
+
+    if ((fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0660)) >= 0)
+    {
+        ok = (write(fd, p_snap, sizeof(tBTA_SYS_METRICS)) == (ssize_t)sizeof(tBTA_SYS_METRICS));
+        ok = (close(fd) == 0) && ok;
+        ok = ok && (rename(tmp_path, p_path) == 0);
+        if (!ok)
+            unlink(tmp_path);
+    }
+
+    if (!ok)
+        APPL_TRACE_ERROR("%s: unable to write %s: %s", __FUNCTION__, p_path, strerror(errno));
+
+    GKI_os_free(p_snap);
+    return ok;
+}
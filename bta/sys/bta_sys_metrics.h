@@ -0,0 +1,139 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Event dispatch metrics of the BTA system manager.
+ *
+ *  bta_sys_sendmsg stamps each message with the time it was sent and
+ *  bta_sys_event times the subsystem handler. For every subsystem the
+ *  metrics count the messages and keep histograms of the time they waited
+ *  in the BTU mailbox and of the time their handler ran. Every event code
+ *  also gets its own count, sums and maxima.
+ *
+ *  Only the BTU thread updates the metrics. Any thread may take a snapshot.
+ *  A snapshot is a plain structure that is also the format of the binary
+ *  export; test/bta_metrics/bta_metrics_print prints one on the host.
+ *
+ ******************************************************************************/
+#ifndef BTA_SYS_METRICS_H
+#define BTA_SYS_METRICS_H
+
+#include "data_types.h"
+
+/*****************************************************************************
+**  Constants
+*****************************************************************************/
+
+#define BTA_SYS_METRICS_MAGIC       0x4d415442      /* "BTAM" */
+#define BTA_SYS_METRICS_VERSION     1
+
+/* Subsystem slots, at least BTA_ID_MAX */
+#define BTA_SYS_METRICS_IDS         48
+
+/* Event codes with their own counters. Further codes are only counted
+** with their subsystem. */
+#define BTA_SYS_METRICS_EVTS        256
+
+/* Histogram buckets: <16us, <32us, ... <16ms, then everything longer */
+#define BTA_SYS_METRICS_BUCKETS     12
+#define BTA_SYS_METRICS_MIN_US      16
+
+/*****************************************************************************
+**  Data types
+**
+**  The layout is the export format. Every 64 bit field is 8 byte aligned
+**  so 32 and 64 bit builds agree.
+*****************************************************************************/
+
+/* One subsystem */
+typedef struct
+{
+    UINT32  count;
+    UINT32  wait_max_us;
+    UINT32  hdlr_max_us;
+    UINT32  reserved;
+    UINT64  wait_sum_us;                            /* in the BTU mailbox */
+    UINT64  hdlr_sum_us;                            /* in the event handler */
+    UINT32  wait_hist[BTA_SYS_METRICS_BUCKETS];
+    UINT32  hdlr_hist[BTA_SYS_METRICS_BUCKETS];
+} tBTA_SYS_METRICS_ID;
+
+/* One event code, unused while count is 0 */
+typedef struct
+{
+    UINT16  event;
+    UINT16  reserved;
+    UINT32  count;
+    UINT32  wait_max_us;
+    UINT32  hdlr_max_us;
+    UINT64  wait_sum_us;
+    UINT64  hdlr_sum_us;
+} tBTA_SYS_METRICS_EVT;
+
+typedef struct
+{
+    UINT32  magic;                                  /* BTA_SYS_METRICS_MAGIC */
+    UINT16  version;                                /* BTA_SYS_METRICS_VERSION */
+    UINT16  num_ids;
+    UINT16  num_evts;
+    UINT16  num_buckets;
+    UINT32  unregistered;                           /* messages for no subsystem */
+    UINT32  evt_overflow;                           /* messages of codes with no slot */
+    UINT32  reserved;
+    UINT64  elapsed_us;                             /* since the metrics started */
+    tBTA_SYS_METRICS_ID     id[BTA_SYS_METRICS_IDS];
+    tBTA_SYS_METRICS_EVT    evt[BTA_SYS_METRICS_EVTS];
+} tBTA_SYS_METRICS;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*****************************************************************************
+**  Function declarations
+*****************************************************************************/
+
+/* Clear the metrics. BTU thread, from bta_sys_init. */
+extern void bta_sys_metrics_init(void);
+
+/* Monotonic time in microseconds, truncated to 32 bits */
+extern UINT32 bta_sys_metrics_now(void);
+
+/* Account one dispatched message. BTU thread. */
+extern void bta_sys_metrics_count(UINT16 event, BOOLEAN registered,
+                                  UINT32 wait_us, UINT32 hdlr_us);
+
+/* Copy the metrics. Any thread. */
+extern void bta_sys_metrics_snapshot(tBTA_SYS_METRICS *p_snap);
+
+/* Write a snapshot as text to fd, e.g. the descriptor of a dump request */
+extern void bta_sys_metrics_dump(int fd);
+
+/* Write a snapshot in the binary format to a file */
+extern BOOLEAN bta_sys_metrics_save(const char *p_path);
+
+/* Format a snapshot as text. Has no stack dependencies. */
+extern void bta_sys_metrics_print(int fd, const tBTA_SYS_METRICS *p_snap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BTA_SYS_METRICS_H */
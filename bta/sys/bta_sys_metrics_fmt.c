@@ -0,0 +1,157 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Text output of the BTA dispatch metrics. This file has no stack
+ *  dependencies: bta_metrics_print builds it on the host.
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bta_sys_metrics.h"
+
+/*******************************************************************************
+**
+** Function         bta_sys_metrics_mean
+**
+** Description      Mean of a sum over count values
+**
+** Returns          the mean, 0 for no values
+**
+*******************************************************************************/
+static unsigned bta_sys_metrics_mean(UINT64 sum, UINT32 count)
+{
+    return count ? (unsigned)(sum / count) : 0;
+}
+
+/*******************************************************************************
+**
+** Function         bta_sys_metrics_hist
+**
+** Description      Print one histogram on a line
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bta_sys_metrics_hist(int fd, const char *p_name, const UINT32 *p_hist)
+{
+    int i;
+
+    dprintf(fd, "      %-7s", p_name);
+    for (i = 0; i < BTA_SYS_METRICS_BUCKETS; i++)
+        dprintf(fd, " %7u", p_hist[i]);
+    dprintf(fd, "\n");
+}
+
+/*******************************************************************************
+**
+** Function         bta_sys_metrics_cmp_evt
+**
+** Description      qsort order of event slots: most handler time first
+**
+*******************************************************************************/
+static int bta_sys_metrics_cmp_evt(const void *p_a, const void *p_b)
+{
+    const tBTA_SYS_METRICS_EVT *a = *(const tBTA_SYS_METRICS_EVT * const *)p_a;
+    const tBTA_SYS_METRICS_EVT *b = *(const tBTA_SYS_METRICS_EVT * const *)p_b;
+
+    if (a->hdlr_sum_us != b->hdlr_sum_us)
+        return (a->hdlr_sum_us > b->hdlr_sum_us) ? -1 : 1;
+    return (int)a->event - (int)b->event;
+}
+
+/*******************************************************************************
+**
+** Function         bta_sys_metrics_print
+**
+** Description      Format a snapshot as text: one block per subsystem with
+**                  its histograms, then every event code that was seen,
+**                  the ones that kept the BTU thread busiest first.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bta_sys_metrics_print(int fd, const tBTA_SYS_METRICS *p_snap)
+{
+    const tBTA_SYS_METRICS_ID  *p_id;
+    const tBTA_SYS_METRICS_EVT *p_evts[BTA_SYS_METRICS_EVTS];
+    const tBTA_SYS_METRICS_EVT *p_evt;
+    unsigned                   lim_us;
+    int                        i, num = 0;
+
+    if (p_snap->magic != BTA_SYS_METRICS_MAGIC || p_snap->version != BTA_SYS_METRICS_VERSION
+        || p_snap->num_ids != BTA_SYS_METRICS_IDS || p_snap->num_evts != BTA_SYS_METRICS_EVTS
+        || p_snap->num_buckets != BTA_SYS_METRICS_BUCKETS)
+    {
+        dprintf(fd, "BTA dispatch metrics: unknown format\n");
+        return;
+    }
+
+    dprintf(fd, "BTA dispatch metrics over %u.%03u s: %u unregistered, %u events without a slot\n",
+            (unsigned)(p_snap->elapsed_us / 1000000), (unsigned)(p_snap->elapsed_us / 1000 % 1000),
+            p_snap->unregistered, p_snap->evt_overflow);
+
+    dprintf(fd, "  id    count  wait mean    max  handler mean      max  handler total ms\n");
+    for (i = 0; i < BTA_SYS_METRICS_IDS; i++)
+    {
+        p_id = &p_snap->id[i];
+        if (p_id->count == 0)
+            continue;
+
+        dprintf(fd, "  %2d %8u  %9u %6u  %12u %8u  %16u\n", i, p_id->count,
+                bta_sys_metrics_mean(p_id->wait_sum_us, p_id->count), p_id->wait_max_us,
+                bta_sys_metrics_mean(p_id->hdlr_sum_us, p_id->count), p_id->hdlr_max_us,
+                (unsigned)(p_id->hdlr_sum_us / 1000));
+    }
+
+    dprintf(fd, "  histograms, us  ");
+    for (i = 1, lim_us = BTA_SYS_METRICS_MIN_US; i < BTA_SYS_METRICS_BUCKETS; i++, lim_us *= 2)
+        dprintf(fd, " <%6u", lim_us);
+    dprintf(fd, "    more\n");
+
+    for (i = 0; i < BTA_SYS_METRICS_IDS; i++)
+    {
+        p_id = &p_snap->id[i];
+        if (p_id->count == 0)
+            continue;
+
+        dprintf(fd, "  %2d\n", i);
+        bta_sys_metrics_hist(fd, "wait", p_id->wait_hist);
+        bta_sys_metrics_hist(fd, "handler", p_id->hdlr_hist);
+    }
+
+    for (i = 0; i < BTA_SYS_METRICS_EVTS; i++)
+    {
+        if (p_snap->evt[i].count)
+            p_evts[num++] = &p_snap->evt[i];
+    }
+    qsort(p_evts, num, sizeof(p_evts[0]), bta_sys_metrics_cmp_evt);
+
+    dprintf(fd, "  event     count  wait mean    max  handler mean      max  handler total ms\n");
+    for (i = 0; i < num; i++)
+    {
+        p_evt = p_evts[i];
+        dprintf(fd, "  0x%04x %8u  %9u %6u  %12u %8u  %16u\n", p_evt->event, p_evt->count,
+                bta_sys_metrics_mean(p_evt->wait_sum_us, p_evt->count), p_evt->wait_max_us,
+                bta_sys_metrics_mean(p_evt->hdlr_sum_us, p_evt->count), p_evt->hdlr_max_us,
+                (unsigned)(p_evt->hdlr_sum_us / 1000));
+    }
+}
@@ -17,12 +17,20 @@
  ******************************************************************************/
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "bta_api.h"
 #include "bta_sys.h"
 #include "bta_dm_co.h"
 #include "bta_dm_ci.h"
 #include "bt_utils.h"
+#include "bd.h"
+#include <hardware/bluetooth.h>
+#include "btif_storage.h"
+#if (BTM_SCO_HCI_INCLUDED == TRUE) && (BTM_WBS_INCLUDED == TRUE)
+#include "hcimsgs.h"
+#include "btif_msbc.h"
+#endif
 #if (BTM_OOB_INCLUDED == TRUE)
 #include "btif_dm.h"
 #endif
@@ -135,6 +143,32 @@ void  bta_dm_co_lk_upgrade(BD_ADDR bd_addr, BOOLEAN *p_upgrade )
     UNUSED(p_upgrade);
 }
 
+/*******************************************************************************
+**
+** Function         bta_dm_co_get_link_key
+**
+** Description      This callout function is executed by DM when BTM asks for
+**                  the link key of a device it has no record of, to fetch a
+**                  bond that was not added at startup (BTA_DM_LAZY_LINK_KEYS).
+**
+** Parameters       bd_addr  - The peer device
+**                  link_key - Filled with the stored link key
+**                  *p_key_type - Filled with the link key type
+**                  *p_pin_len - Filled with the PIN length used for bonding
+**
+** Returns          TRUE if the platform has a link key for the device.
+**
+*******************************************************************************/
+BOOLEAN bta_dm_co_get_link_key(BD_ADDR bd_addr, LINK_KEY link_key,
+                               UINT8 *p_key_type, UINT8 *p_pin_len)
+{
+    bt_bdaddr_t remote_bd_addr;
+
+    bdcpy(remote_bd_addr.address, bd_addr);
+    return btif_storage_get_link_key(&remote_bd_addr, link_key, p_key_type, p_pin_len)
+                == BT_STATUS_SUCCESS;
+}
+
 #if (BTM_OOB_INCLUDED == TRUE)
 /*******************************************************************************
 **
@@ -192,6 +226,192 @@ void bta_dm_co_rmt_oob(BD_ADDR bd_addr)
 
 #if (BTM_SCO_HCI_INCLUDED == TRUE ) && (BTM_SCO_INCLUDED == TRUE)
 
+#if (BTM_WBS_INCLUDED == TRUE)
+/* mSBC on a wideband SCO link routed over HCI. The btui codec still moves
+** 16 kHz PCM, mSBC sits between it and the SCO packets. Everything runs on
+** the BTU thread.
+**
+** This is only the integration point. The btui codec and btui_cfg/btui_cb
+** are not part of this tree, so nothing under BTM_SCO_HCI_INCLUDED builds
+** and btif_msbc is not reachable from the stack until the SCO call-outs
+** get a real PCM source and sink. */
+typedef struct
+{
+    BOOLEAN     active;         /* mSBC negotiated for the SCO link */
+    UINT8       pkt_size;       /* payload of the SCO packets sent */
+    UINT16      hci_handle;     /* from the last SCO packet received */
+    BUFFER_Q    pcm_q;          /* microphone PCM from the btui codec */
+    UINT16      pcm_pos;        /* bytes of the first PCM buffer encoded */
+    UINT16      pcm_frac;       /* samples queued short of a whole frame */
+    UINT16      tx_credit;      /* mSBC bytes the queued frames encode to */
+} tBTA_DM_CO_MSBC;
+
+static tBTA_DM_CO_MSBC bta_dm_co_msbc;
+
+/*******************************************************************************
+**
+** Function         bta_dm_sco_co_msbc_pcm
+**
+** Description      mSBC TX audio source: microphone PCM queued by
+**                  bta_dm_sco_co_out_data.
+**
+** Returns          number of samples provided
+**
+*******************************************************************************/
+static UINT16 bta_dm_sco_co_msbc_pcm(INT16 *p_pcm, UINT16 num)
+{
+    tBTA_DM_CO_MSBC *p_cb = &bta_dm_co_msbc;
+    BT_HDR          *p_buf;
+    UINT16          got = 0, n;
+
+    while ((got < num) && ((p_buf = (BT_HDR *)GKI_getfirst(&p_cb->pcm_q)) != NULL))
+    {
+        n = (p_buf->len - p_cb->pcm_pos) / sizeof(INT16);
+        if (n > num - got)
+            n = num - got;
+
+        memcpy(p_pcm + got, (UINT8 *)(p_buf + 1) + p_buf->offset + p_cb->pcm_pos,
+               n * sizeof(INT16));
+        got += n;
+        p_cb->pcm_pos += n * sizeof(INT16);
+
+        /* an odd last byte is dropped, as it is when the samples are counted */
+        if (p_cb->pcm_pos + sizeof(INT16) > p_buf->len)
+        {
+            GKI_freebuf(GKI_dequeue(&p_cb->pcm_q));
+            p_cb->pcm_pos = 0;
+        }
+    }
+
+    return got;
+}
+
+/*******************************************************************************
+**
+** Function         bta_dm_sco_co_msbc_play
+**
+** Description      Decode the next mSBC frame from the jitter buffer and give
+**                  it to the btui codec, laid out like a received SCO packet.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bta_dm_sco_co_msbc_play(void)
+{
+    tBTA_DM_CO_MSBC *p_cb = &bta_dm_co_msbc;
+    INT16           pcm[BTIF_MSBC_SAMPLES];
+    BT_HDR          *p_buf;
+    UINT8           *p;
+
+    btif_msbc_decode(pcm);
+
+    if ((p_buf = (BT_HDR *)GKI_getpoolbuf(HCI_SCO_POOL_ID)) == NULL)
+    {
+        BTIF_TRACE_WARNING("bta_dm_sco_co_msbc_play no buffer");
+        return;
+    }
+
+    p_buf->offset = 0;
+    p_buf->len = HCI_SCO_PREAMBLE_SIZE + sizeof(pcm);
+    p_buf->layer_specific = 0;
+
+    p = (UINT8 *)(p_buf + 1);
+    UINT16_TO_STREAM(p, p_cb->hci_handle);
+    UINT8_TO_STREAM(p, sizeof(pcm));
+    memcpy(p, pcm, sizeof(pcm));
+
+    btui_sco_codec_inqdata(p_buf);
+}
+
+/*******************************************************************************
+**
+** Function         bta_dm_sco_co_msbc_out_data
+**
+** Description      Queue the microphone PCM the btui codec has ready and cut
+**                  the mSBC stream it encodes to into SCO packets. A packet
+**                  is only sent once the PCM of every frame it carries is
+**                  queued, so the stream follows the audio clock. That clock
+**                  also paces playout: one frame is decoded for every frame
+**                  of PCM queued.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bta_dm_sco_co_msbc_out_data(BT_HDR **p_buf)
+{
+    tBTA_DM_CO_MSBC *p_cb = &bta_dm_co_msbc;
+    BT_HDR          *p_pcm;
+
+    *p_buf = NULL;
+
+    btui_sco_codec_readbuf(&p_pcm);
+    while (p_pcm != NULL)
+    {
+        p_cb->pcm_frac += p_pcm->len / sizeof(INT16);
+        GKI_enqueue(&p_cb->pcm_q, p_pcm);
+
+        while (p_cb->pcm_frac >= BTIF_MSBC_SAMPLES)
+        {
+            p_cb->pcm_frac -= BTIF_MSBC_SAMPLES;
+            p_cb->tx_credit += BTIF_MSBC_PKT_LEN;
+
+            if (btui_cfg.sco_use_mic)
+                bta_dm_sco_co_msbc_play();
+        }
+
+        btui_sco_codec_readbuf(&p_pcm);
+    }
+
+    if ((p_cb->pkt_size == 0) || (p_cb->tx_credit < p_cb->pkt_size))
+        return;
+
+    if ((*p_buf = (BT_HDR *)GKI_getpoolbuf(HCI_SCO_POOL_ID)) == NULL)
+    {
+        BTIF_TRACE_WARNING("bta_dm_sco_co_msbc_out_data no buffer");
+        return;
+    }
+
+    (*p_buf)->offset = HCI_SCO_PREAMBLE_SIZE;
+    (*p_buf)->len = p_cb->pkt_size;
+    (*p_buf)->layer_specific = 0;
+    btif_msbc_tx_read((UINT8 *)(*p_buf + 1) + (*p_buf)->offset, p_cb->pkt_size);
+    p_cb->tx_credit -= p_cb->pkt_size;
+}
+
+/*******************************************************************************
+**
+** Function         bta_dm_sco_co_msbc_in_data
+**
+** Description      Queue the payload of a received SCO packet in the mSBC
+**                  jitter buffer. Data the controller flagged is queued as
+**                  bad so the frame it belongs to is concealed.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bta_dm_sco_co_msbc_in_data(BT_HDR *p_buf, tBTM_SCO_DATA_FLAG status)
+{
+    tBTA_DM_CO_MSBC *p_cb = &bta_dm_co_msbc;
+    UINT8           *p = (UINT8 *)(p_buf + 1) + p_buf->offset;
+    UINT16          handle;
+    UINT8           len;
+
+    if (p_buf->len >= HCI_SCO_PREAMBLE_SIZE)
+    {
+        STREAM_TO_UINT16(handle, p);
+        STREAM_TO_UINT8(len, p);
+        p_cb->hci_handle = HCID_GET_HANDLE(handle);
+
+        if (len > p_buf->len - HCI_SCO_PREAMBLE_SIZE)
+            len = p_buf->len - HCI_SCO_PREAMBLE_SIZE;
+
+        btif_msbc_rx_data(p, len, (status != BTM_SCO_DATA_CORRECT));
+    }
+
+    GKI_freebuf(p_buf);
+}
+#endif
+
 /*******************************************************************************
 **
 ** Function         btui_sco_codec_callback
@@ -237,6 +457,12 @@ tBTA_DM_SCO_ROUTE_TYPE bta_dm_sco_co_init(UINT32 rx_bw, UINT32 tx_bw,
     {
         route = btui_cb.sco_hci = BTA_DM_SCO_ROUTE_HCI;
     }
+#if (BTM_WBS_INCLUDED == TRUE)
+    /* the AG asks for 16 kHz when it negotiated mSBC, which the host then
+       has to encode and decode itself */
+    bta_dm_co_msbc.active = (route == BTA_DM_SCO_ROUTE_HCI) &&
+                            (rx_bw == BTA_DM_SCO_SAMP_RATE_16K);
+#endif
     /* no codec is is used for the SCO data */
     if (p_codec_type->codec_type == BTA_SCO_CODEC_PCM && route == BTA_DM_SCO_ROUTE_HCI)
     {
@@ -274,6 +500,17 @@ void bta_dm_sco_co_open(UINT16 handle, UINT8 pkt_size, UINT16 event)
         cfg.p_cback = btui_sco_codec_callback;
         cfg.pkt_size = pkt_size;
         cfg.cb_event = event;
+#if (BTM_WBS_INCLUDED == TRUE)
+        if (bta_dm_co_msbc.active)
+        {
+            bta_dm_co_msbc.pkt_size = pkt_size;
+            bta_dm_co_msbc.pcm_pos = 0;
+            bta_dm_co_msbc.pcm_frac = 0;
+            bta_dm_co_msbc.tx_credit = 0;
+            GKI_init_q(&bta_dm_co_msbc.pcm_q);
+            btif_msbc_init(bta_dm_sco_co_msbc_pcm);
+        }
+#endif
         /* open and start the codec */
         btui_sco_codec_open(&cfg);
         btui_sco_codec_start(handle);
@@ -298,6 +535,14 @@ void bta_dm_sco_co_close(void)
         /* close sco codec */
         btui_sco_codec_close();
 
+#if (BTM_WBS_INCLUDED == TRUE)
+        if (bta_dm_co_msbc.active)
+        {
+            while (!GKI_queue_is_empty(&bta_dm_co_msbc.pcm_q))
+                GKI_freebuf(GKI_dequeue(&bta_dm_co_msbc.pcm_q));
+            bta_dm_co_msbc.active = FALSE;
+        }
+#endif
         btui_cb.sco_hci = FALSE;
     }
 }
@@ -311,8 +556,21 @@ void bta_dm_sco_co_close(void)
 ** Returns          void
 **
 *******************************************************************************/
-void bta_dm_sco_co_in_data(BT_HDR  *p_buf)
+void bta_dm_sco_co_in_data(BT_HDR  *p_buf, tBTM_SCO_DATA_FLAG status)
 {
+    UNUSED(status);
+
+#if (BTM_WBS_INCLUDED == TRUE)
+    if (bta_dm_co_msbc.active)
+    {
+        if (btui_cfg.sco_use_mic)
+            bta_dm_sco_co_msbc_in_data(p_buf, status);
+        else
+            GKI_freebuf(p_buf);
+        return;
+    }
+#endif
+
     if (btui_cfg.sco_use_mic)
         btui_sco_codec_inqdata (p_buf);
     else
@@ -330,6 +588,14 @@ void bta_dm_sco_co_in_data(BT_HDR  *p_buf)
 *******************************************************************************/
 void bta_dm_sco_co_out_data(BT_HDR  **p_buf)
 {
+#if (BTM_WBS_INCLUDED == TRUE)
+    if (bta_dm_co_msbc.active)
+    {
+        bta_dm_sco_co_msbc_out_data(p_buf);
+        return;
+    }
+#endif
+
     btui_sco_codec_readbuf(p_buf);
 }
 
@@ -17,6 +17,15 @@
  ******************************************************************************/
 
 
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "gki.h"
 #include "bta_gattc_co.h"
 #include "bta_gattc_ci.h"
@@ -26,41 +35,643 @@
 #if( defined BLE_INCLUDED ) && (BLE_INCLUDED == TRUE)
 #if( defined BTA_GATT_INCLUDED ) && (BTA_GATT_INCLUDED == TRUE)
 
-#define GATT_CACHE_PREFIX "/data/misc/bluedroid/gatt_cache_"
+/* All servers share one store. Devices map to a service layout, and layouts are
+   content addressed so that peers of the same model share one copy of their
+   attribute table. The store is mapped read-only and rewritten as a whole. */
+#define GATT_CACHE_DIR          "/data/misc/bluedroid/"
+#define GATT_CACHE_FILE         GATT_CACHE_DIR "gatt_cache.db"
+#define GATT_CACHE_LEGACY_PREFIX "gatt_cache_"     /* one raw attribute file per server */
+#define GATT_CACHE_FILE_NEW     GATT_CACHE_FILE ".new"
+#define GATT_CACHE_MAGIC        0x43544147      /* "GATC" */
+#define GATT_CACHE_VERSION      1
+#define GATT_CACHE_MAX_DEV      BTM_SEC_MAX_DEVICE_RECORDS
+#define GATT_CACHE_MAX_BYTES    (256 * 1024)    /* least recently used devices are evicted above this */
+
+typedef struct
+{
+    UINT32  magic;
+    UINT16  version;
+    UINT16  attr_size;      /* sizeof(tBTA_GATTC_NV_ATTR) of the writer */
+    UINT32  seq;            /* LRU clock */
+    UINT16  num_dev;
+    UINT16  num_layout;
+    UINT32  num_attr;
+} tGATT_CACHE_HDR;
+
+typedef struct
+{
+    BD_ADDR bda;
+    UINT16  layout;
+    UINT32  last_used;
+} tGATT_CACHE_DEV;
+
+typedef struct
+{
+    UINT32  hash;
+    UINT32  offset;         /* in attributes, from the start of the attribute table */
+    UINT32  num_attr;
+} tGATT_CACHE_LAYOUT_REC;
+
+typedef struct
+{
+    UINT32                      hash;
+    UINT16                      num_attr;
+    const tBTA_GATTC_NV_ATTR    *p_attr;    /* into the mapping, or the pending save */
+} tGATT_CACHE_LAYOUT;
+
+typedef struct
+{
+    BOOLEAN             loaded;
+    UINT8               *p_map;
+    size_t              map_len;
+    UINT32              seq;
+
+    UINT16              num_dev;
+    tGATT_CACHE_DEV     dev[GATT_CACHE_MAX_DEV];
+    UINT16              num_layout;
+    tGATT_CACHE_LAYOUT  layout[GATT_CACHE_MAX_DEV + 1];
+
+    /* the open operation */
+    BOOLEAN             is_open;
+    BOOLEAN             to_save;
+    BOOLEAN             save_failed;
+    BD_ADDR             bda;
+    UINT16              cur_layout;
+    tBTA_GATTC_NV_ATTR  *p_pending;
+    UINT16              num_pending;
+    UINT16              pending_size;
+} tGATT_CACHE_CB;
+
+static tGATT_CACHE_CB gatt_cache;
+
+static UINT32 cacheHash(const tBTA_GATTC_NV_ATTR *p_attr, UINT16 num_attr)
+{
+    const UINT8 *p = (const UINT8 *)p_attr;
+    size_t len = num_attr * sizeof(tBTA_GATTC_NV_ATTR);
+    UINT32 hash = 2166136261u;
+
+    while (len--)
+    {
+        hash ^= *p++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* copies an attribute with unused UUID bytes and padding cleared, so equal
+   layouts hash and compare equal */
+static void cacheNormalize(tBTA_GATTC_NV_ATTR *p_dst, const tBTA_GATTC_NV_ATTR *p_src)
+{
+    memset(p_dst, 0, sizeof(tBTA_GATTC_NV_ATTR));
+
+    p_dst->uuid.len = p_src->uuid.len;
+    if (p_src->uuid.len == LEN_UUID_16)
+        p_dst->uuid.uu.uuid16 = p_src->uuid.uu.uuid16;
+    else if (p_src->uuid.len == LEN_UUID_32)
+        p_dst->uuid.uu.uuid32 = p_src->uuid.uu.uuid32;
+    else
+        memcpy(p_dst->uuid.uu.uuid128, p_src->uuid.uu.uuid128, LEN_UUID_128);
 
-static FILE* sCacheFD = 0;
+    p_dst->s_handle   = p_src->s_handle;
+    p_dst->e_handle   = p_src->e_handle;
+    p_dst->attr_type  = p_src->attr_type;
+    p_dst->id         = p_src->id;
+    p_dst->prop       = p_src->prop;
+    p_dst->is_primary = p_src->is_primary;
+}
 
-static void getFilename(char *buffer, BD_ADDR bda)
+static void cacheUnmap(void)
 {
-    sprintf(buffer, "%s%02x%02x%02x%02x%02x%02x", GATT_CACHE_PREFIX
-        , bda[0], bda[1], bda[2], bda[3], bda[4], bda[5]);
+    if (gatt_cache.p_map)
+        munmap(gatt_cache.p_map, gatt_cache.map_len);
+
+    gatt_cache.p_map = NULL;
+    gatt_cache.map_len = 0;
+    gatt_cache.num_dev = 0;
+    gatt_cache.num_layout = 0;
 }
 
-static void cacheClose()
+/* maps the store and indexes it; a missing or invalid store reads as empty */
+static void cacheMap(void)
 {
-    if (sCacheFD != 0)
+    const tGATT_CACHE_HDR           *p_hdr;
+    const tGATT_CACHE_DEV           *p_dev;
+    const tGATT_CACHE_LAYOUT_REC    *p_rec;
+    const tBTA_GATTC_NV_ATTR        *p_attr;
+    struct stat st;
+    size_t  need;
+    UINT16  i;
+    int fd;
+
+    cacheUnmap();
+    gatt_cache.loaded = TRUE;
+
+    if ((fd = open(GATT_CACHE_FILE, O_RDONLY)) < 0)
+        return;
+
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(tGATT_CACHE_HDR))
     {
-        fclose(sCacheFD);
-        sCacheFD = 0;
+        gatt_cache.p_map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (gatt_cache.p_map == MAP_FAILED)
+            gatt_cache.p_map = NULL;
+        else
+            gatt_cache.map_len = st.st_size;
     }
+    close(fd);
+
+    if (gatt_cache.p_map == NULL)
+        return;
+
+    p_hdr = (const tGATT_CACHE_HDR *)gatt_cache.p_map;
+    need = sizeof(tGATT_CACHE_HDR) + p_hdr->num_dev * sizeof(tGATT_CACHE_DEV) +
+           p_hdr->num_layout * sizeof(tGATT_CACHE_LAYOUT_REC) +
+           (size_t)p_hdr->num_attr * sizeof(tBTA_GATTC_NV_ATTR);
+
+    if (p_hdr->magic != GATT_CACHE_MAGIC || p_hdr->version != GATT_CACHE_VERSION ||
+        p_hdr->attr_size != sizeof(tBTA_GATTC_NV_ATTR) ||
+        p_hdr->num_dev > GATT_CACHE_MAX_DEV || p_hdr->num_layout > GATT_CACHE_MAX_DEV ||
+        need != gatt_cache.map_len)
+    {
+        BTIF_TRACE_WARNING("%s() - discarding invalid cache store", __FUNCTION__);
+        cacheUnmap();
+        return;
+    }
+
+    p_dev  = (const tGATT_CACHE_DEV *)(p_hdr + 1);
+    p_rec  = (const tGATT_CACHE_LAYOUT_REC *)(p_dev + p_hdr->num_dev);
+    p_attr = (const tBTA_GATTC_NV_ATTR *)(p_rec + p_hdr->num_layout);
+
+    for (i = 0; i < p_hdr->num_layout; i++)
+    {
+        if (p_rec[i].offset > p_hdr->num_attr || p_rec[i].num_attr > 0xFFFF ||
+            p_rec[i].num_attr > p_hdr->num_attr - p_rec[i].offset)
+        {
+            cacheUnmap();
+            return;
+        }
+        gatt_cache.layout[i].hash     = p_rec[i].hash;
+        gatt_cache.layout[i].num_attr = (UINT16)p_rec[i].num_attr;
+        gatt_cache.layout[i].p_attr   = p_attr + p_rec[i].offset;
+    }
+
+    for (i = 0; i < p_hdr->num_dev; i++)
+    {
+        if (p_dev[i].layout >= p_hdr->num_layout)
+        {
+            cacheUnmap();
+            return;
+        }
+        gatt_cache.dev[i] = p_dev[i];
+    }
+
+    gatt_cache.num_dev = p_hdr->num_dev;
+    gatt_cache.num_layout = p_hdr->num_layout;
+    gatt_cache.seq = p_hdr->seq;
+}
+
+static int cacheFindDev(BD_ADDR bda)
+{
+    int i;
+
+    for (i = 0; i < gatt_cache.num_dev; i++)
+    {
+        if (memcmp(gatt_cache.dev[i].bda, bda, BD_ADDR_LEN) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static void cacheRemoveDev(int idx)
+{
+    gatt_cache.num_dev--;
+    memmove(&gatt_cache.dev[idx], &gatt_cache.dev[idx + 1],
+            (gatt_cache.num_dev - idx) * sizeof(tGATT_CACHE_DEV));
+}
+
+static int cacheCompareLru(const void *a, const void *b)
+{
+    UINT32 la = ((const tGATT_CACHE_DEV *)a)->last_used;
+    UINT32 lb = ((const tGATT_CACHE_DEV *)b)->last_used;
+
+    return (la < lb) - (la > lb);
+}
+
+/*******************************************************************************
+**
+** Function         cacheCommit
+**
+** Description      Rewrites the store from the in-memory tables. Devices are
+**                  kept most recently used first until GATT_CACHE_MAX_BYTES is
+**                  reached; layouts no device refers to are dropped. The new
+**                  image is written beside the old one, synced, renamed over it
+**                  and mapped again.
+**
+** Returns          TRUE if the store was written.
+**
+*******************************************************************************/
+static BOOLEAN cacheCommit(void)
+{
+    UINT16  remap[GATT_CACHE_MAX_DEV + 1];
+    UINT16  num_dev = 0, num_layout = 0, i;
+    UINT32  num_attr = 0;
+    size_t  size = sizeof(tGATT_CACHE_HDR), cost, written = 0;
+    tGATT_CACHE_HDR         *p_hdr;
+    tGATT_CACHE_DEV         *p_dev;
+    tGATT_CACHE_LAYOUT_REC  *p_rec;
+    tBTA_GATTC_NV_ATTR      *p_attr;
+    UINT8   *p_buf;
+    BOOLEAN ok = FALSE;
+    int fd;
+
+    memset(remap, 0xFF, sizeof(remap));
+    qsort(gatt_cache.dev, gatt_cache.num_dev, sizeof(tGATT_CACHE_DEV), cacheCompareLru);
+
+    for (i = 0; i < gatt_cache.num_dev; i++)
+    {
+        tGATT_CACHE_DEV *p = &gatt_cache.dev[i];
+
+        cost = sizeof(tGATT_CACHE_DEV);
+        if (remap[p->layout] == 0xFFFF)
+            cost += sizeof(tGATT_CACHE_LAYOUT_REC) +
+                    gatt_cache.layout[p->layout].num_attr * sizeof(tBTA_GATTC_NV_ATTR);
+
+        if (size + cost > GATT_CACHE_MAX_BYTES)
+        {
+            BTIF_TRACE_DEBUG("%s() - evicting %02x:%02x:%02x:%02x:%02x:%02x", __FUNCTION__,
+                p->bda[0], p->bda[1], p->bda[2], p->bda[3], p->bda[4], p->bda[5]);
+            continue;
+        }
+
+        if (remap[p->layout] == 0xFFFF)
+        {
+            remap[p->layout] = num_layout++;
+            num_attr += gatt_cache.layout[p->layout].num_attr;
+        }
+        size += cost;
+        gatt_cache.dev[num_dev++] = *p;
+    }
+    gatt_cache.num_dev = num_dev;
+
+    if ((p_buf = (UINT8 *)malloc(size)) == NULL)
+        return FALSE;
+
+    p_hdr  = (tGATT_CACHE_HDR *)p_buf;
+    p_dev  = (tGATT_CACHE_DEV *)(p_hdr + 1);
+    p_rec  = (tGATT_CACHE_LAYOUT_REC *)(p_dev + num_dev);
+    p_attr = (tBTA_GATTC_NV_ATTR *)(p_rec + num_layout);
+
+    p_hdr->magic      = GATT_CACHE_MAGIC;
+    p_hdr->version    = GATT_CACHE_VERSION;
+    p_hdr->attr_size  = sizeof(tBTA_GATTC_NV_ATTR);
+    p_hdr->seq        = gatt_cache.seq;
+    p_hdr->num_dev    = num_dev;
+    p_hdr->num_layout = num_layout;
+    p_hdr->num_attr   = num_attr;
+
+    for (i = 0; i < num_dev; i++)
+    {
+        p_dev[i] = gatt_cache.dev[i];
+        p_dev[i].layout = remap[gatt_cache.dev[i].layout];
+    }
+
+    num_attr = 0;
+    for (i = 0; i < gatt_cache.num_layout; i++)
+    {
+        const tGATT_CACHE_LAYOUT *p_layout = &gatt_cache.layout[i];
+
+        if (remap[i] == 0xFFFF)
+            continue;
+
+        p_rec[remap[i]].hash     = p_layout->hash;
+        p_rec[remap[i]].offset   = num_attr;
+        p_rec[remap[i]].num_attr = p_layout->num_attr;
+        memcpy(p_attr + num_attr, p_layout->p_attr,
+               p_layout->num_attr * sizeof(tBTA_GATTC_NV_ATTR));
+        num_attr += p_layout->num_attr;
+    }
+
+    if ((fd = open(GATT_CACHE_FILE_NEW, O_WRONLY | O_CREAT | O_TRUNC, 0660)) >= 0)
+    {
+        while (written < size)
+        {
+            ssize_t ret = write(fd, p_buf + written, size - written);
+            if (ret <= 0)
+                break;
+            written += ret;
+        }
+        ok = (written == size && fsync(fd) == 0);
+        close(fd);
+
+        if (ok && rename(GATT_CACHE_FILE_NEW, GATT_CACHE_FILE) != 0)
+            ok = FALSE;
+        if (!ok)
+            unlink(GATT_CACHE_FILE_NEW);
+    }
+    free(p_buf);
+
+    if (!ok)
+    {
+        BTIF_TRACE_ERROR("%s() - failed to write %s", __FUNCTION__, GATT_CACHE_FILE);
+    }
+
+    /* pointers into the old mapping and the pending save go stale here */
+    cacheMap();
+    return ok;
+}
+
+static void cacheClose(void)
+{
+    int idx, i;
+
+    if (gatt_cache.is_open && gatt_cache.to_save && !gatt_cache.save_failed &&
+        gatt_cache.num_pending > 0)
+    {
+        UINT32 hash = cacheHash(gatt_cache.p_pending, gatt_cache.num_pending);
+
+        for (i = 0; i < gatt_cache.num_layout; i++)
+        {
+            if (gatt_cache.layout[i].hash == hash &&
+                gatt_cache.layout[i].num_attr == gatt_cache.num_pending &&
+                memcmp(gatt_cache.layout[i].p_attr, gatt_cache.p_pending,
+                       gatt_cache.num_pending * sizeof(tBTA_GATTC_NV_ATTR)) == 0)
+                break;
+        }
+        if (i == gatt_cache.num_layout)
+        {
+            gatt_cache.layout[i].hash     = hash;
+            gatt_cache.layout[i].num_attr = gatt_cache.num_pending;
+            gatt_cache.layout[i].p_attr   = gatt_cache.p_pending;
+            gatt_cache.num_layout++;
+        }
+
+        if ((idx = cacheFindDev(gatt_cache.bda)) < 0)
+        {
+            if (gatt_cache.num_dev == GATT_CACHE_MAX_DEV)
+            {
+                /* make room by dropping the least recently used device */
+                qsort(gatt_cache.dev, gatt_cache.num_dev, sizeof(tGATT_CACHE_DEV),
+                      cacheCompareLru);
+                gatt_cache.num_dev--;
+            }
+            idx = gatt_cache.num_dev++;
+            memcpy(gatt_cache.dev[idx].bda, gatt_cache.bda, BD_ADDR_LEN);
+        }
+        gatt_cache.dev[idx].layout = (UINT16)i;
+        gatt_cache.dev[idx].last_used = ++gatt_cache.seq;
+
+        cacheCommit();
+    }
+
+    if (gatt_cache.p_pending)
+        free(gatt_cache.p_pending);
+
+    gatt_cache.p_pending = NULL;
+    gatt_cache.num_pending = 0;
+    gatt_cache.pending_size = 0;
+    gatt_cache.is_open = FALSE;
+}
+
+/* reads one legacy per-server file; returns the number of attributes or 0 */
+static UINT16 cacheReadLegacy(const char *name, BD_ADDR bda, tBTA_GATTC_NV_ATTR **pp_attr)
+{
+    char path[255];
+    unsigned int b[BD_ADDR_LEN];
+    tBTA_GATTC_NV_ATTR *p_attr;
+    struct stat st;
+    size_t num_attr, i;
+    int fd, n = 0;
+
+    if (sscanf(name, GATT_CACHE_LEGACY_PREFIX "%2x%2x%2x%2x%2x%2x%n",
+               &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &n) != BD_ADDR_LEN ||
+        name[n] != '\0')
+        return 0;
+
+    for (i = 0; i < BD_ADDR_LEN; i++)
+        bda[i] = (UINT8)b[i];
+
+    snprintf(path, sizeof(path), "%s%s", GATT_CACHE_DIR, name);
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return 0;
+
+    num_attr = 0;
+    if (fstat(fd, &st) == 0 && st.st_size > 0 &&
+        st.st_size % sizeof(tBTA_GATTC_NV_ATTR) == 0 &&
+        st.st_size / sizeof(tBTA_GATTC_NV_ATTR) <= 0xFFFF)
+        num_attr = st.st_size / sizeof(tBTA_GATTC_NV_ATTR);
+
+    if (num_attr > 0 &&
+        (p_attr = (tBTA_GATTC_NV_ATTR *)malloc(st.st_size)) != NULL)
+    {
+        if (read(fd, p_attr, st.st_size) == st.st_size)
+        {
+            for (i = 0; i < num_attr; i++)
+            {
+                tBTA_GATTC_NV_ATTR attr = p_attr[i];
+                cacheNormalize(&p_attr[i], &attr);
+            }
+            *pp_attr = p_attr;
+        }
+        else
+        {
+            free(p_attr);
+            num_attr = 0;
+        }
+    }
+    else
+        num_attr = 0;
+
+    close(fd);
+    return (UINT16)num_attr;
+}
+
+/*******************************************************************************
+**
+** Function         cacheImportLegacy
+**
+** Description      Moves the per-server files of the old cache format into the
+**                  store. Servers the store already knows keep their entry.
+**                  The old files are removed once the store is written;
+**                  unreadable ones are removed straight away.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void cacheImportLegacy(void)
+{
+    tBTA_GATTC_NV_ATTR *p_buf[GATT_CACHE_MAX_DEV];
+    char name[GATT_CACHE_MAX_DEV][32];
+    char path[255];
+    UINT16 num_import = 0, num_buf = 0, num_attr, i;
+    struct dirent *de;
+    BD_ADDR bda;
+    DIR *dir;
+
+    if ((dir = opendir(GATT_CACHE_DIR)) == NULL)
+        return;
+
+    while ((de = readdir(dir)) != NULL)
+    {
+        tBTA_GATTC_NV_ATTR *p_attr = NULL;
+        UINT32 hash;
+
+        if (strncmp(de->d_name, GATT_CACHE_LEGACY_PREFIX,
+                    strlen(GATT_CACHE_LEGACY_PREFIX)) != 0 ||
+            strlen(de->d_name) >= sizeof(name[0]))
+            continue;
+
+        num_attr = cacheReadLegacy(de->d_name, bda, &p_attr);
+        if (num_attr > 0 && gatt_cache.num_dev < GATT_CACHE_MAX_DEV &&
+            gatt_cache.num_layout < GATT_CACHE_MAX_DEV && cacheFindDev(bda) < 0)
+        {
+            tGATT_CACHE_DEV *p_dev = &gatt_cache.dev[gatt_cache.num_dev++];
+
+            hash = cacheHash(p_attr, num_attr);
+            for (i = 0; i < gatt_cache.num_layout; i++)
+            {
+                if (gatt_cache.layout[i].hash == hash &&
+                    gatt_cache.layout[i].num_attr == num_attr &&
+                    memcmp(gatt_cache.layout[i].p_attr, p_attr,
+                           num_attr * sizeof(tBTA_GATTC_NV_ATTR)) == 0)
+                    break;
+            }
+            if (i == gatt_cache.num_layout)
+            {
+                gatt_cache.layout[i].hash     = hash;
+                gatt_cache.layout[i].num_attr = num_attr;
+                gatt_cache.layout[i].p_attr   = p_attr;
+                gatt_cache.num_layout++;
+                p_buf[num_buf++] = p_attr;
+                p_attr = NULL;
+            }
+            memcpy(p_dev->bda, bda, BD_ADDR_LEN);
+            p_dev->layout    = i;
+            p_dev->last_used = ++gatt_cache.seq;
+
+            strcpy(name[num_import++], de->d_name);
+        }
+        else
+        {
+            /* unreadable, superseded by the store, or no room left */
+            snprintf(path, sizeof(path), "%s%s", GATT_CACHE_DIR, de->d_name);
+            unlink(path);
+        }
+
+        if (p_attr)
+            free(p_attr);
+    }
+    closedir(dir);
+
+    if (num_import == 0)
+        return;
+
+    BTIF_TRACE_DEBUG("%s() - importing %d legacy cache files", __FUNCTION__, num_import);
+
+    /* on failure the old files stay and the import is retried on the next start */
+    if (cacheCommit())
+    {
+        for (i = 0; i < num_import; i++)
+        {
+            snprintf(path, sizeof(path), "%s%s", GATT_CACHE_DIR, name[i]);
+            unlink(path);
+        }
+    }
+
+    for (i = 0; i < num_buf; i++)
+        free(p_buf[i]);
+}
+
+/* maps the store the first time it is needed, bringing in any legacy files */
+static void cacheLoad(void)
+{
+    cacheMap();
+    cacheImportLegacy();
 }
 
 static bool cacheOpen(BD_ADDR bda, bool to_save)
 {
-    char fname[255] = {0};
-    getFilename(fname, bda);
+    int idx;
 
     cacheClose();
-    sCacheFD = fopen(fname, to_save ? "w" : "r");
+    if (!gatt_cache.loaded)
+        cacheLoad();
+
+    if (!to_save)
+    {
+        if ((idx = cacheFindDev(bda)) < 0)
+            return false;
 
-    return (sCacheFD != 0);
+        gatt_cache.cur_layout = gatt_cache.dev[idx].layout;
+        /* recency is persisted with the next rewrite */
+        gatt_cache.dev[idx].last_used = ++gatt_cache.seq;
+    }
+
+    memcpy(gatt_cache.bda, bda, BD_ADDR_LEN);
+    gatt_cache.to_save = to_save;
+    gatt_cache.save_failed = FALSE;
+    gatt_cache.is_open = TRUE;
+    return true;
+}
+
+static BOOLEAN cacheAppend(const tBTA_GATTC_NV_ATTR *p_attr, UINT16 num_attr)
+{
+    tBTA_GATTC_NV_ATTR *p_new;
+    UINT16 i;
+
+    if ((UINT32)gatt_cache.num_pending + num_attr > 0xFFFF)
+        return FALSE;
+
+    if (gatt_cache.num_pending + num_attr > gatt_cache.pending_size)
+    {
+        UINT32 size = gatt_cache.pending_size ? gatt_cache.pending_size * 2 : 64;
+
+        while (size < (UINT32)gatt_cache.num_pending + num_attr)
+            size *= 2;
+        if (size > 0xFFFF)
+            size = 0xFFFF;
+
+        p_new = (tBTA_GATTC_NV_ATTR *)realloc(gatt_cache.p_pending,
+                                              size * sizeof(tBTA_GATTC_NV_ATTR));
+        if (p_new == NULL)
+            return FALSE;
+
+        gatt_cache.p_pending = p_new;
+        gatt_cache.pending_size = (UINT16)size;
+    }
+
+    for (i = 0; i < num_attr; i++)
+        cacheNormalize(&gatt_cache.p_pending[gatt_cache.num_pending++], &p_attr[i]);
+
+    return TRUE;
 }
 
 static void cacheReset(BD_ADDR bda)
 {
-    char fname[255] = {0};
-    getFilename(fname, bda);
-    unlink(fname);
+    int idx;
+
+    /* an operation in flight for this server must not bring it back */
+    if (gatt_cache.is_open && memcmp(gatt_cache.bda, bda, BD_ADDR_LEN) == 0)
+    {
+        gatt_cache.save_failed = TRUE;
+        cacheClose();
+    }
+
+    if (!gatt_cache.loaded)
+        cacheLoad();
+
+    if ((idx = cacheFindDev(bda)) >= 0)
+    {
+        cacheRemoveDev(idx);
+        cacheCommit();
+
+        /* layout indices change with the rewrite */
+        if (gatt_cache.is_open && !gatt_cache.to_save)
+        {
+            if ((idx = cacheFindDev(gatt_cache.bda)) >= 0)
+                gatt_cache.cur_layout = gatt_cache.dev[idx].layout;
+            else
+                gatt_cache.is_open = FALSE;
+        }
+    }
 }
 
 
@@ -112,18 +723,26 @@ void bta_gattc_co_cache_open(BD_ADDR server_bda, UINT16 evt, UINT16 conn_id, BOO
 void bta_gattc_co_cache_load(BD_ADDR server_bda, UINT16 evt, UINT16 start_index, UINT16 conn_id)
 {
     UINT16              num_attr = 0;
-    tBTA_GATTC_NV_ATTR  attr[BTA_GATTC_NV_LOAD_MAX];
+    const tBTA_GATTC_NV_ATTR *p_attr = NULL;
     tBTA_GATT_STATUS    status = BTA_GATT_ERROR;
 
-    if (sCacheFD && (0 == fseek(sCacheFD, start_index * sizeof(tBTA_GATTC_NV_ATTR), SEEK_SET)))
+    /* the whole table is served straight from the mapping, normally in one call-in */
+    if (gatt_cache.is_open && !gatt_cache.to_save &&
+        start_index <= gatt_cache.layout[gatt_cache.cur_layout].num_attr)
     {
-        num_attr = fread(attr, sizeof(tBTA_GATTC_NV_ATTR), BTA_GATTC_NV_LOAD_MAX, sCacheFD);
-        status = (num_attr < BTA_GATTC_NV_LOAD_MAX ? BTA_GATT_OK : BTA_GATT_MORE);
+        const tGATT_CACHE_LAYOUT *p_layout = &gatt_cache.layout[gatt_cache.cur_layout];
+
+        num_attr = p_layout->num_attr - start_index;
+        if (num_attr > BTA_GATTC_NV_LOAD_BULK_MAX)
+            num_attr = BTA_GATTC_NV_LOAD_BULK_MAX;
+
+        p_attr = p_layout->p_attr + start_index;
+        status = (start_index + num_attr < p_layout->num_attr ? BTA_GATT_MORE : BTA_GATT_OK);
     }
 
-    BTIF_TRACE_DEBUG("%s() - sCacheFD=%p, start_index=%d, read=%d, status=%d",
-        __FUNCTION__, sCacheFD, start_index, num_attr, status);
-    bta_gattc_ci_cache_load(server_bda, evt, num_attr, attr, status, conn_id);
+    BTIF_TRACE_DEBUG("%s() - start_index=%d, read=%d, status=%d",
+        __FUNCTION__, start_index, num_attr, status);
+    bta_gattc_ci_cache_load(server_bda, evt, num_attr, (tBTA_GATTC_NV_ATTR *)p_attr, status, conn_id);
 }
 
 /*******************************************************************************
@@ -148,10 +767,14 @@ void bta_gattc_co_cache_save (BD_ADDR server_bda, UINT16 evt, UINT16 num_attr,
     tBTA_GATT_STATUS    status = BTA_GATT_OK;
     UNUSED(attr_index);
 
-    if (sCacheFD != 0)
+    if (gatt_cache.is_open && gatt_cache.to_save && !gatt_cache.save_failed)
     {
-        int num = fwrite(p_attr_list, sizeof(tBTA_GATTC_NV_ATTR), num_attr, sCacheFD);
-        BTIF_TRACE_DEBUG("%s() wrote %d", __FUNCTION__, num);
+        if (!cacheAppend(p_attr_list, num_attr))
+        {
+            gatt_cache.save_failed = TRUE;
+            status = BTA_GATT_NO_RESOURCES;
+        }
+        BTIF_TRACE_DEBUG("%s() buffered %d", __FUNCTION__, num_attr);
     }
 
     bta_gattc_ci_cache_save(server_bda, evt, status, conn_id);
@@ -175,11 +798,9 @@ void bta_gattc_co_cache_close(BD_ADDR server_bda, UINT16 conn_id)
     UNUSED(server_bda);
     UNUSED(conn_id);
 
+    /* a completed save is deduplicated and committed to the store here */
     cacheClose();
 
-    /* close NV when server cache is done saving or loading,
-       does not need to do anything for now on Insight */
-
     BTIF_TRACE_DEBUG("%s()", __FUNCTION__);
 }
 
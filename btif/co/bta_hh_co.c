@@ -26,12 +26,17 @@
 #include <string.h>
 #include <stdint.h>
 #include <errno.h>
+#include <time.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
 #include <linux/uhid.h>
 #include "btif_hh.h"
 #include "bta_api.h"
 #include "bta_hh_api.h"
 #include "btif_util.h"
 #include "bta_hh_co.h"
+#include "bt_utils.h"
+#include "gki.h"
 
 const char *dev_path = "/dev/uhid";
 
@@ -47,6 +52,32 @@ static tBTA_HH_RPT_CACHE_ENTRY sReportCache[BTA_HH_NV_LOAD_MAX];
 #define REPORT_DESC_START_COLLECTION    0xA1
 #define REPORT_DESC_END_COLLECTION      0xC0
 
+/* UHID_INPUT2 (Linux 3.16) carries the report size ahead of the data, so an
+** input event is the 4 byte type, the 2 byte size and the report alone
+** instead of a whole struct uhid_event. Older kernels reject it. */
+#define UHID_INPUT2_TYPE                12
+#define UHID_INPUT2_HDR_LEN             6
+
+/* Input reports written by one writev() call of the uhid writer thread.
+** uhid has no write_iter, so the kernel hands every iovec to its write
+** handler as a separate event. */
+#define UHID_WRITER_MAX_BATCH           16
+
+#define UHID_QUEUE_MASK                 (BTIF_HH_UHID_QUEUE_SIZE - 1)
+
+static pthread_once_t uhid_writer_once = PTHREAD_ONCE_INIT;
+static int uhid_writer_wake_fd = -1;
+static struct uhid_event uhid_legacy_ev;    /* writer thread only */
+
+/* Serializes the producers of the report queues: BTU, and the BTU data
+** thread when it takes the interrupt channels. It is seldom contended. */
+static pthread_mutex_t uhid_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Lets uhid_stop wait for the writer to empty the queue of a device */
+static pthread_mutex_t uhid_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t uhid_drain_cond = PTHREAD_COND_INITIALIZER;
+static BOOLEAN uhid_writer_exited = FALSE;  /* under uhid_drain_lock */
+
 /*********************************************************
 **  Local type definitions
 *********************************************************/
@@ -326,14 +357,400 @@ static inline void btif_hh_close_poll_thread(btif_hh_device_t *p_dev)
     return;
 }
 
-void bta_hh_co_destroy(int fd)
+/*******************************************************************************
+**
+** Function         uhid_now_us
+**
+** Description      Monotonic time of the input report path.
+**
+** Returns          microseconds
+**
+*******************************************************************************/
+static UINT64 uhid_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UINT64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*******************************************************************************
+**
+** Function         uhid_write_legacy
+**
+** Description      Write one input report as a UHID_INPUT event, for kernels
+**                  without UHID_INPUT2. The event is static to the writer
+**                  thread: the kernel only reads size bytes of the data, so
+**                  it is not cleared between reports.
+**
+** Returns          0 on success, negative errno otherwise
+**
+*******************************************************************************/
+static int uhid_write_legacy(int fd, const UINT8 *p_rpt, UINT16 len)
+{
+    uhid_legacy_ev.type = UHID_INPUT;
+    uhid_legacy_ev.u.input.size = len;
+    memcpy(uhid_legacy_ev.u.input.data, p_rpt, len);
+    return uhid_write(fd, &uhid_legacy_ev);
+}
+
+/*******************************************************************************
+**
+** Function         uhid_account
+**
+** Description      Record the latency of a report written to uhid, from its
+**                  receive time to now.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void uhid_account(btif_hh_uhid_stats_t *p_stats, UINT64 rx_us, UINT64 now_us)
+{
+    UINT32  lat = (UINT32)(now_us - rx_us);
+    UINT32  bucket = 0;
+
+    while (bucket < BTIF_HH_UHID_LAT_BUCKETS - 1 && lat >= (125u << bucket))
+        bucket++;
+
+    p_stats->reports++;
+    p_stats->lat_sum_us += lat;
+    p_stats->lat_hist[bucket]++;
+    if (lat > p_stats->lat_max_us)
+        p_stats->lat_max_us = lat;
+}
+
+/*******************************************************************************
+**
+** Function         uhid_flush
+**
+** Description      Write the reports queued for a device, up to
+**                  UHID_WRITER_MAX_BATCH of them with a single writev().
+**                  Each event is built in the headroom of its buffer, in
+**                  front of the report, so nothing is copied. Runs on the
+**                  uhid writer thread.
+**
+** Returns          TRUE if reports were taken off the queue
+**
+*******************************************************************************/
+static BOOLEAN uhid_flush(btif_hh_device_t *p_dev)
+{
+    struct iovec        iov[UHID_WRITER_MAX_BATCH];
+    btif_hh_uhid_rpt_t  *p_rpt;
+    UINT32              tail = p_dev->uhid_tail;
+    UINT32              head = __atomic_load_n(&p_dev->uhid_head, __ATOMIC_ACQUIRE);
+    UINT32              num, i, type = UHID_INPUT2_TYPE;
+    UINT16              len;
+    UINT8               *p;
+    UINT64              now;
+    ssize_t             ret = -1;
+    int                 fd;
+
+    if (head == tail)
+        return FALSE;
+
+    /* uhid_stop keeps the fd open until the queue is empty */
+    fd = p_dev->fd;
+
+    num = head - tail;
+    if (num > UHID_WRITER_MAX_BATCH)
+        num = UHID_WRITER_MAX_BATCH;
+
+    if (fd >= 0 && !p_dev->uhid_legacy)
+    {
+        for (i = 0; i < num; i++)
+        {
+            p_rpt = &p_dev->uhid_queue[(tail + i) & UHID_QUEUE_MASK];
+            len = p_rpt->p_buf->len;
+            p = (UINT8 *)(p_rpt->p_buf + 1) + p_rpt->p_buf->offset - UHID_INPUT2_HDR_LEN;
+            memcpy(p, &type, sizeof(type));
+            memcpy(p + sizeof(type), &len, sizeof(len));
+            iov[i].iov_base = p;
+            iov[i].iov_len = UHID_INPUT2_HDR_LEN + len;
+        }
+
+        ret = writev(fd, iov, num);
+        if (ret < 0 && (errno == EOPNOTSUPP || errno == EINVAL))
+        {
+            APPL_TRACE_WARNING("%s: uhid has no UHID_INPUT2, writing UHID_INPUT", __FUNCTION__);
+            p_dev->uhid_legacy = TRUE;
+        }
+        else if (ret < 0)
+        {
+            APPL_TRACE_ERROR("%s: Cannot write to uhid:%s", __FUNCTION__, strerror(errno));
+        }
+        else
+        {
+            p_dev->uhid_stats.writes++;
+        }
+    }
+
+    now = uhid_now_us();
+    for (i = 0; i < num; i++)
+    {
+        p_rpt = &p_dev->uhid_queue[(tail + i) & UHID_QUEUE_MASK];
+        len = p_rpt->p_buf->len;
+
+        if (fd >= 0 && p_dev->uhid_legacy)
+        {
+            p = (UINT8 *)(p_rpt->p_buf + 1) + p_rpt->p_buf->offset;
+            p_dev->uhid_stats.writes++;
+            if (uhid_write_legacy(fd, p, len) == 0)
+                uhid_account(&p_dev->uhid_stats, p_rpt->rx_us, uhid_now_us());
+            else
+                __atomic_add_fetch(&p_dev->uhid_stats.dropped, 1, __ATOMIC_RELAXED);
+        }
+        else if (ret > 0 && ret >= (ssize_t)iov[i].iov_len)
+        {
+            /* a failing event ends the writev() short */
+            ret -= iov[i].iov_len;
+            uhid_account(&p_dev->uhid_stats, p_rpt->rx_us, now);
+        }
+        else
+        {
+            ret = 0;
+            __atomic_add_fetch(&p_dev->uhid_stats.dropped, 1, __ATOMIC_RELAXED);
+        }
+        GKI_freebuf(p_rpt->p_buf);
+    }
+
+    __atomic_store_n(&p_dev->uhid_tail, tail + num, __ATOMIC_RELEASE);
+    /* pairs with the fence of uhid_queue: either BTU sees the queue drained
+       and wakes the writer, or the writer sees the new report. Likewise
+       with uhid_stop for uhid_draining. */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&p_dev->uhid_draining, __ATOMIC_RELAXED))
+    {
+        pthread_mutex_lock(&uhid_drain_lock);
+        pthread_cond_broadcast(&uhid_drain_cond);
+        pthread_mutex_unlock(&uhid_drain_lock);
+    }
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         uhid_writer_thread
+**
+** Description      Writes the input reports of every HID device to uhid.
+**                  Sleeps on an eventfd that BTU signals when it queues a
+**                  report the writer may have missed; a burst of reports
+**                  arriving while the writer is busy costs no wakeup.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void *uhid_writer_thread(void *arg)
+{
+    UINT64  val;
+    BOOLEAN busy;
+    int     i;
+    UNUSED(arg);
+
+    raise_priority_a2dp(TASK_HIGH_HH_UHID);
+
+    for (;;)
+    {
+        do
+        {
+            busy = FALSE;
+            for (i = 0; i < BTIF_HH_MAX_HID; i++)
+                busy |= uhid_flush(&btif_hh_cb.devices[i]);
+        } while (busy);
+
+        if (read(uhid_writer_wake_fd, &val, sizeof(val)) < 0 && errno != EINTR)
+        {
+            APPL_TRACE_ERROR("%s: Cannot read wake fd: %s", __FUNCTION__, strerror(errno));
+            break;
+        }
+    }
+
+    /* nobody empties the queues any more, uhid_stop does it itself */
+    pthread_mutex_lock(&uhid_drain_lock);
+    uhid_writer_exited = TRUE;
+    pthread_cond_broadcast(&uhid_drain_cond);
+    pthread_mutex_unlock(&uhid_drain_lock);
+
+    return 0;
+}
+
+/*******************************************************************************
+**
+** Function         uhid_writer_init
+**
+** Description      Start the uhid writer thread, once per process.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void uhid_writer_init(void)
+{
+    uhid_writer_wake_fd = eventfd(0, EFD_CLOEXEC);
+    if (uhid_writer_wake_fd < 0)
+    {
+        APPL_TRACE_ERROR("%s: eventfd failed: %s", __FUNCTION__, strerror(errno));
+        return;
+    }
+
+    if (create_thread(uhid_writer_thread, NULL) == (pthread_t)-1)
+    {
+        close(uhid_writer_wake_fd);
+        uhid_writer_wake_fd = -1;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         uhid_queue
+**
+** Description      Queue an input report for the uhid writer thread, which
+**                  frees the buffer. The buffer needs UHID_INPUT2_HDR_LEN
+**                  bytes of headroom. Called on BTU or the BTU data thread.
+**                  The report is dropped if the device is being stopped.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void uhid_queue(btif_hh_device_t *p_dev, BT_HDR *p_buf, UINT64 rx_us)
+{
+    UINT32  head;
+    UINT64  val = 1;
+    BOOLEAN wake;
+
+    pthread_mutex_lock(&uhid_queue_lock);
+    head = p_dev->uhid_head;
+
+    /* uhid_stop may have run since the caller checked */
+    if (!p_dev->uhid_active ||
+        head - __atomic_load_n(&p_dev->uhid_tail, __ATOMIC_ACQUIRE) >= BTIF_HH_UHID_QUEUE_SIZE)
+    {
+        pthread_mutex_unlock(&uhid_queue_lock);
+        __atomic_add_fetch(&p_dev->uhid_stats.dropped, 1, __ATOMIC_RELAXED);
+        GKI_freebuf(p_buf);
+        return;
+    }
+
+    p_dev->uhid_queue[head & UHID_QUEUE_MASK].p_buf = p_buf;
+    p_dev->uhid_queue[head & UHID_QUEUE_MASK].rx_us = rx_us;
+    __atomic_store_n(&p_dev->uhid_head, head + 1, __ATOMIC_RELEASE);
+
+    /* the writer only sleeps after finding the queue empty */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    wake = (__atomic_load_n(&p_dev->uhid_tail, __ATOMIC_RELAXED) == head);
+    pthread_mutex_unlock(&uhid_queue_lock);
+
+    if (wake)
+    {
+        if (write(uhid_writer_wake_fd, &val, sizeof(val)) < 0)
+            APPL_TRACE_ERROR("%s: Cannot wake the writer: %s", __FUNCTION__, strerror(errno));
+    }
+}
+
+/*******************************************************************************
+**
+** Function         uhid_stop
+**
+** Description      Stop queueing input reports for a device and wait until
+**                  the writer thread has written those already queued. The
+**                  writer no longer uses the fd of the device afterwards, so
+**                  it can be closed. Called on the btif thread.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void uhid_stop(btif_hh_device_t *p_dev)
+{
+    btif_hh_uhid_rpt_t  *p_rpt;
+
+    /* no producer queues a report once it has seen this */
+    pthread_mutex_lock(&uhid_queue_lock);
+    p_dev->uhid_active = FALSE;
+    pthread_mutex_unlock(&uhid_queue_lock);
+
+    pthread_mutex_lock(&uhid_drain_lock);
+    __atomic_store_n(&p_dev->uhid_draining, TRUE, __ATOMIC_SEQ_CST);
+    while (!uhid_writer_exited &&
+           __atomic_load_n(&p_dev->uhid_tail, __ATOMIC_SEQ_CST) != p_dev->uhid_head)
+    {
+        pthread_cond_wait(&uhid_drain_cond, &uhid_drain_lock);
+    }
+    __atomic_store_n(&p_dev->uhid_draining, FALSE, __ATOMIC_RELAXED);
+
+    /* the writer is gone, drop what it left */
+    while (p_dev->uhid_tail != p_dev->uhid_head)
+    {
+        p_rpt = &p_dev->uhid_queue[p_dev->uhid_tail++ & UHID_QUEUE_MASK];
+        GKI_freebuf(p_rpt->p_buf);
+        p_dev->uhid_stats.dropped++;
+    }
+    pthread_mutex_unlock(&uhid_drain_lock);
+}
+
+/*******************************************************************************
+**
+** Function         uhid_copy_rpt
+**
+** Description      Copy a report into a buffer with room for the uhid event
+**                  header.
+**
+** Returns          the buffer, NULL if out of buffers or the report is too big
+**
+*******************************************************************************/
+static BT_HDR *uhid_copy_rpt(const UINT8 *p_rpt, UINT16 len)
+{
+    BT_HDR  *p_buf;
+
+    if (len > UHID_DATA_MAX)
+        return NULL;
+
+    if ((p_buf = (BT_HDR *)GKI_getbuf(sizeof(BT_HDR) + UHID_INPUT2_HDR_LEN + len)) != NULL)
+    {
+        p_buf->offset = UHID_INPUT2_HDR_LEN;
+        p_buf->len = len;
+        memcpy((UINT8 *)(p_buf + 1) + p_buf->offset, p_rpt, len);
+    }
+    return p_buf;
+}
+
+/*******************************************************************************
+**
+** Function         uhid_log_stats
+**
+** Description      Log the input report latency of a device.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void uhid_log_stats(btif_hh_device_t *p_dev)
+{
+    btif_hh_uhid_stats_t *p_stats = &p_dev->uhid_stats;
+    const UINT32         *h = p_stats->lat_hist;
+
+    if (p_stats->reports == 0)
+        return;
+
+    APPL_TRACE_WARNING("%s: dev_handle %d: %u reports in %u writes, %u dropped, "
+                       "latency us mean %u max %u", __FUNCTION__, p_dev->dev_handle,
+                       p_stats->reports, p_stats->writes, p_stats->dropped,
+                       (UINT32)(p_stats->lat_sum_us / p_stats->reports), p_stats->lat_max_us);
+    APPL_TRACE_WARNING("%s: latency <125us %u <250us %u <500us %u <1ms %u <2ms %u "
+                       "<4ms %u <8ms %u more %u", __FUNCTION__,
+                       h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7]);
+}
+
+void bta_hh_co_destroy(btif_hh_device_t *p_dev)
 {
     struct uhid_event ev;
+
+    /* the uhid writer thread must be done with the fd before it is closed */
+    uhid_stop(p_dev);
+
     memset(&ev, 0, sizeof(ev));
     ev.type = UHID_DESTROY;
-    uhid_write(fd, &ev);
-    APPL_TRACE_DEBUG("%s:closing fd = %d",__FUNCTION__, fd);
-    close(fd);
+    uhid_write(p_dev->fd, &ev);
+    APPL_TRACE_DEBUG("%s:closing fd = %d",__FUNCTION__, p_dev->fd);
+    close(p_dev->fd);
+    p_dev->fd = -1;
 }
 
 int bta_hh_co_write(int fd, UINT8* rpt, UINT16 len)
@@ -436,6 +853,14 @@ void bta_hh_co_open(UINT8 dev_handle, UINT8 sub_class, tBTA_HH_ATTR_MASK attr_ma
     }
 
     p_dev->dev_status = BTHH_CONN_STATE_CONNECTED;
+
+    /* input reports go through the uhid writer thread */
+    pthread_once(&uhid_writer_once, uhid_writer_init);
+    memset(&p_dev->uhid_stats, 0, sizeof(p_dev->uhid_stats));
+    pthread_mutex_lock(&uhid_queue_lock);
+    p_dev->uhid_active = (uhid_writer_wake_fd >= 0 && p_dev->fd >= 0);
+    pthread_mutex_unlock(&uhid_queue_lock);
+
     APPL_TRACE_DEBUG("%s: Return device status %d", __FUNCTION__, p_dev->dev_status);
 }
 
@@ -471,6 +896,8 @@ void bta_hh_co_close(UINT8 dev_handle, UINT8 app_id)
                                                         ,__FUNCTION__,p_dev->dev_status
                                                         ,p_dev->dev_handle);
             btif_hh_close_poll_thread(p_dev);
+            uhid_stop(p_dev);
+            uhid_log_stats(p_dev);
             break;
         }
      }
@@ -497,6 +924,7 @@ void bta_hh_co_data(UINT8 dev_handle, UINT8 *p_rpt, UINT16 len, tBTA_HH_PROTO_MO
                     UINT8 sub_class, UINT8 ctry_code, BD_ADDR peer_addr, UINT8 app_id)
 {
     btif_hh_device_t *p_dev;
+    BT_HDR *p_buf;
     UNUSED(peer_addr);
 
     APPL_TRACE_VERBOSE("%s: dev_handle = %d, subclass = 0x%02X, mode = %d, "
@@ -509,7 +937,12 @@ void bta_hh_co_data(UINT8 dev_handle, UINT8 *p_rpt, UINT16 len, tBTA_HH_PROTO_MO
         return;
     }
     // Send the HID report to the kernel.
-    if (p_dev->fd >= 0) {
+    if (p_dev->uhid_active) {
+        if ((p_buf = uhid_copy_rpt(p_rpt, len)) != NULL)
+            uhid_queue(p_dev, p_buf, uhid_now_us());
+        else
+            __atomic_add_fetch(&p_dev->uhid_stats.dropped, 1, __ATOMIC_RELAXED);
+    } else if (p_dev->fd >= 0) {
         bta_hh_co_write(p_dev->fd, p_rpt, len);
     }else {
         APPL_TRACE_WARNING("%s: Error: fd = %d, len = %d", __FUNCTION__, p_dev->fd, len);
@@ -517,6 +950,47 @@ void bta_hh_co_data(UINT8 dev_handle, UINT8 *p_rpt, UINT16 len, tBTA_HH_PROTO_MO
 }
 
 
+/*******************************************************************************
+**
+** Function         bta_hh_co_intr_data
+**
+** Description      This function is executed by BTA, on BTU or the BTU data
+**                  thread, for an input report received on the interrupt
+**                  channel of an open device, before it is queued to the BTA
+**                  task.
+**
+** Parameters       dev_handle  - device handle
+**                  p_buf       - the report, its offset past the HID header
+**
+** Returns          TRUE if the buffer was taken, FALSE to pass the report
+**                  through the BTA task to bta_hh_co_data
+*******************************************************************************/
+BOOLEAN bta_hh_co_intr_data(UINT8 dev_handle, BT_HDR *p_buf)
+{
+    UINT64 rx_us = uhid_now_us();
+    btif_hh_device_t *p_dev = btif_hh_find_connected_dev_by_handle(dev_handle);
+    BT_HDR *p_copy;
+
+    if (p_dev == NULL || !p_dev->uhid_active)
+        return FALSE;
+
+    /* L2CAP leaves its own headers in front of the report */
+    if (p_buf->offset < UHID_INPUT2_HDR_LEN || p_buf->len > UHID_DATA_MAX)
+    {
+        p_copy = uhid_copy_rpt((UINT8 *)(p_buf + 1) + p_buf->offset, p_buf->len);
+        GKI_freebuf(p_buf);
+        if ((p_buf = p_copy) == NULL)
+        {
+            __atomic_add_fetch(&p_dev->uhid_stats.dropped, 1, __ATOMIC_RELAXED);
+            return TRUE;
+        }
+    }
+
+    uhid_queue(p_dev, p_buf, rx_us);
+    return TRUE;
+}
+
+
 /*******************************************************************************
 **
 ** Function         bta_hh_co_send_hid_info
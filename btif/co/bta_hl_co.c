@@ -378,28 +378,21 @@ void bta_hl_co_put_rx_data (UINT8 app_id, tBTA_HL_MDL_HANDLE mdl_handle,
     {
         p_dcb = BTIF_HL_GET_MDL_CB_PTR(app_idx, mcl_idx, mdl_idx);
 
-        if ((p_dcb->p_rx_pkt = (UINT8 *)btif_hl_get_buf(data_size)) != NULL)
+        if (p_dcb->p_scb)
         {
-            memcpy(p_dcb->p_rx_pkt, p_data, data_size);
-            if (p_dcb->p_scb)
-            {
-                BTIF_TRACE_DEBUG("app_idx=%d mcl_idx=0x%x mdl_idx=0x%x data_size=%d",
-                                  app_idx, mcl_idx, mdl_idx, data_size);
-                r = send(p_dcb->p_scb->socket_id[1], p_dcb->p_rx_pkt, data_size, 0);
-
-                if (r == data_size)
-                {
-                    BTIF_TRACE_DEBUG("socket send success data_size=%d",  data_size);
-                    status = BTA_HL_STATUS_OK;
-                }
-                else
-                {
-                    BTIF_TRACE_ERROR("socket send failed r=%d data_size=%d",r, data_size);
-                }
-
+            BTIF_TRACE_DEBUG("app_idx=%d mcl_idx=0x%x mdl_idx=0x%x data_size=%d",
+                              app_idx, mcl_idx, mdl_idx, data_size);
+            r = send(p_dcb->p_scb->socket_id[1], p_data, data_size, 0);
 
+            if (r == data_size)
+            {
+                BTIF_TRACE_DEBUG("socket send success data_size=%d",  data_size);
+                status = BTA_HL_STATUS_OK;
+            }
+            else
+            {
+                BTIF_TRACE_ERROR("socket send failed r=%d data_size=%d",r, data_size);
             }
-            btif_hl_free_buf((void **) &p_dcb->p_rx_pkt);
         }
     }
 
@@ -407,6 +400,37 @@ void bta_hl_co_put_rx_data (UINT8 app_id, tBTA_HL_MDL_HANDLE mdl_handle,
 }
 
 
+/*******************************************************************************
+**
+** Function        bta_hl_co_put_rx_buf
+**
+** Description     Take a received APDU by reference. It is queued for the
+**                 select thread, which writes it to the app socket from the
+**                 buffer itself.
+**
+** Parameters      app_id - HDP application ID
+**                 mdl_handle - MDL handle
+**                 p_buf - the buffer holding the APDU
+**
+** Returns        TRUE if the buffer was taken, FALSE to have the data put
+**                with bta_hl_co_put_rx_data
+**
+*******************************************************************************/
+BOOLEAN bta_hl_co_put_rx_buf (UINT8 app_id, tBTA_HL_MDL_HANDLE mdl_handle,
+                              BT_HDR *p_buf)
+{
+    UINT8 app_idx, mcl_idx, mdl_idx;
+    btif_hl_mdl_cb_t *p_dcb;
+    UNUSED(app_id);
+
+    if (!btif_hl_find_mdl_idx_using_handle(mdl_handle, &app_idx, &mcl_idx, &mdl_idx))
+        return FALSE;
+
+    p_dcb = BTIF_HL_GET_MDL_CB_PTR(app_idx, mcl_idx, mdl_idx);
+    return btif_hl_queue_rx_buf(p_dcb, p_buf);
+}
+
+
 /*******************************************************************************
 **
 ** Function         bta_hl_co_get_tx_data
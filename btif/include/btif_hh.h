@@ -43,6 +43,16 @@
 #define BTIF_HH_KEYSTATE_MASK_CAPSLOCK   0x02
 #define BTIF_HH_KEYSTATE_MASK_SCROLLLOCK 0x04
 
+/* Input reports queued per device for the uhid writer thread.
+** Must be a power of 2. */
+#ifndef BTIF_HH_UHID_QUEUE_SIZE
+#define BTIF_HH_UHID_QUEUE_SIZE          64
+#endif
+
+/* Latency histogram from L2CAP receive to uhid write: bucket i counts the
+** reports written within 125 << i us, the last one all slower reports */
+#define BTIF_HH_UHID_LAT_BUCKETS         8
+
 
 /*******************************************************************************
 **  Type definitions and return values
@@ -59,6 +69,23 @@ typedef enum
     BTIF_HH_DEV_DISCONNECTED
 } BTIF_HH_STATUS;
 
+/* An input report waiting for the uhid writer thread */
+typedef struct
+{
+    BT_HDR                        *p_buf;
+    UINT64                        rx_us;        /* receive time, CLOCK_MONOTONIC */
+} btif_hh_uhid_rpt_t;
+
+typedef struct
+{
+    UINT32                        reports;      /* input reports written to uhid */
+    UINT32                        writes;       /* system calls that wrote them */
+    UINT32                        dropped;      /* queue full or write failed */
+    UINT32                        lat_max_us;
+    UINT64                        lat_sum_us;
+    UINT32                        lat_hist[BTIF_HH_UHID_LAT_BUCKETS];
+} btif_hh_uhid_stats_t;
+
 typedef struct
 {
     bthh_connection_state_t       dev_status;
@@ -73,6 +100,15 @@ typedef struct
     BOOLEAN                       vup_timer_active;
     TIMER_LIST_ENT                vup_timer;
     BOOLEAN                       local_vup; // Indicated locally initiated VUP
+    /* input reports, queued by BTU or the BTU data thread and written by
+       the uhid writer thread */
+    btif_hh_uhid_rpt_t            uhid_queue[BTIF_HH_UHID_QUEUE_SIZE];
+    UINT32                        uhid_head;    /* written under uhid_queue_lock */
+    UINT32                        uhid_tail;    /* written by the writer only */
+    BOOLEAN                       uhid_active;  /* BTU may queue reports, under uhid_queue_lock */
+    BOOLEAN                       uhid_draining; /* uhid_stop waits for the writer */
+    BOOLEAN                       uhid_legacy;  /* kernel lacks UHID_INPUT2 */
+    btif_hh_uhid_stats_t          uhid_stats;
 } btif_hh_device_t;
 
 /* Control block to maintain properties of devices */
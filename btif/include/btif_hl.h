@@ -39,6 +39,17 @@
 #define BTIF_HL_CCH_NUM_FILTER_ELEMS            3
 #define BTIF_HL_APPLICATION_NAME_LEN          512
 
+/* APDUs read from an app socket and not yet confirmed by BTA. The socket
+** is not read while the window is full or the channel is congested. */
+#ifndef BTIF_HL_TX_WINDOW
+#define BTIF_HL_TX_WINDOW                     4
+#endif
+
+/* Received APDUs written to an app socket by one sendmsg() */
+#ifndef BTIF_HL_RX_MAX_BATCH
+#define BTIF_HL_RX_MAX_BATCH                  16
+#endif
+
 
 
 /*******************************************************************************
@@ -157,6 +168,24 @@ typedef struct
     btif_hl_filter_elem_t   elem[BTIF_HL_CCH_NUM_FILTER_ELEMS];
 } btif_hl_cch_filter_t;
 
+/* Data path counters of an MDL, logged when it is cleaned up */
+typedef struct
+{
+    UINT64                  start_us;       /* socket connected */
+    UINT64                  rx_bytes;
+    UINT64                  rx_lat_sum_us;  /* from BTA to the app socket */
+    UINT32                  rx_lat_max_us;
+    UINT32                  rx_apdus;
+    UINT32                  rx_writes;      /* sendmsg() calls that carried them */
+    UINT32                  rx_drops;
+    UINT64                  tx_bytes;
+    UINT64                  tx_lat_sum_us;  /* from the app socket to MCAP */
+    UINT32                  tx_lat_max_us;
+    UINT32                  tx_apdus;
+    UINT32                  tx_errors;
+    UINT32                  tx_pauses;      /* socket reads held back */
+} btif_hl_mdl_stats_t;
+
 typedef struct
 {
     BOOLEAN                 in_use;
@@ -181,6 +210,13 @@ typedef struct
     BOOLEAN                 cong;
     btif_hl_soc_cb_t        *p_scb;
     int                     channel_id;
+    BUFFER_Q                rx_q;           /* APDUs for the app socket, under GKI_disable */
+    BOOLEAN                 rx_signaled;    /* the select thread was woken for rx_q */
+    UINT32                  tx_head;        /* APDUs sent, select thread */
+    UINT32                  tx_tail;        /* APDUs confirmed, btif thread */
+    UINT64                  tx_start_us[BTIF_HL_TX_WINDOW];
+    BOOLEAN                 tx_paused;      /* socket out of the select set */
+    btif_hl_mdl_stats_t     stats;
 } btif_hl_mdl_cb_t;
 
 typedef struct
@@ -321,6 +357,7 @@ extern BOOLEAN  btif_hl_save_mdl_cfg(UINT8 app_id, UINT8 item_idx, tBTA_HL_MDL_C
 extern BOOLEAN  btif_hl_delete_mdl_cfg(UINT8 app_id, UINT8 item_idx);
 extern void * btif_hl_get_buf(UINT16 size);
 extern void btif_hl_free_buf(void **p);
+extern BOOLEAN btif_hl_queue_rx_buf(btif_hl_mdl_cb_t *p_dcb, BT_HDR *p_buf);
 extern BOOLEAN btif_hl_find_mdl_idx_using_handle(tBTA_HL_MDL_HANDLE mdl_handle,
                                                  UINT8 *p_app_idx,UINT8 *p_mcl_idx,
                                                  UINT8 *p_mdl_idx);
@@ -0,0 +1,150 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*****************************************************************************
+ *
+ *  Filename:      btif_msbc.h
+ *
+ *  Description:   mSBC wideband speech codec for SCO routed over HCI
+ *
+ *                 Every 7.5 ms the codec turns 120 PCM samples at 16 kHz
+ *                 into one 57 byte mSBC frame. On air a frame travels in a
+ *                 60 byte packet: a 2 byte H2 synchronization header, the
+ *                 frame and one pad byte.
+ *
+ *                 TX runs on the BTU thread: btif_msbc_tx_read cuts the
+ *                 packets into SCO packets of any size, encoding a new one
+ *                 from the PCM source when needed.
+ *
+ *                 RX is split between two threads with no lock in between.
+ *                 The BTU thread hands SCO payloads to btif_msbc_rx_data,
+ *                 which realigns them on H2 headers and queues the packets
+ *                 in a jitter buffer. The audio thread calls
+ *                 btif_msbc_decode every 7.5 ms, which plays the oldest
+ *                 packet or conceals a lost one.
+ *
+ *                 The SCO over HCI call-outs in bta_dm_co.c are meant to
+ *                 drive the codec, but they need a btui codec that is not
+ *                 in this tree, so for now test/msbc_bench is its only user.
+ *
+ *                 The SBC encoder keeps its analysis filter in globals and
+ *                 is shared with A2DP. Both users take it with
+ *                 btif_sbc_enc_lock around every call into it.
+ *
+ *****************************************************************************/
+
+#ifndef BTIF_MSBC_H
+#define BTIF_MSBC_H
+
+#include "data_types.h"
+
+/*****************************************************************************
+**  Constants & Macros
+******************************************************************************/
+
+#define BTIF_MSBC_PKT_LEN           60      /* H2 header, frame, pad byte */
+#define BTIF_MSBC_H2_LEN            2
+#define BTIF_MSBC_FRAME_LEN         57
+#define BTIF_MSBC_SAMPLES           120     /* per frame, 7.5 ms at 16 kHz */
+#define BTIF_MSBC_FRAME_US          7500
+
+/* Packets the jitter buffer holds. Must be a power of 2. */
+#ifndef BTIF_MSBC_JITTER_SLOTS
+#define BTIF_MSBC_JITTER_SLOTS      8
+#endif
+
+/* Packets queued before playout starts, or restarts after an underrun.
+** Each one adds 7.5 ms of latency and absorbs 7.5 ms of delivery jitter. */
+#ifndef BTIF_MSBC_JITTER_DEPTH
+#define BTIF_MSBC_JITTER_DEPTH      2
+#endif
+
+/* Consecutive lost frames that are concealed before the output fades to
+** silence */
+#ifndef BTIF_MSBC_PLC_MAX_FRAMES
+#define BTIF_MSBC_PLC_MAX_FRAMES    5
+#endif
+
+/* Users of the SBC encoder */
+#define BTIF_SBC_ENC_NONE           0
+#define BTIF_SBC_ENC_A2DP           1
+#define BTIF_SBC_ENC_MSBC           2
+
+/* Results of btif_msbc_decode */
+#define BTIF_MSBC_DECODED           0       /* a packet was decoded */
+#define BTIF_MSBC_CONCEALED         1       /* a lost or bad packet was concealed */
+#define BTIF_MSBC_BUFFERING         2       /* the jitter buffer is filling up */
+typedef UINT8 tBTIF_MSBC_RESULT;
+
+/*****************************************************************************
+**  Type definitions
+******************************************************************************/
+
+/* Provides up to num PCM samples to encode. Returns the number provided;
+** the rest of the frame is sent as silence. Called on the BTU thread. */
+typedef UINT16 (tBTIF_MSBC_PCM_CBACK) (INT16 *p_pcm, UINT16 num);
+
+typedef struct
+{
+    UINT32  tx_frames;          /* frames encoded */
+    UINT32  rx_pkts;            /* packets queued in the jitter buffer */
+    UINT32  rx_bad;             /* packets flagged by the controller */
+    UINT32  rx_resync;          /* bytes skipped to find an H2 header */
+    UINT32  rx_overrun;         /* packets dropped, jitter buffer full */
+    UINT32  dec_frames;         /* packets decoded */
+    UINT32  dec_errors;         /* packets whose frame did not decode */
+    UINT32  seq_gaps;           /* packets missing from the H2 sequence */
+    UINT32  concealed;          /* frames concealed */
+    UINT32  underruns;          /* playout found the jitter buffer empty */
+} tBTIF_MSBC_STATS;
+
+/*****************************************************************************
+**  Functions
+******************************************************************************/
+
+/* Reset the codec and the jitter buffer before a SCO connection opens.
+** p_pcm_cback is the TX audio source, it may be NULL. */
+extern void btif_msbc_init(tBTIF_MSBC_PCM_CBACK *p_pcm_cback);
+
+/* TX, BTU thread: fill p_buf with len bytes of the packet stream */
+extern void btif_msbc_tx_read(UINT8 *p_buf, UINT16 len);
+
+/* Encode BTIF_MSBC_SAMPLES samples into one BTIF_MSBC_PKT_LEN byte packet */
+extern void btif_msbc_encode(const INT16 *p_pcm, UINT8 *p_pkt);
+
+/* RX, BTU thread: queue the payload of one SCO packet. bad is TRUE if the
+** controller flagged the data as erroneous or lost. */
+extern void btif_msbc_rx_data(const UINT8 *p_data, UINT16 len, BOOLEAN bad);
+
+/* RX, audio thread: write BTIF_MSBC_SAMPLES samples of the next frame */
+extern tBTIF_MSBC_RESULT btif_msbc_decode(INT16 *p_pcm);
+
+/* Packets in the jitter buffer */
+extern UINT16 btif_msbc_rx_depth(void);
+
+extern void btif_msbc_get_stats(tBTIF_MSBC_STATS *p_stats);
+
+/* Take the SBC encoder for user. Returns TRUE if another user ran it since
+** user released it: its globals then belong to the other stream and user
+** must call SBC_Encoder_Init before encoding. */
+extern BOOLEAN btif_sbc_enc_lock(UINT8 user);
+
+/* Release the SBC encoder taken with btif_sbc_enc_lock */
+extern void btif_sbc_enc_unlock(UINT8 user);
+
+#endif /* BTIF_MSBC_H */
@@ -81,8 +81,6 @@ typedef struct
     int open_count;
     int flow; // 1: outbound data flow on; 0: outbound data flow off
     btpan_conn_t conns[MAX_PAN_CONNS];
-    int congest_packet_size;
-    unsigned char congest_packet[1600]; //max ethernet packet size
 } btpan_cb_t;
 
 
@@ -140,6 +140,22 @@ bt_status_t btif_storage_add_bonded_device(bt_bdaddr_t *remote_bd_addr,
 *******************************************************************************/
 bt_status_t btif_storage_remove_bonded_device(bt_bdaddr_t *remote_bd_addr);
 
+/*******************************************************************************
+**
+** Function         btif_storage_get_link_key
+**
+** Description      BTIF storage API - Fetches the link-key, key type and
+**                  pin key length of a bonded device from NVRAM
+**
+** Returns          BT_STATUS_SUCCESS if the device has a stored link key,
+**                  BT_STATUS_FAIL otherwise
+**
+*******************************************************************************/
+bt_status_t btif_storage_get_link_key(bt_bdaddr_t *remote_bd_addr,
+                                      LINK_KEY link_key,
+                                      uint8_t *p_key_type,
+                                      uint8_t *p_pin_length);
+
 /*******************************************************************************
 **
 ** Function         btif_storage_is_device_bonded
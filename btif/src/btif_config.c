@@ -21,8 +21,9 @@
  *  Filename:      btif_config.c
  *
  *  Description:   Stores the local BT adapter and remote device properties in
- *                 NVRAM storage, typically as xml file in the
- *                 mobile's filesystem
+ *                 NVRAM storage, as a binary snapshot in the mobile's
+ *                 filesystem plus a journal of changes made since. An
+ *                 existing xml config is imported on first load.
  *
  *
  ***********************************************************************************/
@@ -33,6 +34,7 @@
 #include <stdio.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <limits.h>
 #include <unistd.h>
 #include <dirent.h>
 #include <sys/types.h>
@@ -59,6 +61,8 @@
 #define CFG_FILE_EXT ".xml"
 #define CFG_FILE_EXT_OLD ".old"
 #define CFG_FILE_EXT_NEW ".new"
+#define CFG_FILE_EXT_JOURNAL ".journal"
+#define CFG_FILE_EXT_BIN ".bin"
 #define CFG_GROW_SIZE (10*sizeof(cfg_node))
 #define GET_CHILD_MAX_COUNT(node) (short)((int)(node)->bytes / sizeof(cfg_node))
 #define GET_CHILD_COUNT(p) (short)((int)(p)->used / sizeof(cfg_node))
@@ -67,12 +71,34 @@
 #define GET_NODE_COUNT(bytes) (bytes / sizeof(cfg_node))
 #define GET_NODE_BYTES(c) (c * sizeof(cfg_node))
 #define MAX_NODE_BYTES 32000
+//parents with at least this many children get a hash index, smaller ones are scanned
+#define CFG_INDEX_MIN_CHILDREN 8
 #define CFG_CMD_SAVE 1
+#define CFG_JOURNAL_MAGIC 0x4A43
+#define CFG_JOURNAL_OP_SET 1
+#define CFG_JOURNAL_OP_REMOVE 2
+#define CFG_JOURNAL_GROW_SIZE 1024
+//journal size on disk at which the next save compacts it into a new snapshot
+#define CFG_JOURNAL_MAX_BYTES (64*1024)
+#define CFG_SNAPSHOT_MAGIC 0x46434442
+#define CFG_SNAPSHOT_VERSION 2
+#define CFG_JOURNAL_FILE_MAGIC 0x4A434642
 
 #ifndef FALSE
 #define TRUE 1
 #define FALSE 0
 #endif
+typedef struct
+{
+    uint32_t hash;
+    short pos;      //child position, -1 if the slot is empty
+} cfg_index_entry;
+typedef struct
+{
+    int mask;       //table size - 1, table size is a power of 2
+    int count;
+    cfg_index_entry entry[];
+} cfg_index;
 typedef struct cfg_node_s
 {
     const char* name;
@@ -84,18 +110,71 @@ typedef struct cfg_node_s
     short bytes;
     short type;
     short used;
-    short flag;
+    short index;    //name lookup of the children, rebuilt on demand: index_slots position + 1, 0 if none
 } cfg_node;
 
+//one journal or snapshot record is this header followed by the section, key and name
+//strings (each including its terminating 0, name_len 0 means NULL) and value_len bytes
+//of value
+typedef struct
+{
+    uint16_t magic;
+    uint8_t op;
+    uint8_t reserved;
+    uint16_t type;
+    uint16_t section_len;
+    uint16_t key_len;
+    uint16_t name_len;
+    uint16_t value_len;
+    uint16_t reserved2;
+    uint32_t checksum;
+} cfg_journal_rec;
+
+//the binary snapshot is this header followed by record_count CFG_JOURNAL_OP_SET records
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t hdr_len;
+    uint32_t record_bytes;
+    uint32_t record_count;
+    uint32_t generation;    //bumped by every save, the journal names the one it applies to
+} cfg_snapshot_hdr;
+
+//the journal file is this header followed by records
+typedef struct
+{
+    uint32_t magic;
+    uint32_t generation;    //of the snapshot the records apply to
+} cfg_journal_hdr;
+
+typedef struct
+{
+    char* data;
+    int len;
+    int size;
+} cfg_record_buf;
+
 static pthread_mutex_t slot_lock;
 static int pth = -1; //poll thread handle
 static cfg_node root;
 static int cached_change;
 static int save_cmds_queued;
+static cfg_record_buf journal;  //records not yet written to the journal file
+static int journal_fd = -1;
+static int journal_bytes;       //bytes of valid header and records in the journal file
+static uint32_t snapshot_generation;    //of the loaded or last saved snapshot, 0 if none
+//the indexes live outside cfg_node so that a node stays as small as it was, which is
+//what bounds the number of children under MAX_NODE_BYTES
+static cfg_index** index_slots;
+static int index_slot_count;
+static int index_slot_free;     //no free slot below this one
+static int journal_suspended;   //set while the snapshot itself is being loaded
+static int journal_needs_snapshot;
 static void cfg_cmd_callback(int cmd_fd, int type, int flags, uint32_t user_id);
 static inline short alloc_node(cfg_node* p, short grow);
 static inline void free_node(cfg_node* p);
-static inline short find_inode(const cfg_node* p, const char* name);
+static inline short find_inode(cfg_node* p, const char* name);
 static cfg_node* find_node(const char* section, const char* key, const char* name);
 static int remove_node(const char* section, const char* key, const char* name);
 static int remove_filter_node(const char* section, const char* filter[], int filter_count, int max_allowed);
@@ -104,11 +183,16 @@ static int set_node(const char* section, const char* key, const char* name,
                         const char* value, short bytes, short type);
 static int save_cfg();
 static void load_cfg();
+static void journal_append(int op, const char* section, const char* key, const char* name,
+                           const char* value, int bytes, int type);
+static int journal_flush();
+static void journal_replay();
 static short find_next_node(const cfg_node* p, short start, char* name, int* bytes);
 #ifdef UNIT_TEST
 static void cfg_test_load();
 static void cfg_test_write();
 static void cfg_test_read();
+static void cfg_test_lookup_perf();
 #endif
 #define MY_LOG_LEVEL appl_trace_level
 #define MY_LOG_LAYER TRACE_LAYER_NONE | TRACE_ORG_APPL
@@ -118,8 +202,8 @@ static inline void dump_node(const char* title, const cfg_node* p)
     if(p) {
         bdld("%s, p->name:%s, child/value:%p, bytes:%d",
                           title, p->name, p->child, p->bytes);
-        bdld("p->used:%d, type:%x, p->flag:%d",
-                          p->used, p->type, p->flag);
+        bdld("p->used:%d, type:%x, p->index:%d",
+                          p->used, p->type, p->index);
     } else bdld("%s is NULL", title);
 }
 
@@ -146,6 +230,7 @@ int btif_config_init()
         #ifdef UNIT_TEST
             cfg_test_write();
             //cfg_test_read();
+            cfg_test_lookup_perf();
             exit(0);
         #endif
     }
@@ -230,7 +315,13 @@ int btif_config_set(const char* section, const char* key, const char* name, cons
         lock_slot(&slot_lock);
         ret = set_node(section, key, name, value, (short)bytes, (short)type);
         if(ret && !(type & BTIF_CFG_TYPE_VOLATILE))
+        {
+            journal_append(CFG_JOURNAL_OP_SET, section, key, name, value, bytes, type);
             cached_change++;
+        }
+        //volatile values are never persisted, drop any older persisted copy
+        else if(ret)
+            journal_append(CFG_JOURNAL_OP_REMOVE, section, key, name, NULL, 0, 0);
         unlock_slot(&slot_lock);
     }
     return ret;
@@ -245,7 +336,10 @@ int btif_config_remove(const char* section, const char* key, const char* name)
          lock_slot(&slot_lock);
          ret = remove_node(section, key, name);
          if(ret)
+         {
+            journal_append(CFG_JOURNAL_OP_REMOVE, section, key, name, NULL, 0, 0);
             cached_change++;
+         }
          unlock_slot(&slot_lock);
     }
     return ret;
@@ -280,7 +374,7 @@ short btif_config_next_key(short pos, const char* section, char * name, int* byt
     short si = find_inode(&root, section);
     if(si >= 0)
     {
-        const cfg_node* section_node = &root.child[si];
+        cfg_node* section_node = &root.child[si];
         next = find_next_node(section_node, pos, name, bytes);
     }
     unlock_slot(&slot_lock);
@@ -293,7 +387,7 @@ short btif_config_next_value(short pos, const char* section, const char* key, ch
     short si = find_inode(&root, section);
     if(si >= 0)
     {
-        const cfg_node* section_node = &root.child[si];
+        cfg_node* section_node = &root.child[si];
         short ki = find_inode(section_node, key);
         if(ki >= 0)
         {
@@ -362,7 +456,7 @@ void btif_config_flush()
 {
     lock_slot(&slot_lock);
     if(cached_change > 0)
-        save_cfg();
+        journal_flush();
     unlock_slot(&slot_lock);
 }
 
@@ -425,10 +519,86 @@ static inline short alloc_node(cfg_node* p, short grow)
     }
     return -1;
 }
+static inline uint32_t name_hash(const char* name)
+{
+    uint32_t hash = 2166136261u;
+    while(*name)
+        hash = (hash ^ (uint8_t)*name++) * 16777619u;
+    return hash;
+}
+static inline cfg_index* node_index(const cfg_node* p)
+{
+    return p->index ? index_slots[p->index - 1] : NULL;
+}
+static inline void drop_index(cfg_node* p)
+{
+    //children moved or went away, the next lookup rebuilds the index
+    if(p->index)
+    {
+        int slot = p->index - 1;
+        free(index_slots[slot]);
+        index_slots[slot] = NULL;
+        if(slot < index_slot_free)
+            index_slot_free = slot;
+        p->index = 0;
+    }
+}
+static inline void index_insert(cfg_index* index, uint32_t hash, short pos)
+{
+    int i = hash & index->mask;
+    while(index->entry[i].pos >= 0)
+        i = (i + 1) & index->mask;
+    index->entry[i].hash = hash;
+    index->entry[i].pos = pos;
+    index->count++;
+}
+static cfg_index* build_index(cfg_node* p)
+{
+    int count = GET_CHILD_COUNT(p);
+    int size = 16;
+    int i;
+    //keep the load under 1/4 so we can add children for a while before rebuilding
+    while(size < count * 4)
+        size <<= 1;
+    cfg_index* index = (cfg_index*)malloc(sizeof(cfg_index) + size * sizeof(cfg_index_entry));
+    if(!index)
+        return NULL;
+    index->mask = size - 1;
+    index->count = 0;
+    for(i = 0; i < size; i++)
+        index->entry[i].pos = -1;
+    for(i = 0; i < count; i++)
+    {
+        if(p->child[i].name && *p->child[i].name)
+            index_insert(index, name_hash(p->child[i].name), (short)i);
+    }
+    int slot = index_slot_free;
+    while(slot < index_slot_count && index_slots[slot])
+        slot++;
+    if(slot == index_slot_count)
+    {
+        int new_count = index_slot_count + 16;
+        cfg_index** slots = new_count <= SHRT_MAX ?
+                (cfg_index**)realloc(index_slots, new_count * sizeof(cfg_index*)) : NULL;
+        if(!slots)
+        {
+            free(index);
+            return NULL;
+        }
+        memset(slots + index_slot_count, 0, (new_count - index_slot_count) * sizeof(cfg_index*));
+        index_slots = slots;
+        index_slot_count = new_count;
+    }
+    index_slots[slot] = index;
+    index_slot_free = slot + 1;
+    p->index = (short)(slot + 1);
+    return index;
+}
 static inline void free_node(cfg_node* p)
 {
     if(p)
     {
+        drop_index(p);
         if(p->child)
         {
             free(p->child);
@@ -439,15 +609,27 @@ static inline void free_node(cfg_node* p)
             free((void*)p->name);
             p->name = 0;
         }
-        p->used = p->bytes = p->flag = p->type = 0;
+        p->used = p->bytes = p->type = 0;
     }
 }
-static inline short find_inode(const cfg_node* p, const char* name)
+static inline short find_inode(cfg_node* p, const char* name)
 {
     if(p && p->child && name && *name)
     {
         int i;
         int count = GET_CHILD_COUNT(p);
+        const cfg_index* index;
+        if(count >= CFG_INDEX_MIN_CHILDREN && ((index = node_index(p)) || (index = build_index(p))))
+        {
+            uint32_t hash = name_hash(name);
+            for(i = hash & index->mask; index->entry[i].pos >= 0; i = (i + 1) & index->mask)
+            {
+                short pos = index->entry[i].pos;
+                if(index->entry[i].hash == hash && strcmp(p->child[pos].name, name) == 0)
+                    return pos;
+            }
+            return -1;
+        }
         //bdld("parent name:%s, child name:%s, child count:%d", p->name, name, count);
         for(i = 0; i < count; i++)
         {
@@ -489,7 +671,17 @@ static cfg_node* find_add_node(cfg_node* p, const char* name)
     }
     else node = &p->child[i];
     if(node && (!node->name))
+    {
         node->name = strdup(name);
+        cfg_index* index = node_index(p);
+        if(index)
+        {
+            if((index->count + 1) * 2 > index->mask + 1)
+                drop_index(p);
+            else if(node->name)
+                index_insert(index, name_hash(name), (short)(node - p->child));
+        }
+    }
     return node;
 }
 static int set_node(const char* section, const char* key, const char* name,
@@ -606,10 +798,12 @@ static void free_child(cfg_node* p, int ichild, int count)
     {
         int mv_count = child_count - i;
         memmove(p->child + ichild, p->child + i, GET_NODE_BYTES(mv_count));
-        //cleanup the buffer of already moved children
-        memset(p->child + i, 0, GET_NODE_BYTES(mv_count));
+        //cleanup the slots left behind by the moved children
+        int rm_count = i - ichild;
+        memset(p->child + ichild + mv_count, 0, GET_NODE_BYTES(rm_count));
     }
     DEC_CHILD_COUNT(p, i - ichild);
+    drop_index(p);
 }
 static int remove_node(const char* section, const char* key, const char* name)
 {
@@ -719,6 +913,7 @@ static int remove_filter_node(const char* section, const char* filter[], int fil
     {
         if(!value_in_filter(&s->child[i], filter, filter_count))
         {
+            journal_append(CFG_JOURNAL_OP_REMOVE, section, s->child[i].name, NULL, NULL, 0, 0);
             free_child(&s->child[i], 0, GET_CHILD_COUNT(&s->child[i]));
             free_node(&s->child[i]);
             rm_count++;
@@ -729,13 +924,207 @@ static int remove_filter_node(const char* section, const char* filter[], int fil
     if(rm_count)
     {
         pack_child(s);
+        drop_index(s);
         DEC_CHILD_COUNT(s, rm_count);
         return TRUE;
     }
     return FALSE;
 }
 
-static int save_cfg()
+static uint32_t journal_checksum(const cfg_journal_rec* rec, const char* payload, int bytes)
+{
+    //FNV-1a over the header with the checksum field zeroed, then the payload
+    cfg_journal_rec hdr = *rec;
+    const uint8_t* p = (const uint8_t*)&hdr;
+    uint32_t hash = 2166136261u;
+    int i;
+    hdr.checksum = 0;
+    for(i = 0; i < (int)sizeof(hdr); i++)
+        hash = (hash ^ p[i]) * 16777619u;
+    p = (const uint8_t*)payload;
+    for(i = 0; i < bytes; i++)
+        hash = (hash ^ p[i]) * 16777619u;
+    return hash;
+}
+static int append_record(cfg_record_buf* buf, int op, const char* section, const char* key,
+                         const char* name, const char* value, int bytes, int type)
+{
+    cfg_journal_rec rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = CFG_JOURNAL_MAGIC;
+    rec.op = (uint8_t)op;
+    rec.type = (uint16_t)type;
+    rec.section_len = strlen(section) + 1;
+    rec.key_len = strlen(key) + 1;
+    rec.name_len = name ? strlen(name) + 1 : 0;
+    rec.value_len = (op == CFG_JOURNAL_OP_SET && value) ? bytes : 0;
+    int payload_bytes = rec.section_len + rec.key_len + rec.name_len + rec.value_len;
+    int rec_bytes = sizeof(rec) + payload_bytes;
+    if(buf->len + rec_bytes > buf->size)
+    {
+        int new_size = buf->len + rec_bytes + CFG_JOURNAL_GROW_SIZE;
+        char* data = (char*)realloc(buf->data, new_size);
+        if(!data)
+        {
+            bdle("no memory for config record, size:%d", new_size);
+            return FALSE;
+        }
+        buf->data = data;
+        buf->size = new_size;
+    }
+    char* payload = buf->data + buf->len + sizeof(rec);
+    char* p = payload;
+    memcpy(p, section, rec.section_len);
+    p += rec.section_len;
+    memcpy(p, key, rec.key_len);
+    p += rec.key_len;
+    if(rec.name_len)
+    {
+        memcpy(p, name, rec.name_len);
+        p += rec.name_len;
+    }
+    if(rec.value_len)
+        memcpy(p, value, rec.value_len);
+    rec.checksum = journal_checksum(&rec, payload, payload_bytes);
+    memcpy(buf->data + buf->len, &rec, sizeof(rec));
+    buf->len += rec_bytes;
+    return TRUE;
+}
+//returns the number of bytes in the leading run of complete records, applying them if asked
+static int parse_records(const char* data, int size, int apply, int* count)
+{
+    cfg_journal_rec rec;
+    int pos = 0;
+    *count = 0;
+    while(pos + (int)sizeof(rec) <= size)
+    {
+        memcpy(&rec, data + pos, sizeof(rec));
+        const char* section = data + pos + sizeof(rec);
+        const char* key = section + rec.section_len;
+        const char* name = rec.name_len ? key + rec.key_len : NULL;
+        const char* value = key + rec.key_len + rec.name_len;
+        int payload_bytes = rec.section_len + rec.key_len + rec.name_len + rec.value_len;
+        if(rec.magic != CFG_JOURNAL_MAGIC || !rec.section_len || !rec.key_len ||
+           pos + (int)sizeof(rec) + payload_bytes > size ||
+           journal_checksum(&rec, section, payload_bytes) != rec.checksum ||
+           section[rec.section_len - 1] || key[rec.key_len - 1] ||
+           (name && name[rec.name_len - 1]))
+            break;
+        if(apply)
+        {
+            if(rec.op == CFG_JOURNAL_OP_SET && name)
+                set_node(section, key, name, value, (short)rec.value_len, (short)rec.type);
+            else if(rec.op == CFG_JOURNAL_OP_REMOVE)
+                remove_node(section, key, name);
+        }
+        pos += sizeof(rec) + payload_bytes;
+        (*count)++;
+    }
+    return pos;
+}
+static int write_snapshot(const char* file_name, uint32_t generation)
+{
+    cfg_record_buf buf = {NULL, 0, 0};
+    cfg_snapshot_hdr hdr;
+    int si, ki, vi;
+    int ret = FALSE;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = CFG_SNAPSHOT_MAGIC;
+    hdr.version = CFG_SNAPSHOT_VERSION;
+    hdr.hdr_len = sizeof(hdr);
+    hdr.generation = generation;
+    //reserve room for the header, it is filled in once the records are known
+    buf.size = sizeof(hdr) + CFG_JOURNAL_GROW_SIZE;
+    if(!(buf.data = (char*)malloc(buf.size)))
+        return FALSE;
+    buf.len = sizeof(hdr);
+    for(si = 0; si < GET_CHILD_COUNT(&root); si++)
+    {
+        const cfg_node* section_node = &root.child[si];
+        if(!section_node->name || !*section_node->name)
+            continue;
+        for(ki = 0; ki < GET_CHILD_COUNT(section_node); ki++)
+        {
+            const cfg_node* key_node = &section_node->child[ki];
+            if(!key_node->name || !*key_node->name)
+                continue;
+            for(vi = 0; vi < GET_CHILD_COUNT(key_node); vi++)
+            {
+                const cfg_node* value_node = &key_node->child[vi];
+                if(!value_node->name || !*value_node->name ||
+                   (value_node->type & BTIF_CFG_TYPE_VOLATILE))
+                    continue;
+                if(!append_record(&buf, CFG_JOURNAL_OP_SET, section_node->name, key_node->name,
+                                  value_node->name, value_node->value, value_node->used,
+                                  value_node->type))
+                    goto out;
+                hdr.record_count++;
+            }
+        }
+    }
+    hdr.record_bytes = buf.len - sizeof(hdr);
+    memcpy(buf.data, &hdr, sizeof(hdr));
+    int fd = open(file_name, O_WRONLY | O_CREAT | O_TRUNC, 0660);
+    if(fd < 0)
+    {
+        bdle("cannot create %s, error:%s", file_name, strerror(errno));
+        goto out;
+    }
+    int sent = 0;
+    while(sent < buf.len)
+    {
+        int n = write(fd, buf.data + sent, buf.len - sent);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            break;
+        sent += n;
+    }
+    ret = sent == buf.len && fsync(fd) == 0;
+    if(!ret)
+        bdle("writing %s failed, error:%s", file_name, strerror(errno));
+    close(fd);
+out:
+    free(buf.data);
+    return ret;
+}
+static int load_snapshot(const char* file_name)
+{
+    int fd = open(file_name, O_RDONLY);
+    if(fd < 0)
+        return FALSE;
+    struct stat st;
+    char* data = NULL;
+    int size = 0, count = 0;
+    int ret = FALSE;
+    if(fstat(fd, &st) == 0 && st.st_size >= (int)sizeof(cfg_snapshot_hdr) &&
+       (data = (char*)malloc(st.st_size)))
+        size = read(fd, data, st.st_size);
+    close(fd);
+    if(data && size == st.st_size)
+    {
+        cfg_snapshot_hdr hdr;
+        memcpy(&hdr, data, sizeof(hdr));
+        int record_bytes = size - hdr.hdr_len;
+        //check every record before touching the tree, a bad snapshot must not be half loaded
+        if(hdr.magic == CFG_SNAPSHOT_MAGIC && hdr.version == CFG_SNAPSHOT_VERSION &&
+           hdr.hdr_len >= sizeof(hdr) && hdr.hdr_len <= size &&
+           (int)hdr.record_bytes == record_bytes &&
+           parse_records(data + hdr.hdr_len, record_bytes, FALSE, &count) == record_bytes &&
+           count == (int)hdr.record_count)
+        {
+            parse_records(data + hdr.hdr_len, record_bytes, TRUE, &count);
+            snapshot_generation = hdr.generation;
+            bdld("loaded %d values from %s, generation:%u", count, file_name, hdr.generation);
+            ret = TRUE;
+        }
+        else bdle("%s is not a valid config snapshot", file_name);
+    }
+    free(data);
+    return ret;
+}
+
+static int export_cfg()
 {
     const char* file_name = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT;
     const char* file_name_new = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_NEW;
@@ -745,9 +1134,8 @@ static int save_cfg()
         unlink(file_name_old);
     if(access(file_name_new, F_OK) == 0)
         unlink(file_name_new);
-   if(btif_config_save_file(file_name_new))
+    if(btif_config_save_file(file_name_new))
     {
-        cached_change = 0;
         chown(file_name_new, -1, AID_NET_BT_STACK);
         chmod(file_name_new, 0660);
         rename(file_name, file_name_old);
@@ -757,6 +1145,152 @@ static int save_cfg()
     else bdle("btif_config_save_file failed");
     return ret;
 }
+static int save_cfg()
+{
+    const char* file_name = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_BIN;
+    const char* file_name_new = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_BIN CFG_FILE_EXT_NEW;
+    const char* file_name_old = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_BIN CFG_FILE_EXT_OLD;
+    int ret = FALSE;
+    if(access(file_name_old,  F_OK) == 0)
+        unlink(file_name_old);
+    if(access(file_name_new, F_OK) == 0)
+        unlink(file_name_new);
+    if(write_snapshot(file_name_new, snapshot_generation + 1))
+    {
+        cached_change = 0;
+        chown(file_name_new, -1, AID_NET_BT_STACK);
+        chmod(file_name_new, 0660);
+        rename(file_name, file_name_old);
+        rename(file_name_new, file_name);
+        snapshot_generation++;
+        //the new snapshot has everything the journal had. If we die before the
+        //unlink, the journal names the older generation and is dropped on load
+        if(journal_fd >= 0)
+        {
+            close(journal_fd);
+            journal_fd = -1;
+        }
+        unlink(CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_JOURNAL);
+        //keep the xml export in step with the snapshot, so it is never older than
+        //it if both snapshots go bad, and a build that only reads xml keeps its bonds
+        export_cfg();
+        journal_bytes = 0;
+        journal.len = 0;
+        journal_needs_snapshot = FALSE;
+        ret = TRUE;
+    }
+    else bdle("write_snapshot failed");
+    return ret;
+}
+static void journal_append(int op, const char* section, const char* key, const char* name,
+                           const char* value, int bytes, int type)
+{
+    //nothing to log while loading, or when the next save rewrites the snapshot anyway
+    if(journal_suspended || journal_needs_snapshot)
+        return;
+    if(!append_record(&journal, op, section, key, name, value, bytes, type))
+    {
+        bdle("journal record dropped, falling back to a full save");
+        journal_needs_snapshot = TRUE;
+    }
+}
+static int journal_flush()
+{
+    if(journal_needs_snapshot || journal_bytes + journal.len > CFG_JOURNAL_MAX_BYTES)
+    {
+        bdld("compacting journal, journal bytes:%d, pending:%d", journal_bytes, journal.len);
+        //if the snapshot can't be written keep appending, unless the journal is incomplete
+        if(save_cfg() || journal_needs_snapshot)
+            return !journal_needs_snapshot;
+    }
+    if(journal.len > 0)
+    {
+        if(journal_fd < 0)
+        {
+            journal_fd = open(CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_JOURNAL,
+                              O_WRONLY | O_CREAT | O_APPEND, 0660);
+            if(journal_fd < 0)
+            {
+                bdle("cannot open journal, error:%s", strerror(errno));
+                return save_cfg();
+            }
+            fchown(journal_fd, -1, AID_NET_BT_STACK);
+        }
+        if(journal_bytes == 0)
+        {
+            //a new journal starts with the generation of the snapshot it applies to
+            cfg_journal_hdr hdr = {CFG_JOURNAL_FILE_MAGIC, snapshot_generation};
+            if(ftruncate(journal_fd, 0) != 0 ||
+               write(journal_fd, &hdr, sizeof(hdr)) != sizeof(hdr))
+            {
+                bdle("journal header write failed, error:%s", strerror(errno));
+                ftruncate(journal_fd, 0);
+                return save_cfg();
+            }
+            journal_bytes = sizeof(hdr);
+        }
+        int sent = 0;
+        while(sent < journal.len)
+        {
+            int ret = write(journal_fd, journal.data + sent, journal.len - sent);
+            if(ret < 0 && errno == EINTR)
+                continue;
+            if(ret <= 0)
+                break;
+            sent += ret;
+        }
+        //one fsync covers every change batched since the last flush
+        if(sent != journal.len || fsync(journal_fd) != 0)
+        {
+            bdle("journal write failed, error:%s", strerror(errno));
+            //don't leave a torn record in front of whatever gets appended next
+            ftruncate(journal_fd, journal_bytes);
+            return save_cfg();
+        }
+        journal_bytes += journal.len;
+        journal.len = 0;
+    }
+    cached_change = 0;
+    return TRUE;
+}
+static void journal_replay()
+{
+    int fd = open(CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_JOURNAL, O_RDWR);
+    if(fd < 0)
+        return;
+    struct stat st;
+    int size = 0, pos = 0, count = 0;
+    const char* map = MAP_FAILED;
+    if(fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        size = st.st_size;
+        map = (const char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    if(map != MAP_FAILED)
+    {
+        cfg_journal_hdr hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        if(size >= (int)sizeof(hdr))
+            memcpy(&hdr, map, sizeof(hdr));
+        //a journal for another snapshot than the one loaded would undo newer changes
+        if(hdr.magic == CFG_JOURNAL_FILE_MAGIC && hdr.generation == snapshot_generation)
+        {
+            //stop at the first record that was not completely written
+            pos = sizeof(hdr) + parse_records(map + sizeof(hdr), size - sizeof(hdr), TRUE, &count);
+        }
+        else bdle("dropping journal of generation:%u, snapshot generation:%u",
+                  hdr.generation, snapshot_generation);
+        munmap((void*)map, size);
+    }
+    if(pos < size)
+    {
+        bdle("dropping %d bytes of incomplete journal", size - pos);
+        ftruncate(fd, pos);
+    }
+    journal_bytes = pos;
+    close(fd);
+    bdld("replayed %d journal records, %d bytes", count, pos);
+}
 
 static int load_bluez_cfg()
 {
@@ -816,16 +1350,35 @@ static void load_cfg()
     const char* file_name = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT;
     const char* file_name_new = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_NEW;
     const char* file_name_old = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_OLD;
-    if(!btif_config_load_file(file_name))
+    int imported = FALSE;
+    journal_suspended = TRUE;
+    if(!load_snapshot(CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_BIN) &&
+       !load_snapshot(CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_BIN CFG_FILE_EXT_OLD))
     {
-        unlink(file_name);
-        if(!btif_config_load_file(file_name_old))
+        //no usable binary snapshot, import the xml export
+        imported = TRUE;
+        if(!btif_config_load_file(file_name))
         {
-            unlink(file_name_old);
-            if(load_bluez_cfg() && save_cfg())
-                remove_bluez_cfg();
+            unlink(file_name);
+            if(!btif_config_load_file(file_name_old))
+            {
+                unlink(file_name_old);
+                imported = FALSE;
+                if(load_bluez_cfg() && save_cfg())
+                    remove_bluez_cfg();
+            }
         }
     }
+    journal_replay();
+    journal_suspended = FALSE;
+    //what we just loaded is already on disk
+    cached_change = 0;
+    if(imported)
+    {
+        journal_needs_snapshot = TRUE;
+        cached_change++;
+        btif_config_save();
+    }
     int bluez_migration_done = 0;
     btif_config_get_int("Local", "Adapter", "BluezMigrationDone", &bluez_migration_done);
     if(!bluez_migration_done)
@@ -869,9 +1422,9 @@ static void cfg_cmd_callback(int cmd_fd, int type, int size, uint32_t user_id)
                     break;
                 last_cached_change = cached_change;
             }
-            bdld("writing the bt_config.xml now, cached change:%d", cached_change);
+            bdld("writing the bt_config journal now, cached change:%d", cached_change);
             if(cached_change > 0)
-                save_cfg();
+                journal_flush();
             unlock_slot(&slot_lock);
             break;
         }
@@ -994,4 +1547,50 @@ static void cfg_test_read()
 }
 
 
+static inline uint64_t cfg_test_now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+static void cfg_test_lookup_perf()
+{
+    //what btif_storage_load_bonded_devices does at startup for many bonded devices
+    static const char* names[] =
+    {"LinkKey", "LinkKeyType", "PinLength", "Name", "DevClass", "DevType", "AddrType",
+     "Service", "Timestamp", "Manufacturer", "LmpVer", "LmpSubVer"};
+    const int name_count = sizeof(names)/sizeof(names[0]);
+    const int dev_count = 500;
+    char key[32];
+    char value[64];
+    int i, j, size, found = 0;
+    uint64_t start = cfg_test_now_us();
+    for(i = 0; i < dev_count; i++)
+    {
+        sprintf(key, "00:22:5F:%02X:%02X:%02X", (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+        for(j = 0; j < name_count; j++)
+            btif_config_set_str("Remote", key, names[j], "synthetic value");
+    }
+    uint64_t populated = cfg_test_now_us();
+    for(i = 0; i < dev_count; i++)
+    {
+        sprintf(key, "00:22:5F:%02X:%02X:%02X", (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+        for(j = 0; j < name_count; j++)
+        {
+            size = sizeof(value);
+            if(btif_config_get_str("Remote", key, names[j], value, &size))
+                found++;
+        }
+    }
+    uint64_t looked_up = cfg_test_now_us();
+    bdld("%d devices, populate:%llu us, %d lookups:%llu us", dev_count,
+         (unsigned long long)(populated - start), found,
+         (unsigned long long)(looked_up - populated));
+    for(i = 0; i < dev_count; i++)
+    {
+        sprintf(key, "00:22:5F:%02X:%02X:%02X", (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+        btif_config_remove("Remote", key, NULL);
+    }
+}
+
 #endif
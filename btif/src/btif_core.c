@@ -34,6 +34,8 @@
 #include <fcntl.h>
 #include <dirent.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <time.h>
 #include <cutils/properties.h>
 
 #define LOG_TAG "BTIF_CORE"
@@ -69,6 +71,12 @@
 
 #define BTIF_TASK_STR        ((INT8 *) "BTIF")
 
+/* signals the btif task that context switch slots are ready */
+#define BTIF_CONTEXT_SWITCH_EVT_MASK    EVENT_MASK(APPL_EVT_2)
+
+/* number of distinct (callback, event) pairs tracked for dispatch statistics */
+#define BTIF_CONTEXT_STATS_SIZE         64
+
 /************************************************************************************
 **  Local type definitions
 ************************************************************************************/
@@ -103,12 +111,64 @@ typedef enum {
     BTIF_CORE_STATE_DISABLING
 } btif_core_state_t;
 
+/* One event switched to the btif task. Parameters up to BTIF_CONTEXT_INLINE_SIZE
+   are held in the slot itself, larger ones in a GKI buffer. */
+typedef struct
+{
+    tBTIF_CBACK     *p_cb;
+    UINT16          event;
+    UINT16          depth;          /* slots in use when this one was taken */
+    BOOLEAN         ready;
+    UINT32          enq_us;
+    char            *p_ext;         /* GKI buffer when the parameters do not fit */
+    union
+    {
+        char        param[BTIF_CONTEXT_INLINE_SIZE];
+        UINT64      align;
+    } u;
+} btif_context_slot_t;
+
+/* Multi-producer, single consumer ring of slots. Slots are reserved in order
+   under the lock, filled outside it and handed over by setting ready. When the
+   ring is full events fall back to GKI messages on BTU_BTIF_MBOX; while any of
+   those are outstanding new events also take that path so order is kept. */
+typedef struct
+{
+    pthread_mutex_t     lock;
+    pthread_cond_t      ready_cond;
+    UINT32              head;       /* next slot to reserve */
+    UINT32              tail;       /* next slot to dispatch */
+    UINT32              overflow;   /* outstanding mailbox fallbacks */
+    btif_context_slot_t slot[BTIF_CONTEXT_SLOTS];
+} btif_context_ring_t;
+
+typedef struct
+{
+    tBTIF_CBACK     *p_cb;
+    UINT16          event;
+    UINT16          max_depth;
+    UINT32          count;
+    UINT32          ext_count;      /* parameters carried in a GKI buffer */
+    UINT64          total_us;
+    UINT32          max_us;
+} btif_context_stats_t;
+
 /************************************************************************************
 **  Static variables
 ************************************************************************************/
 
 bt_bdaddr_t btif_local_bd_addr;
 
+static btif_context_ring_t btif_context_ring =
+{
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .ready_cond = PTHREAD_COND_INITIALIZER,
+};
+
+/* only touched on the btif task */
+static btif_context_stats_t btif_context_stats[BTIF_CONTEXT_STATS_SIZE];
+static UINT32 btif_context_overflow_count;
+
 static UINT32 btif_task_stack[(BTIF_TASK_STACK_SIZE + 3) / 4];
 
 /* holds main adapter state */
@@ -166,6 +226,142 @@ void bte_main_config_hci_logging(BOOLEAN enable, BOOLEAN bt_disabled);
 *****************************************************************************/
 
 
+static UINT32 btif_context_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UINT32)(ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+/*******************************************************************************
+**
+** Function         btif_context_account
+**
+** Description      Records dispatch latency and queue depth of one event,
+**                  keyed by its callback and event id.
+**
+** Returns          void
+**
+*******************************************************************************/
+
+static void btif_context_account(tBTIF_CBACK *p_cb, UINT16 event, UINT32 latency_us,
+                                 UINT16 depth, BOOLEAN ext)
+{
+    UINT32 i = (((UINT32)(uintptr_t)p_cb >> 2) ^ (event * 31u)) % BTIF_CONTEXT_STATS_SIZE;
+    UINT32 n;
+    btif_context_stats_t *p_stats;
+
+    for (n = 0; n < BTIF_CONTEXT_STATS_SIZE; n++, i = (i + 1) % BTIF_CONTEXT_STATS_SIZE)
+    {
+        p_stats = &btif_context_stats[i];
+
+        if (p_stats->count == 0)
+        {
+            p_stats->p_cb = p_cb;
+            p_stats->event = event;
+        }
+        else if (p_stats->p_cb != p_cb || p_stats->event != event)
+        {
+            continue;
+        }
+
+        p_stats->count++;
+        p_stats->total_us += latency_us;
+        if (latency_us > p_stats->max_us)
+            p_stats->max_us = latency_us;
+        if (depth > p_stats->max_depth)
+            p_stats->max_depth = depth;
+        if (ext)
+            p_stats->ext_count++;
+        return;
+    }
+    /* table full, the event goes uncounted */
+}
+
+/*******************************************************************************
+**
+** Function         btif_context_log_stats
+**
+** Description      Logs the dispatch statistics gathered since startup
+**
+** Returns          void
+**
+*******************************************************************************/
+
+static void btif_context_log_stats(void)
+{
+    int i;
+
+    BTIF_TRACE_DEBUG("btif context switch: %d mailbox fallbacks", btif_context_overflow_count);
+
+    for (i = 0; i < BTIF_CONTEXT_STATS_SIZE; i++)
+    {
+        btif_context_stats_t *p_stats = &btif_context_stats[i];
+
+        if (p_stats->count == 0)
+            continue;
+
+        BTIF_TRACE_DEBUG("  cb %p evt %d: count %d ext %d avg %dus max %dus max depth %d",
+                         p_stats->p_cb, p_stats->event, p_stats->count, p_stats->ext_count,
+                         (UINT32)(p_stats->total_us / p_stats->count), p_stats->max_us,
+                         p_stats->max_depth);
+    }
+}
+
+/*******************************************************************************
+**
+** Function         btif_context_dispatch
+**
+** Description      Runs the ready slots in order. With wait_all set it also
+**                  waits for reserved slots still being filled, so that every
+**                  event queued before a mailbox fallback runs before it.
+**
+** Returns          void
+**
+*******************************************************************************/
+
+static void btif_context_dispatch(BOOLEAN wait_all)
+{
+    btif_context_ring_t *p_ring = &btif_context_ring;
+    btif_context_slot_t *p_slot;
+    UINT32 latency_us;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&p_ring->lock);
+        if (p_ring->tail == p_ring->head)
+        {
+            pthread_mutex_unlock(&p_ring->lock);
+            return;
+        }
+        p_slot = &p_ring->slot[p_ring->tail % BTIF_CONTEXT_SLOTS];
+        while (!p_slot->ready && wait_all)
+            pthread_cond_wait(&p_ring->ready_cond, &p_ring->lock);
+        pthread_mutex_unlock(&p_ring->lock);
+
+        /* its producer still owns it and will signal once done */
+        if (!p_slot->ready)
+            return;
+
+        if (p_slot->p_cb)
+        {
+            latency_us = btif_context_now_us() - p_slot->enq_us;
+            p_slot->p_cb(p_slot->event, p_slot->p_ext ? p_slot->p_ext : p_slot->u.param);
+            btif_context_account(p_slot->p_cb, p_slot->event, latency_us, p_slot->depth,
+                                 p_slot->p_ext != NULL);
+        }
+
+        if (p_slot->p_ext)
+            GKI_freebuf(p_slot->p_ext);
+
+        pthread_mutex_lock(&p_ring->lock);
+        p_slot->ready = FALSE;
+        p_slot->p_ext = NULL;
+        p_ring->tail++;
+        pthread_mutex_unlock(&p_ring->lock);
+    }
+}
+
 /*******************************************************************************
 **
 ** Function         btif_context_switched
@@ -186,9 +382,17 @@ static void btif_context_switched(void *p_msg)
 
     p = (tBTIF_CONTEXT_SWITCH_CBACK *) p_msg;
 
+    /* mailbox fallbacks come after everything already in the ring */
+    btif_context_dispatch(TRUE);
+    btif_context_overflow_count++;
+
     /* each callback knows how to parse the data */
     if (p->p_cb)
         p->p_cb(p->event, p->p_param);
+
+    pthread_mutex_lock(&btif_context_ring.lock);
+    btif_context_ring.overflow--;
+    pthread_mutex_unlock(&btif_context_ring.lock);
 }
 
 
@@ -196,7 +400,10 @@ static void btif_context_switched(void *p_msg)
 **
 ** Function         btif_transfer_context
 **
-** Description      This function switches context to btif task
+** Description      This function switches context to btif task. The event
+**                  normally goes through a preallocated slot; only parameters
+**                  larger than BTIF_CONTEXT_INLINE_SIZE, or a full ring, take
+**                  a GKI buffer.
 **
 **                  p_cback   : callback used to process message in btif context
 **                  event     : event id of message
@@ -210,7 +417,12 @@ static void btif_context_switched(void *p_msg)
 
 bt_status_t btif_transfer_context (tBTIF_CBACK *p_cback, UINT16 event, char* p_params, int param_len, tBTIF_COPY_CBACK *p_copy_cback)
 {
+    btif_context_ring_t *p_ring = &btif_context_ring;
+    btif_context_slot_t *p_slot = NULL;
     tBTIF_CONTEXT_SWITCH_CBACK *p_msg;
+    bt_status_t status = BT_STATUS_SUCCESS;
+    char *p_dest;
+    UINT16 depth = 0;
 
     BTIF_TRACE_VERBOSE("btif_transfer_context event %d, len %d", event, param_len);
 
@@ -219,7 +431,58 @@ bt_status_t btif_transfer_context (tBTIF_CBACK *p_cback, UINT16 event, char* p_p
         BTIF_TRACE_WARNING("btif_transfer_context: BT-IF thread already exited");
         return BT_STATUS_FAIL;
     }
-    /* allocate and send message that will be executed in btif context */
+
+    pthread_mutex_lock(&p_ring->lock);
+    if (p_ring->overflow == 0 && p_ring->head - p_ring->tail < BTIF_CONTEXT_SLOTS)
+    {
+        depth = (UINT16)(p_ring->head - p_ring->tail);
+        p_slot = &p_ring->slot[p_ring->head++ % BTIF_CONTEXT_SLOTS];
+    }
+    else
+    {
+        p_ring->overflow++;
+    }
+    pthread_mutex_unlock(&p_ring->lock);
+
+    if (p_slot)
+    {
+        p_slot->p_cb = p_cback;
+        p_slot->event = event;
+        p_slot->depth = depth;
+        p_slot->p_ext = NULL;
+        p_slot->enq_us = btif_context_now_us();
+        p_dest = p_slot->u.param;
+
+        if (param_len > BTIF_CONTEXT_INLINE_SIZE)
+        {
+            if ((p_slot->p_ext = (char *) GKI_getbuf((UINT16) param_len)) == NULL)
+            {
+                /* the slot is still handed over, as an empty one, to keep order */
+                p_slot->p_cb = NULL;
+                status = BT_STATUS_NOMEM;
+            }
+            p_dest = p_slot->p_ext;
+        }
+
+        if (p_dest)
+        {
+            /* check if caller has provided a copy callback to do the deep copy */
+            if (p_copy_cback)
+                p_copy_cback(event, p_dest, p_params);
+            else if (p_params)
+                memcpy(p_dest, p_params, param_len);  /* callback parameter data */
+        }
+
+        pthread_mutex_lock(&p_ring->lock);
+        p_slot->ready = TRUE;
+        pthread_cond_signal(&p_ring->ready_cond);
+        pthread_mutex_unlock(&p_ring->lock);
+
+        GKI_send_event(BTIF_TASK, BTIF_CONTEXT_SWITCH_EVT_MASK);
+        return status;
+    }
+
+    /* ring is full: allocate and send message that will be executed in btif context */
     if ((p_msg = (tBTIF_CONTEXT_SWITCH_CBACK *) GKI_getbuf(sizeof(tBTIF_CONTEXT_SWITCH_CBACK) + param_len)) != NULL)
     {
         p_msg->hdr.event = BT_EVT_CONTEXT_SWITCH_EVT; /* internal event */
@@ -242,6 +505,10 @@ bt_status_t btif_transfer_context (tBTIF_CBACK *p_cback, UINT16 event, char* p_p
     }
     else
     {
+        pthread_mutex_lock(&p_ring->lock);
+        p_ring->overflow--;
+        pthread_mutex_unlock(&p_ring->lock);
+
         /* let caller deal with a failed allocation */
         return BT_STATUS_NOMEM;
     }
@@ -307,7 +574,7 @@ static void btif_task(UINT32 params)
          * Wait for the trigger to init chip and stack. This trigger will
          * be received by btu_task once the UART is opened and ready
          */
-        if (event == BT_EVT_TRIGGER_STACK_INIT)
+        if (event & BT_EVT_TRIGGER_STACK_INIT)
         {
             BTIF_TRACE_DEBUG("btif_task: received trigger stack init event");
             #if (BLE_INCLUDED == TRUE)
@@ -320,7 +587,7 @@ static void btif_task(UINT32 params)
          * Failed to initialize controller hardware, reset state and bring
          * down all threads
          */
-        if (event == BT_EVT_HARDWARE_INIT_FAIL)
+        if (event & BT_EVT_HARDWARE_INIT_FAIL)
         {
             lock_slot(&mutex_bt_disable);
             BTIF_TRACE_DEBUG("btif_task: mutex_bt_disable lock");
@@ -345,6 +612,9 @@ static void btif_task(UINT32 params)
         if (event & EVENT_MASK(GKI_SHUTDOWN_EVT))
             break;
 
+        if (event & BTIF_CONTEXT_SWITCH_EVT_MASK)
+            btif_context_dispatch(FALSE);
+
         if(event & TASK_MBOX_1_EVT_MASK)
         {
             while((p_msg = GKI_read_mbox(BTU_BTIF_MBOX)) != NULL)
@@ -366,6 +636,7 @@ static void btif_task(UINT32 params)
         }
     }
 
+    btif_context_log_stats();
     btif_disassociate_evt();
 
     BTIF_TRACE_DEBUG("btif task exiting");
@@ -30,6 +30,8 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <pthread.h>
+#include <time.h>
 
 #define LOG_TAG "BtGatt.btif"
 
@@ -52,6 +54,7 @@
 #include "btif_storage.h"
 
 #include "vendor_api.h"
+#include "btu.h"
 
 /*******************************************************************************
 **  Constants & Macros
@@ -112,10 +115,12 @@ typedef enum {
 } btif_gattc_event_t;
 
 #define BTIF_GATT_MAX_OBSERVED_DEV 40
+#define BTIF_GATT_ADV_DATA_LEN     62   /* advertising data plus scan response */
 
 #define BTIF_GATT_OBSERVE_EVT   0x1000
 #define BTIF_GATTC_RSSI_EVT     0x1001
 #define BTIF_GATTC_SCAN_FILTER_EVT   0x1003
+#define BTIF_GATT_OBSERVE_REC_EVT    0x1004
 
 #define ENABLE_BATCH_SCAN 1
 #define DISABLE_BATCH_SCAN 0
@@ -231,6 +236,32 @@ typedef struct
     uint8_t            next_storage_idx;
 }__attribute__((packed)) btif_gattc_dev_cb_t;
 
+/* One LE scan result waiting to be delivered */
+typedef struct
+{
+    bt_bdaddr_t bd_addr;
+    uint32_t    hash;       /* of value, to spot repeats of the same advertisement */
+    int8_t      rssi;
+    uint8_t     addr_type;
+    uint8_t     flag;
+    tBT_DEVICE_TYPE device_type;
+    uint8_t     value[BTIF_GATT_ADV_DATA_LEN];
+} btif_gattc_scan_rec_t;
+
+/* Scan results are added on the BTU task and drained by btif in one event */
+typedef struct
+{
+    pthread_mutex_t       lock;
+    btif_gattc_scan_rec_t rec[BTIF_GATT_SCAN_BATCH_SIZE];
+    uint16_t              count;
+    BOOLEAN               drain_pending;
+    BOOLEAN               timer_armed;
+    uint32_t              last_drain_ms;
+    uint32_t              merged;     /* repeats folded into a pending result */
+    uint32_t              overflow;   /* results sent on their own past a full batch */
+    TIMER_LIST_ENT        tle;
+} btif_gattc_scan_batch_t;
+
 /*******************************************************************************
 **  Static variables
 ********************************************************************************/
@@ -238,6 +269,8 @@ typedef struct
 extern const btgatt_callbacks_t *bt_gatt_callbacks;
 static btif_gattc_dev_cb_t  btif_gattc_dev_cb;
 static btif_gattc_dev_cb_t  *p_dev_cb = &btif_gattc_dev_cb;
+static btif_gattc_scan_batch_t btif_gattc_scan_batch = { .lock = PTHREAD_MUTEX_INITIALIZER };
+static btif_gattc_scan_rec_t btif_gattc_scan_drain_buf[BTIF_GATT_SCAN_BATCH_SIZE];
 static uint8_t rssi_request_client_if;
 
 /*******************************************************************************
@@ -378,7 +411,7 @@ static BOOLEAN btif_gattc_find_bdaddr (BD_ADDR p_bda)
     return FALSE;
 }
 
-static void btif_gattc_update_properties ( btif_gattc_cb_t *p_btif_cb )
+static void btif_gattc_update_properties ( btif_gattc_scan_rec_t *p_btif_cb )
 {
     uint8_t remote_name_len;
     uint8_t *p_eir_remote_name=NULL;
@@ -407,6 +440,10 @@ static void btif_gattc_update_properties ( btif_gattc_cb_t *p_btif_cb )
     btif_storage_set_remote_addr_type( &p_btif_cb->bd_addr, p_btif_cb->addr_type);
 }
 
+static void btif_gattc_scan_drain(void);
+static BOOLEAN btif_gattc_scan_deliver(btif_gattc_scan_rec_t *p_rec);
+static void btif_gattc_scan_trim_remotes(void);
+
 static void btif_gattc_upstreams_evt(uint16_t event, char* p_param)
 {
     BTIF_TRACE_EVENT("%s: Event %d", __FUNCTION__, event);
@@ -561,53 +598,13 @@ static void btif_gattc_upstreams_evt(uint16_t event, char* p_param)
             break;
 
         case BTIF_GATT_OBSERVE_EVT:
-        {
-            btif_gattc_cb_t *p_btif_cb = (btif_gattc_cb_t*) p_param;
-            uint8_t remote_name_len;
-            uint8_t *p_eir_remote_name=NULL;
-            bt_device_type_t dev_type;
-            bt_property_t properties;
-
-            p_eir_remote_name = BTA_CheckEirData(p_btif_cb->value,
-                                         BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &remote_name_len);
-
-            if (p_eir_remote_name == NULL)
-            {
-                p_eir_remote_name = BTA_CheckEirData(p_btif_cb->value,
-                                BT_EIR_SHORTENED_LOCAL_NAME_TYPE, &remote_name_len);
-            }
-
-            if ((p_btif_cb->addr_type != BLE_ADDR_RANDOM) || (p_eir_remote_name))
-            {
-               if (!btif_gattc_find_bdaddr(p_btif_cb->bd_addr.address))
-               {
-                  static const char* exclude_filter[] =
-                        {"LinkKey", "LE_KEY_PENC", "LE_KEY_PID", "LE_KEY_PCSRK", "LE_KEY_LENC", "LE_KEY_LCSRK"};
-
-                  btif_gattc_add_remote_bdaddr(p_btif_cb->bd_addr.address, p_btif_cb->addr_type);
-                  btif_gattc_update_properties(p_btif_cb);
-                  btif_config_filter_remove("Remote", exclude_filter, sizeof(exclude_filter)/sizeof(char*),
-                  BTIF_STORAGE_MAX_ALLOWED_REMOTE_DEVICE);
-               }
-
-            }
-
-            if (( p_btif_cb->device_type == BT_DEVICE_TYPE_DUMO)&&
-               (p_btif_cb->flag & BTA_BLE_DMT_CONTROLLER_SPT) &&
-               (p_btif_cb->flag & BTA_BLE_DMT_HOST_SPT))
-             {
-                btif_storage_set_dmt_support_type (&(p_btif_cb->bd_addr), TRUE);
-             }
-
-             dev_type =  p_btif_cb->device_type;
-             BTIF_STORAGE_FILL_PROPERTY(&properties,
-                        BT_PROPERTY_TYPE_OF_DEVICE, sizeof(dev_type), &dev_type);
-             btif_storage_set_remote_device_property(&(p_btif_cb->bd_addr), &properties);
+            btif_gattc_scan_drain();
+            break;
 
-            HAL_CBACK(bt_gatt_callbacks, client->scan_result_cb,
-                      &p_btif_cb->bd_addr, p_btif_cb->rssi, p_btif_cb->value);
+        case BTIF_GATT_OBSERVE_REC_EVT:
+            if (btif_gattc_scan_deliver((btif_gattc_scan_rec_t*) p_param))
+                btif_gattc_scan_trim_remotes();
             break;
-        }
 
         case BTIF_GATTC_RSSI_EVT:
         {
@@ -959,29 +956,280 @@ static void bta_batch_scan_reports_cb(tBTA_DM_BLE_REF_VALUE ref_value, UINT8 rep
         GKI_freebuf(btif_scan_track_cb.read_reports.p_rep_data);
 }
 
+static uint32_t btif_gattc_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static uint32_t btif_gattc_adv_hash(const uint8_t *p_data, int len)
+{
+    uint32_t hash = 2166136261u;
+
+    while (len--)
+    {
+        hash ^= *p_data++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void btif_gattc_scan_post_drain(void)
+{
+    if (btif_transfer_context(btif_gattc_upstreams_evt, BTIF_GATT_OBSERVE_EVT,
+                              NULL, 0, NULL) != BT_STATUS_SUCCESS)
+    {
+        /* let the next result try again */
+        pthread_mutex_lock(&btif_gattc_scan_batch.lock);
+        btif_gattc_scan_batch.drain_pending = FALSE;
+        pthread_mutex_unlock(&btif_gattc_scan_batch.lock);
+    }
+}
+
+static void btif_gattc_scan_timeout(void *p_tle)
+{
+    UNUSED(p_tle);
+    btif_gattc_scan_batch.timer_armed = FALSE;
+    btif_gattc_scan_post_drain();
+}
+
+/*******************************************************************************
+**
+** Function         btif_gattc_scan_enqueue
+**
+** Description      Adds a scan result to the pending batch. Runs on the BTU
+**                  task. A result repeating a pending one (same address and
+**                  advertising data) only refreshes its RSSI. The first result
+**                  of a batch schedules the drain: at once if the last drain
+**                  is older than BTIF_GATT_SCAN_LATENCY_MS, otherwise when
+**                  that much time has passed. The result that fills the batch
+**                  posts the drain at once; results arriving before it has
+**                  run are sent to btif on their own.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btif_gattc_scan_enqueue(const btif_gattc_scan_rec_t *p_rec)
+{
+    btif_gattc_scan_batch_t *p_batch = &btif_gattc_scan_batch;
+    uint32_t elapsed = 0;
+    BOOLEAN schedule = FALSE, full = FALSE;
+    int i;
+
+    pthread_mutex_lock(&p_batch->lock);
+
+    for (i = 0; i < p_batch->count; i++)
+    {
+        btif_gattc_scan_rec_t *p_cur = &p_batch->rec[i];
+
+        if (p_cur->hash == p_rec->hash &&
+            !bdcmp(p_cur->bd_addr.address, p_rec->bd_addr.address) &&
+            !memcmp(p_cur->value, p_rec->value, BTIF_GATT_ADV_DATA_LEN))
+        {
+            p_cur->rssi = p_rec->rssi;
+            p_batch->merged++;
+            pthread_mutex_unlock(&p_batch->lock);
+            return;
+        }
+    }
+
+    if (p_batch->count == BTIF_GATT_SCAN_BATCH_SIZE)
+    {
+        /* the drain is already posted, unless posting it failed; this result
+           follows it on its own */
+        schedule = !p_batch->drain_pending;
+        p_batch->drain_pending = TRUE;
+        p_batch->overflow++;
+        pthread_mutex_unlock(&p_batch->lock);
+
+        if (schedule)
+            btif_gattc_scan_post_drain();
+        btif_transfer_context(btif_gattc_upstreams_evt, BTIF_GATT_OBSERVE_REC_EVT,
+                              (char*) p_rec, sizeof(btif_gattc_scan_rec_t), NULL);
+        return;
+    }
+
+    memcpy(&p_batch->rec[p_batch->count++], p_rec, sizeof(btif_gattc_scan_rec_t));
+
+    if (!p_batch->drain_pending)
+    {
+        p_batch->drain_pending = TRUE;
+        elapsed = btif_gattc_now_ms() - p_batch->last_drain_ms;
+        schedule = TRUE;
+    }
+    full = (p_batch->count == BTIF_GATT_SCAN_BATCH_SIZE);
+
+    pthread_mutex_unlock(&p_batch->lock);
+
+    if (full)
+    {
+        /* a drain already posted takes the batch; one waiting on the timer goes now */
+        BOOLEAN waiting = schedule || p_batch->timer_armed;
+
+        if (p_batch->timer_armed)
+        {
+            btu_stop_quick_timer(&p_batch->tle);
+            p_batch->timer_armed = FALSE;
+        }
+        if (waiting)
+            btif_gattc_scan_post_drain();
+        return;
+    }
+
+    if (!schedule)
+        return;
+
+    if (elapsed >= BTIF_GATT_SCAN_LATENCY_MS)
+    {
+        btif_gattc_scan_post_drain();
+    }
+    else
+    {
+        UINT32 ticks = ((BTIF_GATT_SCAN_LATENCY_MS - elapsed) * QUICK_TIMER_TICKS_PER_SEC
+                        + 999) / 1000;
+
+        p_batch->tle.param = (TIMER_PARAM_TYPE) btif_gattc_scan_timeout;
+        p_batch->timer_armed = TRUE;
+        btu_start_quick_timer(&p_batch->tle, BTU_TTYPE_USER_FUNC, ticks);
+    }
+}
+
+static const char* btif_gattc_scan_exclude_filter[] =
+    {"LinkKey", "LE_KEY_PENC", "LE_KEY_PID", "LE_KEY_PCSRK", "LE_KEY_LENC", "LE_KEY_LCSRK"};
+
+static void btif_gattc_scan_trim_remotes(void)
+{
+    btif_config_filter_remove("Remote", btif_gattc_scan_exclude_filter,
+                              sizeof(btif_gattc_scan_exclude_filter)/sizeof(char*),
+                              BTIF_STORAGE_MAX_ALLOWED_REMOTE_DEVICE);
+}
+
+/*******************************************************************************
+**
+** Function         btif_gattc_scan_deliver
+**
+** Description      Records the device of one scan result and reports it
+**                  upstream. Runs on the btif task. A result sent on its own
+**                  (BTIF_GATT_OBSERVE_REC_EVT) trims the stored remotes here;
+**                  a drained batch does so once at the end.
+**
+** Returns          TRUE if the result added a new remote device.
+**
+*******************************************************************************/
+static BOOLEAN btif_gattc_scan_deliver(btif_gattc_scan_rec_t *p_rec)
+{
+    bt_device_type_t dev_type;
+    bt_property_t properties;
+    uint8_t remote_name_len;
+    uint8_t *p_eir_remote_name = NULL;
+    BOOLEAN new_remote = FALSE;
+
+    p_eir_remote_name = BTA_CheckEirData(p_rec->value,
+                                 BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &remote_name_len);
+
+    if (p_eir_remote_name == NULL)
+    {
+        p_eir_remote_name = BTA_CheckEirData(p_rec->value,
+                        BT_EIR_SHORTENED_LOCAL_NAME_TYPE, &remote_name_len);
+    }
+
+    if ((p_rec->addr_type != BLE_ADDR_RANDOM) || (p_eir_remote_name))
+    {
+       if (!btif_gattc_find_bdaddr(p_rec->bd_addr.address))
+       {
+          btif_gattc_add_remote_bdaddr(p_rec->bd_addr.address, p_rec->addr_type);
+          btif_gattc_update_properties(p_rec);
+          new_remote = TRUE;
+       }
+    }
+
+    if (( p_rec->device_type == BT_DEVICE_TYPE_DUMO)&&
+       (p_rec->flag & BTA_BLE_DMT_CONTROLLER_SPT) &&
+       (p_rec->flag & BTA_BLE_DMT_HOST_SPT))
+     {
+        btif_storage_set_dmt_support_type (&(p_rec->bd_addr), TRUE);
+     }
+
+     dev_type =  p_rec->device_type;
+     BTIF_STORAGE_FILL_PROPERTY(&properties,
+                BT_PROPERTY_TYPE_OF_DEVICE, sizeof(dev_type), &dev_type);
+     btif_storage_set_remote_device_property(&(p_rec->bd_addr), &properties);
+
+    HAL_CBACK(bt_gatt_callbacks, client->scan_result_cb,
+              &p_rec->bd_addr, p_rec->rssi, p_rec->value);
+
+    return new_remote;
+}
+
+/*******************************************************************************
+**
+** Function         btif_gattc_scan_drain
+**
+** Description      Takes the whole pending batch and delivers it upstream.
+**                  Runs on the btif task.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btif_gattc_scan_drain(void)
+{
+    btif_gattc_scan_batch_t *p_batch = &btif_gattc_scan_batch;
+    btif_gattc_scan_rec_t *p_rec = btif_gattc_scan_drain_buf;
+    BOOLEAN new_remote = FALSE;
+    uint32_t merged, overflow;
+    int count, i;
+
+    pthread_mutex_lock(&p_batch->lock);
+    count = p_batch->count;
+    memcpy(p_rec, p_batch->rec, count * sizeof(btif_gattc_scan_rec_t));
+    p_batch->count = 0;
+    p_batch->drain_pending = FALSE;
+    p_batch->last_drain_ms = btif_gattc_now_ms();
+    merged = p_batch->merged;
+    overflow = p_batch->overflow;
+    p_batch->merged = p_batch->overflow = 0;
+    pthread_mutex_unlock(&p_batch->lock);
+
+    BTIF_TRACE_DEBUG("%s: %d results, %d merged, %d past a full batch",
+                     __FUNCTION__, count, merged, overflow);
+
+    for (i = 0; i < count; i++)
+    {
+        if (btif_gattc_scan_deliver(&p_rec[i]))
+            new_remote = TRUE;
+    }
+
+    /* trim the stored remotes once per batch rather than once per new device */
+    if (new_remote)
+        btif_gattc_scan_trim_remotes();
+}
+
 static void bta_scan_results_cb (tBTA_DM_SEARCH_EVT event, tBTA_DM_SEARCH *p_data)
 {
-    btif_gattc_cb_t btif_cb;
+    btif_gattc_scan_rec_t rec;
     uint8_t len;
 
     switch (event)
     {
         case BTA_DM_INQ_RES_EVT:
         {
-            bdcpy(btif_cb.bd_addr.address, p_data->inq_res.bd_addr);
-            btif_cb.device_type = p_data->inq_res.device_type;
-            btif_cb.rssi = p_data->inq_res.rssi;
-            btif_cb.addr_type = p_data->inq_res.ble_addr_type;
-            btif_cb.flag = p_data->inq_res.flag;
+            memset(&rec, 0, sizeof(rec));
+            bdcpy(rec.bd_addr.address, p_data->inq_res.bd_addr);
+            rec.device_type = p_data->inq_res.device_type;
+            rec.rssi = p_data->inq_res.rssi;
+            rec.addr_type = p_data->inq_res.ble_addr_type;
+            rec.flag = p_data->inq_res.flag;
             if (p_data->inq_res.p_eir)
             {
-                memcpy(btif_cb.value, p_data->inq_res.p_eir, 62);
+                memcpy(rec.value, p_data->inq_res.p_eir, BTIF_GATT_ADV_DATA_LEN);
                 if (BTA_CheckEirData(p_data->inq_res.p_eir, BTM_EIR_COMPLETE_LOCAL_NAME_TYPE,
                                       &len))
                 {
                     p_data->inq_res.remt_name_not_required  = TRUE;
                 }
             }
+            rec.hash = btif_gattc_adv_hash(rec.value, BTIF_GATT_ADV_DATA_LEN);
         }
         break;
 
@@ -996,8 +1244,7 @@ static void bta_scan_results_cb (tBTA_DM_SEARCH_EVT event, tBTA_DM_SEARCH *p_dat
         BTIF_TRACE_WARNING("%s : Unknown event 0x%x", __FUNCTION__, event);
         return;
     }
-    btif_transfer_context(btif_gattc_upstreams_evt, BTIF_GATT_OBSERVE_EVT,
-                                 (char*) &btif_cb, sizeof(btif_gattc_cb_t), NULL);
+    btif_gattc_scan_enqueue(&rec);
 }
 
 static void bta_track_adv_event_cb(int filt_index, tBLE_ADDR_TYPE addr_type, BD_ADDR bda,
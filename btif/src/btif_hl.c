@@ -32,6 +32,7 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <time.h>
 #include <fcntl.h>
@@ -86,6 +87,8 @@ static bthl_callbacks_t *bt_hl_callbacks=NULL;
 const int btif_hl_signal_select_wakeup = 1;
 const int btif_hl_signal_select_exit = 2;
 const int btif_hl_signal_select_close_connected = 3;
+const int btif_hl_signal_select_rx_data = 4;
+const int btif_hl_signal_select_tx_ready = 5;
 
 static int listen_s = -1;
 static int connected_s = -1;
@@ -97,6 +100,8 @@ static int reg_counter;
 static inline int btif_hl_select_wakeup(void);
 static inline int btif_hl_select_close_connected(void);
 static inline int btif_hl_close_select_thread(void);
+static inline int btif_hl_select_rx_data(void);
+static inline int btif_hl_select_tx_ready(void);
 static UINT8 btif_hl_get_next_app_id(void);
 static int btif_hl_get_next_channel_id(UINT8 app_id);
 static void btif_hl_init_next_app_id(void);
@@ -440,6 +445,59 @@ void btif_hl_free_buf(void **p)
     else
         BTIF_TRACE_ERROR("%s NULL pointer",__FUNCTION__ );
 }
+
+/*******************************************************************************
+**
+** Function      btif_hl_now_us
+**
+** Description   Monotonic time of the data path counters
+**
+** Returns       microseconds
+**
+*******************************************************************************/
+static UINT64 btif_hl_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UINT64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*******************************************************************************
+**
+** Function      btif_hl_log_mdl_stats
+**
+** Description   Log the throughput and latency of an MDL's data path
+**
+** Returns       void
+**
+*******************************************************************************/
+static void btif_hl_log_mdl_stats(btif_hl_mdl_cb_t *p_dcb)
+{
+    btif_hl_mdl_stats_t *p_stats = &p_dcb->stats;
+    UINT64              ms;
+
+    if (p_stats->start_us == 0 || (p_stats->rx_apdus == 0 && p_stats->tx_apdus == 0))
+        return;
+
+    ms = (btif_hl_now_us() - p_stats->start_us) / 1000;
+    if (ms == 0)
+        ms = 1;
+
+    BTIF_TRACE_EVENT("%s: mdl_id=%d %u ms", __FUNCTION__, p_dcb->mdl_id, (UINT32)ms);
+    BTIF_TRACE_EVENT("%s: rx %u APDUs in %u writes, %u dropped, %u bytes/s, "
+                     "latency us mean %u max %u", __FUNCTION__,
+                     p_stats->rx_apdus, p_stats->rx_writes, p_stats->rx_drops,
+                     (UINT32)(p_stats->rx_bytes * 1000 / ms),
+                     p_stats->rx_apdus ? (UINT32)(p_stats->rx_lat_sum_us / p_stats->rx_apdus) : 0,
+                     p_stats->rx_lat_max_us);
+    BTIF_TRACE_EVENT("%s: tx %u APDUs, %u failed, %u pauses, %u bytes/s, "
+                     "latency us mean %u max %u", __FUNCTION__,
+                     p_stats->tx_apdus, p_stats->tx_errors, p_stats->tx_pauses,
+                     (UINT32)(p_stats->tx_bytes * 1000 / ms),
+                     p_stats->tx_apdus ? (UINT32)(p_stats->tx_lat_sum_us / p_stats->tx_apdus) : 0,
+                     p_stats->tx_lat_max_us);
+}
 /*******************************************************************************
 **
 ** Function      btif_hl_is_the_first_reliable_existed
@@ -511,9 +569,18 @@ static void btif_hl_clean_pcb(btif_hl_pending_chan_cb_t *p_pcb)
 *******************************************************************************/
 static void btif_hl_clean_mdl_cb(btif_hl_mdl_cb_t *p_dcb)
 {
+    void *p_buf;
+
     BTIF_TRACE_DEBUG("%s", __FUNCTION__ );
+    btif_hl_log_mdl_stats(p_dcb);
     btif_hl_free_buf((void **) &p_dcb->p_rx_pkt);
     btif_hl_free_buf((void **) &p_dcb->p_tx_pkt);
+
+    GKI_disable();
+    while ((p_buf = GKI_dequeue(&p_dcb->rx_q)) != NULL)
+        GKI_freebuf(p_buf);
+    GKI_enable();
+
     memset(p_dcb, 0 , sizeof(btif_hl_mdl_cb_t));
 }
 
@@ -3207,16 +3274,41 @@ static void btif_hl_proc_send_data_cfm(tBTA_HL_MDL_HANDLE mdl_handle,
                                        tBTA_HL_STATUS status){
     UINT8                   app_idx,mcl_idx, mdl_idx;
     btif_hl_mdl_cb_t         *p_dcb;
-    UNUSED(status);
+    btif_hl_mdl_stats_t      *p_stats;
+    UINT32                   tail, lat;
 
     BTIF_TRACE_DEBUG("%s", __FUNCTION__);
     if (btif_hl_find_mdl_idx_using_handle(mdl_handle,
                                           &app_idx, &mcl_idx, &mdl_idx ))
     {
         p_dcb =BTIF_HL_GET_MDL_CB_PTR(app_idx, mcl_idx, mdl_idx);
-        btif_hl_free_buf((void **) &p_dcb->p_tx_pkt);
-        BTIF_TRACE_DEBUG("send success free p_tx_pkt tx_size=%d", p_dcb->tx_size);
-        p_dcb->tx_size = 0;
+        p_stats = &p_dcb->stats;
+        tail = p_dcb->tx_tail;
+
+        if (tail == __atomic_load_n(&p_dcb->tx_head, __ATOMIC_ACQUIRE))
+        {
+            BTIF_TRACE_ERROR("%s: no APDU in flight", __FUNCTION__);
+            return;
+        }
+
+        if (status == BTA_HL_STATUS_OK)
+        {
+            lat = (UINT32)(btif_hl_now_us() - p_dcb->tx_start_us[tail % BTIF_HL_TX_WINDOW]);
+            p_stats->tx_lat_sum_us += lat;
+            if (lat > p_stats->tx_lat_max_us)
+                p_stats->tx_lat_max_us = lat;
+        }
+        else
+        {
+            BTIF_TRACE_WARNING("%s: status=%d", __FUNCTION__, status);
+            p_stats->tx_errors++;
+        }
+
+        /* open the window, then resume the socket if the select thread
+        ** stopped reading it */
+        __atomic_store_n(&p_dcb->tx_tail, tail + 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&p_dcb->tx_paused, __ATOMIC_SEQ_CST))
+            btif_hl_select_tx_ready();
     }
 }
 
@@ -3241,7 +3333,9 @@ static void btif_hl_proc_dch_cong_ind(tBTA_HL *p_data)
     if (btif_hl_find_mdl_idx_using_handle(p_data->dch_cong_ind.mdl_handle, &app_idx, &mcl_idx, &mdl_idx))
     {
         p_dcb =BTIF_HL_GET_MDL_CB_PTR(app_idx, mcl_idx, mdl_idx);
-        p_dcb->cong = p_data->dch_cong_ind.cong;
+        __atomic_store_n(&p_dcb->cong, p_data->dch_cong_ind.cong, __ATOMIC_SEQ_CST);
+        if (!p_data->dch_cong_ind.cong && __atomic_load_n(&p_dcb->tx_paused, __ATOMIC_SEQ_CST))
+            btif_hl_select_tx_ready();
     }
 }
 
@@ -4664,6 +4758,248 @@ BOOLEAN btif_hl_create_socket(UINT8 app_idx, UINT8 mcl_idx, UINT8 mdl_idx){
     BTIF_TRACE_DEBUG("%s status=%d", __FUNCTION__, status);
     return status;
 }
+/*******************************************************************************
+**
+** Function btif_hl_queue_rx_buf
+**
+** Description Queue an APDU received by BTA for the app socket of an MDL and
+**             wake up the select loop to write it. Called on the BTU thread.
+**             The receive time is kept in the event and layer_specific
+**             fields, which are free once MCAP hands the buffer over.
+**
+** Returns BOOLEAN TRUE if the buffer was queued; it is then freed by the
+**         select loop
+**
+*******************************************************************************/
+BOOLEAN btif_hl_queue_rx_buf(btif_hl_mdl_cb_t *p_dcb, BT_HDR *p_buf)
+{
+    UINT32  now = (UINT32)btif_hl_now_us();
+    BOOLEAN signal = FALSE;
+
+    p_buf->event = (UINT16)now;
+    p_buf->layer_specific = (UINT16)(now >> 16);
+
+    GKI_disable();
+    if (p_dcb->p_scb == NULL)
+    {
+        GKI_enable();
+        return FALSE;
+    }
+    GKI_enqueue(&p_dcb->rx_q, p_buf);
+    if (!p_dcb->rx_signaled)
+    {
+        p_dcb->rx_signaled = TRUE;
+        signal = TRUE;
+    }
+    GKI_enable();
+
+    if (signal)
+        btif_hl_select_rx_data();
+
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function btif_hl_flush_rx
+**
+** Description Write the APDUs queued for an MDL to its app socket, up to
+**             BTIF_HL_RX_MAX_BATCH of them with each sendmsg() straight from
+**             the MCAP buffers. Called on the select thread.
+**
+** Returns void
+**
+*******************************************************************************/
+static void btif_hl_flush_rx(btif_hl_soc_cb_t *p_scb, btif_hl_mdl_cb_t *p_dcb)
+{
+    btif_hl_mdl_stats_t *p_stats = &p_dcb->stats;
+    BT_HDR              *p_bufs[BTIF_HL_RX_MAX_BATCH];
+    struct iovec        iov[BTIF_HL_RX_MAX_BATCH];
+    struct msghdr       msg;
+    UINT32              now, lat;
+    int                 num, i;
+    ssize_t             r;
+
+    for (;;)
+    {
+        GKI_disable();
+        p_dcb->rx_signaled = FALSE;
+        for (num = 0; num < BTIF_HL_RX_MAX_BATCH; num++)
+        {
+            if ((p_bufs[num] = (BT_HDR *)GKI_dequeue(&p_dcb->rx_q)) == NULL)
+                break;
+        }
+        GKI_enable();
+
+        if (num == 0)
+            return;
+
+        for (i = 0; i < num; i++)
+        {
+            iov[i].iov_base = (UINT8 *)(p_bufs[i] + 1) + p_bufs[i]->offset;
+            iov[i].iov_len = p_bufs[i]->len;
+        }
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = num;
+
+        while (msg.msg_iovlen > 0)
+        {
+            r = sendmsg(p_scb->socket_id[1], &msg, MSG_NOSIGNAL);
+            if (r < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                BTIF_TRACE_ERROR("%s: sendmsg failed: %s", __FUNCTION__, strerror(errno));
+                break;
+            }
+
+            /* skip what was written, the socket may take part of a batch */
+            while (msg.msg_iovlen > 0 && (size_t)r >= msg.msg_iov->iov_len)
+            {
+                r -= msg.msg_iov->iov_len;
+                msg.msg_iov++;
+                msg.msg_iovlen--;
+            }
+            if (msg.msg_iovlen > 0)
+            {
+                msg.msg_iov->iov_base = (UINT8 *)msg.msg_iov->iov_base + r;
+                msg.msg_iov->iov_len -= r;
+            }
+        }
+
+        now = (UINT32)btif_hl_now_us();
+        if (msg.msg_iovlen == 0)
+            p_stats->rx_writes++;
+
+        for (i = 0; i < num; i++)
+        {
+            if (msg.msg_iovlen == 0)
+            {
+                lat = now - (((UINT32)p_bufs[i]->layer_specific << 16) | p_bufs[i]->event);
+                p_stats->rx_apdus++;
+                p_stats->rx_bytes += p_bufs[i]->len;
+                p_stats->rx_lat_sum_us += lat;
+                if (lat > p_stats->rx_lat_max_us)
+                    p_stats->rx_lat_max_us = lat;
+            }
+            else
+            {
+                p_stats->rx_drops++;
+            }
+            GKI_freebuf(p_bufs[i]);
+        }
+
+        if (num < BTIF_HL_RX_MAX_BATCH)
+            return;
+    }
+}
+
+/*******************************************************************************
+**
+** Function btif_hl_send_rx_data
+**
+** Description Write the queued APDUs of all connected sockets
+**
+** Returns void
+**
+*******************************************************************************/
+static void btif_hl_send_rx_data(void)
+{
+    btif_hl_soc_cb_t    *p_scb;
+    btif_hl_mdl_cb_t    *p_dcb;
+
+    p_scb = (btif_hl_soc_cb_t *)GKI_getfirst((void *)&soc_queue);
+    while (p_scb != NULL)
+    {
+        if (btif_hl_get_socket_state(p_scb) == BTIF_HL_SOC_STATE_W4_READ)
+        {
+            p_dcb = BTIF_HL_GET_MDL_CB_PTR(p_scb->app_idx, p_scb->mcl_idx, p_scb->mdl_idx);
+            if (p_dcb)
+                btif_hl_flush_rx(p_scb, p_dcb);
+        }
+        p_scb = (btif_hl_soc_cb_t *)GKI_getnext((void *)p_scb );
+    }
+}
+
+/*******************************************************************************
+**
+** Function btif_hl_tx_ready
+**
+** Description Check whether another APDU can be read from the app socket:
+**             the channel is not congested and fewer than BTIF_HL_TX_WINDOW
+**             APDUs wait for their confirmation.
+**
+** Returns BOOLEAN
+**
+*******************************************************************************/
+static BOOLEAN btif_hl_tx_ready(btif_hl_mdl_cb_t *p_dcb)
+{
+    return !__atomic_load_n(&p_dcb->cong, __ATOMIC_SEQ_CST)
+        && (p_dcb->tx_head - __atomic_load_n(&p_dcb->tx_tail, __ATOMIC_SEQ_CST)) < BTIF_HL_TX_WINDOW;
+}
+
+/*******************************************************************************
+**
+** Function btif_hl_pause_tx
+**
+** Description Stop reading an app socket until the window opens. The app
+**             then blocks on its own writes instead of the data being
+**             dropped here.
+**
+** Returns void
+**
+*******************************************************************************/
+static void btif_hl_pause_tx(btif_hl_soc_cb_t *p_scb, btif_hl_mdl_cb_t *p_dcb,
+                             fd_set *p_org_set)
+{
+    if (btif_hl_tx_ready(p_dcb))
+        return;
+
+    FD_CLR(p_scb->socket_id[1], p_org_set);
+    __atomic_store_n(&p_dcb->tx_paused, TRUE, __ATOMIC_SEQ_CST);
+    p_dcb->stats.tx_pauses++;
+
+    /* the confirmation may have come before tx_paused was set */
+    if (btif_hl_tx_ready(p_dcb))
+    {
+        __atomic_store_n(&p_dcb->tx_paused, FALSE, __ATOMIC_SEQ_CST);
+        FD_SET(p_scb->socket_id[1], p_org_set);
+    }
+}
+
+/*******************************************************************************
+**
+** Function btif_hl_resume_tx
+**
+** Description Read again from the paused app sockets whose window opened
+**
+** Returns void
+**
+*******************************************************************************/
+static void btif_hl_resume_tx(fd_set *p_org_set)
+{
+    btif_hl_soc_cb_t    *p_scb;
+    btif_hl_mdl_cb_t    *p_dcb;
+
+    p_scb = (btif_hl_soc_cb_t *)GKI_getfirst((void *)&soc_queue);
+    while (p_scb != NULL)
+    {
+        if (btif_hl_get_socket_state(p_scb) == BTIF_HL_SOC_STATE_W4_READ)
+        {
+            p_dcb = BTIF_HL_GET_MDL_CB_PTR(p_scb->app_idx, p_scb->mcl_idx, p_scb->mdl_idx);
+            if (p_dcb && __atomic_load_n(&p_dcb->tx_paused, __ATOMIC_SEQ_CST)
+                && btif_hl_tx_ready(p_dcb))
+            {
+                __atomic_store_n(&p_dcb->tx_paused, FALSE, __ATOMIC_SEQ_CST);
+                FD_SET(p_scb->socket_id[1], p_org_set);
+            }
+        }
+        p_scb = (btif_hl_soc_cb_t *)GKI_getnext((void *)p_scb );
+    }
+}
+
 /*******************************************************************************
 **
 ** Function btif_hl_add_socket_to_set
@@ -4700,6 +5036,9 @@ void btif_hl_add_socket_to_set( fd_set *p_org_set){
                 p_acb = BTIF_HL_GET_APP_CB_PTR(p_scb->app_idx);
                 if (p_mcb && p_dcb)
                 {
+                    p_dcb->stats.start_us = btif_hl_now_us();
+                    /* APDUs queued before the socket was added */
+                    btif_hl_flush_rx(p_scb, p_dcb);
                     btif_hl_stop_timer_using_handle(p_mcb->mcl_handle);
                     evt_param.chan_cb.app_id = p_acb->app_id;
                     memcpy(evt_param.chan_cb.bd_addr, p_mcb->bd_addr, sizeof(BD_ADDR));
@@ -4805,7 +5144,8 @@ void btif_hl_close_socket( fd_set *p_org_set){
 **
 ** Function btif_hl_select_wakeup_callback
 **
-** Description Select wakup callback to add or close a socket
+** Description Select wakup callback to add or close a socket, write the
+**             received data or resume reading the paused sockets
 **
 ** Returns void
 **
@@ -4822,6 +5162,14 @@ void btif_hl_select_wakeup_callback( fd_set *p_org_set ,  int wakeup_signal){
     {
         btif_hl_close_socket(p_org_set);
     }
+    else if (wakeup_signal == btif_hl_signal_select_rx_data)
+    {
+        btif_hl_send_rx_data();
+    }
+    else if (wakeup_signal == btif_hl_signal_select_tx_ready)
+    {
+        btif_hl_resume_tx(p_org_set);
+    }
     BTIF_TRACE_DEBUG("leaving %s",__FUNCTION__);
 }
 
@@ -4837,8 +5185,9 @@ void btif_hl_select_wakeup_callback( fd_set *p_org_set ,  int wakeup_signal){
 void btif_hl_select_monitor_callback( fd_set *p_cur_set , fd_set *p_org_set){
     btif_hl_soc_cb_t      *p_scb = NULL;
     btif_hl_mdl_cb_t      *p_dcb = NULL;
+    BT_HDR                *p_pkt;
+    UINT32                head;
     int r;
-    UNUSED(p_org_set);
 
     BTIF_TRACE_DEBUG("entering %s",__FUNCTION__);
 
@@ -4855,30 +5204,33 @@ void btif_hl_select_monitor_callback( fd_set *p_cur_set , fd_set *p_org_set){
                     BTIF_TRACE_DEBUG("read data");
                     BTIF_TRACE_DEBUG("state= BTIF_HL_SOC_STATE_W4_READ");
                     p_dcb = BTIF_HL_GET_MDL_CB_PTR(p_scb->app_idx, p_scb->mcl_idx, p_scb->mdl_idx);
-                    if (p_dcb)
+                    if (p_dcb && !btif_hl_tx_ready(p_dcb))
                     {
-                        if (p_dcb->p_tx_pkt)
+                        btif_hl_pause_tx(p_scb, p_dcb, p_org_set);
+                    }
+                    else if (p_dcb)
+                    {
+                        /* read the APDU where MCAP sends it from */
+                        if ((p_pkt = BTA_HlGetTxBuf(p_dcb->mtu)) == NULL)
                         {
-                            BTIF_TRACE_ERROR("Rcv new pkt but the last pkt is still not been sent tx_size=%d", p_dcb->tx_size);
-                            btif_hl_free_buf((void **) &p_dcb->p_tx_pkt);
+                            BTIF_TRACE_ERROR("btif_hl_select_monitor_callback no buffer mtu=%d", p_dcb->mtu);
                         }
-                        p_dcb->p_tx_pkt =  btif_hl_get_buf (p_dcb->mtu);
-                        //do
-                        // {
-                        //     r = recv(p_scb->socket_id[1], p_dcb->p_tx_pkt, p_dcb->mtu , MSG_DONTWAIT));
-                        // } while (r == SOCKET_ERROR && errno == EINTR);
-
-                        if (p_dcb->p_tx_pkt && ((r = (int)recv(p_scb->socket_id[1], p_dcb->p_tx_pkt, p_dcb->mtu , MSG_DONTWAIT)) > 0))
+                        else if ((r = (int)recv(p_scb->socket_id[1], BTA_HL_TX_BUF_PTR(p_pkt), p_dcb->mtu , MSG_DONTWAIT)) > 0)
                         {
                             BTIF_TRACE_DEBUG("btif_hl_select_monitor_callback send data r =%d", r);
-                            p_dcb->tx_size = r;
-                            BTIF_TRACE_DEBUG("btif_hl_select_monitor_callback send data tx_size=%d", p_dcb->tx_size );
-                            BTA_HlSendData(p_dcb->mdl_handle, p_dcb->tx_size  );
+                            p_pkt->len = (UINT16)r;
+                            head = p_dcb->tx_head;
+                            p_dcb->tx_start_us[head % BTIF_HL_TX_WINDOW] = btif_hl_now_us();
+                            __atomic_store_n(&p_dcb->tx_head, head + 1, __ATOMIC_RELEASE);
+                            p_dcb->stats.tx_apdus++;
+                            p_dcb->stats.tx_bytes += r;
+                            BTA_HlSendDataBuf(p_dcb->mdl_handle, p_pkt);
+                            btif_hl_pause_tx(p_scb, p_dcb, p_org_set);
                         }
-
-                        if (r <= 0 )
+                        else
                         {
                             BTIF_TRACE_DEBUG("btif_hl_select_monitor_callback  receive failed r=%d",r);
+                            GKI_freebuf(p_pkt);
                             BTA_HlDchClose(p_dcb->mdl_handle );
                         }
                     }
@@ -4946,6 +5298,34 @@ static inline int btif_hl_select_close_connected(void){
     return send(signal_fds[1], &sig_on, sizeof(sig_on), 0);
 }
 
+/*******************************************************************************
+**
+** Function btif_hl_select_rx_data
+**
+** Description send a signal to write the queued received data
+**
+** Returns int
+**
+*******************************************************************************/
+static inline int btif_hl_select_rx_data(void){
+    char sig_on = btif_hl_signal_select_rx_data;
+    return send(signal_fds[1], &sig_on, sizeof(sig_on), 0);
+}
+
+/*******************************************************************************
+**
+** Function btif_hl_select_tx_ready
+**
+** Description send a signal to resume reading the paused sockets
+**
+** Returns int
+**
+*******************************************************************************/
+static inline int btif_hl_select_tx_ready(void){
+    char sig_on = btif_hl_signal_select_tx_ready;
+    return send(signal_fds[1], &sig_on, sizeof(sig_on), 0);
+}
+
 /*******************************************************************************
 **
 ** Function btif_hl_close_select_thread
@@ -5063,7 +5443,8 @@ static void *btif_hl_select_thread(void *arg){
             {
                 r = btif_hl_select_wake_reset();
                 BTIF_TRACE_DEBUG("btif_hl_select_wake_signaled, signal:%d", r);
-                if (r == btif_hl_signal_select_wakeup || r == btif_hl_signal_select_close_connected )
+                if (r == btif_hl_signal_select_wakeup || r == btif_hl_signal_select_close_connected
+                    || r == btif_hl_signal_select_rx_data || r == btif_hl_signal_select_tx_ready)
                 {
                     btif_hl_select_wakeup_callback(&org_set, r);
                 }
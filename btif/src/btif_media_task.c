@@ -61,6 +61,7 @@
 #include "btif_av_co.h"
 #include "btif_avk_co.h"
 #include "btif_media.h"
+#include "btif_msbc.h"
 
 #if (BTA_AV_INCLUDED == TRUE)
 #include "sbc_encoder.h"
@@ -376,6 +377,7 @@ static void btif_media_send_aa_frame(void);
 static void btif_media_task_feeding_state_reset(void);
 static void btif_media_task_aa_start_tx(void);
 static void btif_media_task_aa_stop_tx(void);
+static void btif_media_task_sbc_enc_init(void);
 static void btif_media_task_enc_init(BT_HDR *p_msg);
 static void btif_media_task_enc_update(BT_HDR *p_msg);
 static void btif_media_task_audio_feeding_init(BT_HDR *p_msg);
@@ -1979,6 +1981,23 @@ static void btif_media_task_aa_tx_flush(BT_HDR *p_msg)
     UIPC_Ioctl(UIPC_CH_ID_AV_AUDIO, UIPC_REQ_RX_FLUSH, NULL);
 }
 
+/*******************************************************************************
+ **
+ ** Function       btif_media_task_sbc_enc_init
+ **
+ ** Description    Reset the SBC encoder with the current configuration. The
+ **                encoder globals are shared with mSBC, take them first.
+ **
+ ** Returns        void
+ **
+ *******************************************************************************/
+static void btif_media_task_sbc_enc_init(void)
+{
+    btif_sbc_enc_lock(BTIF_SBC_ENC_A2DP);
+    SBC_Encoder_Init(&(btif_media_cb.encoder));
+    btif_sbc_enc_unlock(BTIF_SBC_ENC_A2DP);
+}
+
 /*******************************************************************************
  **
  ** Function       btif_media_task_enc_init
@@ -2020,7 +2039,7 @@ static void btif_media_task_enc_init(BT_HDR *p_msg)
             btif_media_cb.encoder.s16SamplingFreq);
 
     /* Reset entirely the SBC encoder */
-    SBC_Encoder_Init(&(btif_media_cb.encoder));
+    btif_media_task_sbc_enc_init();
 
     btif_media_cb.TxNumSBCFrames = check_for_max_number_of_frames_per_packet();
     APPL_TRACE_DEBUG("btif_media_task_enc_init bit pool %d", btif_media_cb.encoder.s16BitPool);
@@ -2188,7 +2207,7 @@ static void btif_media_task_enc_update(BT_HDR *p_msg)
                 btif_media_cb.encoder.u16BitRate, btif_media_cb.encoder.s16BitPool);
 
         /* make sure we reinitialize encoder with new settings */
-        SBC_Encoder_Init(&(btif_media_cb.encoder));
+        btif_media_task_sbc_enc_init();
         btif_media_cb.TxNumSBCFrames = check_for_max_number_of_frames_per_packet();
     }
 }
@@ -2264,7 +2283,7 @@ static void btif_media_task_pcm2sbc_init(tBTIF_MEDIA_INIT_AUDIO_FEEDING * p_feed
                 btif_media_cb.encoder.s16AllocationMethod, btif_media_cb.encoder.u16BitRate,
                 btif_media_cb.encoder.s16SamplingFreq);
 
-        SBC_Encoder_Init(&(btif_media_cb.encoder));
+        btif_media_task_sbc_enc_init();
     }
     else
     {
@@ -3215,7 +3234,14 @@ static void btif_media_aa_prep_sbc_2_send(UINT8 nb_frame)
             if (btif_media_aa_read_feeding(UIPC_CH_ID_AV_AUDIO))
             {
                 /* SBC encode and descramble frame */
+                if (btif_sbc_enc_lock(BTIF_SBC_ENC_A2DP))
+                {
+                    /* mSBC encoded since our last frame, restart from a clean filter */
+                    APPL_TRACE_WARNING("btif_media_aa_prep_sbc_2_send: SBC encoder was used by mSBC");
+                    SBC_Encoder_Init(&(btif_media_cb.encoder));
+                }
                 SBC_Encoder(&(btif_media_cb.encoder));
+                btif_sbc_enc_unlock(BTIF_SBC_ENC_A2DP);
                 A2D_SbcChkFrInit(btif_media_cb.encoder.pu8Packet);
                 A2D_SbcDescramble(btif_media_cb.encoder.pu8Packet, btif_media_cb.encoder.u16PacketLength);
                 /* Update SBC frame length */
@@ -0,0 +1,659 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*****************************************************************************
+ *
+ *  Filename:      btif_msbc.c
+ *
+ *  Description:   mSBC wideband speech codec for SCO routed over HCI: H2
+ *                 framing, jitter buffer and packet loss concealment on
+ *                 top of the embdrv SBC encoder and decoder.
+ *
+ *                 The SBC encoder keeps its analysis filter in globals, so
+ *                 A2DP and mSBC serialize on btif_sbc_enc_lock, and the one
+ *                 that finds the filter left by the other reinitializes it.
+ *
+ *****************************************************************************/
+
+#include <string.h>
+#include <pthread.h>
+
+#include "bt_target.h"
+#include "bt_trace.h"
+#include "sbc_encoder.h"
+#include "oi_codec_sbc.h"
+#include "oi_status.h"
+#include "btif_msbc.h"
+
+/*****************************************************************************
+**  Constants & Macros
+******************************************************************************/
+
+#define BTIF_MSBC_H2_SYNC           0x01
+
+#define BTIF_MSBC_SLOT_MASK         (BTIF_MSBC_JITTER_SLOTS - 1)
+#define BTIF_MSBC_SEQ_NONE          0xFF
+
+/* Concealment repeats the last pitch period of the audio played before the
+** loss. The pitch is searched between 66 and 500 Hz by correlating the last
+** BTIF_MSBC_PLC_CORR_LEN samples with the history. */
+#define BTIF_MSBC_PLC_HIST          (3 * BTIF_MSBC_SAMPLES)
+#define BTIF_MSBC_PLC_CORR_LEN      60
+#define BTIF_MSBC_PLC_PITCH_MIN     32
+#define BTIF_MSBC_PLC_PITCH_MAX     240
+#define BTIF_MSBC_PLC_OLA_LEN       32      /* crossfade into the first good frame */
+
+#if ((BTIF_MSBC_JITTER_SLOTS & BTIF_MSBC_SLOT_MASK) != 0)
+#error "BTIF_MSBC_JITTER_SLOTS must be a power of 2"
+#endif
+
+#if (BTIF_MSBC_JITTER_DEPTH >= BTIF_MSBC_JITTER_SLOTS)
+#error "BTIF_MSBC_JITTER_DEPTH must be smaller than BTIF_MSBC_JITTER_SLOTS"
+#endif
+
+/*****************************************************************************
+**  Local type definitions
+******************************************************************************/
+
+typedef struct
+{
+    UINT8       pkt[BTIF_MSBC_PKT_LEN];
+    BOOLEAN     bad;
+} tBTIF_MSBC_SLOT;
+
+typedef struct
+{
+    /* TX, BTU thread */
+    SBC_ENC_PARAMS          encoder;
+    tBTIF_MSBC_PCM_CBACK    *p_pcm_cback;
+    UINT8                   tx_pkt[BTIF_MSBC_PKT_LEN];
+    UINT16                  tx_pos;         /* bytes of tx_pkt already read */
+    UINT8                   tx_seq;
+
+    /* RX packet alignment, BTU thread */
+    UINT8                   rx_pkt[BTIF_MSBC_PKT_LEN];
+    UINT16                  rx_len;
+    BOOLEAN                 rx_bad;
+
+    /* Jitter buffer. The BTU thread is the only writer of rx_head, the
+    ** audio thread the only writer of rx_tail. A slot belongs to the BTU
+    ** thread until rx_head moves past it, then to the audio thread until
+    ** rx_tail does. */
+    tBTIF_MSBC_SLOT         slots[BTIF_MSBC_JITTER_SLOTS];
+    UINT32                  rx_head;
+    UINT32                  rx_tail;
+
+    /* Decoding and concealment, audio thread */
+    OI_CODEC_SBC_DECODER_CONTEXT decoder;
+    OI_UINT32               decoder_data[CODEC_DATA_WORDS(1, SBC_CODEC_FAST_FILTER_BUFFERS)];
+    BOOLEAN                 playing;        /* FALSE while the jitter buffer fills */
+    UINT8                   last_seq;       /* H2 sequence number of the last packet */
+    INT16                   hist[BTIF_MSBC_PLC_HIST];
+    UINT16                  plc_pitch;
+    UINT16                  plc_pos;        /* samples concealed in this loss */
+    UINT8                   plc_frames;     /* frames concealed in this loss */
+
+    tBTIF_MSBC_STATS        stats;
+} tBTIF_MSBC_CB;
+
+/*****************************************************************************
+**  Static variables
+******************************************************************************/
+
+static tBTIF_MSBC_CB btif_msbc_cb;
+
+/* The SBC encoder and its last user */
+static pthread_mutex_t btif_sbc_enc_mutex = PTHREAD_MUTEX_INITIALIZER;
+static UINT8 btif_sbc_enc_user = BTIF_SBC_ENC_NONE;
+
+/* Second byte of the H2 header for sequence numbers 0 to 3: each of the two
+** bits of the number is sent twice */
+static const UINT8 btif_msbc_h2_seq[4] = { 0x08, 0x38, 0xC8, 0xF8 };
+
+/*****************************************************************************
+**  Static functions
+******************************************************************************/
+
+/*******************************************************************************
+**
+** Function         btif_msbc_h2_seq_num
+**
+** Description      Sequence number carried by the second H2 header byte.
+**
+** Returns          0 to 3, BTIF_MSBC_SEQ_NONE if the byte is not valid
+**
+*******************************************************************************/
+static UINT8 btif_msbc_h2_seq_num(UINT8 h2)
+{
+    UINT8   i;
+
+    for (i = 0; i < 4; i++)
+    {
+        if (btif_msbc_h2_seq[i] == h2)
+            return i;
+    }
+    return BTIF_MSBC_SEQ_NONE;
+}
+
+/*******************************************************************************
+**
+** Function         btif_msbc_hdr_valid
+**
+** Description      Check the first len bytes gathered for a packet against
+**                  the H2 header and the mSBC syncword.
+**
+** Returns          TRUE if they can start a packet
+**
+*******************************************************************************/
+static BOOLEAN btif_msbc_hdr_valid(const UINT8 *p_pkt, UINT16 len)
+{
+    if (len > 0 && p_pkt[0] != BTIF_MSBC_H2_SYNC)
+        return FALSE;
+    if (len > 1 && btif_msbc_h2_seq_num(p_pkt[1]) == BTIF_MSBC_SEQ_NONE)
+        return FALSE;
+    if (len > 2 && p_pkt[2] != SBC_MSBC_SYNC_WORD)
+        return FALSE;
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         btif_msbc_rx_queue
+**
+** Description      Queue a complete packet in the jitter buffer. Called on
+**                  the BTU thread.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btif_msbc_rx_queue(const UINT8 *p_pkt, BOOLEAN bad)
+{
+    tBTIF_MSBC_CB   *p_cb = &btif_msbc_cb;
+    UINT32          head = p_cb->rx_head;
+    UINT32          tail = __atomic_load_n(&p_cb->rx_tail, __ATOMIC_ACQUIRE);
+    tBTIF_MSBC_SLOT *p_slot;
+
+    if (head - tail >= BTIF_MSBC_JITTER_SLOTS)
+    {
+        p_cb->stats.rx_overrun++;
+        return;
+    }
+
+    p_slot = &p_cb->slots[head & BTIF_MSBC_SLOT_MASK];
+    memcpy(p_slot->pkt, p_pkt, BTIF_MSBC_PKT_LEN);
+    p_slot->bad = bad;
+
+    p_cb->stats.rx_pkts++;
+    if (bad)
+        p_cb->stats.rx_bad++;
+
+    /* publish the slot */
+    __atomic_store_n(&p_cb->rx_head, head + 1, __ATOMIC_RELEASE);
+}
+
+/*******************************************************************************
+**
+** Function         btif_msbc_plc_pitch
+**
+** Description      Find the pitch period at the end of the history, the lag
+**                  with the best normalized correlation.
+**
+** Returns          pitch period in samples
+**
+*******************************************************************************/
+static UINT16 btif_msbc_plc_pitch(const INT16 *p_hist)
+{
+    const INT16 *p_ref = p_hist + BTIF_MSBC_PLC_HIST - BTIF_MSBC_PLC_CORR_LEN;
+    const INT16 *p_lag;
+    float       corr, energy, score, best_score = 0;
+    UINT16      lag, best = BTIF_MSBC_PLC_PITCH_MAX;
+    int         i;
+
+    for (lag = BTIF_MSBC_PLC_PITCH_MIN; lag <= BTIF_MSBC_PLC_PITCH_MAX; lag++)
+    {
+        p_lag = p_ref - lag;
+        corr = 0;
+        energy = 1;
+        for (i = 0; i < BTIF_MSBC_PLC_CORR_LEN; i++)
+        {
+            corr += (float)p_ref[i] * p_lag[i];
+            energy += (float)p_lag[i] * p_lag[i];
+        }
+        if (corr <= 0)
+            continue;
+
+        score = corr * corr / energy;
+        if (score > best_score)
+        {
+            best_score = score;
+            best = lag;
+        }
+    }
+    return best;
+}
+
+/*******************************************************************************
+**
+** Function         btif_msbc_plc_synth
+**
+** Description      Continue the concealment waveform by num samples: the
+**                  last pitch period is repeated, fading out linearly over
+**                  BTIF_MSBC_PLC_MAX_FRAMES frames.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btif_msbc_plc_synth(INT16 *p_pcm, UINT16 num)
+{
+    tBTIF_MSBC_CB   *p_cb = &btif_msbc_cb;
+    const INT16     *p_period = p_cb->hist + BTIF_MSBC_PLC_HIST - p_cb->plc_pitch;
+    const UINT32    fade_len = BTIF_MSBC_PLC_MAX_FRAMES * BTIF_MSBC_SAMPLES;
+    UINT32          pos;
+    UINT16          i;
+
+    for (i = 0; i < num; i++)
+    {
+        pos = p_cb->plc_pos + i;
+        if (pos >= fade_len)
+            p_pcm[i] = 0;
+        else
+            p_pcm[i] = (INT16)(((INT32)p_period[pos % p_cb->plc_pitch] *
+                                (INT32)(fade_len - pos)) / (INT32)fade_len);
+    }
+}
+
+/*******************************************************************************
+**
+** Function         btif_msbc_conceal
+**
+** Description      Write one frame in place of a lost one.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btif_msbc_conceal(INT16 *p_pcm)
+{
+    tBTIF_MSBC_CB   *p_cb = &btif_msbc_cb;
+
+    if (p_cb->plc_frames == 0)
+    {
+        p_cb->plc_pitch = btif_msbc_plc_pitch(p_cb->hist);
+        p_cb->plc_pos = 0;
+    }
+
+    btif_msbc_plc_synth(p_pcm, BTIF_MSBC_SAMPLES);
+
+    if (p_cb->plc_frames < BTIF_MSBC_PLC_MAX_FRAMES)
+    {
+        p_cb->plc_frames++;
+        p_cb->plc_pos += BTIF_MSBC_SAMPLES;
+    }
+    p_cb->stats.concealed++;
+}
+
+/*******************************************************************************
+**
+** Function         btif_msbc_played
+**
+** Description      Account for a decoded frame: crossfade from the
+**                  concealment if it follows a loss, then keep it in the
+**                  history.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btif_msbc_played(INT16 *p_pcm)
+{
+    tBTIF_MSBC_CB   *p_cb = &btif_msbc_cb;
+    INT16           plc[BTIF_MSBC_PLC_OLA_LEN];
+    INT32           i;
+
+    if (p_cb->plc_frames > 0)
+    {
+        btif_msbc_plc_synth(plc, BTIF_MSBC_PLC_OLA_LEN);
+        for (i = 0; i < BTIF_MSBC_PLC_OLA_LEN; i++)
+        {
+            p_pcm[i] = (INT16)(((INT32)p_pcm[i] * i +
+                                (INT32)plc[i] * (BTIF_MSBC_PLC_OLA_LEN - i)) / BTIF_MSBC_PLC_OLA_LEN);
+        }
+        p_cb->plc_frames = 0;
+    }
+
+    memmove(p_cb->hist, p_cb->hist + BTIF_MSBC_SAMPLES,
+            (BTIF_MSBC_PLC_HIST - BTIF_MSBC_SAMPLES) * sizeof(INT16));
+    memcpy(p_cb->hist + BTIF_MSBC_PLC_HIST - BTIF_MSBC_SAMPLES, p_pcm,
+           BTIF_MSBC_SAMPLES * sizeof(INT16));
+}
+
+/*****************************************************************************
+**  Externally called functions
+******************************************************************************/
+
+/*******************************************************************************
+**
+** Function         btif_msbc_init
+**
+** Description      Reset the codec and the jitter buffer. Must be called
+**                  before the SCO connection opens, when neither thread
+**                  uses the codec.
+**
+** Returns          void
+**
+*******************************************************************************/
+void btif_msbc_init(tBTIF_MSBC_PCM_CBACK *p_pcm_cback)
+{
+    tBTIF_MSBC_CB   *p_cb = &btif_msbc_cb;
+    OI_STATUS       status;
+
+    memset(p_cb, 0, sizeof(tBTIF_MSBC_CB));
+
+    p_cb->p_pcm_cback = p_pcm_cback;
+    p_cb->tx_pos = BTIF_MSBC_PKT_LEN;
+    p_cb->last_seq = BTIF_MSBC_SEQ_NONE;
+
+    p_cb->encoder.mSBCEnabled = TRUE;
+    btif_sbc_enc_lock(BTIF_SBC_ENC_MSBC);
+    SBC_Encoder_Init(&p_cb->encoder);
+    btif_sbc_enc_unlock(BTIF_SBC_ENC_MSBC);
+
+    status = OI_CODEC_SBC_DecoderReset(&p_cb->decoder, p_cb->decoder_data,
+                                       sizeof(p_cb->decoder_data), 1, 1, FALSE);
+    if (OI_SUCCESS(status))
+        status = OI_CODEC_SBC_DecoderConfigureMSbc(&p_cb->decoder);
+    if (!OI_SUCCESS(status))
+        BTIF_TRACE_ERROR("%s: decoder reset failed: %d", __FUNCTION__, status);
+
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/*******************************************************************************
+**
+** Function         btif_msbc_encode
+**
+** Description      Encode BTIF_MSBC_SAMPLES samples into one packet with its
+**                  H2 header and pad byte.
+**
+** Returns          void
+**
+*******************************************************************************/
+void btif_msbc_encode(const INT16 *p_pcm, UINT8 *p_pkt)
+{
+    tBTIF_MSBC_CB   *p_cb = &btif_msbc_cb;
+
+    p_pkt[0] = BTIF_MSBC_H2_SYNC;
+    p_pkt[1] = btif_msbc_h2_seq[p_cb->tx_seq];
+    p_cb->tx_seq = (p_cb->tx_seq + 1) & 3;
+
+#if (SBC_NO_PCM_CPY_OPTION == TRUE)
+    p_cb->encoder.ps16PcmBuffer = (SINT16 *)p_pcm;
+#else
+    memcpy(p_cb->encoder.as16PcmBuffer, p_pcm, BTIF_MSBC_SAMPLES * sizeof(INT16));
+#endif
+    p_cb->encoder.pu8Packet = p_pkt + BTIF_MSBC_H2_LEN;
+    if (btif_sbc_enc_lock(BTIF_SBC_ENC_MSBC))
+    {
+        /* A2DP encoded since our last frame, restart from a clean filter */
+        BTIF_TRACE_WARNING("%s: SBC encoder was used by A2DP", __FUNCTION__);
+        SBC_Encoder_Init(&p_cb->encoder);
+    }
+    SBC_Encoder(&p_cb->encoder);
+    btif_sbc_enc_unlock(BTIF_SBC_ENC_MSBC);
+
+    p_pkt[BTIF_MSBC_PKT_LEN - 1] = 0;
+    p_cb->stats.tx_frames++;
+}
+
+/*******************************************************************************
+**
+** Function         btif_msbc_tx_read
+**
+** Description      Fill a SCO packet of any size from the packet stream.
+**                  A new packet is encoded whenever the current one has
+**                  been read, with PCM from the source given to
+**                  btif_msbc_init; missing samples are sent as silence.
+**
+** Returns          void
+**
+*******************************************************************************/
+void btif_msbc_tx_read(UINT8 *p_buf, UINT16 len)
+{
+    tBTIF_MSBC_CB   *p_cb = &btif_msbc_cb;
+    INT16           pcm[BTIF_MSBC_SAMPLES];
+    UINT16          num, n;
+
+    while (len > 0)
+    {
+        if (p_cb->tx_pos == BTIF_MSBC_PKT_LEN)
+        {
+            num = p_cb->p_pcm_cback ? (*p_cb->p_pcm_cback)(pcm, BTIF_MSBC_SAMPLES) : 0;
+            if (num < BTIF_MSBC_SAMPLES)
+                memset(pcm + num, 0, (BTIF_MSBC_SAMPLES - num) * sizeof(INT16));
+
+            btif_msbc_encode(pcm, p_cb->tx_pkt);
+            p_cb->tx_pos = 0;
+        }
+
+        n = BTIF_MSBC_PKT_LEN - p_cb->tx_pos;
+        if (n > len)
+            n = len;
+        memcpy(p_buf, p_cb->tx_pkt + p_cb->tx_pos, n);
+        p_cb->tx_pos += n;
+        p_buf += n;
+        len -= n;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         btif_msbc_rx_data
+**
+** Description      Gather SCO payloads into packets and queue them in the
+**                  jitter buffer. The controller delivers SCO packets of
+**                  its own size, so a packet may span several of them; a
+**                  packet starts where an H2 header is followed by the mSBC
+**                  syncword, and bytes in front of one are skipped.
+**
+** Returns          void
+**
+*******************************************************************************/
+void btif_msbc_rx_data(const UINT8 *p_data, UINT16 len, BOOLEAN bad)
+{
+    tBTIF_MSBC_CB   *p_cb = &btif_msbc_cb;
+    UINT16          n;
+
+    if (bad)
+        p_cb->rx_bad = TRUE;
+
+    while (len > 0)
+    {
+        /* header bytes are checked one at a time */
+        n = (p_cb->rx_len < BTIF_MSBC_H2_LEN + 1) ? 1 : BTIF_MSBC_PKT_LEN - p_cb->rx_len;
+        if (n > len)
+            n = len;
+        memcpy(p_cb->rx_pkt + p_cb->rx_len, p_data, n);
+        p_cb->rx_len += n;
+        p_data += n;
+        len -= n;
+
+        while (p_cb->rx_len > 0 && !btif_msbc_hdr_valid(p_cb->rx_pkt, p_cb->rx_len))
+        {
+            memmove(p_cb->rx_pkt, p_cb->rx_pkt + 1, --p_cb->rx_len);
+            p_cb->stats.rx_resync++;
+        }
+
+        if (p_cb->rx_len == BTIF_MSBC_PKT_LEN)
+        {
+            btif_msbc_rx_queue(p_cb->rx_pkt, p_cb->rx_bad);
+            p_cb->rx_len = 0;
+            p_cb->rx_bad = bad && (len > 0);
+        }
+    }
+}
+
+/*******************************************************************************
+**
+** Function         btif_msbc_decode
+**
+** Description      Write the next BTIF_MSBC_SAMPLES samples. Called on the
+**                  audio thread every 7.5 ms. Playout waits for
+**                  BTIF_MSBC_JITTER_DEPTH packets, then takes one packet a
+**                  call. A packet flagged bad, one whose frame does not
+**                  decode, or one missing from the H2 sequence is
+**                  concealed. An empty jitter buffer is concealed too, and
+**                  playout waits for it to fill again.
+**
+** Returns          BTIF_MSBC_DECODED, BTIF_MSBC_CONCEALED or
+**                  BTIF_MSBC_BUFFERING
+**
+*******************************************************************************/
+tBTIF_MSBC_RESULT btif_msbc_decode(INT16 *p_pcm)
+{
+    tBTIF_MSBC_CB   *p_cb = &btif_msbc_cb;
+    UINT32          tail = p_cb->rx_tail;
+    UINT32          head = __atomic_load_n(&p_cb->rx_head, __ATOMIC_ACQUIRE);
+    tBTIF_MSBC_SLOT *p_slot;
+    const OI_BYTE   *p_frame;
+    OI_UINT32       frame_bytes, pcm_bytes;
+    OI_STATUS       status;
+    UINT8           seq;
+    BOOLEAN         decoded = FALSE;
+
+    if (!p_cb->playing)
+    {
+        if (head - tail < BTIF_MSBC_JITTER_DEPTH)
+        {
+            /* keep concealing the underrun, or stay silent before the first packet */
+            if (p_cb->plc_frames > 0)
+                btif_msbc_conceal(p_pcm);
+            else
+                memset(p_pcm, 0, BTIF_MSBC_SAMPLES * sizeof(INT16));
+            return BTIF_MSBC_BUFFERING;
+        }
+        p_cb->playing = TRUE;
+    }
+
+    if (head == tail)
+    {
+        p_cb->stats.underruns++;
+        p_cb->playing = FALSE;
+        btif_msbc_conceal(p_pcm);
+        return BTIF_MSBC_CONCEALED;
+    }
+
+    p_slot = &p_cb->slots[tail & BTIF_MSBC_SLOT_MASK];
+    seq = btif_msbc_h2_seq_num(p_slot->pkt[1]);
+
+    /* conceal the packets missing in front of this one, one per call */
+    if (p_cb->last_seq != BTIF_MSBC_SEQ_NONE && seq != ((p_cb->last_seq + 1) & 3))
+    {
+        p_cb->last_seq = (p_cb->last_seq + 1) & 3;
+        p_cb->stats.seq_gaps++;
+        btif_msbc_conceal(p_pcm);
+        return BTIF_MSBC_CONCEALED;
+    }
+    p_cb->last_seq = seq;
+
+    if (!p_slot->bad)
+    {
+        p_frame = p_slot->pkt + BTIF_MSBC_H2_LEN;
+        frame_bytes = BTIF_MSBC_PKT_LEN - BTIF_MSBC_H2_LEN;
+        pcm_bytes = BTIF_MSBC_SAMPLES * sizeof(INT16);
+        status = OI_CODEC_SBC_DecodeFrame(&p_cb->decoder, &p_frame, &frame_bytes,
+                                          p_pcm, &pcm_bytes);
+        decoded = OI_SUCCESS(status) && (pcm_bytes == BTIF_MSBC_SAMPLES * sizeof(INT16));
+        if (!decoded)
+            p_cb->stats.dec_errors++;
+    }
+
+    /* hand the slot back */
+    __atomic_store_n(&p_cb->rx_tail, tail + 1, __ATOMIC_RELEASE);
+
+    if (!decoded)
+    {
+        btif_msbc_conceal(p_pcm);
+        return BTIF_MSBC_CONCEALED;
+    }
+
+    p_cb->stats.dec_frames++;
+    btif_msbc_played(p_pcm);
+    return BTIF_MSBC_DECODED;
+}
+
+/*******************************************************************************
+**
+** Function         btif_msbc_rx_depth
+**
+** Description      Number of packets in the jitter buffer.
+**
+** Returns          UINT16
+**
+*******************************************************************************/
+UINT16 btif_msbc_rx_depth(void)
+{
+    return (UINT16)(__atomic_load_n(&btif_msbc_cb.rx_head, __ATOMIC_ACQUIRE) -
+                    __atomic_load_n(&btif_msbc_cb.rx_tail, __ATOMIC_ACQUIRE));
+}
+
+/*******************************************************************************
+**
+** Function         btif_msbc_get_stats
+**
+** Description      Copy the codec counters.
+**
+** Returns          void
+**
+*******************************************************************************/
+void btif_msbc_get_stats(tBTIF_MSBC_STATS *p_stats)
+{
+    memcpy(p_stats, &btif_msbc_cb.stats, sizeof(tBTIF_MSBC_STATS));
+}
+
+/*******************************************************************************
+**
+** Function         btif_sbc_enc_lock
+**
+** Description      Take the SBC encoder, which A2DP and mSBC share. Its
+**                  analysis filter and packing state are globals that carry
+**                  over from frame to frame, so they are only valid for the
+**                  stream that last ran the encoder.
+**
+** Returns          TRUE if another user ran the encoder since user did
+**
+*******************************************************************************/
+BOOLEAN btif_sbc_enc_lock(UINT8 user)
+{
+    pthread_mutex_lock(&btif_sbc_enc_mutex);
+
+    return (btif_sbc_enc_user != user);
+}
+
+/*******************************************************************************
+**
+** Function         btif_sbc_enc_unlock
+**
+** Description      Release the SBC encoder, leaving its globals to user.
+**
+** Returns          void
+**
+*******************************************************************************/
+void btif_sbc_enc_unlock(UINT8 user)
+{
+    btif_sbc_enc_user = user;
+
+    pthread_mutex_unlock(&btif_sbc_enc_mutex);
+}
@@ -38,6 +38,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <net/if.h>
 #include <linux/sockios.h>
@@ -77,8 +78,6 @@
 
 #define asrt(s) if(!(s)) BTIF_TRACE_ERROR("btif_pan: ## %s assert %s failed at line:%d ##",__FUNCTION__, #s, __LINE__)
 
-#define MIN(x, y) (((x) < (y)) ? (x) : (y))
-
 btpan_cb_t btpan_cb;
 
 BD_ADDR local_addr;
@@ -445,25 +444,22 @@ int btpan_tap_send(int tap_fd, const BD_ADDR src, const BD_ADDR dst, UINT16 prot
     if(tap_fd != -1)
     {
         tETH_HDR eth_hdr;
-        //if(is_empty_eth_addr(dst))
-        //    memcpy(&eth_hdr.h_dest, local_addr, ETH_ADDR_LEN);
-        //else
+        struct iovec iov[2];
         memcpy(&eth_hdr.h_dest, dst, ETH_ADDR_LEN);
         memcpy(&eth_hdr.h_src, src, ETH_ADDR_LEN);
         eth_hdr.h_proto = htons(proto);
-        char packet[2014];
-        memcpy(packet, &eth_hdr, sizeof(tETH_HDR));
         if(len > 2000)
         {
             ALOGE("btpan_tap_send eth packet size:%d is exceeded limit!", len);
             return -1;
         }
-        memcpy(packet + sizeof(tETH_HDR), buf, len);
 
-        /* Send data to network interface */
-        //btnet_send(btpan_cb.conn[i].sock.sock, &buffer, (len + sizeof(tETH_HDR)));
-        //dump_bin("packet to network", packet, len + sizeof(tETH_HDR));
-        int ret = write(tap_fd, packet, len + sizeof(tETH_HDR));
+        /* Send header and payload to the network interface as one frame */
+        iov[0].iov_base = &eth_hdr;
+        iov[0].iov_len = sizeof(tETH_HDR);
+        iov[1].iov_base = (void *)buf;
+        iov[1].iov_len = len;
+        int ret = writev(tap_fd, iov, 2);
         BTIF_TRACE_DEBUG("ret:%d", ret);
         return ret;
     }
@@ -696,9 +692,22 @@ static void bta_pan_callback(tBTA_PAN_EVT event, tBTA_PAN *p_data)
     btif_transfer_context(bta_pan_callback_transfer, event, (char*)p_data, sizeof(tBTA_PAN), NULL);
 }
 
-#define IS_EXCEPTION(e) ((e) & (POLLHUP | POLLRDHUP | POLLERR | POLLNVAL))
+// Returns false if a BNEP link has no room for another frame. BNEP frees a
+// frame it cannot queue, so the reader checks this before taking a frame off
+// the TAP fd; the flow control events that stop the reader come too late to
+// cover a burst read in one go.
+static bool bnep_has_room(void) {
+    for (int i = 0; i < MAX_PAN_CONNS; i++) {
+        tBNEP_STATUS status;
+        if (btpan_cb.conns[i].handle != -1 &&
+                BNEP_GetStatus(btpan_cb.conns[i].handle, &status) == BNEP_SUCCESS &&
+                status.xmit_q_depth >= BNEP_MAX_XMITQ_DEPTH)
+            return false;
+    }
+    return true;
+}
+
 static void btu_exec_tap_fd_read(void *p_param) {
-    struct pollfd ufd;
     int fd = (int)p_param;
 
     if (fd == -1 || fd != btpan_cb.tap_fd)
@@ -706,8 +715,14 @@ static void btu_exec_tap_fd_read(void *p_param) {
 
     // Don't occupy BTU context too long, avoid GKI buffer overruns and
     // give other profiles a chance to run by limiting the amount of memory
-    // PAN can use from the shared pool buffer.
+    // PAN can use from the shared pool buffer. The TAP fd is non-blocking,
+    // so we drain it until read() reports EAGAIN instead of polling after
+    // every packet.
     for(int i = 0; i < PAN_POOL_MAX && btif_is_enabled() && btpan_cb.flow; i++) {
+        // Leave the frame in the TAP driver until BNEP can take it.
+        if (!bnep_has_room())
+            break;
+
         BT_HDR *buffer = (BT_HDR *)GKI_getpoolbuf(PAN_POOL_ID);
         if (!buffer) {
             BTIF_TRACE_WARNING("%s unable to allocate buffer for packet.", __func__);
@@ -718,32 +733,18 @@ static void btu_exec_tap_fd_read(void *p_param) {
 
         UINT8 *packet = (UINT8 *)buffer + sizeof(BT_HDR) + buffer->offset;
 
-        // If we don't have an undelivered packet left over, pull one from the TAP driver.
-        // We save it in the congest_packet right away in case we can't deliver it in this
-        // attempt.
-        if (!btpan_cb.congest_packet_size) {
-            ssize_t ret = read(fd, btpan_cb.congest_packet, sizeof(btpan_cb.congest_packet));
-            switch (ret) {
-                case -1:
-                    BTIF_TRACE_ERROR("%s unable to read from driver: %s", __func__, strerror(errno));
-                    GKI_freebuf(buffer);
-                    //add fd back to monitor thread to try it again later
-                    btsock_thread_add_fd(pan_pth, fd, 0, SOCK_THREAD_FD_RD, 0);
-                    return;
-                case 0:
-                    BTIF_TRACE_WARNING("%s end of file reached.", __func__);
-                    GKI_freebuf(buffer);
-                    //add fd back to monitor thread to process the exception
-                    btsock_thread_add_fd(pan_pth, fd, 0, SOCK_THREAD_FD_RD, 0);
-                    return;
-                default:
-                    btpan_cb.congest_packet_size = ret;
-                    break;
+        // Read the frame straight into the buffer that goes down to BNEP.
+        ssize_t ret = read(fd, packet, buffer->len);
+        if (ret <= 0) {
+            GKI_freebuf(buffer);
+            if (ret == 0) {
+                BTIF_TRACE_WARNING("%s end of file reached.", __func__);
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                BTIF_TRACE_ERROR("%s unable to read from driver: %s", __func__, strerror(errno));
             }
+            break;
         }
-
-        memcpy(packet, btpan_cb.congest_packet, MIN(btpan_cb.congest_packet_size, buffer->len));
-        buffer->len = MIN(btpan_cb.congest_packet_size, buffer->len);
+        buffer->len = ret;
 
         if (buffer->len > sizeof(tETH_HDR) && should_forward((tETH_HDR *)packet)) {
             // Extract the ethernet header from the buffer since the PAN_WriteBuf inside
@@ -754,20 +755,15 @@ static void btu_exec_tap_fd_read(void *p_param) {
             // Skip the ethernet header.
             buffer->len -= sizeof(tETH_HDR);
             buffer->offset += sizeof(tETH_HDR);
-            if (forward_bnep(&hdr, buffer) != FORWARD_CONGEST)
-                btpan_cb.congest_packet_size = 0;
+            if (forward_bnep(&hdr, buffer) == FORWARD_CONGEST) {
+                // Not expected after bnep_has_room(); BNEP has released the frame.
+                BTIF_TRACE_WARNING("%s bnep queue full, dropped packet", __func__);
+                break;
+            }
         } else {
             BTIF_TRACE_WARNING("%s dropping packet of length %d", __func__, buffer->len);
-            btpan_cb.congest_packet_size = 0;
             GKI_freebuf(buffer);
         }
-
-        // Bail out of the loop if reading from the TAP fd would block.
-        ufd.fd = fd;
-        ufd.events = POLLIN;
-        ufd.revents = 0;
-        if(poll(&ufd, 1, 0) <= 0 || IS_EXCEPTION(ufd.revents))
-            break;
     }
     //add fd back to monitor thread
     btsock_thread_add_fd(pan_pth, fd, 0, SOCK_THREAD_FD_RD, 0);
@@ -28,6 +28,7 @@
 #include <hardware/bt_sock.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include <sys/ioctl.h>
 
@@ -79,6 +80,7 @@ static inline void logu(const char* title, const uint8_t * p_uuid)
 
 
 #define MAX_RFC_SESSION BTA_JV_MAX_RFC_SR_SESSION //3 by default
+#define MAX_INCOMING_IOV 16 //max queued buffers coalesced into one sendmsg
 typedef struct {
     int outgoing_congest : 1;
     int pending_sdp_request : 1;
@@ -88,6 +90,17 @@ typedef struct {
     int closing : 1;
 } flags_t;
 
+/* Per-slot counters for data parked on the way to the app socket */
+typedef struct {
+    uint32_t queue_bufs;
+    uint32_t queue_bytes;
+    uint32_t max_queue_bufs;
+    uint32_t max_queue_bytes;
+    uint32_t delivered_bytes;
+    uint32_t sendmsg_calls;
+    uint32_t flow_off_count;
+} rfc_queue_stats_t;
+
 typedef struct {
   flags_t f;
   uint32_t id;
@@ -105,6 +118,8 @@ typedef struct {
   int rfc_port_handle;
   int role;
   list_t *incoming_queue;
+  int app_sndbuf;
+  rfc_queue_stats_t stats;
 } rfc_slot_t;
 
 static rfc_slot_t rfc_slots[MAX_RFC_CHANNEL];
@@ -683,6 +698,13 @@ static void cleanup_rfc_slot(rfc_slot_t* rs)
     {
         list_clear(rs->incoming_queue);
     }
+    APPL_TRACE_DEBUG("slot:%u incoming stats, max queued bufs:%u, max queued bytes:%u, "
+                     "delivered bytes:%u, sendmsg calls:%u, flow off count:%u", rs->id,
+                      rs->stats.max_queue_bufs, rs->stats.max_queue_bytes,
+                      rs->stats.delivered_bytes, rs->stats.sendmsg_calls,
+                      rs->stats.flow_off_count);
+    memset(&rs->stats, 0, sizeof(rs->stats));
+    rs->app_sndbuf = 0;
 
     rs->rfc_port_handle = 0;
     //cleanup the flag
@@ -993,55 +1015,108 @@ static void jv_dm_cback(tBTA_JV_EVT event, tBTA_JV *p_data, void *user_data)
 #define SENT_PARTIAL 1
 #define SENT_NONE 0
 #define SENT_FAILED (-1)
-static int send_data_to_app(int fd, BT_HDR *p_buf)
+static inline void queue_incoming(rfc_slot_t* rs, BT_HDR *p_buf)
 {
-    if(p_buf->len == 0)
-        return SENT_ALL;
-    int sent = send(fd, (UINT8 *)(p_buf + 1) + p_buf->offset,  p_buf->len, MSG_DONTWAIT);
-    if(sent == p_buf->len)
+    list_append(rs->incoming_queue, p_buf);
+    rs->stats.queue_bufs++;
+    rs->stats.queue_bytes += p_buf->len;
+    if(rs->stats.queue_bufs > rs->stats.max_queue_bufs)
+        rs->stats.max_queue_bufs = rs->stats.queue_bufs;
+    if(rs->stats.queue_bytes > rs->stats.max_queue_bytes)
+        rs->stats.max_queue_bytes = rs->stats.queue_bytes;
+}
+static int send_incoming_que_to_app(rfc_slot_t* rs)
+{
+    struct iovec iov[MAX_INCOMING_IOV];
+    struct msghdr msg;
+    list_node_t *node;
+    int count = 0;
+    //coalesce the queued buffers into one sendmsg
+    for(node = list_begin(rs->incoming_queue);
+        node != list_end(rs->incoming_queue) && count < MAX_INCOMING_IOV;
+        node = list_next(node))
+    {
+        BT_HDR *p_buf = list_node(node);
+        iov[count].iov_base = (UINT8 *)(p_buf + 1) + p_buf->offset;
+        iov[count].iov_len = p_buf->len;
+        count++;
+    }
+    if(count == 0)
         return SENT_ALL;
-
-    if(sent > 0 && sent < p_buf->len)
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    int sent = sendmsg(rs->fd, &msg, MSG_DONTWAIT);
+    rs->stats.sendmsg_calls++;
+    if(sent < 0)
     {
-        //sent partial
-        APPL_TRACE_ERROR("send partial, sent:%d, p_buf->len:%d", sent, p_buf->len);
-        p_buf->offset += sent;
-        p_buf->len -= sent;
-        return SENT_PARTIAL;
-
+        if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        {
+            APPL_TRACE_DEBUG("send none, EAGAIN or EWOULDBLOCK, errno:%d", errno);
+            return SENT_NONE;
+        }
+        APPL_TRACE_ERROR("unknown sendmsg() error, count:%d, errno:%d", count, errno);
+        return SENT_FAILED;
     }
-    if(sent < 0 &&
-        (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    rs->stats.delivered_bytes += sent;
+    rs->stats.queue_bytes -= sent;
+    //release the fully sent buffers and trim the partially sent one
+    int i;
+    for(i = 0; i < count; i++)
     {
-        APPL_TRACE_ERROR("send none, EAGAIN or EWOULDBLOCK, errno:%d", errno);
-        return SENT_NONE;
+        BT_HDR *p_buf = list_front(rs->incoming_queue);
+        if(sent < p_buf->len)
+        {
+            APPL_TRACE_DEBUG("send partial, sent:%d, p_buf->len:%d", sent, p_buf->len);
+            p_buf->offset += sent;
+            p_buf->len -= sent;
+            return SENT_PARTIAL;
+        }
+        sent -= p_buf->len;
+        list_remove(rs->incoming_queue, p_buf);
+        rs->stats.queue_bufs--;
     }
-    APPL_TRACE_ERROR("unknown send() error, sent:%d, p_buf->len:%d,  errno:%d", sent, p_buf->len, errno);
-    return SENT_FAILED;
+    return SENT_ALL;
+}
+static BOOLEAN app_sock_has_room(rfc_slot_t* rs)
+{
+    int pending = 0;
+    if(rs->app_sndbuf <= 0)
+    {
+        socklen_t len = sizeof(rs->app_sndbuf);
+        if(getsockopt(rs->fd, SOL_SOCKET, SO_SNDBUF, &rs->app_sndbuf, &len) != 0)
+            rs->app_sndbuf = 0;
+    }
+    if(rs->app_sndbuf <= 0 || ioctl(rs->fd, TIOCOUTQ, &pending) != 0)
+        return TRUE;
+    //same threshold the kernel uses to report a unix socket writable, so the
+    //write signal we wait on fires once the app has drained the socket
+    return (pending * 4) <= rs->app_sndbuf;
+}
+static int deliver_incoming_que(rfc_slot_t* rs)
+{
+    int sent;
+    //each sendmsg covers at most MAX_INCOMING_IOV buffers, keep going while
+    //the app socket accepts whole batches
+    do
+    {
+        sent = send_incoming_que_to_app(rs);
+    } while(sent == SENT_ALL && !list_is_empty(rs->incoming_queue));
+    return sent;
 }
 static BOOLEAN flush_incoming_que_on_wr_signal(rfc_slot_t* rs)
 {
-    while(!list_is_empty(rs->incoming_queue))
+    switch(deliver_incoming_que(rs))
     {
-        BT_HDR *p_buf = list_front(rs->incoming_queue);
-        if (p_buf)
-        {
-            int sent = send_data_to_app(rs->fd, p_buf);
-            switch(sent)
-            {
-                case SENT_NONE:
-                case SENT_PARTIAL:
-                    //monitor the fd to get callback when app is ready to receive data
-                    btsock_thread_add_fd(pth, rs->fd, BTSOCK_RFCOMM, SOCK_THREAD_FD_WR, rs->id);
-                    return TRUE;
-                case SENT_ALL:
-                    list_remove(rs->incoming_queue, p_buf);
-                    break;
-                case SENT_FAILED:
-                    list_remove(rs->incoming_queue, p_buf);
-                    return FALSE;
-            }
-        }
+        case SENT_NONE:
+        case SENT_PARTIAL:
+            //monitor the fd to get callback when app is ready to receive data
+            btsock_thread_add_fd(pth, rs->fd, BTSOCK_RFCOMM, SOCK_THREAD_FD_WR, rs->id);
+            return TRUE;
+        case SENT_FAILED:
+            return FALSE;
+        case SENT_ALL:
+            break;
     }
 
     //app is ready to receive data, tell stack to start the data flow
@@ -1125,31 +1200,38 @@ int bta_co_rfc_data_incoming(void *user_data, BT_HDR *p_buf)
     rfc_slot_t* rs = find_rfc_slot_by_id(id);
     if(rs)
     {
-        if(!list_is_empty(rs->incoming_queue))
-            list_append(rs->incoming_queue, p_buf);
-        else
+        BOOLEAN was_empty = list_is_empty(rs->incoming_queue);
+        queue_incoming(rs, p_buf);
+        //the app is not draining, keep the data parked until the write signal
+        if(!was_empty)
         {
-            int sent = send_data_to_app(rs->fd, p_buf);
-            switch(sent)
-            {
-                case SENT_NONE:
-                case SENT_PARTIAL:
-                    //add it to the end of the queue
-                    list_append(rs->incoming_queue, p_buf);
-                    //monitor the fd to get callback when app is ready to receive data
-                    btsock_thread_add_fd(pth, rs->fd, BTSOCK_RFCOMM, SOCK_THREAD_FD_WR, rs->id);
-                    break;
-                case SENT_ALL:
-                    GKI_freebuf(p_buf);
+            unlock_slot(&slot_lock);
+            return 0;
+        }
+        switch(deliver_incoming_que(rs))
+        {
+            case SENT_NONE:
+            case SENT_PARTIAL:
+                //monitor the fd to get callback when app is ready to receive data
+                rs->stats.flow_off_count++;
+                btsock_thread_add_fd(pth, rs->fd, BTSOCK_RFCOMM, SOCK_THREAD_FD_WR, rs->id);
+                break;
+            case SENT_ALL:
+                if(app_sock_has_room(rs))
+                {
                     ret = 1;//enable the data flow
                     break;
-                case SENT_FAILED:
-                    GKI_freebuf(p_buf);
-                    cleanup_rfc_slot(rs);
-                    break;
-            }
+                }
+                //app socket is filling up, hold the peer's credits until it drains
+                rs->stats.flow_off_count++;
+                btsock_thread_add_fd(pth, rs->fd, BTSOCK_RFCOMM, SOCK_THREAD_FD_WR, rs->id);
+                break;
+            case SENT_FAILED:
+                cleanup_rfc_slot(rs);
+                break;
         }
      }
+    else GKI_freebuf(p_buf);
     unlock_slot(&slot_lock);
     return ret;//return 0 to disable data flow
 }
@@ -1199,4 +1281,40 @@ int bta_co_rfc_data_outgoing(void *user_data, UINT8* buf, UINT16 size)
     unlock_slot(&slot_lock);
     return ret;
 }
-
+int bta_co_rfc_data_outgoing_vec(void *user_data, BT_HDR **pp_buf, UINT16 count)
+{
+    uint32_t id = (uintptr_t)user_data;
+    int ret = FALSE;
+    struct iovec iov[PORT_DATA_VEC_MAX];
+    int size = 0;
+    int i;
+    if(count > PORT_DATA_VEC_MAX)
+    {
+        APPL_TRACE_ERROR("bta_co_rfc_data_outgoing_vec, too many buffers:%d", count);
+        return FALSE;
+    }
+    for(i = 0; i < count; i++)
+    {
+        iov[i].iov_base = (UINT8 *)(pp_buf[i] + 1) + pp_buf[i]->offset;
+        iov[i].iov_len = pp_buf[i]->len;
+        size += pp_buf[i]->len;
+    }
+    lock_slot(&slot_lock);
+    rfc_slot_t* rs = find_rfc_slot_by_id(id);
+    if(rs)
+    {
+        //one scatter read fills the whole chain of mtu sized buffers
+        int received = readv(rs->fd, iov, count);
+        if(received == size)
+            ret = TRUE;
+        else
+        {
+            APPL_TRACE_ERROR("readv error, errno:%d, fd:%d, size:%d, count:%d, received:%d",
+                             errno, rs->fd, size, count, received);
+            cleanup_rfc_slot(rs);
+        }
+    }
+    else APPL_TRACE_ERROR("bta_co_rfc_data_outgoing_vec, invalid slot id:%d", id);
+    unlock_slot(&slot_lock);
+    return ret;
+}
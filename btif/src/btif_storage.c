@@ -617,13 +617,26 @@ static bt_status_t btif_in_fetch_bonded_devices(btif_bonded_devices_t *p_bonded_
                 {
                     DEV_CLASS dev_class = {0, 0, 0};
                     int cod;
-                    if(btif_config_get_int("Remote", kname, "DevClass", &cod))
-                        uint2devclass((UINT32)cod, dev_class);
-                    BTA_DmAddDevice(bd_addr.address, dev_class, link_key, 0, 0, (UINT8)linkkey_type, 0, pin_len);
+                    BOOLEAN dual_mode = FALSE;
+                    BOOLEAN add_to_btm = TRUE;
+#if BLE_INCLUDED == TRUE
+                    dual_mode = btif_config_get_int("Remote", kname, "DevType", &device_type) &&
+                                (device_type == BT_DEVICE_TYPE_DUMO);
+#endif
+#if (BTA_DM_LAZY_LINK_KEYS == TRUE)
+                    /* BTM fetches the key through bta_dm_co_get_link_key() when first needed */
+                    add_to_btm = dual_mode;
+#endif
+                    if(add_to_btm)
+                    {
+                        if(btif_config_get_int("Remote", kname, "DevClass", &cod))
+                            uint2devclass((UINT32)cod, dev_class);
+                        BTA_DmAddDevice(bd_addr.address, dev_class, link_key, 0, 0,
+                                        (UINT8)linkkey_type, 0, pin_len);
+                    }
 
 #if BLE_INCLUDED == TRUE
-                    if (btif_config_get_int("Remote", kname, "DevType", &device_type) &&
-                       (device_type == BT_DEVICE_TYPE_DUMO) )
+                    if (dual_mode)
                     {
                         btif_gatts_add_bonded_dev_from_nv(bd_addr.address);
                     }
@@ -926,6 +939,39 @@ bt_status_t btif_storage_remove_bonded_device(bt_bdaddr_t *remote_bd_addr)
 
 }
 
+/*******************************************************************************
+**
+** Function         btif_storage_get_link_key
+**
+** Description      BTIF storage API - Fetches the link-key, key type and
+**                  pin key length of a bonded device from NVRAM
+**
+** Returns          BT_STATUS_SUCCESS if the device has a stored link key,
+**                  BT_STATUS_FAIL otherwise
+**
+*******************************************************************************/
+bt_status_t btif_storage_get_link_key(bt_bdaddr_t *remote_bd_addr,
+                                      LINK_KEY link_key,
+                                      uint8_t *p_key_type,
+                                      uint8_t *p_pin_length)
+{
+    bdstr_t bdstr;
+    int type = BTIF_CFG_TYPE_BIN;
+    int size = sizeof(LINK_KEY);
+    int linkkey_type;
+    int pin_len = 0;
+
+    bd2str(remote_bd_addr, &bdstr);
+    if(!btif_config_get("Remote", bdstr, "LinkKey", (char*)link_key, &size, &type) ||
+       !btif_config_get_int("Remote", bdstr, "LinkKeyType", &linkkey_type))
+        return BT_STATUS_FAIL;
+    btif_config_get_int("Remote", bdstr, "PinLength", &pin_len);
+    BTIF_TRACE_DEBUG("%s: bd addr:%s, key type:%d", __FUNCTION__, bdstr, linkkey_type);
+    *p_key_type = (uint8_t)linkkey_type;
+    *p_pin_length = (uint8_t)pin_len;
+    return BT_STATUS_SUCCESS;
+}
+
 /*******************************************************************************
 **
 ** Function         btif_storage_is_device_bonded
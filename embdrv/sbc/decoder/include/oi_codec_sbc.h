@@ -65,6 +65,13 @@ Declarations of codec functions, data types, and macros.
 #define SBC_WBS_FRAME_LEN 62
 #define SBC_WBS_SAMPLES_PER_FRAME 128
 
+/* mSBC, the HFP wideband speech codec: 16 kHz mono, 8 subbands, 15 blocks,
+ * loudness allocation and bitpool 26. The header carries none of these. */
+#define SBC_MSBC_BITPOOL 26
+#define SBC_MSBC_NROF_BLOCKS 15
+#define SBC_MSBC_FRAME_LEN 57
+#define SBC_MSBC_SAMPLES_PER_FRAME 120
+
 
 #define SBC_HEADER_LEN 4
 #define SBC_MAX_FRAME_LEN (SBC_HEADER_LEN + \
@@ -76,6 +83,7 @@ Declarations of codec functions, data types, and macros.
 
 #define OI_SBC_SYNCWORD 0x9c
 #define OI_SBC_ENHANCED_SYNCWORD 0x9d
+#define OI_mSBC_SYNCWORD 0xad
 
 /**@name Sampling frequencies */
 /**@{*/
@@ -198,6 +206,7 @@ typedef struct {
     OI_UINT8 limitFrameFormat;              /* Boolean, set by OI_CODEC_SBC_DecoderLimit() */
     OI_UINT8 restrictSubbands;
     OI_UINT8 enhancedEnabled;
+    OI_UINT8 mSbcEnabled;                   /* Boolean, set by OI_CODEC_SBC_DecoderConfigureMSbc() */
     OI_UINT8 bufferedBlocks;
 } OI_CODEC_SBC_DECODER_CONTEXT;
 
@@ -260,6 +269,18 @@ OI_STATUS OI_CODEC_SBC_DecoderLimit(OI_CODEC_SBC_DECODER_CONTEXT *context,
                                     OI_BOOL enhanced,
                                     OI_UINT8 subbands);
 
+/**
+ * This function switches the decoder to mSBC frames, the wideband speech
+ * codec of the Hands-Free Profile. It must be called after calling
+ * OI_CODEC_SBC_DecoderReset(). After it is called the decoder only
+ * recognizes the mSBC syncword, and takes the frame parameters from the
+ * mSBC definition instead of the frame header.
+ *
+ * @param context   Pointer to the decoder context structure. It must have
+ *                  been reset with maxChannels of at least 1.
+ */
+OI_STATUS OI_CODEC_SBC_DecoderConfigureMSbc(OI_CODEC_SBC_DECODER_CONTEXT *context);
+
 /**
  * This function sets the decoder parameters for a raw decode where the decoder parameters are not
  * available in the sbc data stream. OI_CODEC_SBC_DecoderReset must be called
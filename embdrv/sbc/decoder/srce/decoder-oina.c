@@ -98,6 +98,19 @@ OI_STATUS OI_CODEC_SBC_DecoderConfigureRaw(OI_CODEC_SBC_DECODER_CONTEXT *context
 
 
 
+OI_STATUS OI_CODEC_SBC_DecoderConfigureMSbc(OI_CODEC_SBC_DECODER_CONTEXT *context)
+{
+    if (context->common.maxChannels < 1) {
+        return OI_STATUS_INVALID_PARAMETERS;
+    }
+
+    context->enhancedEnabled = FALSE;
+    context->limitFrameFormat = FALSE;
+    context->mSbcEnabled = TRUE;
+    context->bufferedBlocks = 0;
+    return OI_OK;
+}
+
 OI_STATUS OI_CODEC_SBC_DecodeRaw(OI_CODEC_SBC_DECODER_CONTEXT *context,
                                  OI_UINT8 bitpool,
                                  const OI_BYTE **frameData,
@@ -91,7 +91,26 @@ INLINE void OI_SBC_ReadHeader(OI_CODEC_SBC_COMMON_CONTEXT *common, const OI_BYTE
     OI_UINT8 d1;
 
 
-    OI_ASSERT(data[0] == OI_SBC_SYNCWORD || data[0] == OI_SBC_ENHANCED_SYNCWORD);
+    OI_ASSERT(data[0] == OI_SBC_SYNCWORD || data[0] == OI_SBC_ENHANCED_SYNCWORD ||
+              data[0] == OI_mSBC_SYNCWORD);
+
+    /* FindSyncword only accepts the mSBC syncword on an mSBC context. The
+     * mSBC header carries no parameters, they are fixed by the definition.
+     */
+    if (data[0] == OI_mSBC_SYNCWORD) {
+        frame->freqIndex = SBC_FREQ_16000;
+        frame->frequency = 16000;
+        frame->blocks = SBC_BLOCKS_16;
+        frame->nrof_blocks = SBC_MSBC_NROF_BLOCKS;
+        frame->mode = SBC_MONO;
+        frame->nrof_channels = 1;
+        frame->alloc = SBC_LOUDNESS;
+        frame->subbands = SBC_SUBBANDS_8;
+        frame->nrof_subbands = 8;
+        frame->bitpool = SBC_MSBC_BITPOOL;
+        frame->crc = data[3];
+        return;
+    }
 
     /* Avoid filling out all these strucutures if we already remember the values
      * from last time. Just in case we get a stream corresponding to data[1] ==
@@ -67,6 +67,14 @@
 
 #define SBC_NULL    0
 
+/* mSBC, the HFP wideband speech codec: fixed 16 kHz mono, 8 subbands,
+** 15 blocks, loudness and bitpool 26, giving 57 byte frames of 120 samples */
+#define SBC_MSBC_SYNC_WORD          0xAD
+#define SBC_MSBC_NUM_OF_BLOCKS      15
+#define SBC_MSBC_BIT_POOL           26
+#define SBC_MSBC_FRAME_LEN          57
+#define SBC_MSBC_SAMPLES_PER_FRAME  120
+
 #ifndef SBC_MAX_NUM_FRAME
 #define SBC_MAX_NUM_FRAME 1
 #endif
@@ -187,6 +195,7 @@ typedef struct SBC_ENC_PARAMS_TAG
     UINT8  *pu8NextPacket;
     UINT16 FrameHeader;
     UINT16 u16PacketLength;
+    UINT8  mSBCEnabled;                             /* TRUE to encode mSBC frames */
 
 }SBC_ENC_PARAMS;
 
@@ -269,6 +269,10 @@ void SBC_Encoder(SBC_ENC_PARAMS *pstrEncParams)
         /* Quantize the encoded audio */
         EncPacking(pstrEncParams);
 
+        /* mSBC frames are not scrambled */
+        if (pstrEncParams->mSBCEnabled)
+            continue;
+
         /* scramble the code */
         SBC_PRTC_CHK_INIT(pu8);
         SBC_PRTC_CHK_CRC(pu8);
@@ -301,6 +305,17 @@ void SBC_Encoder_Init(SBC_ENC_PARAMS *pstrEncParams)
 
     pstrEncParams->u8NumPacketToEncode = 1; /* default is one for retrocompatibility purpose */
 
+    /* mSBC has a single configuration */
+    if (pstrEncParams->mSBCEnabled)
+    {
+        pstrEncParams->s16SamplingFreq = SBC_sf16000;
+        pstrEncParams->s16ChannelMode = SBC_MONO;
+        pstrEncParams->s16NumOfSubBands = SUB_BANDS_8;
+        pstrEncParams->s16NumOfBlocks = SBC_MSBC_NUM_OF_BLOCKS;
+        pstrEncParams->s16AllocationMethod = SBC_LOUDNESS;
+        pstrEncParams->u16BitRate = 60;
+    }
+
     /* Required number of channels */
     if (pstrEncParams->s16ChannelMode == SBC_MONO)
         pstrEncParams->s16NumOfChannels = 1;
@@ -362,6 +377,9 @@ void SBC_Encoder_Init(SBC_ENC_PARAMS *pstrEncParams)
 
     if (pstrEncParams->s16BitPool < 0)
         pstrEncParams->s16BitPool = 0;
+
+    if (pstrEncParams->mSBCEnabled)
+        pstrEncParams->s16BitPool = SBC_MSBC_BIT_POOL;
     /* sampling freq */
     HeaderParams = ((pstrEncParams->s16SamplingFreq & 3)<< 6);
 
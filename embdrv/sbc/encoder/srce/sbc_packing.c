@@ -82,10 +82,20 @@ void EncPacking(SBC_ENC_PARAMS *pstrEncParams)
 #endif
 
     pu8PacketPtr    = pstrEncParams->pu8NextPacket;    /*Initialize the ptr*/
-    *pu8PacketPtr++ = (UINT8)0x9C;  /*Sync word*/
-    *pu8PacketPtr++=(UINT8)(pstrEncParams->FrameHeader);
+    if (pstrEncParams->mSBCEnabled)
+    {
+        /* the mSBC header carries no parameters; the reserved bytes are in the CRC */
+        *pu8PacketPtr++ = (UINT8)SBC_MSBC_SYNC_WORD;
+        *pu8PacketPtr++ = 0;
+        *pu8PacketPtr = 0;
+    }
+    else
+    {
+        *pu8PacketPtr++ = (UINT8)0x9C;  /*Sync word*/
+        *pu8PacketPtr++=(UINT8)(pstrEncParams->FrameHeader);
 
-    *pu8PacketPtr = (UINT8)(pstrEncParams->s16BitPool & 0x00FF);
+        *pu8PacketPtr = (UINT8)(pstrEncParams->s16BitPool & 0x00FF);
+    }
     pu8PacketPtr += 2;  /*skip for CRC*/
 
     /*here it indicate if it is byte boundary or nibble boundary*/
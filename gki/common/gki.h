@@ -191,6 +191,8 @@ GKI_API extern UINT8   GKI_send_event (UINT8, UINT16);
 GKI_API extern void    GKI_freebuf (void *);
 GKI_API extern void   *GKI_getbuf (UINT16);
 GKI_API extern UINT16  GKI_get_buf_size (void *);
+GKI_API extern void    GKI_set_buf_stamp (void *, UINT32);
+GKI_API extern UINT32  GKI_get_buf_stamp (void *);
 GKI_API extern void   *GKI_getpoolbuf (UINT8);
 GKI_API extern UINT16  GKI_poolcount (UINT8);
 GKI_API extern UINT16  GKI_poolfreecount (UINT8);
@@ -25,6 +25,63 @@
 static void gki_add_to_pool_list(UINT8 pool_id);
 static void gki_remove_from_pool_list(UINT8 pool_id);
 
+#if (GKI_BUF_STAMP == TRUE)
+/* Stamps of the buffers of each pool, in the order of the buffers. Not in
+** gki_cb, so they survive GKI_init and are allocated only once. */
+static UINT32 *gki_pool_stamp[GKI_NUM_TOTAL_BUF_POOLS];
+static UINT16  gki_pool_stamp_cnt[GKI_NUM_TOTAL_BUF_POOLS];
+
+/*******************************************************************************
+**
+** Function         gki_init_pool_stamp
+**
+** Description      Internal function to make room for the stamps of a pool
+**                  of total buffers.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_init_pool_stamp (UINT8 id, UINT16 total)
+{
+    if (gki_pool_stamp_cnt[id] >= total)
+        return;
+
+    if (gki_pool_stamp[id])
+        GKI_os_free(gki_pool_stamp[id]);
+
+    gki_pool_stamp[id] = (UINT32 *)GKI_os_malloc(total * sizeof(UINT32));
+    gki_pool_stamp_cnt[id] = gki_pool_stamp[id] ? total : 0;
+}
+
+/*******************************************************************************
+**
+** Function         gki_buf_stamp_slot
+**
+** Description      Internal function to find the stamp of a buffer.
+**
+** Returns          pointer to the stamp, NULL if the buffer is not part of
+**                  a pool that has stamps
+**
+*******************************************************************************/
+static UINT32 *gki_buf_stamp_slot (void *p_buf)
+{
+    UINT8       *p_hdr = (UINT8 *)p_buf - BUFFER_HDR_SIZE;
+    UINT8        id = ((BUFFER_HDR_T *)p_hdr)->q_id;
+    UINT32       idx;
+    tGKI_COM_CB *p_cb = &gki_cb.com;
+
+    if ((id >= GKI_NUM_TOTAL_BUF_POOLS) || (gki_pool_stamp[id] == NULL)
+     || (p_hdr < p_cb->pool_start[id]) || (p_hdr >= p_cb->pool_end[id]))
+        return NULL;
+
+    idx = (UINT32)(p_hdr - p_cb->pool_start[id]) / p_cb->pool_size[id];
+    if (idx >= gki_pool_stamp_cnt[id])
+        return NULL;
+
+    return &gki_pool_stamp[id][idx];
+}
+#endif
+
 /*******************************************************************************
 **
 ** Function         gki_init_free_queue
@@ -55,6 +112,9 @@ static void gki_init_free_queue (UINT8 id, UINT16 size, UINT16 total, void *p_me
     {
         p_cb->pool_start[id] = (UINT8 *)p_mem;
         p_cb->pool_end[id]   = (UINT8 *)p_mem + (act_size * total);
+#if (GKI_BUF_STAMP == TRUE)
+        gki_init_pool_stamp(id, total);
+#endif
     }
 // btla-specific --
 
@@ -163,8 +223,14 @@ void gki_buffer_init(void)
     {
         for (mb = 0; mb < NUM_TASK_MBOX; mb++)
         {
+#if (GKI_LOCKFREE_MBOX == TRUE)
+            p_cb->OSTaskQStub [tt][mb].p_next = NULL;
+            p_cb->OSTaskQFirst[tt][mb] = &p_cb->OSTaskQStub[tt][mb];
+            p_cb->OSTaskQLast [tt][mb] = &p_cb->OSTaskQStub[tt][mb];
+#else
             p_cb->OSTaskQFirst[tt][mb] = NULL;
             p_cb->OSTaskQLast [tt][mb] = NULL;
+#endif
         }
     }
 
@@ -682,6 +748,59 @@ UINT16 GKI_get_buf_size (void *p_buf)
     return (0);
 }
 
+/*******************************************************************************
+**
+** Function         GKI_set_buf_stamp
+**
+** Description      Called by the sender of a message to record a value with
+**                  the buffer, typically the time it was sent. The stamp is
+**                  kept beside the pool, not in the buffer header, and has
+**                  no meaning for GKI. Buffers outside the pools have none.
+**
+** Parameters       p_buf - (input) address of the beginning of a buffer.
+**                  stamp - (input) value to record
+**
+** Returns          void
+**
+*******************************************************************************/
+void GKI_set_buf_stamp (void *p_buf, UINT32 stamp)
+{
+#if (GKI_BUF_STAMP == TRUE)
+    UINT32 *p_stamp = gki_buf_stamp_slot(p_buf);
+
+    if (p_stamp)
+        *p_stamp = stamp;
+#else
+    (void)p_buf;
+    (void)stamp;
+#endif
+}
+
+/*******************************************************************************
+**
+** Function         GKI_get_buf_stamp
+**
+** Description      Called by the receiver of a message to read the value
+**                  recorded with GKI_set_buf_stamp.
+**
+** Parameters       p_buf - (input) address of the beginning of a buffer.
+**
+** Returns          the stamp, 0 if the buffer has none or GKI_BUF_STAMP is
+**                  FALSE
+**
+*******************************************************************************/
+UINT32 GKI_get_buf_stamp (void *p_buf)
+{
+#if (GKI_BUF_STAMP == TRUE)
+    UINT32 *p_stamp = gki_buf_stamp_slot(p_buf);
+
+    return p_stamp ? *p_stamp : 0;
+#else
+    (void)p_buf;
+    return 0;
+#endif
+}
+
 /*******************************************************************************
 **
 ** Function         gki_chk_buf_damage
@@ -713,6 +832,76 @@ BOOLEAN gki_chk_buf_damage(void *p_buf)
 #endif
 }
 
+#if (GKI_LOCKFREE_MBOX == TRUE)
+/*******************************************************************************
+**
+** Function         gki_mbox_push
+**
+** Description      Link a buffer at the tail of a task mailbox. Any number of
+**                  tasks may push at the same time: the tail is claimed with
+**                  one atomic exchange, then the previous tail is linked to
+**                  the buffer. Until that link is made the owner sees the
+**                  mailbox end at the previous tail.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_mbox_push (UINT8 task_id, UINT8 mbox, BUFFER_HDR_T *p_hdr)
+{
+    BUFFER_HDR_T    *p_prev;
+
+    __atomic_store_n (&p_hdr->p_next, NULL, __ATOMIC_RELAXED);
+    p_prev = __atomic_exchange_n (&gki_cb.com.OSTaskQLast[task_id][mbox], p_hdr, __ATOMIC_ACQ_REL);
+    __atomic_store_n (&p_prev->p_next, p_hdr, __ATOMIC_RELEASE);
+}
+
+/*******************************************************************************
+**
+** Function         gki_mbox_pop
+**
+** Description      Unlink the buffer at the head of a task mailbox. Only the
+**                  task owning the mailbox pops. The mailbox always holds at
+**                  least one entry: the stub is pushed back before the last
+**                  buffer is handed out.
+**
+** Returns          NULL if the mailbox is empty, or a sender has claimed the
+**                  tail but not linked it yet. That sender signals the
+**                  mailbox event once it has.
+**
+*******************************************************************************/
+static BUFFER_HDR_T *gki_mbox_pop (UINT8 task_id, UINT8 mbox)
+{
+    tGKI_COM_CB     *p_cb = &gki_cb.com;
+    BUFFER_HDR_T    *p_stub = &p_cb->OSTaskQStub[task_id][mbox];
+    BUFFER_HDR_T    *p_first = p_cb->OSTaskQFirst[task_id][mbox];
+    BUFFER_HDR_T    *p_next = __atomic_load_n (&p_first->p_next, __ATOMIC_ACQUIRE);
+
+    if (p_first == p_stub)
+    {
+        if (p_next == NULL)
+            return (NULL);
+
+        p_cb->OSTaskQFirst[task_id][mbox] = p_first = p_next;
+        p_next = __atomic_load_n (&p_first->p_next, __ATOMIC_ACQUIRE);
+    }
+
+    if (p_next == NULL)
+    {
+        /* Last buffer: put the stub behind it so the tail never goes away */
+        if (p_first != __atomic_load_n (&p_cb->OSTaskQLast[task_id][mbox], __ATOMIC_ACQUIRE))
+            return (NULL);
+
+        gki_mbox_push (task_id, mbox, p_stub);
+
+        if ((p_next = __atomic_load_n (&p_first->p_next, __ATOMIC_ACQUIRE)) == NULL)
+            return (NULL);
+    }
+
+    p_cb->OSTaskQFirst[task_id][mbox] = p_next;
+    return (p_first);
+}
+#endif
+
 /*******************************************************************************
 **
 ** Function         GKI_send_msg
@@ -751,6 +940,12 @@ void GKI_send_msg (UINT8 task_id, UINT8 mbox, void *msg)
         return;
     }
 
+#if (GKI_LOCKFREE_MBOX == TRUE)
+    p_hdr->status = BUF_STATUS_QUEUED;
+    p_hdr->task_id = task_id;
+
+    gki_mbox_push (task_id, mbox, p_hdr);
+#else
     GKI_disable();
 
     if (p_cb->OSTaskQFirst[task_id][mbox])
@@ -766,6 +961,7 @@ void GKI_send_msg (UINT8 task_id, UINT8 mbox, void *msg)
 
 
     GKI_enable();
+#endif
 
     GKI_send_event(task_id, (UINT16)EVENT_MASK(mbox));
 
@@ -793,6 +989,15 @@ void *GKI_read_mbox (UINT8 mbox)
     if ((task_id >= GKI_MAX_TASKS) || (mbox >= NUM_TASK_MBOX))
         return (NULL);
 
+#if (GKI_LOCKFREE_MBOX == TRUE)
+    if ((p_hdr = gki_mbox_pop (task_id, mbox)) != NULL)
+    {
+        p_hdr->p_next = NULL;
+        p_hdr->status = BUF_STATUS_UNLINKED;
+
+        p_buf = (UINT8 *)p_hdr + BUFFER_HDR_SIZE;
+    }
+#else
     GKI_disable();
 
     if (gki_cb.com.OSTaskQFirst[task_id][mbox])
@@ -807,6 +1012,7 @@ void *GKI_read_mbox (UINT8 mbox)
     }
 
     GKI_enable();
+#endif
 
     return (p_buf);
 }
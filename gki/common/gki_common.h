@@ -298,6 +298,9 @@ typedef struct
     */
     BUFFER_HDR_T    *OSTaskQFirst[GKI_MAX_TASKS][NUM_TASK_MBOX]; /* array of pointers to the first event in the task mailbox */
     BUFFER_HDR_T    *OSTaskQLast [GKI_MAX_TASKS][NUM_TASK_MBOX]; /* array of pointers to the last event in the task mailbox */
+#if (GKI_LOCKFREE_MBOX == TRUE)
+    BUFFER_HDR_T    OSTaskQStub  [GKI_MAX_TASKS][NUM_TASK_MBOX]; /* placeholder kept in an empty mailbox, never handed out */
+#endif
 
     /* Define the buffer pool management variables
     */
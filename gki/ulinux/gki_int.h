@@ -61,6 +61,9 @@ typedef struct
     pthread_cond_t      thread_evt_cond[GKI_MAX_TASKS];
     pthread_mutex_t     thread_timeout_mutex[GKI_MAX_TASKS];
     pthread_cond_t      thread_timeout_cond[GKI_MAX_TASKS];
+#if (GKI_LOCKFREE_MBOX == TRUE)
+    UINT32              thread_evt_seq[GKI_MAX_TASKS];  /* futex word, bumped to wake the task */
+#endif
 #if (GKI_DEBUG == TRUE)
     pthread_mutex_t     GKI_trace_mutex;
 #endif
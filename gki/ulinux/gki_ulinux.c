@@ -28,6 +28,11 @@
 
 #include <assert.h>
 #include <sys/times.h>
+#if (GKI_LOCKFREE_MBOX == TRUE)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #include "gki_int.h"
 #include "bt_utils.h"
@@ -61,6 +66,9 @@ tGKI_CB   gki_cb;
 #define GKI_SHUTDOWN_EVT    APPL_EVT_7
 #endif
 
+/* Thread specific value of a thread that is not a GKI task */
+#define GKI_TASK_KEY_NONE   (GKI_MAX_TASKS + 1)
+
 /*****************************************************************************
 **  Local type definitions
 ******************************************************************************/
@@ -95,6 +103,12 @@ static alarm_service_t alarm_service;
 static timer_t posix_timer;
 static bool timer_created;
 
+// Task id + 1 of the calling thread, or GKI_TASK_KEY_NONE, cached by
+// GKI_get_taskid.
+static pthread_once_t task_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t task_key;
+static bool task_key_created;
+
 
 /*****************************************************************************
 **  Externs
@@ -252,19 +266,54 @@ void alarm_service_reschedule()
 }
 
 
+/*****************************************************************************
+**
+** Function        gki_task_key_init
+**
+** Description     Create the key holding the task id of each thread. It is
+**                 kept across GKI_init calls: threads that are not GKI tasks
+**                 keep their cached value.
+**
+** Returns         void
+**
+*******************************************************************************/
+static void gki_task_key_init(void)
+{
+    task_key_created = (pthread_key_create(&task_key, NULL) == 0);
+}
+
+#if (GKI_LOCKFREE_MBOX == TRUE)
+/*****************************************************************************
+**
+** Function        gki_futex
+**
+** Description     futex(2) on a task event word
+**
+** Returns         result of the system call
+**
+*******************************************************************************/
+static int gki_futex(UINT32 *p_word, int op, UINT32 val, const struct timespec *p_timeout)
+{
+    return syscall(__NR_futex, p_word, op, val, p_timeout, NULL, 0);
+}
+#endif
+
 /*****************************************************************************
 **
 ** Function        gki_task_entry
 **
-** Description     GKI pthread callback
+** Description     GKI pthread callback. Takes the task info as a pointer;
+**                 a UINT32 parameter truncates it on 64-bit builds.
 **
 ** Returns         void
 **
 *******************************************************************************/
-static void gki_task_entry(UINT32 params)
+static void *gki_task_entry(void *p_params)
 {
-    gki_pthread_info_t *p_pthread_info = (gki_pthread_info_t *)params;
+    gki_pthread_info_t *p_pthread_info = (gki_pthread_info_t *)p_params;
     gki_cb.os.thread_id[p_pthread_info->task_id] = pthread_self();
+    if (task_key_created)
+        pthread_setspecific(task_key, (void *)(uintptr_t)(p_pthread_info->task_id + 1));
 
     prctl(PR_SET_NAME, (unsigned long)gki_cb.com.OSTName[p_pthread_info->task_id], 0, 0, 0);
 
@@ -311,6 +360,7 @@ void GKI_init(void)
 #endif
     p_os = &gki_cb.os;
     pthread_mutex_init(&p_os->GKI_mutex, &attr);
+    pthread_once(&task_key_once, gki_task_key_init);
     /* pthread_mutex_init(&GKI_sched_mutex, NULL); */
 #if (GKI_DEBUG == TRUE)
     pthread_mutex_init(&p_os->GKI_trace_mutex, NULL);
@@ -418,7 +468,7 @@ UINT8 GKI_create_task (TASKPTR task_entry, UINT8 task_id, INT8 *taskname, UINT16
 
     ret = pthread_create( &gki_cb.os.thread_id[task_id],
               &attr1,
-              (void *)gki_task_entry,
+              gki_task_entry,
               &gki_pthread_info[task_id]);
 
     if (ret != 0)
@@ -766,13 +816,75 @@ UINT16 GKI_wait (UINT16 flag, UINT32 timeout)
     UINT8 rtask;
     struct timespec abstime = { 0, 0 };
 
+#if (GKI_LOCKFREE_MBOX == TRUE)
+    struct timespec now, rel;
+    UINT32 seq;
+#else
     int sec;
     int nano_sec;
+#endif
 
     rtask = GKI_get_taskid();
 
     GKI_TRACE("GKI_wait %d %x %d", (int)rtask, (int)flag, (int)timeout);
 
+#if (GKI_LOCKFREE_MBOX == TRUE)
+
+    if (timeout)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &abstime);
+        abstime.tv_sec += timeout / 1000;
+        abstime.tv_nsec += (timeout % 1000) * NANOSEC_PER_MILLISEC;
+        if (abstime.tv_nsec >= NSEC_PER_SEC)
+        {
+            abstime.tv_sec++;
+            abstime.tv_nsec -= NSEC_PER_SEC;
+        }
+    }
+
+    /* Senders only wake the task when this is set. The store and their
+    ** event update are ordered against each other, so an event sent from
+    ** here on is either seen below or bumps thread_evt_seq. */
+    __atomic_store_n(&gki_cb.com.OSWaitForEvt[rtask], flag, __ATOMIC_SEQ_CST);
+
+    for (;;)
+    {
+        seq = __atomic_load_n(&gki_cb.os.thread_evt_seq[rtask], __ATOMIC_SEQ_CST);
+
+        if (__atomic_load_n(&gki_cb.com.OSWaitEvt[rtask], __ATOMIC_SEQ_CST) & flag)
+            break;
+
+        if (timeout)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            rel.tv_sec = abstime.tv_sec - now.tv_sec;
+            rel.tv_nsec = abstime.tv_nsec - now.tv_nsec;
+            if (rel.tv_nsec < 0)
+            {
+                rel.tv_sec--;
+                rel.tv_nsec += NSEC_PER_SEC;
+            }
+            if (rel.tv_sec < 0)
+                break;
+        }
+
+        gki_futex(&gki_cb.os.thread_evt_seq[rtask], FUTEX_WAIT_PRIVATE, seq,
+                  timeout ? &rel : NULL);
+
+        if (gki_cb.com.OSRdyTbl[rtask] == TASK_DEAD)
+        {
+            __atomic_store_n(&gki_cb.com.OSWaitEvt[rtask], 0, __ATOMIC_SEQ_CST);
+            __atomic_store_n(&gki_cb.com.OSWaitForEvt[rtask], 0, __ATOMIC_SEQ_CST);
+            return (EVENT_MASK(GKI_SHUTDOWN_EVT));
+        }
+    }
+
+    /* Clear the wait for event mask */
+    __atomic_store_n(&gki_cb.com.OSWaitForEvt[rtask], 0, __ATOMIC_SEQ_CST);
+
+    /* Return and clear only those bits which user wants... */
+    evt = __atomic_fetch_and(&gki_cb.com.OSWaitEvt[rtask], (UINT16)~flag, __ATOMIC_SEQ_CST) & flag;
+#else
     gki_cb.com.OSWaitForEvt[rtask] = flag;
 
     /* protect OSWaitEvt[rtask] from modification from an other thread */
@@ -840,6 +952,7 @@ UINT16 GKI_wait (UINT16 flag, UINT32 timeout)
 
     /* unlock thread_evt_mutex as pthread_cond_wait() does auto lock mutex when cond is met */
     pthread_mutex_unlock(&gki_cb.os.thread_evt_mutex[rtask]);
+#endif
 
     GKI_TRACE("GKI_wait %d %x %d %x done", (int)rtask, (int)flag, (int)timeout, (int)evt);
     return (evt);
@@ -912,6 +1025,16 @@ UINT8 GKI_send_event (UINT8 task_id, UINT16 event)
 
     if (task_id < GKI_MAX_TASKS)
     {
+#if (GKI_LOCKFREE_MBOX == TRUE)
+        /* Set the event bit, then wake the task if it is in GKI_wait */
+        __atomic_fetch_or(&gki_cb.com.OSWaitEvt[task_id], event, __ATOMIC_SEQ_CST);
+
+        if (__atomic_load_n(&gki_cb.com.OSWaitForEvt[task_id], __ATOMIC_SEQ_CST))
+        {
+            __atomic_fetch_add(&gki_cb.os.thread_evt_seq[task_id], 1, __ATOMIC_SEQ_CST);
+            gki_futex(&gki_cb.os.thread_evt_seq[task_id], FUTEX_WAKE_PRIVATE, 1, NULL);
+        }
+#else
         /* protect OSWaitEvt[task_id] from manipulation in GKI_wait() */
         pthread_mutex_lock(&gki_cb.os.thread_evt_mutex[task_id]);
 
@@ -921,6 +1044,7 @@ UINT8 GKI_send_event (UINT8 task_id, UINT16 event)
         pthread_cond_signal(&gki_cb.os.thread_evt_cond[task_id]);
 
         pthread_mutex_unlock(&gki_cb.os.thread_evt_mutex[task_id]);
+#endif
 
         GKI_TRACE("GKI_send_event %d %x done", task_id, event);
         return ( GKI_SUCCESS );
@@ -934,7 +1058,9 @@ UINT8 GKI_send_event (UINT8 task_id, UINT16 event)
 **
 ** Function         GKI_get_taskid
 **
-** Description      This function gets the currently running task ID.
+** Description      This function gets the currently running task ID. The
+**                  result is cached per thread, only the first call of a
+**                  thread looks it up.
 **
 ** Returns          task ID
 **
@@ -947,6 +1073,16 @@ UINT8 GKI_send_event (UINT8 task_id, UINT16 event)
 UINT8 GKI_get_taskid (void)
 {
     int i;
+    uintptr_t cached = 0;
+
+    if (task_key_created)
+    {
+        cached = (uintptr_t)pthread_getspecific(task_key);
+        if (cached == GKI_TASK_KEY_NONE)
+            return(-1);
+        if (cached)
+            return(cached - 1);
+    }
 
     pthread_t thread_id = pthread_self( );
 
@@ -955,12 +1091,17 @@ UINT8 GKI_get_taskid (void)
     for (i = 0; i < GKI_MAX_TASKS; i++) {
         if (gki_cb.os.thread_id[i] == thread_id) {
             //GKI_TRACE("GKI_get_taskid %x %d done", thread_id, i);
+            if (task_key_created)
+                pthread_setspecific(task_key, (void *)(uintptr_t)(i + 1));
             return(i);
         }
     }
 
     GKI_TRACE("GKI_get_taskid: task id = -1");
 
+    if (task_key_created)
+        pthread_setspecific(task_key, (void *)(uintptr_t)GKI_TASK_KEY_NONE);
+
     return(-1);
 }
 
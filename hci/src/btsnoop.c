@@ -51,7 +51,7 @@ static int hci_btsnoop_fd = -1;
 
 void btsnoop_net_open();
 void btsnoop_net_close();
-void btsnoop_net_write(const void *data, size_t length);
+void btsnoop_net_write(const uint8_t *header, const uint8_t *packet, size_t length);
 
 static uint64_t btsnoop_timestamp(void) {
   struct timeval tv;
@@ -64,13 +64,6 @@ static uint64_t btsnoop_timestamp(void) {
   return timestamp;
 }
 
-static void btsnoop_write(const void *data, size_t length) {
-  if (hci_btsnoop_fd != -1)
-    write(hci_btsnoop_fd, data, length);
-
-  btsnoop_net_write(data, length);
-}
-
 static void btsnoop_write_packet(packet_type_t type, const uint8_t *packet, bool is_received) {
   int length_he = 0;
   int length;
@@ -105,17 +98,23 @@ static void btsnoop_write_packet(packet_type_t type, const uint8_t *packet, bool
   time_hi = htonl(time_hi);
   time_lo = htonl(time_lo);
 
+  // The record header, then the packet type.
+  uint8_t header[25];
+  memcpy(header, &length, 4);
+  memcpy(header + 4, &length, 4);
+  memcpy(header + 8, &flags, 4);
+  memcpy(header + 12, &drops, 4);
+  memcpy(header + 16, &time_hi, 4);
+  memcpy(header + 20, &time_lo, 4);
+  header[24] = type;
+
   // This function is called from different contexts.
   utils_lock();
 
-  btsnoop_write(&length, 4);
-  btsnoop_write(&length, 4);
-  btsnoop_write(&flags, 4);
-  btsnoop_write(&drops, 4);
-  btsnoop_write(&time_hi, 4);
-  btsnoop_write(&time_lo, 4);
-  btsnoop_write(&type, 1);
-  btsnoop_write(packet, length_he - 1);
+  write(hci_btsnoop_fd, header, sizeof(header));
+  write(hci_btsnoop_fd, packet, length_he - 1);
+
+  btsnoop_net_write(header, packet, length_he - 1);
 
   utils_unlock();
 }
@@ -18,63 +18,421 @@
 
 #define LOG_TAG "btsnoop_net"
 
+#include <arpa/inet.h>
 #include <assert.h>
 #include <cutils/log.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <netinet/in.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/prctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include "osi.h"
 
+// Clients attached at the same time; further connections are closed.
+#define MAX_CLIENTS_ 8
+
+// Connection handles a client may filter ACL and SCO packets on.
+#define MAX_FILTER_HANDLES_ 4
+
+#define MAX_COMMAND_ 128
+
+// Ids of the epoll events that are not clients.
+#define LISTEN_ID_ MAX_CLIENTS_
+#define WAKE_ID_ (MAX_CLIENTS_ + 1)
+
+// A btsnoop record: length, length, flags, cumulative drops and timestamp,
+// followed by the packet type and the packet.
+#define RECORD_HEADER_SIZE_ 25
+#define RECORD_DROPS_OFFSET_ 12
+#define RECORD_TYPE_OFFSET_ 24
+
+#define PACKET_TYPE_COMMAND_ 1
+#define PACKET_TYPE_ACL_ 2
+#define PACKET_TYPE_SCO_ 3
+#define PACKET_TYPE_EVENT_ 4
+
+typedef struct {
+  int socket;                     // -1 if the slot is free
+  uint8_t *ring;                  // records waiting to be sent
+  uint32_t head;                  // ring bytes written, by the packet path
+  uint32_t tail;                  // ring bytes sent, by the server thread
+  bool want_write;                // waiting for the socket to take more
+  uint32_t queued;                // records put in the ring
+  uint32_t dropped;               // records that did not fit
+  uint8_t type_mask;              // packet types to send, a bit each; 0 for all
+  uint16_t handles[MAX_FILTER_HANDLES_];  // ACL and SCO handles to send
+  int num_handles;                // 0 for all
+  char command[MAX_COMMAND_];     // filter command being received
+  size_t command_length;
+} client_t;
+
 static void safe_close_(int *fd);
-static void *listen_fn_(void *context);
+static void *server_fn_(void *context);
 
-static const char *LISTEN_THREAD_NAME_ = "btsnoop_net_listen";
+static const char *SERVER_THREAD_NAME_ = "btsnoop_net";
 static const int LOCALHOST_ = 0x7F000001;
 static const int LISTEN_PORT_ = 8872;
 
-static pthread_t listen_thread_;
-static bool listen_thread_valid_ = false;
-static pthread_mutex_t client_socket_lock_ = PTHREAD_MUTEX_INITIALIZER;
+// Ring of each client. A power of two, enough for about a second of
+// ACL data at full EDR rate.
+static const uint32_t RING_SIZE_ = 256 * 1024;
+
+static const uint8_t FILE_HEADER_[16] = "btsnoop\0\0\0\0\1\0\0\x3\xea";
+
+static pthread_t server_thread_;
+static bool server_thread_valid_ = false;
 static int listen_socket_ = -1;
-static int client_socket_ = -1;
+static int epoll_fd_ = -1;
+static int wake_fd_ = -1;
+
+// Guards the clients, their rings, wake_pending_ and stop_.
+static pthread_mutex_t clients_lock_ = PTHREAD_MUTEX_INITIALIZER;
+static client_t clients_[MAX_CLIENTS_];
+static int num_clients_ = 0;
+static bool wake_pending_ = false;
+static bool stop_ = false;
 
 void btsnoop_net_open() {
-  listen_thread_valid_ = (pthread_create(&listen_thread_, NULL, listen_fn_, NULL) == 0);
-  if (!listen_thread_valid_) {
+  if (server_thread_valid_)
+    return;
+
+  for (int i = 0; i < MAX_CLIENTS_; ++i)
+    clients_[i].socket = -1;
+  num_clients_ = 0;
+  wake_pending_ = false;
+  stop_ = false;
+
+  epoll_fd_ = epoll_create(MAX_CLIENTS_ + 2);
+  wake_fd_ = eventfd(0, 0);
+  if (epoll_fd_ == -1 || wake_fd_ == -1) {
+    ALOGE("%s unable to create epoll or eventfd: %s", __func__, strerror(errno));
+    goto error;
+  }
+
+  struct epoll_event event = { .events = EPOLLIN, .data.u32 = WAKE_ID_ };
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) == -1) {
+    ALOGE("%s unable to watch eventfd: %s", __func__, strerror(errno));
+    goto error;
+  }
+
+  server_thread_valid_ = (pthread_create(&server_thread_, NULL, server_fn_, NULL) == 0);
+  if (!server_thread_valid_) {
     ALOGE("%s pthread_create failed: %s", __func__, strerror(errno));
-  } else {
-    ALOGD("initialized");
+    goto error;
   }
+
+  ALOGD("initialized");
+  return;
+
+error:
+  safe_close_(&wake_fd_);
+  safe_close_(&epoll_fd_);
 }
 
 void btsnoop_net_close() {
-  if (listen_thread_valid_) {
-    shutdown(listen_socket_, SHUT_RDWR);
-    pthread_join(listen_thread_, NULL);
-    safe_close_(&client_socket_);
-    listen_thread_valid_ = false;
+  if (!server_thread_valid_)
+    return;
+
+  pthread_mutex_lock(&clients_lock_);
+  stop_ = true;
+  pthread_mutex_unlock(&clients_lock_);
+  eventfd_write(wake_fd_, 1);
+
+  pthread_join(server_thread_, NULL);
+  server_thread_valid_ = false;
+
+  // The packet path keeps running; take every client away from it before
+  // its socket and ring go.
+  int sockets[MAX_CLIENTS_];
+  uint8_t *rings[MAX_CLIENTS_];
+  pthread_mutex_lock(&clients_lock_);
+  for (int i = 0; i < MAX_CLIENTS_; ++i) {
+    sockets[i] = clients_[i].socket;
+    rings[i] = clients_[i].ring;
+    clients_[i].socket = -1;
+    clients_[i].ring = NULL;
   }
+  num_clients_ = 0;
+  int wake_fd = wake_fd_;
+  wake_fd_ = -1;
+  pthread_mutex_unlock(&clients_lock_);
+
+  for (int i = 0; i < MAX_CLIENTS_; ++i) {
+    safe_close_(&sockets[i]);
+    free(rings[i]);
+  }
+
+  safe_close_(&listen_socket_);
+  safe_close_(&wake_fd);
+  safe_close_(&epoll_fd_);
 }
 
-void btsnoop_net_write(const void *data, size_t length) {
-  pthread_mutex_lock(&client_socket_lock_);
-  if (client_socket_ != -1) {
-    if (send(client_socket_, data, length, 0) == -1 && errno == ECONNRESET) {
-      safe_close_(&client_socket_);
+static bool client_wants_(const client_t *client, const uint8_t *header, const uint8_t *packet,
+                          size_t length) {
+  uint8_t type = header[RECORD_TYPE_OFFSET_];
+
+  if (client->type_mask && !(client->type_mask & (1 << type)))
+    return false;
+
+  if (client->num_handles == 0 || (type != PACKET_TYPE_ACL_ && type != PACKET_TYPE_SCO_))
+    return true;
+
+  if (length < 2)
+    return false;
+
+  uint16_t handle = (packet[0] | (packet[1] << 8)) & 0x0FFF;
+  for (int i = 0; i < client->num_handles; ++i)
+    if (client->handles[i] == handle)
+      return true;
+  return false;
+}
+
+static void ring_put_(client_t *client, const void *data, size_t length) {
+  uint32_t offset = client->head & (RING_SIZE_ - 1);
+  size_t first = RING_SIZE_ - offset;
+
+  if (first > length)
+    first = length;
+  memcpy(client->ring + offset, data, first);
+  memcpy(client->ring, (const uint8_t *)data + first, length - first);
+  client->head += length;
+}
+
+// Queues a record for every client that wants it; |header| holds the
+// RECORD_HEADER_SIZE_ bytes before the packet. Never blocks on a client: a
+// record that does not fit the ring of a client is dropped for it, and
+// counted in the drops of the next record it gets.
+void btsnoop_net_write(const uint8_t *header, const uint8_t *packet, size_t length) {
+  bool wake = false;
+
+  pthread_mutex_lock(&clients_lock_);
+  for (int i = 0; i < MAX_CLIENTS_ && num_clients_; ++i) {
+    client_t *client = &clients_[i];
+    if (client->socket == -1 || !client_wants_(client, header, packet, length))
+      continue;
+
+    if (RING_SIZE_ - (client->head - client->tail) < RECORD_HEADER_SIZE_ + length) {
+      ++client->dropped;
+      continue;
     }
+
+    // The server thread only needs a kick for a ring it has emptied.
+    if (client->head == client->tail && !client->want_write)
+      wake = true;
+
+    uint8_t client_header[RECORD_HEADER_SIZE_];
+    uint32_t drops = htonl(client->dropped);
+    memcpy(client_header, header, RECORD_HEADER_SIZE_);
+    memcpy(client_header + RECORD_DROPS_OFFSET_, &drops, sizeof(drops));
+
+    ring_put_(client, client_header, RECORD_HEADER_SIZE_);
+    ring_put_(client, packet, length);
+    ++client->queued;
   }
-  pthread_mutex_unlock(&client_socket_lock_);
+
+  // Kicked under the lock, which keeps btsnoop_net_close from closing the
+  // eventfd under us; this happens once per emptied ring, not per packet.
+  if (wake && !wake_pending_ && wake_fd_ != -1) {
+    wake_pending_ = true;
+    eventfd_write(wake_fd_, 1);
+  }
+  pthread_mutex_unlock(&clients_lock_);
 }
 
-static void *listen_fn_(UNUSED_ATTR void *context) {
+static void close_client_(int id) {
+  client_t *client = &clients_[id];
+
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, client->socket, NULL);
+
+  pthread_mutex_lock(&clients_lock_);
+  int socket = client->socket;
+  client->socket = -1;
+  --num_clients_;
+  pthread_mutex_unlock(&clients_lock_);
+
+  ALOGI("client %d disconnected, %u packets queued, %u dropped", id, client->queued, client->dropped);
+  close(socket);
+  free(client->ring);
+  client->ring = NULL;
+}
+
+// Sends what the ring of client |id| holds, as far as its socket takes it.
+static void flush_client_(int id) {
+  client_t *client = &clients_[id];
+
+  pthread_mutex_lock(&clients_lock_);
+  uint32_t head = client->head;
+  uint32_t tail = client->tail;
+  pthread_mutex_unlock(&clients_lock_);
 
-  prctl(PR_SET_NAME, (unsigned long)LISTEN_THREAD_NAME_, 0, 0, 0);
+  while (tail != head) {
+    uint32_t offset = tail & (RING_SIZE_ - 1);
+    size_t length = head - tail;
+    if (length > RING_SIZE_ - offset)
+      length = RING_SIZE_ - offset;
+
+    ssize_t sent = send(client->socket, client->ring + offset, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent == -1) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        break;
+      close_client_(id);
+      return;
+    }
+    tail += sent;
+  }
+
+  // Decided with the tail, so that the packet path wakes us for what it adds.
+  pthread_mutex_lock(&clients_lock_);
+  client->tail = tail;
+  bool want_write = (client->head != tail);
+  bool changed = (want_write != client->want_write);
+  client->want_write = want_write;
+  pthread_mutex_unlock(&clients_lock_);
+
+  if (changed) {
+    struct epoll_event event = { .events = EPOLLIN | (want_write ? EPOLLOUT : 0), .data.u32 = id };
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, client->socket, &event);
+  }
+}
+
+// Applies a filter line: any of "cmd", "acl", "sco" and "evt" to send only
+// those packet types, "handle=<n>" to send only those ACL and SCO handles,
+// "all" or an empty line to send everything.
+static void parse_filter_(int id, char *line) {
+  uint8_t type_mask = 0;
+  uint16_t handles[MAX_FILTER_HANDLES_] = { 0 };
+  int num_handles = 0;
+
+  for (char *token = line + strspn(line, " \t\r"); *token; token += strspn(token, " \t\r")) {
+    char *end = token + strcspn(token, " \t\r");
+    bool last = (*end == '\0');
+    *end = '\0';
+
+    if (!strcmp(token, "cmd"))
+      type_mask |= 1 << PACKET_TYPE_COMMAND_;
+    else if (!strcmp(token, "acl"))
+      type_mask |= 1 << PACKET_TYPE_ACL_;
+    else if (!strcmp(token, "sco"))
+      type_mask |= 1 << PACKET_TYPE_SCO_;
+    else if (!strcmp(token, "evt"))
+      type_mask |= 1 << PACKET_TYPE_EVENT_;
+    else if (!strncmp(token, "handle=", 7) && num_handles < MAX_FILTER_HANDLES_)
+      handles[num_handles++] = strtoul(token + 7, NULL, 0) & 0x0FFF;
+    else if (strcmp(token, "all"))
+      ALOGW("%s client %d: unknown filter '%s'", __func__, id, token);
+
+    token = last ? end : end + 1;
+  }
+
+  pthread_mutex_lock(&clients_lock_);
+  clients_[id].type_mask = type_mask;
+  memcpy(clients_[id].handles, handles, sizeof(handles));
+  clients_[id].num_handles = num_handles;
+  pthread_mutex_unlock(&clients_lock_);
+
+  ALOGI("client %d filter: types 0x%02x, %d handles", id, type_mask, num_handles);
+}
+
+// Reads the filter lines client |id| sends; closes it when it goes away.
+static void read_client_(int id) {
+  client_t *client = &clients_[id];
+  char buffer[MAX_COMMAND_];
+
+  for (;;) {
+    ssize_t count = recv(client->socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (count == -1 && errno == EINTR)
+      continue;
+    if (count == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      return;
+    if (count <= 0) {
+      close_client_(id);
+      return;
+    }
+
+    for (ssize_t i = 0; i < count; ++i) {
+      if (buffer[i] != '\n') {
+        if (client->command_length < MAX_COMMAND_ - 1)
+          client->command[client->command_length++] = buffer[i];
+        continue;
+      }
+      client->command[client->command_length] = '\0';
+      client->command_length = 0;
+      parse_filter_(id, client->command);
+    }
+  }
+}
+
+static void accept_clients_(void) {
+  for (;;) {
+    int socket = accept(listen_socket_, NULL, NULL);
+    if (socket == -1) {
+      if (errno == EINTR)
+        continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        ALOGW("%s error accepting socket: %s", __func__, strerror(errno));
+      return;
+    }
+
+    int id = 0;
+    while (id < MAX_CLIENTS_ && clients_[id].socket != -1)
+      ++id;
+
+    uint8_t *ring = (id < MAX_CLIENTS_) ? malloc(RING_SIZE_) : NULL;
+    if (!ring) {
+      ALOGW("%s no room for another client", __func__);
+      close(socket);
+      continue;
+    }
+
+    fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) | O_NONBLOCK);
+
+    struct epoll_event event = { .events = EPOLLIN, .data.u32 = id };
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket, &event) == -1) {
+      ALOGW("%s unable to watch client socket: %s", __func__, strerror(errno));
+      free(ring);
+      close(socket);
+      continue;
+    }
+
+    client_t *client = &clients_[id];
+    client->ring = ring;
+    client->want_write = false;
+    client->queued = 0;
+    client->dropped = 0;
+    client->type_mask = 0;
+    client->num_handles = 0;
+    client->command_length = 0;
+
+    /* A new client gets the btsnoop file header first. This allows a
+       decoder to treat the session as a new, valid btsnoop file. */
+    client->head = client->tail = 0;
+    ring_put_(client, FILE_HEADER_, sizeof(FILE_HEADER_));
+
+    pthread_mutex_lock(&clients_lock_);
+    client->socket = socket;
+    ++num_clients_;
+    pthread_mutex_unlock(&clients_lock_);
+
+    ALOGI("client %d connected", id);
+    flush_client_(id);
+  }
+}
+
+static void *server_fn_(UNUSED_ATTR void *context) {
+
+  prctl(PR_SET_NAME, (unsigned long)SERVER_THREAD_NAME_, 0, 0, 0);
 
   listen_socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
   if (listen_socket_ == -1) {
@@ -89,6 +447,7 @@ static void *listen_fn_(UNUSED_ATTR void *context) {
   }
 
   struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
   addr.sin_family = AF_INET;
   addr.sin_addr.s_addr = htonl(LOCALHOST_);
   addr.sin_port = htons(LISTEN_PORT_);
@@ -102,28 +461,67 @@ static void *listen_fn_(UNUSED_ATTR void *context) {
     goto cleanup;
   }
 
+  fcntl(listen_socket_, F_SETFL, fcntl(listen_socket_, F_GETFL) | O_NONBLOCK);
+
+  struct epoll_event event = { .events = EPOLLIN, .data.u32 = LISTEN_ID_ };
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_socket_, &event) == -1) {
+    ALOGE("%s unable to watch listen socket: %s", __func__, strerror(errno));
+    goto cleanup;
+  }
+
+  ALOGD("waiting for client connections");
+
   for (;;) {
-    ALOGD("waiting for client connection");
-    int client_socket = accept(listen_socket_, NULL, NULL);
-    if (client_socket == -1) {
-      if (errno == EINVAL || errno == EBADF) {
-        break;
-      }
-      ALOGW("%s error accepting socket: %s", __func__, strerror(errno));
-      continue;
+    struct epoll_event events[MAX_CLIENTS_ + 2];
+    int count = epoll_wait(epoll_fd_, events, MAX_CLIENTS_ + 2, -1);
+    if (count == -1) {
+      if (errno == EINTR)
+        continue;
+      ALOGE("%s error in epoll_wait: %s", __func__, strerror(errno));
+      break;
     }
 
-    /* When a new client connects, we have to send the btsnoop file header. This allows
-       a decoder to treat the session as a new, valid btsnoop file. */
-    ALOGI("client connected");
-    pthread_mutex_lock(&client_socket_lock_);
-    safe_close_(&client_socket_);
-    client_socket_ = client_socket;
-    send(client_socket_, "btsnoop\0\0\0\0\1\0\0\x3\xea", 16, 0);
-    pthread_mutex_unlock(&client_socket_lock_);
+    for (int i = 0; i < count; ++i) {
+      uint32_t id = events[i].data.u32;
+
+      if (id == LISTEN_ID_) {
+        accept_clients_();
+      } else if (id == WAKE_ID_) {
+        eventfd_t value;
+        eventfd_read(wake_fd_, &value);
+
+        pthread_mutex_lock(&clients_lock_);
+        bool stop = stop_;
+        wake_pending_ = false;
+        pthread_mutex_unlock(&clients_lock_);
+        if (stop)
+          return NULL;
+
+        for (int j = 0; j < MAX_CLIENTS_; ++j)
+          if (clients_[j].socket != -1 && !clients_[j].want_write)
+            flush_client_(j);
+      } else if (clients_[id].socket != -1) {
+        if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+          read_client_(id);
+        if (clients_[id].socket != -1 && (events[i].events & EPOLLOUT))
+          flush_client_(id);
+      }
+    }
   }
 
 cleanup:
+  // Stay until closed; the packet path finds no clients meanwhile.
+  for (;;) {
+    eventfd_t value;
+    if (eventfd_read(wake_fd_, &value) == -1 && errno != EINTR)
+      break;
+    pthread_mutex_lock(&clients_lock_);
+    bool stop = stop_;
+    wake_pending_ = false;
+    pthread_mutex_unlock(&clients_lock_);
+    if (stop)
+      break;
+  }
   safe_close_(&listen_socket_);
   return NULL;
 }
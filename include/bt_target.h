@@ -364,6 +364,37 @@
 #define BTIF_DM_OOB_TEST  TRUE
 #endif
 
+/* Give bonded BR/EDR devices to BTM on their first link key request rather than at startup */
+#ifndef BTA_DM_LAZY_LINK_KEYS
+#define BTA_DM_LAZY_LINK_KEYS  FALSE
+#endif
+
+/* Devices after the current one in the inquiry results whose first service
+** search BTA_DmSearch runs at the same time. 0 searches one device at a time. */
+#ifndef BTA_DM_SDP_SCHED_MAX
+#define BTA_DM_SDP_SCHED_MAX  2
+#endif
+
+/* Longest time an LE scan result is held back so results reach btif in batches (ms) */
+#ifndef BTIF_GATT_SCAN_LATENCY_MS
+#define BTIF_GATT_SCAN_LATENCY_MS  100
+#endif
+
+/* Distinct LE scan results buffered between two deliveries to btif */
+#ifndef BTIF_GATT_SCAN_BATCH_SIZE
+#define BTIF_GATT_SCAN_BATCH_SIZE  64
+#endif
+
+/* Preallocated slots for events switched to the btif task */
+#ifndef BTIF_CONTEXT_SLOTS
+#define BTIF_CONTEXT_SLOTS  64
+#endif
+
+/* Largest event parameter stored inside a slot; bigger ones use a GKI buffer */
+#ifndef BTIF_CONTEXT_INLINE_SIZE
+#define BTIF_CONTEXT_INLINE_SIZE  256
+#endif
+
 // How long to wait before activating sniff mode after entering the
 // idle state for FTS, OPS connections
 #ifndef BTA_FTS_OPS_IDLE_TO_SNIFF_DELAY_MS
@@ -748,6 +779,17 @@ BT_API extern void bte_ssr_cleanup(void);
 #define BTU_CMD_CMPL_TIMEOUT        8
 #endif
 
+/* If TRUE, HCI commands are queued by class (urgent, normal, LE bulk) and a queued
+** LE scan/advertising setting is replaced by a newer one with the same opcode */
+#ifndef BTU_HCI_CMD_SCHEDULING
+#define BTU_HCI_CMD_SCHEDULING      TRUE
+#endif
+
+/* Max number of normal priority HCI commands sent ahead of a waiting bulk one */
+#ifndef BTU_CMD_BULK_MAX_SKIP
+#define BTU_CMD_BULK_MAX_SKIP       4
+#endif
+
 /* If TRUE, BTU task will check HCISU again when HCI command timer expires */
 #ifndef BTU_CMD_CMPL_TOUT_DOUBLE_CHECK
 #define BTU_CMD_CMPL_TOUT_DOUBLE_CHECK      FALSE
@@ -967,6 +1009,24 @@ and USER_HW_DISABLE_API macros */
 #define BTU_BTA_INCLUDED            TRUE
 #endif
 
+/* Count the messages bta_sys_event dispatches and time how long they waited
+** in the BTU mailbox and how long their handler ran, see bta_sys_metrics.h */
+#ifndef BTA_SYS_METRICS
+#define BTA_SYS_METRICS             TRUE
+#endif
+
+/* Build in the BTU data thread: received ACL data of the L2CAP channels that
+** ask for it (L2CA_SetFastDataPath) and SCO data is handled there instead of
+** on BTU. It only runs when BtuDataThread is set in bt_stack.conf. */
+#ifndef BTU_DATA_INCLUDED
+#define BTU_DATA_INCLUDED           TRUE
+#endif
+
+/* Number of channels the BTU data thread can serve at a time */
+#ifndef BTU_DATA_MAX_ROUTES
+#define BTU_DATA_MAX_ROUTES         8
+#endif
+
 /* Number of seconds to wait to send an HCI Reset command upon device initialization. */
 #ifndef BTM_FIRST_RESET_DELAY
 #define BTM_FIRST_RESET_DELAY       0
@@ -1326,6 +1386,21 @@ and USER_HW_DISABLE_API macros */
 #define L2CAP_ROUND_ROBIN_CHANNEL_SERVICE   TRUE
 #endif
 
+/* Deficit round robin by bytes, with latency classes, to pick the channel to send on */
+#ifndef L2CAP_DRR_CHANNEL_SERVICE
+#define L2CAP_DRR_CHANNEL_SERVICE   TRUE
+#endif
+
+/* Rebalance ACL buffer quotas between normal priority links by measured demand */
+#ifndef L2CAP_ADAPTIVE_ACL_ALLOC
+#define L2CAP_ADAPTIVE_ACL_ALLOC    TRUE
+#endif
+
+/* Minimum time in ms between two adaptive ACL quota rebalances */
+#ifndef L2CAP_ADAPTIVE_ACL_INTERVAL_MS
+#define L2CAP_ADAPTIVE_ACL_INTERVAL_MS  100
+#endif
+
 /* Used for calculating transmit buffers off of */
 #ifndef L2CAP_NUM_XMIT_BUFFS
 #define L2CAP_NUM_XMIT_BUFFS                HCI_ACL_BUF_MAX
@@ -1608,9 +1683,15 @@ and USER_HW_DISABLE_API macros */
 #define SDP_MAX_DISC_SERVER_RECS    21
 #endif
 
-/* The size of a scratchpad buffer, in bytes, for storing the response to an attribute request. */
+/* The maximum number of bytes taken from the responses to one attribute request,
+** across continuations. Nothing is buffered; the attributes go to the discovery database. */
 #ifndef SDP_MAX_LIST_BYTE_COUNT
-#define SDP_MAX_LIST_BYTE_COUNT     4096
+#define SDP_MAX_LIST_BYTE_COUNT     16384
+#endif
+
+/* The size of the chunks a discovery database adds when it is full and may grow. */
+#ifndef SDP_DB_CHUNK_SIZE
+#define SDP_DB_CHUNK_SIZE           2048
 #endif
 
 /* The maximum number of parameters in an SDP protocol element. */
@@ -1720,6 +1801,11 @@ and USER_HW_DISABLE_API macros */
 #define PORT_TX_BUF_CRITICAL_WM     15
 #endif
 
+/* The maximum number of buffers filled by a single scatter/gather data call. */
+#ifndef PORT_DATA_VEC_MAX
+#define PORT_DATA_VEC_MAX           PORT_TX_BUF_HIGH_WM
+#endif
+
 /* The RFCOMM multiplexer preferred flow control mechanism. */
 #ifndef PORT_FC_DEFAULT
 #define PORT_FC_DEFAULT             PORT_FC_CREDIT
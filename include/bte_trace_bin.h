@@ -0,0 +1,133 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Binary deferred tracing. In binary mode LogMsg does not format: it
+ *  stores the format string ID, a timestamp and the raw arguments in a
+ *  per-thread ring. A drainer thread formats them to logcat, or writes
+ *  them to a file for bte_trace_decode.
+ *
+ *  The record layout below is shared by the stack and the host tools.
+ *
+ ******************************************************************************/
+
+#ifndef BTE_TRACE_BIN_H
+#define BTE_TRACE_BIN_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include "data_types.h"
+
+/* Bytes of ring per tracing thread */
+#ifndef BTE_TRACE_BIN_RING_SIZE
+#define BTE_TRACE_BIN_RING_SIZE     (64 * 1024)
+#endif
+
+/* Max number of threads with a ring; others fall back to text tracing */
+#ifndef BTE_TRACE_BIN_MAX_THREADS
+#define BTE_TRACE_BIN_MAX_THREADS   32
+#endif
+
+/* Max number of distinct format strings */
+#ifndef BTE_TRACE_BIN_MAX_FMT
+#define BTE_TRACE_BIN_MAX_FMT       4096
+#endif
+
+/* Interval in ms at which the drainer empties the rings */
+#ifndef BTE_TRACE_BIN_DRAIN_MS
+#define BTE_TRACE_BIN_DRAIN_MS      50
+#endif
+
+#define BTE_TRACE_BIN_MAX_ARGS      16          /* conversions per format string */
+#define BTE_TRACE_BIN_MAX_STR       128         /* bytes kept of a %s argument */
+#define BTE_TRACE_BIN_MAX_REC       1024        /* bytes in one record */
+
+/* Argument types, in the order they appear in the record */
+#define BTE_TRACE_ARG_INT32         1           /* 4 bytes */
+#define BTE_TRACE_ARG_INT64         2           /* 8 bytes */
+#define BTE_TRACE_ARG_PTR           3           /* 8 bytes */
+#define BTE_TRACE_ARG_DOUBLE        4           /* 8 bytes */
+#define BTE_TRACE_ARG_STR           5           /* UINT16 length, then the bytes */
+
+#define BTE_TRACE_STR_NULL          0xFFFF      /* length of a NULL %s argument */
+
+/* Record IDs. A format definition carries the UINT8 number of arguments,
+** their BTE_TRACE_ARG_xxx types and the NUL terminated format string. A drop
+** record carries the UINT32 number of records lost. */
+#define BTE_TRACE_ID_DEF_FLAG       0x8000
+#define BTE_TRACE_ID_DROPPED        0x7FFF
+#define BTE_TRACE_ID_WRAP           0x7FFE      /* ring only: continue at offset 0 */
+
+/* Header of every record. Records are padded to 4 bytes. */
+typedef struct
+{
+    UINT16  len;                /* header and payload, before padding */
+    UINT16  fmt_id;
+    UINT32  trace_set_mask;
+    UINT32  tid;
+    UINT32  ts_sec;             /* CLOCK_MONOTONIC */
+    UINT32  ts_nsec;
+} tBTE_TRACE_REC;
+
+/* File header, followed by records */
+#define BTE_TRACE_FILE_MAGIC        0x43525442  /* "BTRC" */
+#define BTE_TRACE_FILE_VERSION      1
+
+typedef struct
+{
+    UINT32  magic;
+    UINT32  version;
+    UINT32  mono_sec;           /* CLOCK_MONOTONIC when the file was opened */
+    UINT32  mono_nsec;
+    UINT32  real_sec;           /* CLOCK_REALTIME at the same moment */
+    UINT32  real_nsec;
+} tBTE_TRACE_FILE_HDR;
+
+#define BTE_TRACE_REC_ALIGN(len)    (((len) + 3) & ~3)
+
+/* Functions provided by bte_trace_fmt.c, shared with the host tools
+*******************************************************************/
+
+/* Parse a printf format string into its argument types. Returns the number
+** of arguments, or -1 if the format cannot be recorded in binary. */
+extern int bte_trace_bin_parse (const char *p_fmt, UINT8 *p_types, int max_types);
+
+/* Format a recorded payload with its format string and argument types.
+** Returns the length of the output. */
+extern int bte_trace_bin_format (char *p_out, size_t out_size, const char *p_fmt,
+                                 const UINT8 *p_types, int num_types,
+                                 const UINT8 *p_args, size_t args_len);
+
+/* Functions provided by bte_trace_bin.c
+***************************************/
+
+extern BOOLEAN bte_trace_bin_enabled;
+
+/* Start binary tracing. With a file path the records are written there for
+** bte_trace_decode, otherwise the drainer formats them to the log. */
+extern BOOLEAN bte_trace_bin_init (const char *p_path);
+extern void    bte_trace_bin_cleanup (void);
+
+/* Record one trace. Returns FALSE if it must be traced as text instead. */
+extern BOOLEAN bte_trace_bin_record (UINT32 trace_set_mask, const char *p_fmt, va_list ap);
+
+/* Provided by the user of bte_trace_bin.c: write one formatted trace */
+extern void bte_log_write (UINT32 trace_set_mask, const char *p_msg);
+
+#endif /* BTE_TRACE_BIN_H */
@@ -69,9 +69,26 @@
 #define A2DP_MEDIA_TASK         2
 #endif
 
+#ifndef BTU_DATA_TASK
+#define BTU_DATA_TASK           3
+#endif
+
 /* The number of GKI tasks in the software system. */
 #ifndef GKI_MAX_TASKS
-#define GKI_MAX_TASKS               3
+#define GKI_MAX_TASKS               4
+#endif
+
+/* Task mailboxes are lock-free queues and task events are signaled with a
+** futex, so GKI_send_msg and GKI_send_event never block on a lock. */
+#ifndef GKI_LOCKFREE_MBOX
+#define GKI_LOCKFREE_MBOX           TRUE
+#endif
+
+/* Each pool buffer has a 32 bit stamp the sender of a message may set, see
+** GKI_set_buf_stamp. The stamps live in a table beside the pools, 4 bytes
+** per buffer, so the buffer header keeps the layout libbt-hci relies on. */
+#ifndef GKI_BUF_STAMP
+#define GKI_BUF_STAMP               TRUE
 #endif
 
 /******************************************************************************
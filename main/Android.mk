@@ -15,7 +15,9 @@ LOCAL_SRC_FILES += \
 	bte_conf.c \
 	bte_init.c \
 	bte_logmsg.c \
-	bte_main.c
+	bte_main.c \
+	bte_trace_bin.c \
+	bte_trace_fmt.c
 
 # BTIF
 LOCAL_SRC_FILES += \
@@ -38,6 +40,7 @@ LOCAL_SRC_FILES += \
 	../btif/src/btif_mce.c \
 	../btif/src/btif_media_task.c \
 	../btif/src/btif_media_aac.c \
+	../btif/src/btif_msbc.c \
 	../btif/src/btif_pan.c \
 	../btif/src/btif_profile_queue.c \
 	../btif/src/btif_a2dp_pcm_dump.c \
@@ -24,10 +24,13 @@
 #include <utils/Log.h>
 
 #include "bta_api.h"
+#include "bte_trace_bin.h"
 #include "config.h"
 
 // TODO: eliminate these global variables.
 extern char hci_logfile[256];
+extern char bta_metrics_file[256];
+extern BOOLEAN btu_data_thread_enabled;
 extern BOOLEAN hci_logging_enabled;
 extern BOOLEAN hci_save_log;
 extern BOOLEAN trace_conf_enabled;
@@ -51,6 +54,15 @@ void bte_load_conf(const char *path) {
   hci_save_log = config_get_bool(config, CONFIG_DEFAULT_SECTION, "BtSnoopSaveLog", false);
   trace_conf_enabled = config_get_bool(config, CONFIG_DEFAULT_SECTION, "TraceConf", false);
 
+  if (config_get_bool(config, CONFIG_DEFAULT_SECTION, "TraceBinary", false)) {
+    const char *path = config_get_string(config, CONFIG_DEFAULT_SECTION, "TraceBinaryFile", "");
+    if (!bte_trace_bin_init(path))
+      ALOGE("%s unable to start binary tracing to >%s<", __func__, path);
+  }
+
+  strlcpy(bta_metrics_file, config_get_string(config, CONFIG_DEFAULT_SECTION, "BtaMetricsFile", ""), sizeof(bta_metrics_file));
+  btu_data_thread_enabled = config_get_bool(config, CONFIG_DEFAULT_SECTION, "BtuDataThread", false);
+
   bte_trace_conf_config(config);
   config_free(config);
 }
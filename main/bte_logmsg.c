@@ -29,6 +29,8 @@
 #include <string.h>
 #include <stdarg.h>
 
+#include "bt_utils.h"
+#include "bte_trace_bin.h"
 #include "config.h"
 #include "gki.h"
 #include "bte.h"
@@ -222,32 +224,14 @@ const char * const bt_layer_tags[] = {
 #endif
 #define DBG_TRACE_DEBUG2( m, p0, p1 ) BT_TRACE( TRACE_LAYER_BTM, (TRACE_ORG_APPL|TRACE_TYPE_DEBUG), m, p0, p1 )
 
+/* Write one formatted trace to logcat, or to stderr */
 void
-LogMsg(UINT32 trace_set_mask, const char *fmt_str, ...)
+bte_log_write(UINT32 trace_set_mask, const char *buffer)
 {
-	static char buffer[BTE_LOG_BUF_SIZE];
     int trace_layer = TRACE_GET_LAYER(trace_set_mask);
     if (trace_layer >= TRACE_LAYER_MAX_NUM)
         trace_layer = 0;
 
-	va_list ap;
-#if (BTE_ANDROID_INTERNAL_TIMESTAMP==TRUE)
-	struct timeval tv;
-	struct timezone tz;
-	struct tm *tm;
-	time_t t;
-
-	gettimeofday(&tv, &tz);
-	time(&t);
-	tm = localtime(&t);
-        if (tm)
-            sprintf(buffer, "%02d:%02d:%02d.%03d ", tm->tm_hour, tm->tm_min, tm->tm_sec,
-            tv.tv_usec / 1000);
-#endif
-	va_start(ap, fmt_str);
-	vsnprintf(&buffer[MSG_BUFFER_OFFSET], BTE_LOG_MAX_SIZE, fmt_str, ap);
-	va_end(ap);
-
 #if (defined(ANDROID_USE_LOGCAT) && (ANDROID_USE_LOGCAT==TRUE))
 #if (BTE_MAP_TRACE_LEVEL==TRUE)
     switch ( TRACE_GET_TYPE(trace_set_mask) )
@@ -273,15 +257,56 @@ LogMsg(UINT32 trace_set_mask, const char *fmt_str, ...)
     LOGI0(bt_layer_tags[trace_layer], buffer);
 #endif
 #else
+    UNUSED(trace_layer);
 	write(2, buffer, strlen(buffer));
 	write(2, "\n", 1);
 #endif
 }
 
+void
+LogMsg(UINT32 trace_set_mask, const char *fmt_str, ...)
+{
+	char buffer[BTE_LOG_BUF_SIZE];
+	va_list ap;
+#if (BTE_ANDROID_INTERNAL_TIMESTAMP==TRUE)
+	struct timeval tv;
+	struct timezone tz;
+	struct tm tm;
+	time_t t;
+#endif
+
+    /* In binary mode the trace is only recorded; the drainer formats it */
+    if (bte_trace_bin_enabled)
+    {
+        BOOLEAN recorded;
+
+        va_start(ap, fmt_str);
+        recorded = bte_trace_bin_record(trace_set_mask, fmt_str, ap);
+        va_end(ap);
+
+        if (recorded)
+            return;
+    }
+
+#if (BTE_ANDROID_INTERNAL_TIMESTAMP==TRUE)
+	buffer[0] = 0;
+	gettimeofday(&tv, &tz);
+	time(&t);
+        if (localtime_r(&t, &tm))
+            sprintf(buffer, "%02d:%02d:%02d.%03d ", tm.tm_hour, tm.tm_min, tm.tm_sec,
+            (int)(tv.tv_usec / 1000));
+#endif
+	va_start(ap, fmt_str);
+	vsnprintf(&buffer[MSG_BUFFER_OFFSET], BTE_LOG_MAX_SIZE, fmt_str, ap);
+	va_end(ap);
+
+    bte_log_write(trace_set_mask, buffer);
+}
+
 void
 ScrLog(UINT32 trace_set_mask, const char *fmt_str, ...)
 {
-	static char buffer[BTE_LOG_BUF_SIZE];
+	char buffer[BTE_LOG_BUF_SIZE];
 
 	va_list ap;
 	struct timeval tv;
@@ -291,6 +316,7 @@ ScrLog(UINT32 trace_set_mask, const char *fmt_str, ...)
     int trace_layer = TRACE_GET_LAYER(trace_set_mask);
     if (trace_layer >= TRACE_LAYER_MAX_NUM)
         trace_layer = 0;
+	buffer[0] = 0;
 	gettimeofday(&tv, &tz);
 	time(&t);
 	tm = localtime(&t);
@@ -34,6 +34,10 @@
 #include "bd.h"
 #include "btu.h"
 #include "bte.h"
+#include "bte_trace_bin.h"
+#if (BTA_SYS_METRICS == TRUE)
+#include "bta_sys_metrics.h"
+#endif
 #include "bta_api.h"
 #include "bt_utils.h"
 #include "bt_hci_bdroid.h"
@@ -84,6 +88,8 @@ BOOLEAN hci_logging_enabled = FALSE;    /* by default, turn hci log off */
 BOOLEAN hci_logging_config = FALSE;    /* configured from bluetooth framework */
 BOOLEAN hci_save_log = FALSE; /* save a copy of the log before starting again */
 char hci_logfile[256] = HCI_LOGGING_FILENAME;
+char bta_metrics_file[256] = "";   /* BTA dispatch metrics saved on disable */
+BOOLEAN btu_data_thread_enabled = FALSE;  /* received data of routed channels off BTU */
 
 /*******************************************************************************
 **  Static variables
@@ -129,6 +135,15 @@ extern bt_bdaddr_t btif_local_bd_addr;
 #define BTE_BTU_TASK_STR        ((INT8 *) "BTU")
 UINT32 bte_btu_stack[(BTE_BTU_STACK_SIZE + 3) / 4];
 
+#if (BTU_DATA_INCLUDED == TRUE)
+/* BTU data task */
+#ifndef BTE_BTU_DATA_STACK_SIZE
+#define BTE_BTU_DATA_STACK_SIZE  0         /* In bytes */
+#endif
+#define BTE_BTU_DATA_TASK_STR   ((INT8 *) "BTU DATA")
+UINT32 bte_btu_data_stack[(BTE_BTU_DATA_STACK_SIZE + 3) / 4];
+#endif
+
 /******************************************************************************
 **
 ** Function         bte_main_in_hw_init
@@ -193,6 +208,8 @@ void bte_main_shutdown()
     pthread_mutex_destroy(&cleanup_lock);
 
     GKI_shutdown();
+
+    bte_trace_bin_cleanup();
 }
 
 /******************************************************************************
@@ -218,6 +235,14 @@ void bte_main_enable()
                     (UINT16 *) ((UINT8 *)bte_btu_stack + BTE_BTU_STACK_SIZE),
                     sizeof(bte_btu_stack));
 
+#if (BTU_DATA_INCLUDED == TRUE)
+    /* before HCI, so that no channel can be routed while the thread is not up */
+    if (btu_data_thread_enabled)
+        GKI_create_task((TASKPTR)btu_data_task, BTU_DATA_TASK, BTE_BTU_DATA_TASK_STR,
+                        (UINT16 *) ((UINT8 *)bte_btu_data_stack + BTE_BTU_DATA_STACK_SIZE),
+                        sizeof(bte_btu_data_stack));
+#endif
+
     bte_hci_enable();
 
     GKI_run();
@@ -237,8 +262,18 @@ void bte_main_disable(void)
 {
     APPL_TRACE_DEBUG("%s", __FUNCTION__);
 
+#if (BTA_SYS_METRICS == TRUE)
+    if (bta_metrics_file[0])
+        bta_sys_metrics_save(bta_metrics_file);
+#endif
+
     preload_stop_wait_timer();
     bte_hci_disable();
+#if (BTU_DATA_INCLUDED == TRUE)
+    /* hands nothing to BTU once HCI is down, so it goes first */
+    if (btu_data_thread_enabled)
+        GKI_destroy_task(BTU_DATA_TASK);
+#endif
     GKI_destroy_task(BTU_TASK);
 }
 
@@ -808,6 +843,11 @@ static int data_ind(TRANSAC transac, char *p_buf, int len)
     APPL_TRACE_DEBUG("HC data_ind event=0x%04X (len=%d)", p_msg->event, len);
     */
 
+#if (BTU_DATA_INCLUDED == TRUE)
+    if (btu_data_rcv(p_msg))
+        return BT_HC_STATUS_SUCCESS;
+#endif
+
     GKI_send_msg (BTU_TASK, BTU_HCI_RCV_MBOX, transac);
     return BT_HC_STATUS_SUCCESS;
 }
@@ -0,0 +1,766 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Binary deferred tracing engine.
+ *
+ *  Each tracing thread owns a single producer, single consumer ring. A
+ *  trace is a fixed header (format ID, trace mask, thread, timestamp) and
+ *  the raw arguments, copied with one memcpy and published with a release
+ *  store of the ring head. Nothing is formatted and no lock is taken on
+ *  that path, except the first time a format string or a thread is seen.
+ *  When a ring is full the trace is dropped and counted.
+ *
+ *  Formats are known by their address, so only formats in the read-only
+ *  segment of this library are traced in binary. A format built at run
+ *  time (a stack buffer, a path) may change or go away at the same address
+ *  and goes through the text path instead.
+ *
+ *  The drainer thread wakes every BTE_TRACE_BIN_DRAIN_MS, merges the rings
+ *  by timestamp and either formats the traces to the log or appends them
+ *  to a file, preceded by the definition of each format string the first
+ *  time it is used.
+ *
+ ******************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <link.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bt_types.h"
+#include "bt_utils.h"
+#include "bte_trace_bin.h"
+
+#define BTE_TRACE_HASH_SIZE     (2 * BTE_TRACE_BIN_MAX_FMT)
+#define BTE_TRACE_WBUF_SIZE     (16 * 1024)
+#define BTE_TRACE_BIN_RO_PROBE  "bte_trace_bin"
+
+/* A format string seen by LogMsg. Written once under the lock, then only read. */
+typedef struct
+{
+    const char      *p_fmt;
+    BOOLEAN         binary;                         /* FALSE: trace it as text */
+    UINT8           num_args;
+    UINT8           types[BTE_TRACE_BIN_MAX_ARGS];
+} tBTE_TRACE_FMT;
+
+typedef struct
+{
+    UINT32          head;                           /* written by the thread */
+    UINT32          tail;                           /* written by the drainer */
+    UINT32          dropped;                        /* written by the thread */
+    UINT32          dropped_seen;                   /* drainer only */
+    UINT32          tid;
+    BOOLEAN         orphan;                         /* the thread has exited */
+    UINT8           data[BTE_TRACE_BIN_RING_SIZE];
+} tBTE_TRACE_RING;
+
+typedef struct
+{
+    pthread_mutex_t lock;                           /* format insert, ring list */
+    pthread_cond_t  cond;
+    pthread_key_t   ring_key;
+    pthread_t       drainer;
+    BOOLEAN         initialized;
+    BOOLEAN         running;
+
+    uintptr_t       ro_start;                       /* read-only segment of this library */
+    uintptr_t       ro_end;
+    tBTE_TRACE_FMT  *p_fmts;                        /* indexed by format ID */
+    UINT16          *p_hash;                        /* format ID + 1, by format pointer */
+    UINT16          num_fmts;
+
+    tBTE_TRACE_RING *p_rings[BTE_TRACE_BIN_MAX_THREADS];
+    UINT16          num_rings;
+
+    /* drainer only */
+    int             fd;                             /* -1: format to the log */
+    UINT8           *p_defined;                     /* format written to the file */
+    UINT8           wbuf[BTE_TRACE_WBUF_SIZE];
+    UINT16          wbuf_len;
+} tBTE_TRACE_CB;
+
+BOOLEAN bte_trace_bin_enabled = FALSE;
+
+static tBTE_TRACE_CB bte_trace_cb;
+
+/*******************************************************************************
+**
+** Function         bte_trace_bin_ring_exit
+**
+** Description      Thread exit destructor of a ring. The drainer frees it
+**                  once it is empty.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bte_trace_bin_ring_exit (void *p_data)
+{
+    tBTE_TRACE_RING *p_ring = (tBTE_TRACE_RING *)p_data;
+
+    __atomic_store_n (&p_ring->orphan, TRUE, __ATOMIC_RELEASE);
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_bin_get_ring
+**
+** Description      Ring of the calling thread, created on its first trace.
+**
+** Returns          the ring, or NULL if no more rings can be created
+**
+*******************************************************************************/
+static tBTE_TRACE_RING *bte_trace_bin_get_ring (void)
+{
+    tBTE_TRACE_RING *p_ring = pthread_getspecific (bte_trace_cb.ring_key);
+
+    if (p_ring != NULL)
+        return p_ring;
+
+    pthread_mutex_lock (&bte_trace_cb.lock);
+    if ( (bte_trace_cb.num_rings < BTE_TRACE_BIN_MAX_THREADS)
+      && ((p_ring = calloc (1, sizeof (tBTE_TRACE_RING))) != NULL) )
+    {
+        p_ring->tid = (UINT32)syscall (__NR_gettid);
+        bte_trace_cb.p_rings[bte_trace_cb.num_rings++] = p_ring;
+        pthread_setspecific (bte_trace_cb.ring_key, p_ring);
+    }
+    pthread_mutex_unlock (&bte_trace_cb.lock);
+
+    return p_ring;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_bin_find_ro
+**
+** Description      dl_iterate_phdr callback. Records the read-only load
+**                  segment that holds the string literals of this library.
+**
+** Returns          1 once found, to stop the iteration
+**
+*******************************************************************************/
+static int bte_trace_bin_find_ro (struct dl_phdr_info *p_info, size_t size, void *p_data)
+{
+    uintptr_t   addr = (uintptr_t)p_data;
+    uintptr_t   start;
+    int         xx;
+
+    UNUSED(size);
+
+    for (xx = 0; xx < p_info->dlpi_phnum; xx++)
+    {
+        const ElfW(Phdr) *p_phdr = &p_info->dlpi_phdr[xx];
+
+        if ((p_phdr->p_type != PT_LOAD) || (p_phdr->p_flags & PF_W))
+            continue;
+
+        start = p_info->dlpi_addr + p_phdr->p_vaddr;
+        if ((addr >= start) && (addr < start + p_phdr->p_memsz))
+        {
+            bte_trace_cb.ro_start = start;
+            bte_trace_cb.ro_end   = start + p_phdr->p_memsz;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_bin_get_fmt
+**
+** Description      Find a format string by its address. A new one is parsed
+**                  and given the next ID under the lock, then published in
+**                  the hash with a release store; lookups take no lock.
+**
+** Returns          the format ID, or -1 if the table is full
+**
+*******************************************************************************/
+static int bte_trace_bin_get_fmt (const char *p_fmt)
+{
+    UINT32          start = (UINT32)(((uintptr_t)p_fmt >> 2) * 2654435761u) % BTE_TRACE_HASH_SIZE;
+    UINT32          xx, h;
+    UINT16          slot;
+    int             id = -1;
+    int             num;
+    tBTE_TRACE_FMT  *p_entry;
+
+    for (xx = 0, h = start; xx < BTE_TRACE_HASH_SIZE; xx++, h = (h + 1) % BTE_TRACE_HASH_SIZE)
+    {
+        if ((slot = __atomic_load_n (&bte_trace_cb.p_hash[h], __ATOMIC_ACQUIRE)) == 0)
+            break;
+        if (bte_trace_cb.p_fmts[slot - 1].p_fmt == p_fmt)
+            return slot - 1;
+    }
+
+    pthread_mutex_lock (&bte_trace_cb.lock);
+
+    /* Another thread may have added it, look again from the start */
+    for (xx = 0, h = start; xx < BTE_TRACE_HASH_SIZE; xx++, h = (h + 1) % BTE_TRACE_HASH_SIZE)
+    {
+        if ((slot = bte_trace_cb.p_hash[h]) == 0)
+        {
+            if (bte_trace_cb.num_fmts >= BTE_TRACE_BIN_MAX_FMT)
+                break;
+
+            id = bte_trace_cb.num_fmts++;
+            p_entry = &bte_trace_cb.p_fmts[id];
+            p_entry->p_fmt = p_fmt;
+            num = bte_trace_bin_parse (p_fmt, p_entry->types, BTE_TRACE_BIN_MAX_ARGS);
+            p_entry->binary = (num >= 0);
+            p_entry->num_args = (num > 0) ? num : 0;
+
+            __atomic_store_n (&bte_trace_cb.p_hash[h], (UINT16)(id + 1), __ATOMIC_RELEASE);
+            break;
+        }
+        if (bte_trace_cb.p_fmts[slot - 1].p_fmt == p_fmt)
+        {
+            id = slot - 1;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock (&bte_trace_cb.lock);
+    return id;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_bin_min_size
+**
+** Description      Smallest room an argument of the given type takes.
+**
+** Returns          size in bytes
+**
+*******************************************************************************/
+static int bte_trace_bin_min_size (UINT8 type)
+{
+    switch (type)
+    {
+        case BTE_TRACE_ARG_INT32:   return 4;
+        case BTE_TRACE_ARG_STR:     return 2;
+        default:                    return 8;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_bin_record
+**
+** Description      Record one trace in the ring of the calling thread.
+**
+** Returns          FALSE if the trace must go through the text path: the
+**                  format is not supported or not a literal of this
+**                  library, or no ring or ID is left
+**
+*******************************************************************************/
+BOOLEAN bte_trace_bin_record (UINT32 trace_set_mask, const char *p_fmt, va_list ap)
+{
+    UINT8           rec[BTE_TRACE_BIN_MAX_REC];
+    tBTE_TRACE_REC  *p_hdr = (tBTE_TRACE_REC *)rec;
+    tBTE_TRACE_RING *p_ring;
+    tBTE_TRACE_FMT  *p_entry;
+    struct timespec ts;
+    UINT8           *p = rec + sizeof (tBTE_TRACE_REC);
+    UINT8           *p_end = rec + sizeof (rec);
+    UINT32          head, tail, pos, len, need;
+    INT32           i32;
+    int64_t         i64;
+    double          dbl;
+    const char      *p_str;
+    UINT16          n;
+    int             id, xx;
+    int             reserve = 0;
+
+    if ( ((uintptr_t)p_fmt < bte_trace_cb.ro_start)
+      || ((uintptr_t)p_fmt >= bte_trace_cb.ro_end) )
+        return FALSE;
+
+    if ((p_ring = bte_trace_bin_get_ring ()) == NULL)
+        return FALSE;
+
+    if ((id = bte_trace_bin_get_fmt (p_fmt)) < 0)
+        return FALSE;
+
+    p_entry = &bte_trace_cb.p_fmts[id];
+    if (!p_entry->binary)
+        return FALSE;
+
+    /* Strings get what is left once every argument has its minimum room */
+    for (xx = 0; xx < p_entry->num_args; xx++)
+        reserve += bte_trace_bin_min_size (p_entry->types[xx]);
+
+    for (xx = 0; xx < p_entry->num_args; xx++)
+    {
+        reserve -= bte_trace_bin_min_size (p_entry->types[xx]);
+
+        switch (p_entry->types[xx])
+        {
+            case BTE_TRACE_ARG_INT32:
+                i32 = va_arg (ap, int);
+                memcpy (p, &i32, 4);
+                p += 4;
+                break;
+
+            case BTE_TRACE_ARG_INT64:
+                i64 = va_arg (ap, long long);
+                memcpy (p, &i64, 8);
+                p += 8;
+                break;
+
+            case BTE_TRACE_ARG_PTR:
+                i64 = (int64_t)(uintptr_t)va_arg (ap, void *);
+                memcpy (p, &i64, 8);
+                p += 8;
+                break;
+
+            case BTE_TRACE_ARG_DOUBLE:
+                dbl = va_arg (ap, double);
+                memcpy (p, &dbl, 8);
+                p += 8;
+                break;
+
+            default:
+                p_str = va_arg (ap, const char *);
+                if (p_str == NULL)
+                    n = BTE_TRACE_STR_NULL;
+                else
+                {
+                    n = strnlen (p_str, BTE_TRACE_BIN_MAX_STR);
+                    if (n > (p_end - p) - 2 - reserve)
+                        n = (p_end - p) - 2 - reserve;
+                }
+                memcpy (p, &n, 2);
+                p += 2;
+                if (n != BTE_TRACE_STR_NULL)
+                {
+                    memcpy (p, p_str, n);
+                    p += n;
+                }
+                break;
+        }
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    p_hdr->len            = (UINT16)(p - rec);
+    p_hdr->fmt_id         = (UINT16)id;
+    p_hdr->trace_set_mask = trace_set_mask;
+    p_hdr->tid            = p_ring->tid;
+    p_hdr->ts_sec         = (UINT32)ts.tv_sec;
+    p_hdr->ts_nsec        = (UINT32)ts.tv_nsec;
+
+    /* Reserve contiguous room; a record never straddles the end of the ring */
+    len  = BTE_TRACE_REC_ALIGN (p_hdr->len);
+    head = p_ring->head;
+    tail = __atomic_load_n (&p_ring->tail, __ATOMIC_ACQUIRE);
+    pos  = head % BTE_TRACE_BIN_RING_SIZE;
+    need = (BTE_TRACE_BIN_RING_SIZE - pos < len) ? len + BTE_TRACE_BIN_RING_SIZE - pos : len;
+
+    if (head - tail + need > BTE_TRACE_BIN_RING_SIZE)
+    {
+        __atomic_store_n (&p_ring->dropped, p_ring->dropped + 1, __ATOMIC_RELAXED);
+        return TRUE;
+    }
+
+    if (need != len)
+    {
+        n = BTE_TRACE_ID_WRAP;
+        memcpy (&p_ring->data[pos + 2], &n, 2);
+        head += BTE_TRACE_BIN_RING_SIZE - pos;
+        pos = 0;
+    }
+
+    memcpy (&p_ring->data[pos], rec, p_hdr->len);
+    __atomic_store_n (&p_ring->head, head + len, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_bin_peek
+**
+** Description      Next record of a ring, skipping a wrap marker.
+**
+** Returns          the record, or NULL if the ring is empty up to head
+**
+*******************************************************************************/
+static tBTE_TRACE_REC *bte_trace_bin_peek (tBTE_TRACE_RING *p_ring, UINT32 head)
+{
+    UINT32  pos;
+    UINT16  id;
+
+    while (p_ring->tail != head)
+    {
+        pos = p_ring->tail % BTE_TRACE_BIN_RING_SIZE;
+        memcpy (&id, &p_ring->data[pos + 2], 2);
+
+        if (id != BTE_TRACE_ID_WRAP)
+            return (tBTE_TRACE_REC *)&p_ring->data[pos];
+
+        p_ring->tail += BTE_TRACE_BIN_RING_SIZE - pos;
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_bin_flush
+**
+** Description      Write the drainer buffer to the trace file.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bte_trace_bin_flush (void)
+{
+    UINT16  off = 0;
+    ssize_t ret;
+
+    while (off < bte_trace_cb.wbuf_len)
+    {
+        ret = write (bte_trace_cb.fd, bte_trace_cb.wbuf + off, bte_trace_cb.wbuf_len - off);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            break;
+        off += ret;
+    }
+    bte_trace_cb.wbuf_len = 0;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_bin_put
+**
+** Description      Append one record, with its header, to the trace file.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bte_trace_bin_put (const tBTE_TRACE_REC *p_hdr, const void *p_payload, UINT16 payload_len)
+{
+    UINT16  len = BTE_TRACE_REC_ALIGN (sizeof (tBTE_TRACE_REC) + payload_len);
+    UINT8   *p;
+
+    if (bte_trace_cb.wbuf_len + len > BTE_TRACE_WBUF_SIZE)
+        bte_trace_bin_flush ();
+
+    p = bte_trace_cb.wbuf + bte_trace_cb.wbuf_len;
+    memcpy (p, p_hdr, sizeof (tBTE_TRACE_REC));
+    ((tBTE_TRACE_REC *)p)->len = sizeof (tBTE_TRACE_REC) + payload_len;
+    memcpy (p + sizeof (tBTE_TRACE_REC), p_payload, payload_len);
+    memset (p + sizeof (tBTE_TRACE_REC) + payload_len, 0, len - sizeof (tBTE_TRACE_REC) - payload_len);
+    bte_trace_cb.wbuf_len += len;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_bin_emit
+**
+** Description      Output one record: format it to the log, or write it to
+**                  the file after the definition of its format string.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bte_trace_bin_emit (const tBTE_TRACE_REC *p_rec)
+{
+    const tBTE_TRACE_FMT    *p_entry = &bte_trace_cb.p_fmts[p_rec->fmt_id];
+    tBTE_TRACE_REC          def;
+    UINT8                   payload[1 + BTE_TRACE_BIN_MAX_ARGS + BTE_TRACE_BIN_MAX_REC];
+    char                    msg[BTE_TRACE_BIN_MAX_REC];
+    size_t                  n;
+
+    if (bte_trace_cb.fd < 0)
+    {
+        bte_trace_bin_format (msg, sizeof (msg), p_entry->p_fmt,
+                              p_entry->types, p_entry->num_args,
+                              (const UINT8 *)(p_rec + 1), p_rec->len - sizeof (tBTE_TRACE_REC));
+        bte_log_write (p_rec->trace_set_mask, msg);
+        return;
+    }
+
+    if (!bte_trace_cb.p_defined[p_rec->fmt_id])
+    {
+        memset (&def, 0, sizeof (def));
+        def.fmt_id = p_rec->fmt_id | BTE_TRACE_ID_DEF_FLAG;
+
+        n = strnlen (p_entry->p_fmt, BTE_TRACE_BIN_MAX_REC - 1);
+        payload[0] = p_entry->num_args;
+        memcpy (&payload[1], p_entry->types, p_entry->num_args);
+        memcpy (&payload[1 + p_entry->num_args], p_entry->p_fmt, n);
+        payload[1 + p_entry->num_args + n] = 0;
+
+        bte_trace_bin_put (&def, payload, 1 + p_entry->num_args + n + 1);
+        bte_trace_cb.p_defined[p_rec->fmt_id] = TRUE;
+    }
+
+    bte_trace_bin_put (p_rec, p_rec + 1, p_rec->len - sizeof (tBTE_TRACE_REC));
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_bin_drain
+**
+** Description      Empty every ring, oldest record first. Rings of exited
+**                  threads are freed once empty.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bte_trace_bin_drain (void)
+{
+    tBTE_TRACE_RING *p_rings[BTE_TRACE_BIN_MAX_THREADS];
+    UINT32          heads[BTE_TRACE_BIN_MAX_THREADS];
+    tBTE_TRACE_REC  *p_rec, *p_best;
+    tBTE_TRACE_REC  drop;
+    char            msg[64];
+    UINT32          lost;
+    int             num, xx, yy, best;
+
+    pthread_mutex_lock (&bte_trace_cb.lock);
+    num = bte_trace_cb.num_rings;
+    memcpy (p_rings, bte_trace_cb.p_rings, num * sizeof (tBTE_TRACE_RING *));
+    pthread_mutex_unlock (&bte_trace_cb.lock);
+
+    /* Only what is there now, a busy thread must not keep the drainer here */
+    for (xx = 0; xx < num; xx++)
+    {
+        heads[xx] = __atomic_load_n (&p_rings[xx]->head, __ATOMIC_ACQUIRE);
+
+        lost = __atomic_load_n (&p_rings[xx]->dropped, __ATOMIC_RELAXED) - p_rings[xx]->dropped_seen;
+        if (lost == 0)
+            continue;
+
+        p_rings[xx]->dropped_seen += lost;
+        if (bte_trace_cb.fd < 0)
+        {
+            snprintf (msg, sizeof (msg), "bte_trace: %u traces lost by thread %u",
+                      lost, p_rings[xx]->tid);
+            bte_log_write (TRACE_CTRL_GENERAL | TRACE_LAYER_NONE | TRACE_ORG_STACK | TRACE_TYPE_WARNING, msg);
+        }
+        else
+        {
+            memset (&drop, 0, sizeof (drop));
+            drop.fmt_id = BTE_TRACE_ID_DROPPED;
+            drop.tid    = p_rings[xx]->tid;
+            bte_trace_bin_put (&drop, &lost, sizeof (lost));
+        }
+    }
+
+    for (;;)
+    {
+        p_best = NULL;
+        best   = -1;
+        for (xx = 0; xx < num; xx++)
+        {
+            if ((p_rec = bte_trace_bin_peek (p_rings[xx], heads[xx])) == NULL)
+                continue;
+
+            if ( (p_best == NULL)
+              || (p_rec->ts_sec < p_best->ts_sec)
+              || ((p_rec->ts_sec == p_best->ts_sec) && (p_rec->ts_nsec < p_best->ts_nsec)) )
+            {
+                p_best = p_rec;
+                best   = xx;
+            }
+        }
+
+        if (p_best == NULL)
+            break;
+
+        bte_trace_bin_emit (p_best);
+        __atomic_store_n (&p_rings[best]->tail,
+                          p_rings[best]->tail + BTE_TRACE_REC_ALIGN (p_best->len), __ATOMIC_RELEASE);
+    }
+
+    if (bte_trace_cb.fd >= 0)
+        bte_trace_bin_flush ();
+
+    /* Free the rings of exited threads */
+    pthread_mutex_lock (&bte_trace_cb.lock);
+    for (xx = 0; xx < bte_trace_cb.num_rings; )
+    {
+        tBTE_TRACE_RING *p_ring = bte_trace_cb.p_rings[xx];
+
+        if ( (__atomic_load_n (&p_ring->orphan, __ATOMIC_ACQUIRE))
+          && (p_ring->tail == __atomic_load_n (&p_ring->head, __ATOMIC_ACQUIRE)) )
+        {
+            for (yy = xx + 1; yy < bte_trace_cb.num_rings; yy++)
+                bte_trace_cb.p_rings[yy - 1] = bte_trace_cb.p_rings[yy];
+            bte_trace_cb.num_rings--;
+            free (p_ring);
+        }
+        else
+            xx++;
+    }
+    pthread_mutex_unlock (&bte_trace_cb.lock);
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_bin_drainer
+**
+** Description      Drainer thread.
+**
+** Returns          NULL
+**
+*******************************************************************************/
+static void *bte_trace_bin_drainer (void *p_arg)
+{
+    struct timespec ts;
+    UNUSED(p_arg);
+
+    pthread_mutex_lock (&bte_trace_cb.lock);
+    while (bte_trace_cb.running)
+    {
+        clock_gettime (CLOCK_REALTIME, &ts);
+        ts.tv_nsec += BTE_TRACE_BIN_DRAIN_MS * 1000000L;
+        ts.tv_sec  += ts.tv_nsec / 1000000000L;
+        ts.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait (&bte_trace_cb.cond, &bte_trace_cb.lock, &ts);
+
+        pthread_mutex_unlock (&bte_trace_cb.lock);
+        bte_trace_bin_drain ();
+        pthread_mutex_lock (&bte_trace_cb.lock);
+    }
+    pthread_mutex_unlock (&bte_trace_cb.lock);
+
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_bin_init
+**
+** Description      Start binary tracing. With a file path the records are
+**                  written there, otherwise they are formatted to the log by
+**                  the drainer.
+**
+** Returns          TRUE if binary tracing is on
+**
+*******************************************************************************/
+BOOLEAN bte_trace_bin_init (const char *p_path)
+{
+    tBTE_TRACE_FILE_HDR hdr;
+    struct timespec     mono, real;
+
+    if (bte_trace_bin_enabled)
+        return TRUE;
+
+    if (!bte_trace_cb.initialized)
+    {
+        bte_trace_cb.p_fmts    = calloc (BTE_TRACE_BIN_MAX_FMT, sizeof (tBTE_TRACE_FMT));
+        bte_trace_cb.p_hash    = calloc (BTE_TRACE_HASH_SIZE, sizeof (UINT16));
+        bte_trace_cb.p_defined = calloc (BTE_TRACE_BIN_MAX_FMT, sizeof (UINT8));
+        if (!bte_trace_cb.p_fmts || !bte_trace_cb.p_hash || !bte_trace_cb.p_defined)
+        {
+            free (bte_trace_cb.p_fmts);
+            free (bte_trace_cb.p_hash);
+            free (bte_trace_cb.p_defined);
+            return FALSE;
+        }
+
+        /* any literal of this file locates the segment all of them are in */
+        dl_iterate_phdr (bte_trace_bin_find_ro, (void *)BTE_TRACE_BIN_RO_PROBE);
+
+        pthread_mutex_init (&bte_trace_cb.lock, NULL);
+        pthread_cond_init (&bte_trace_cb.cond, NULL);
+        pthread_key_create (&bte_trace_cb.ring_key, bte_trace_bin_ring_exit);
+        bte_trace_cb.initialized = TRUE;
+    }
+
+    bte_trace_cb.fd = -1;
+    if (p_path && *p_path)
+    {
+        if ((bte_trace_cb.fd = open (p_path, O_WRONLY | O_CREAT | O_TRUNC, 0660)) < 0)
+            return FALSE;
+
+        clock_gettime (CLOCK_MONOTONIC, &mono);
+        clock_gettime (CLOCK_REALTIME, &real);
+        hdr.magic     = BTE_TRACE_FILE_MAGIC;
+        hdr.version   = BTE_TRACE_FILE_VERSION;
+        hdr.mono_sec  = (UINT32)mono.tv_sec;
+        hdr.mono_nsec = (UINT32)mono.tv_nsec;
+        hdr.real_sec  = (UINT32)real.tv_sec;
+        hdr.real_nsec = (UINT32)real.tv_nsec;
+        if (write (bte_trace_cb.fd, &hdr, sizeof (hdr)) != sizeof (hdr))
+        {
+            close (bte_trace_cb.fd);
+            return FALSE;
+        }
+
+        /* A new file needs the format definitions again */
+        memset (bte_trace_cb.p_defined, 0, BTE_TRACE_BIN_MAX_FMT);
+    }
+
+    bte_trace_cb.running = TRUE;
+    if (pthread_create (&bte_trace_cb.drainer, NULL, bte_trace_bin_drainer, NULL) != 0)
+    {
+        bte_trace_cb.running = FALSE;
+        if (bte_trace_cb.fd >= 0)
+            close (bte_trace_cb.fd);
+        return FALSE;
+    }
+
+    bte_trace_bin_enabled = TRUE;
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_bin_cleanup
+**
+** Description      Stop binary tracing, after draining what was recorded.
+**                  Rings and format IDs are kept: a thread may still be in
+**                  bte_trace_bin_record, and a later init reuses them.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bte_trace_bin_cleanup (void)
+{
+    if (!bte_trace_bin_enabled)
+        return;
+
+    bte_trace_bin_enabled = FALSE;
+
+    pthread_mutex_lock (&bte_trace_cb.lock);
+    bte_trace_cb.running = FALSE;
+    pthread_cond_signal (&bte_trace_cb.cond);
+    pthread_mutex_unlock (&bte_trace_cb.lock);
+    pthread_join (bte_trace_cb.drainer, NULL);
+
+    bte_trace_bin_drain ();
+
+    if (bte_trace_cb.fd >= 0)
+    {
+        close (bte_trace_cb.fd);
+        bte_trace_cb.fd = -1;
+    }
+}
@@ -0,0 +1,387 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Format string handling of the binary trace records. This file has no
+ *  stack dependencies: bte_trace_decode and bte_trace_bench build it on
+ *  the host.
+ *
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bte_trace_bin.h"
+
+/* One conversion of a format string */
+typedef struct
+{
+    const char  *p_start;       /* the '%' */
+    const char  *p_flags;       /* flags, up to p_width */
+    const char  *p_width;       /* width digits, up to p_prec, or "*" */
+    const char  *p_prec;        /* '.' and precision digits, up to p_len, or ".*" */
+    const char  *p_len;         /* length modifier, up to p_conv */
+    const char  *p_conv;        /* conversion character */
+    BOOLEAN     width_arg;      /* width is taken from an INT32 argument */
+    BOOLEAN     prec_arg;       /* precision is taken from an INT32 argument */
+    UINT8       type;           /* BTE_TRACE_ARG_xxx of the value, 0 for none */
+} tBTE_TRACE_SPEC;
+
+/*******************************************************************************
+**
+** Function         bte_trace_int_type
+**
+** Description      Argument type of an integer conversion with the given
+**                  length modifier, as laid out by the recording host.
+**
+** Returns          BTE_TRACE_ARG_INT32 or BTE_TRACE_ARG_INT64
+**
+*******************************************************************************/
+static UINT8 bte_trace_int_type (const char *p_len, const char *p_conv)
+{
+    size_t  size = sizeof (int);
+
+    if ((p_conv - p_len) == 2 && p_len[0] == 'l' && p_len[1] == 'l')
+        size = sizeof (long long);
+    else if ((p_conv - p_len) == 1)
+    {
+        switch (*p_len)
+        {
+            case 'l':   size = sizeof (long);       break;
+            case 'q':
+            case 'j':   size = sizeof (long long);  break;
+            case 'z':   size = sizeof (size_t);     break;
+            case 't':   size = sizeof (ptrdiff_t);  break;
+            default:                                break;
+        }
+    }
+
+    return (size > 4) ? BTE_TRACE_ARG_INT64 : BTE_TRACE_ARG_INT32;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_next_spec
+**
+** Description      Find the next conversion in a format string.
+**
+** Returns          1 if one was found, 0 at the end of the string, -1 if the
+**                  conversion is not supported (%n, wide strings, long
+**                  double, unterminated)
+**
+*******************************************************************************/
+static int bte_trace_next_spec (const char **pp_fmt, tBTE_TRACE_SPEC *p_spec)
+{
+    const char  *p = *pp_fmt;
+
+    for (;;)
+    {
+        if ((p = strchr (p, '%')) == NULL)
+            return 0;
+
+        if (p[1] != '%')
+            break;
+
+        p += 2;
+    }
+
+    memset (p_spec, 0, sizeof (tBTE_TRACE_SPEC));
+    p_spec->p_start = p++;
+
+    p_spec->p_flags = p;
+    while (*p && strchr ("-+ #0'", *p))
+        p++;
+
+    p_spec->p_width = p;
+    if (*p == '*')
+    {
+        p_spec->width_arg = TRUE;
+        p++;
+    }
+    else
+    {
+        while (*p >= '0' && *p <= '9')
+            p++;
+    }
+
+    p_spec->p_prec = p;
+    if (*p == '.')
+    {
+        p++;
+        if (*p == '*')
+        {
+            p_spec->prec_arg = TRUE;
+            p++;
+        }
+        else
+        {
+            while (*p >= '0' && *p <= '9')
+                p++;
+        }
+    }
+
+    p_spec->p_len = p;
+    while (*p && strchr ("hlqjztL", *p))
+        p++;
+
+    p_spec->p_conv = p;
+    *pp_fmt = (*p) ? p + 1 : p;
+
+    switch (*p)
+    {
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+            p_spec->type = bte_trace_int_type (p_spec->p_len, p);
+            break;
+
+        case 'p':
+            p_spec->type = BTE_TRACE_ARG_PTR;
+            break;
+
+        case 's':
+            if (p != p_spec->p_len)
+                return -1;
+            p_spec->type = BTE_TRACE_ARG_STR;
+            break;
+
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            if (memchr (p_spec->p_len, 'L', p - p_spec->p_len))
+                return -1;
+            p_spec->type = BTE_TRACE_ARG_DOUBLE;
+            break;
+
+        default:
+            return -1;
+    }
+    return 1;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_bin_parse
+**
+** Description      Parse a printf format string into the types of the
+**                  arguments it consumes, '*' width and precision included.
+**
+** Returns          number of arguments, -1 if the format is not supported
+**
+*******************************************************************************/
+int bte_trace_bin_parse (const char *p_fmt, UINT8 *p_types, int max_types)
+{
+    tBTE_TRACE_SPEC spec;
+    int             num = 0;
+    int             rc;
+
+    while ((rc = bte_trace_next_spec (&p_fmt, &spec)) > 0)
+    {
+        if (num + spec.width_arg + spec.prec_arg + 1 > max_types)
+            return -1;
+
+        if (spec.width_arg)
+            p_types[num++] = BTE_TRACE_ARG_INT32;
+        if (spec.prec_arg)
+            p_types[num++] = BTE_TRACE_ARG_INT32;
+        p_types[num++] = spec.type;
+    }
+    return (rc < 0) ? -1 : num;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_read_arg
+**
+** Description      Read the next argument of a record payload.
+**
+** Returns          TRUE if the payload held an argument of that type
+**
+*******************************************************************************/
+static BOOLEAN bte_trace_read_arg (UINT8 type, const UINT8 **pp_args, const UINT8 *p_end,
+                                   int64_t *p_int, double *p_dbl, char *p_str)
+{
+    const UINT8 *p = *pp_args;
+    INT32       i32;
+    UINT16      n;
+
+    switch (type)
+    {
+        case BTE_TRACE_ARG_INT32:
+            if (p + 4 > p_end)
+                return FALSE;
+            memcpy (&i32, p, 4);
+            *p_int = i32;
+            p += 4;
+            break;
+
+        case BTE_TRACE_ARG_INT64:
+        case BTE_TRACE_ARG_PTR:
+            if (p + 8 > p_end)
+                return FALSE;
+            memcpy (p_int, p, 8);
+            p += 8;
+            break;
+
+        case BTE_TRACE_ARG_DOUBLE:
+            if (p + 8 > p_end)
+                return FALSE;
+            memcpy (p_dbl, p, 8);
+            p += 8;
+            break;
+
+        case BTE_TRACE_ARG_STR:
+            if (p + 2 > p_end)
+                return FALSE;
+            memcpy (&n, p, 2);
+            p += 2;
+            if (n == BTE_TRACE_STR_NULL)
+            {
+                strcpy (p_str, "(null)");
+                break;
+            }
+            if (n > BTE_TRACE_BIN_MAX_STR || p + n > p_end)
+                return FALSE;
+            memcpy (p_str, p, n);
+            p_str[n] = 0;
+            p += n;
+            break;
+
+        default:
+            return FALSE;
+    }
+
+    *pp_args = p;
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_bin_format
+**
+** Description      Format a record payload. Each conversion is rebuilt with
+**                  the length modifier matching the recorded argument size,
+**                  so a trace recorded on a 32 bit target decodes on a 64
+**                  bit host. Literal text is copied as is.
+**
+** Returns          length of the output
+**
+*******************************************************************************/
+int bte_trace_bin_format (char *p_out, size_t out_size, const char *p_fmt,
+                          const UINT8 *p_types, int num_types,
+                          const UINT8 *p_args, size_t args_len)
+{
+    const UINT8     *p_end = p_args + args_len;
+    const char      *p_lit = p_fmt;
+    tBTE_TRACE_SPEC spec;
+    char            conv[32];
+    char            str[BTE_TRACE_BIN_MAX_STR + 1];
+    size_t          pos = 0;
+    size_t          n;
+    int64_t         val, width = 0, prec = 0;
+    double          dbl = 0;
+    int             ti = 0;
+    int             rc;
+
+    if (out_size == 0)
+        return 0;
+
+#define BTE_TRACE_EMIT(len) \
+    pos += (len); \
+    if (pos >= out_size) \
+        pos = out_size - 1;
+
+    for (;;)
+    {
+        rc = bte_trace_next_spec (&p_fmt, &spec);
+
+        /* literal text up to the conversion, or to the end */
+        n = (rc > 0) ? (size_t)(spec.p_start - p_lit) : strlen (p_lit);
+        if (n > out_size - 1 - pos)
+            n = out_size - 1 - pos;
+        memcpy (p_out + pos, p_lit, n);
+        pos += n;
+        p_out[pos] = 0;
+
+        if (rc <= 0)
+            break;
+
+        p_lit = p_fmt;
+
+        if ( (spec.width_arg && (ti >= num_types
+              || !bte_trace_read_arg (p_types[ti++], &p_args, p_end, &width, &dbl, str)))
+          || (spec.prec_arg && (ti >= num_types
+              || !bte_trace_read_arg (p_types[ti++], &p_args, p_end, &prec, &dbl, str)))
+          || (ti >= num_types)
+          || !bte_trace_read_arg (p_types[ti], &p_args, p_end, &val, &dbl, str) )
+        {
+            n = snprintf (p_out + pos, out_size - pos, "<?>");
+            BTE_TRACE_EMIT (n);
+            break;
+        }
+
+        /* flags, then width and precision with '*' resolved */
+        n = snprintf (conv, sizeof (conv), "%%%.*s", (int)(spec.p_width - spec.p_flags), spec.p_flags);
+        if (spec.width_arg)
+            n += snprintf (conv + n, sizeof (conv) - n, "%d", (int)width);
+        else
+            n += snprintf (conv + n, sizeof (conv) - n, "%.*s", (int)(spec.p_prec - spec.p_width), spec.p_width);
+        if (spec.prec_arg)
+            n += snprintf (conv + n, sizeof (conv) - n, ".%d", (int)prec);
+        else
+            n += snprintf (conv + n, sizeof (conv) - n, "%.*s", (int)(spec.p_len - spec.p_prec), spec.p_prec);
+        if (n >= sizeof (conv) - 4)
+            n = sizeof (conv) - 4;
+
+        switch (p_types[ti++])
+        {
+            case BTE_TRACE_ARG_INT32:
+                /* keep h and hh, they narrow the promoted value */
+                snprintf (conv + n, sizeof (conv) - n, "%.*s%c",
+                          (*spec.p_len == 'h') ? (int)(spec.p_conv - spec.p_len) : 0,
+                          spec.p_len, *spec.p_conv);
+                n = snprintf (p_out + pos, out_size - pos, conv, (int)val);
+                break;
+
+            case BTE_TRACE_ARG_INT64:
+                snprintf (conv + n, sizeof (conv) - n, "ll%c", *spec.p_conv);
+                n = snprintf (p_out + pos, out_size - pos, conv, (long long)val);
+                break;
+
+            case BTE_TRACE_ARG_PTR:
+                snprintf (conv + n, sizeof (conv) - n, "llx");
+                n = snprintf (p_out + pos, out_size - pos, "0x");
+                BTE_TRACE_EMIT (n);
+                n = snprintf (p_out + pos, out_size - pos, conv, (unsigned long long)val);
+                break;
+
+            case BTE_TRACE_ARG_DOUBLE:
+                snprintf (conv + n, sizeof (conv) - n, "%c", *spec.p_conv);
+                n = snprintf (p_out + pos, out_size - pos, conv, dbl);
+                break;
+
+            default:
+                snprintf (conv + n, sizeof (conv) - n, "s");
+                n = snprintf (p_out + pos, out_size - pos, conv, str);
+                break;
+        }
+        BTE_TRACE_EMIT (n);
+    }
+
+#undef BTE_TRACE_EMIT
+
+    return (int)pos;
+}
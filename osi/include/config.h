@@ -2,8 +2,8 @@
 
 // This module implements a configuration parser. Clients can query the
 // contents of a configuration file through the interface provided here.
-// The current implementation is read-only; mutations are only kept in
-// memory. This parser supports the INI file format.
+// Mutations are kept in memory until written out with |config_save|.
+// This parser supports the INI file format.
 
 // Implementation notes:
 // - Key/value pairs that are not within a section are assumed to be under
@@ -14,6 +14,9 @@
 //   not exist. In other words, |config_has_section| will return false for
 //   empty sections.
 // - Duplicate keys in a section will overwrite previous values.
+// - Sections and keys are hashed for lookup but remember the order in which
+//   they were first seen, which is the order |config_save| writes them in.
+// - Lines may be of any length.
 
 #include <stdbool.h>
 
@@ -31,6 +34,11 @@ typedef struct config_t config_t;
 // file on the filesystem.
 config_t *config_new(const char *filename);
 
+// Returns a handle to an empty config. Returns NULL if there was a problem
+// allocating memory. Clients must call |config_free| on the returned handle
+// when it is no longer required.
+config_t *config_new_empty(void);
+
 // Frees resources associated with the config file. No further operations may
 // be performed on the |config| object after calling this function. |config|
 // may be NULL.
@@ -76,3 +84,11 @@ void config_set_bool(config_t *config, const char *section, const char *key, boo
 // not already exist, this function creates them. |config|, |section|, |key|, and
 // |value| must not be NULL.
 void config_set_string(config_t *config, const char *section, const char *key, const char *value);
+
+// Writes |config| to |filename| in the format understood by |config_new|.
+// The file is written next to |filename| and renamed over it, so |filename|
+// is either left untouched or fully replaced. Values are written as-is and
+// must not contain newlines; leading and trailing whitespace is not
+// preserved across a save and reload. Returns true on success. |config| and
+// |filename| must not be NULL.
+bool config_save(const config_t *config, const char *filename);
@@ -2,29 +2,51 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <utils/Log.h>
 
 #include "config.h"
 #include "list.h"
 
+// Sections and entries start with this header so a single hash index
+// implementation can look up either one by name.
+typedef struct index_node_t {
+  char *name;
+  uint32_t hash;
+  struct index_node_t *next;
+} index_node_t;
+
+typedef struct {
+  index_node_t **buckets;
+  size_t bucket_count;  // Always a power of 2.
+  size_t count;
+} index_t;
+
 typedef struct {
-  char *key;
+  index_node_t node;  // |node.name| is the key.
   char *value;
 } entry_t;
 
 typedef struct {
-  char *name;
-  list_t *entries;
+  index_node_t node;  // |node.name| is the section name.
+  list_t *entries;    // Insertion order, for serialization.
+  index_t index;
 } section_t;
 
 struct config_t {
-  list_t *sections;
+  list_t *sections;   // Insertion order, for serialization.
+  index_t index;
 };
 
-static void config_parse(FILE *fp, config_t *config);
+static const size_t INDEX_INITIAL_BUCKETS = 8;
+static const size_t PARSE_CHUNK_SIZE = 4096;
+
+static bool config_parse(FILE *fp, config_t *config);
 
 static section_t *section_new(const char *name);
 static void section_free(void *ptr);
@@ -34,6 +56,28 @@ static entry_t *entry_new(const char *key, const char *value);
 static void entry_free(void *ptr);
 static entry_t *entry_find(const config_t *config, const char *section, const char *key);
 
+static bool index_init(index_t *index);
+static void index_cleanup(index_t *index);
+static index_node_t *index_find(const index_t *index, const char *name);
+static void index_insert(index_t *index, index_node_t *node);
+
+config_t *config_new_empty(void) {
+  config_t *config = calloc(1, sizeof(config_t));
+  if (!config) {
+    ALOGE("%s unable to allocate memory for config_t.", __func__);
+    return NULL;
+  }
+
+  config->sections = list_new(section_free);
+  if (!config->sections || !index_init(&config->index)) {
+    ALOGE("%s unable to allocate memory for config_t.", __func__);
+    config_free(config);
+    return NULL;
+  }
+
+  return config;
+}
+
 config_t *config_new(const char *filename) {
   assert(filename != NULL);
 
@@ -43,16 +87,12 @@ config_t *config_new(const char *filename) {
     return NULL;
   }
 
-  config_t *config = calloc(1, sizeof(config_t));
-  if (!config) {
-    ALOGE("%s unable to allocate memory for config_t.", __func__);
-    fclose(fp);
-    return NULL;
+  config_t *config = config_new_empty();
+  if (config && !config_parse(fp, config)) {
+    config_free(config);
+    config = NULL;
   }
 
-  config->sections = list_new(section_free);
-  config_parse(fp, config);
-
   fclose(fp);
 
   return config;
@@ -63,6 +103,7 @@ void config_free(config_t *config) {
     return;
 
   list_free(config->sections);
+  index_cleanup(&config->index);
   free(config);
 }
 
@@ -146,8 +187,10 @@ void config_set_string(config_t *config, const char *section, const char *key, c
   section_t *sec = section_find(config, section);
   if (!sec) {
     sec = section_new(section);
-    if (sec)
+    if (sec) {
       list_append(config->sections, sec);
+      index_insert(&config->index, &sec->node);
+    }
     else
     {
       ALOGE("%s: Unable to allocate memory for section", __func__);
@@ -155,17 +198,78 @@ void config_set_string(config_t *config, const char *section, const char *key, c
     }
   }
 
-  for (const list_node_t *node = list_begin(sec->entries); node != list_end(sec->entries); node = list_next(node)) {
-    entry_t *entry = list_node(node);
-    if (!strcmp(entry->key, key)) {
-      free(entry->value);
-      entry->value = strdup(value);
+  entry_t *entry = (entry_t *)index_find(&sec->index, key);
+  if (entry) {
+    char *new_value = strdup(value);
+    if (!new_value) {
+      ALOGE("%s: Unable to allocate memory for value", __func__);
       return;
     }
+    free(entry->value);
+    entry->value = new_value;
+    return;
   }
 
-  entry_t *entry = entry_new(key, value);
+  entry = entry_new(key, value);
+  if (!entry) {
+    ALOGE("%s: Unable to allocate memory for entry", __func__);
+    return;
+  }
   list_append(sec->entries, entry);
+  index_insert(&sec->index, &entry->node);
+}
+
+bool config_save(const config_t *config, const char *filename) {
+  assert(config != NULL);
+  assert(filename != NULL);
+
+  // Write a sibling file and rename it over |filename| so readers never see
+  // a partially written config.
+  static const char TEMP_SUFFIX[] = ".new";
+  size_t filename_len = strlen(filename);
+  char *temp_filename = malloc(filename_len + sizeof(TEMP_SUFFIX));
+  if (!temp_filename) {
+    ALOGE("%s unable to allocate memory for file name.", __func__);
+    return false;
+  }
+  memcpy(temp_filename, filename, filename_len);
+  memcpy(temp_filename + filename_len, TEMP_SUFFIX, sizeof(TEMP_SUFFIX));
+
+  FILE *fp = fopen(temp_filename, "wt");
+  if (!fp) {
+    ALOGE("%s unable to write file '%s': %s", __func__, temp_filename, strerror(errno));
+    free(temp_filename);
+    return false;
+  }
+
+  bool ok = true;
+  for (const list_node_t *node = list_begin(config->sections); ok && node != list_end(config->sections); node = list_next(node)) {
+    const section_t *section = list_node(node);
+    ok = fprintf(fp, "[%s]\n", section->node.name) >= 0;
+
+    for (const list_node_t *enode = list_begin(section->entries); ok && enode != list_end(section->entries); enode = list_next(enode)) {
+      const entry_t *entry = list_node(enode);
+      ok = fprintf(fp, "%s = %s\n", entry->node.name, entry->value) >= 0;
+    }
+
+    if (ok && list_next(node) != list_end(config->sections))
+      ok = fputc('\n', fp) != EOF;
+  }
+
+  ok = ok && fflush(fp) != EOF && fsync(fileno(fp)) != -1;
+  if (fclose(fp) == EOF)
+    ok = false;
+
+  if (ok && rename(temp_filename, filename) == -1)
+    ok = false;
+
+  if (!ok) {
+    ALOGE("%s unable to save file '%s': %s", __func__, filename, strerror(errno));
+    unlink(temp_filename);
+  }
+
+  free(temp_filename);
+  return ok;
 }
 
 static char *trim(char *str) {
@@ -183,42 +287,103 @@ static char *trim(char *str) {
   return str;
 }
 
-static void config_parse(FILE *fp, config_t *config) {
+// Parses one line of input. |*section| is the name of the section the line
+// belongs to and is replaced when the line starts a new section.
+static bool config_parse_line(config_t *config, char **section, char *line, int line_num) {
+  char *line_ptr = trim(line);
+
+  // Skip blank and comment lines.
+  if (*line_ptr == '\0' || *line_ptr == '#')
+    return true;
+
+  if (*line_ptr == '[') {
+    size_t len = strlen(line_ptr);
+    if (line_ptr[len - 1] != ']') {
+      ALOGD("%s unterminated section name on line %d.", __func__, line_num);
+      return true;
+    }
+    char *name = malloc(len - 1);
+    if (!name)
+      return false;
+    memcpy(name, line_ptr + 1, len - 2);
+    name[len - 2] = '\0';
+    free(*section);
+    *section = name;
+  } else {
+    char *split = strchr(line_ptr, '=');
+    if (!split) {
+      ALOGD("%s no key/value separator found on line %d.", __func__, line_num);
+      return true;
+    }
+
+    *split = '\0';
+    config_set_string(config, *section, trim(line_ptr), trim(split + 1));
+  }
+
+  return true;
+}
+
+// Reads |fp| in fixed size chunks and hands complete lines to
+// |config_parse_line|. Lines may be of any length.
+static bool config_parse(FILE *fp, config_t *config) {
   assert(fp != NULL);
   assert(config != NULL);
 
   int line_num = 0;
-  char line[1024];
-  char section[1024];
-  strcpy(section, CONFIG_DEFAULT_SECTION);
-
-  while (fgets(line, sizeof(line), fp)) {
-    char *line_ptr = trim(line);
-    ++line_num;
-
-    // Skip blank and comment lines.
-    if (*line_ptr == '\0' || *line_ptr == '#')
-      continue;
-
-    if (*line_ptr == '[') {
-      size_t len = strlen(line_ptr);
-      if (line_ptr[len - 1] != ']') {
-        ALOGD("%s unterminated section name on line %d.", __func__, line_num);
-        continue;
+  char *chunk = malloc(PARSE_CHUNK_SIZE);
+  char *line = NULL;
+  size_t line_len = 0;
+  size_t line_size = 0;
+  char *section = strdup(CONFIG_DEFAULT_SECTION);
+  bool ok = (chunk && section);
+
+  size_t read;
+  while (ok && (read = fread(chunk, 1, PARSE_CHUNK_SIZE, fp)) > 0) {
+    const char *ptr = chunk;
+    const char *chunk_end = chunk + read;
+    while (ok && ptr < chunk_end) {
+      const char *newline = memchr(ptr, '\n', chunk_end - ptr);
+      size_t span = (newline ? newline : chunk_end) - ptr;
+
+      // Keep room for the terminator.
+      if (line_len + span + 1 > line_size) {
+        size_t new_size = line_size ? line_size : 128;
+        while (new_size < line_len + span + 1)
+          new_size *= 2;
+        char *new_line = realloc(line, new_size);
+        if (!new_line) {
+          ok = false;
+          break;
+        }
+        line = new_line;
+        line_size = new_size;
       }
-      strncpy(section, line_ptr + 1, len - 2);
-      section[len - 2] = '\0';
-    } else {
-      char *split = strchr(line_ptr, '=');
-      if (!split) {
-        ALOGD("%s no key/value separator found on line %d.", __func__, line_num);
-        continue;
+      memcpy(line + line_len, ptr, span);
+      line_len += span;
+      ptr += span;
+
+      if (newline) {
+        line[line_len] = '\0';
+        ok = config_parse_line(config, &section, line, ++line_num);
+        line_len = 0;
+        ++ptr;
       }
-
-      *split = '\0';
-      config_set_string(config, section, trim(line_ptr), trim(split + 1));
     }
   }
+
+  // Last line without a trailing newline.
+  if (ok && line_len) {
+    line[line_len] = '\0';
+    ok = config_parse_line(config, &section, line, ++line_num);
+  }
+
+  if (!ok)
+    ALOGE("%s unable to allocate memory while parsing line %d.", __func__, line_num);
+
+  free(section);
+  free(line);
+  free(chunk);
+  return ok;
 }
 
 static section_t *section_new(const char *name) {
@@ -226,8 +391,12 @@ static section_t *section_new(const char *name) {
   if (!section)
     return NULL;
 
-  section->name = strdup(name);
+  section->node.name = strdup(name);
   section->entries = list_new(entry_free);
+  if (!section->node.name || !section->entries || !index_init(&section->index)) {
+    section_free(section);
+    return NULL;
+  }
   return section;
 }
 
@@ -236,18 +405,14 @@ static void section_free(void *ptr) {
     return;
 
   section_t *section = ptr;
-  free(section->name);
+  free(section->node.name);
   list_free(section->entries);
+  index_cleanup(&section->index);
+  free(section);
 }
 
 static section_t *section_find(const config_t *config, const char *section) {
-  for (const list_node_t *node = list_begin(config->sections); node != list_end(config->sections); node = list_next(node)) {
-    section_t *sec = list_node(node);
-    if (!strcmp(sec->name, section))
-      return sec;
-  }
-
-  return NULL;
+  return (section_t *)index_find(&config->index, section);
 }
 
 static entry_t *entry_new(const char *key, const char *value) {
@@ -255,8 +420,12 @@ static entry_t *entry_new(const char *key, const char *value) {
   if (!entry)
     return NULL;
 
-  entry->key = strdup(key);
+  entry->node.name = strdup(key);
   entry->value = strdup(value);
+  if (!entry->node.name || !entry->value) {
+    entry_free(entry);
+    return NULL;
+  }
   return entry;
 }
 
@@ -265,8 +434,9 @@ static void entry_free(void *ptr) {
     return;
 
   entry_t *entry = ptr;
-  free(entry->key);
+  free(entry->node.name);
   free(entry->value);
+  free(entry);
 }
 
 static entry_t *entry_find(const config_t *config, const char *section, const char *key) {
@@ -274,11 +444,71 @@ static entry_t *entry_find(const config_t *config, const char *section, const ch
   if (!sec)
     return NULL;
 
-  for (const list_node_t *node = list_begin(sec->entries); node != list_end(sec->entries); node = list_next(node)) {
-    entry_t *entry = list_node(node);
-    if (!strcmp(entry->key, key))
-      return entry;
-  }
+  return (entry_t *)index_find(&sec->index, key);
+}
+
+// FNV-1a.
+static uint32_t index_hash(const char *name) {
+  uint32_t hash = 2166136261u;
+  for (const unsigned char *ptr = (const unsigned char *)name; *ptr; ++ptr)
+    hash = (hash ^ *ptr) * 16777619u;
+  return hash;
+}
+
+static bool index_init(index_t *index) {
+  index->buckets = calloc(INDEX_INITIAL_BUCKETS, sizeof(index_node_t *));
+  index->bucket_count = index->buckets ? INDEX_INITIAL_BUCKETS : 0;
+  index->count = 0;
+  return (index->buckets != NULL);
+}
+
+// The nodes themselves are owned by the section and entry lists.
+static void index_cleanup(index_t *index) {
+  free(index->buckets);
+  index->buckets = NULL;
+  index->bucket_count = 0;
+  index->count = 0;
+}
+
+static index_node_t *index_find(const index_t *index, const char *name) {
+  if (!index->bucket_count)
+    return NULL;
+
+  uint32_t hash = index_hash(name);
+  for (index_node_t *node = index->buckets[hash & (index->bucket_count - 1)]; node; node = node->next)
+    if (node->hash == hash && !strcmp(node->name, name))
+      return node;
 
   return NULL;
 }
+
+static void index_insert(index_t *index, index_node_t *node) {
+  // Keep the average chain length at or below one. If the table can't grow
+  // lookups get slower but stay correct.
+  if (index->count >= index->bucket_count) {
+    size_t new_count = index->bucket_count ? index->bucket_count * 2 : INDEX_INITIAL_BUCKETS;
+    index_node_t **new_buckets = calloc(new_count, sizeof(index_node_t *));
+    if (new_buckets) {
+      for (size_t i = 0; i < index->bucket_count; ++i) {
+        index_node_t *cur = index->buckets[i];
+        while (cur) {
+          index_node_t *next = cur->next;
+          cur->next = new_buckets[cur->hash & (new_count - 1)];
+          new_buckets[cur->hash & (new_count - 1)] = cur;
+          cur = next;
+        }
+      }
+      free(index->buckets);
+      index->buckets = new_buckets;
+      index->bucket_count = new_count;
+    }
+  }
+
+  if (!index->bucket_count)
+    return;
+
+  node->hash = index_hash(node->name);
+  node->next = index->buckets[node->hash & (index->bucket_count - 1)];
+  index->buckets[node->hash & (index->bucket_count - 1)] = node;
+  ++index->count;
+}
@@ -1,10 +1,17 @@
 #include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
 
 extern "C" {
 #include "config.h"
 }
 
 static const char CONFIG_FILE[] = "/data/local/tmp/config_test.conf";
+static const char CONFIG_SAVE_FILE[] = "/data/local/tmp/config_test_save.conf";
+static const char CONFIG_BENCHMARK_FILE[] = "/data/local/tmp/config_test_benchmark.conf";
+static const int BENCHMARK_SECTIONS = 500;
+static const int BENCHMARK_KEYS = 20;
 static const char CONFIG_FILE_CONTENT[] =
 "                                                                                    \n\
 first_key=value                                                                      \n\
@@ -111,3 +118,123 @@ TEST_F(ConfigTest, config_get_int_default) {
   EXPECT_EQ(config_get_int(config, "DID", "primaryRecord", 123), 123);
   config_free(config);
 }
+
+static uint64_t now_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+TEST_F(ConfigTest, config_new_empty) {
+  config_t *config = config_new_empty();
+  EXPECT_TRUE(config != NULL);
+  EXPECT_FALSE(config_has_section(config, CONFIG_DEFAULT_SECTION));
+  config_set_int(config, "DID", "version", 7);
+  EXPECT_EQ(config_get_int(config, "DID", "version", 0), 7);
+  config_free(config);
+}
+
+TEST_F(ConfigTest, config_overwrite_value) {
+  config_t *config = config_new(CONFIG_FILE);
+  config_set_string(config, "DID", "version", "0x2000");
+  EXPECT_EQ(config_get_int(config, "DID", "version", 0), 0x2000);
+  config_free(config);
+}
+
+TEST_F(ConfigTest, config_long_line) {
+  char value[4096];
+  memset(value, 'a', sizeof(value) - 1);
+  value[sizeof(value) - 1] = '\0';
+
+  FILE *fp = fopen(CONFIG_SAVE_FILE, "wt");
+  fprintf(fp, "[Long]\nkey = %s\nlast_key = no trailing newline", value);
+  fclose(fp);
+
+  config_t *config = config_new(CONFIG_SAVE_FILE);
+  EXPECT_STREQ(config_get_string(config, "Long", "key", ""), value);
+  EXPECT_STREQ(config_get_string(config, "Long", "last_key", ""), "no trailing newline");
+  config_free(config);
+}
+
+TEST_F(ConfigTest, config_save_round_trip) {
+  config_t *config = config_new(CONFIG_FILE);
+  config_set_string(config, "New", "b", "second");
+  config_set_string(config, "New", "a", "first");
+  EXPECT_TRUE(config_save(config, CONFIG_SAVE_FILE));
+  config_free(config);
+
+  config = config_new(CONFIG_SAVE_FILE);
+  EXPECT_STREQ(config_get_string(config, CONFIG_DEFAULT_SECTION, "first_key", ""), "value");
+  EXPECT_EQ(config_get_int(config, "DID", "recordNumber", 0), 1);
+  EXPECT_TRUE(config_get_bool(config, "DID", "primaryRecord", false));
+  EXPECT_EQ(config_get_int(config, "DID", "version", 0), 0x1436);
+  EXPECT_STREQ(config_get_string(config, "New", "a", ""), "first");
+  EXPECT_STREQ(config_get_string(config, "New", "b", ""), "second");
+  config_free(config);
+
+  // Sections and keys are written in the order they were first seen.
+  FILE *fp = fopen(CONFIG_SAVE_FILE, "rt");
+  char contents[1024] = { 0 };
+  fread(contents, 1, sizeof(contents) - 1, fp);
+  fclose(fp);
+  const char *global = strstr(contents, "[Global]");
+  const char *did = strstr(contents, "[DID]");
+  const char *b = strstr(contents, "b = second");
+  const char *a = strstr(contents, "a = first");
+  EXPECT_TRUE(global && did && a && b);
+  EXPECT_LT(global, did);
+  EXPECT_LT(b, a);
+}
+
+TEST_F(ConfigTest, config_save_bad_path) {
+  config_t *config = config_new(CONFIG_FILE);
+  EXPECT_FALSE(config_save(config, "/meow/meow.conf"));
+  config_free(config);
+}
+
+static void write_benchmark_file() {
+  FILE *fp = fopen(CONFIG_BENCHMARK_FILE, "wt");
+  for (int i = 0; i < BENCHMARK_SECTIONS; ++i) {
+    fprintf(fp, "[00:22:5F:00:%02X:%02X]\n", (i >> 8) & 0xff, i & 0xff);
+    for (int j = 0; j < BENCHMARK_KEYS; ++j)
+      fprintf(fp, "Key%d = %d\n", j, i * BENCHMARK_KEYS + j);
+  }
+  fclose(fp);
+}
+
+TEST_F(ConfigTest, config_parse_benchmark) {
+  write_benchmark_file();
+
+  uint64_t start = now_us();
+  config_t *config = config_new(CONFIG_BENCHMARK_FILE);
+  uint64_t elapsed = now_us() - start;
+
+  EXPECT_TRUE(config != NULL);
+  EXPECT_EQ(config_get_int(config, "00:22:5F:00:01:F3", "Key19", 0), (BENCHMARK_SECTIONS - 1) * BENCHMARK_KEYS + 19);
+  printf("parsed %d sections x %d keys in %llu us\n", BENCHMARK_SECTIONS, BENCHMARK_KEYS,
+         (unsigned long long)elapsed);
+  config_free(config);
+}
+
+TEST_F(ConfigTest, config_lookup_benchmark) {
+  write_benchmark_file();
+  config_t *config = config_new(CONFIG_BENCHMARK_FILE);
+
+  char section[32];
+  char key[16];
+  int found = 0;
+  uint64_t start = now_us();
+  for (int i = 0; i < BENCHMARK_SECTIONS; ++i) {
+    snprintf(section, sizeof(section), "00:22:5F:00:%02X:%02X", (i >> 8) & 0xff, i & 0xff);
+    for (int j = 0; j < BENCHMARK_KEYS; ++j) {
+      snprintf(key, sizeof(key), "Key%d", j);
+      if (config_get_int(config, section, key, -1) == i * BENCHMARK_KEYS + j)
+        ++found;
+    }
+  }
+  uint64_t elapsed = now_us() - start;
+
+  EXPECT_EQ(found, BENCHMARK_SECTIONS * BENCHMARK_KEYS);
+  printf("%d lookups in %llu us\n", found, (unsigned long long)elapsed);
+  config_free(config);
+}
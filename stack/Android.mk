@@ -128,6 +128,7 @@ LOCAL_SRC_FILES:= \
     ./sdp/sdp_utils.c \
     ./sdp/sdp_api.c \
     ./sdp/sdp_discovery.c \
+    ./sdp/sdp_parse.c \
     ./pan/pan_main.c \
     ./srvc/srvc_battery.c \
     ./srvc/srvc_battery_int.h \
@@ -137,6 +138,7 @@ LOCAL_SRC_FILES:= \
     ./srvc/srvc_eng_int.h \
     ./pan/pan_api.c \
     ./pan/pan_utils.c \
+    ./btu/btu_data.c \
     ./btu/btu_hcif.c \
     ./btu/btu_init.c \
     ./btu/btu_task.c \
@@ -145,6 +147,8 @@ LOCAL_SRC_FILES:= \
     ./l2cap/l2c_main.c \
     ./l2cap/l2c_api.c \
     ./l2cap/l2c_utils.c \
+    ./l2cap/l2c_drr.c \
+    ./l2cap/l2c_adapt.c \
     ./l2cap/l2c_csm.c \
     ./l2cap/l2c_link.c \
     ./l2cap/l2c_ble.c \
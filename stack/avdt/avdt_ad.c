@@ -304,6 +304,45 @@ UINT8 avdt_ad_tc_tbl_to_idx(tAVDT_TC_TBL *p_tbl)
     return (UINT8) (p_tbl - avdt_cb.ad.tc_tbl);
 }
 
+#if (BTU_DATA_INCLUDED == TRUE)
+/*******************************************************************************
+**
+** Function         avdt_ad_fast_data_ind
+**
+** Description      L2CAP receive callback of a media channel, on the BTU data
+**                  thread. Media of a stream in the streaming state, without
+**                  multiplexing, is passed up as avdt_scb_hdl_pkt does on
+**                  BTU. Anything else, e.g. media that overtook a start
+**                  response BTU has yet to process, is left to BTU and the
+**                  stream state machine. The media after it is then kept
+**                  behind it on BTU, and comes here again once BTU has
+**                  handled all of it.
+**
+** Returns          TRUE if the packet was taken
+**
+*******************************************************************************/
+static BOOLEAN avdt_ad_fast_data_ind(UINT16 lcid, BT_HDR *p_buf)
+{
+    tAVDT_TC_TBL    *p_tbl;
+    tAVDT_SCB       *p_scb;
+    tAVDT_SCB_EVT   evt;
+
+    if ((p_tbl = avdt_ad_tc_tbl_by_lcid(lcid)) == NULL || p_tbl->state != AVDT_AD_ST_OPEN
+        || p_tbl->tcid == 0 || avdt_ad_tcid_to_type(p_tbl->tcid) != AVDT_CHAN_MEDIA)
+        return FALSE;
+
+    p_scb = avdt_scb_by_hdl(avdt_cb.ad.rt_tbl[p_tbl->ccb_idx][p_tbl->tcid].scb_hdl);
+    if (p_scb == NULL || p_scb->state != AVDT_SCB_STREAM_ST
+        || (p_scb->curr_cfg.psc_mask & AVDT_PSC_MUX))
+        return FALSE;
+
+    p_buf->layer_specific = AVDT_CHAN_MEDIA;
+    evt.p_pkt = p_buf;
+    avdt_scb_hdl_pkt(p_scb, &evt);
+    return TRUE;
+}
+#endif
+
 /*******************************************************************************
 **
 ** Function         avdt_ad_tc_close_ind
@@ -325,6 +364,12 @@ void avdt_ad_tc_close_ind(tAVDT_TC_TBL *p_tbl, UINT16 reason)
     tAVDT_SCB_TC_CLOSE  close;
     UNUSED(reason);
 
+#if (BTU_DATA_INCLUDED == TRUE)
+    /* get media off the data thread before the tables it reads change */
+    if (p_tbl->tcid != 0 && avdt_ad_tcid_to_type(p_tbl->tcid) == AVDT_CHAN_MEDIA)
+        L2CA_SetFastDataPath(avdt_cb.ad.rt_tbl[p_tbl->ccb_idx][p_tbl->tcid].lcid, NULL);
+#endif
+
     close.old_tc_state = p_tbl->state;
     /* clear avdt_ad_tc_tbl entry */
     p_tbl->state = AVDT_AD_ST_UNUSED;
@@ -403,6 +448,11 @@ void avdt_ad_tc_open_ind(tAVDT_TC_TBL *p_tbl)
             open.lcid = avdt_cb.ad.rt_tbl[p_tbl->ccb_idx][p_tbl->tcid].lcid;
             open.hdr.err_code = avdt_ad_tcid_to_type(p_tbl->tcid);
             avdt_scb_event(p_scb, AVDT_SCB_TC_OPEN_EVT, (tAVDT_SCB_EVT *) &open);
+
+#if (BTU_DATA_INCLUDED == TRUE)
+            if (open.hdr.err_code == AVDT_CHAN_MEDIA)
+                L2CA_SetFastDataPath(open.lcid, avdt_ad_fast_data_ind);
+#endif
         }
     }
 }
@@ -152,6 +152,19 @@ typedef struct
     BD_ADDR           rcvd_mcast_filter_start[BNEP_MAX_MULTI_FILTERS];
     BD_ADDR           rcvd_mcast_filter_end[BNEP_MAX_MULTI_FILTERS];
 
+    /* Peer filters compiled into sorted, non-overlapping ranges for lookup */
+#define BNEP_PROT_BIT_IPV4          0x01
+#define BNEP_PROT_BIT_ARP           0x02
+#define BNEP_PROT_BIT_IPV6          0x04
+    UINT8             rcvd_prot_common;     /* Common EtherTypes passed by the filters */
+    UINT16            rcvd_num_prot_ranges;
+    UINT16            rcvd_prot_range_start[BNEP_MAX_PROT_FILTERS];
+    UINT16            rcvd_prot_range_end[BNEP_MAX_PROT_FILTERS];
+
+    UINT16            rcvd_num_mcast_ranges;
+    BD_ADDR           rcvd_mcast_range_start[BNEP_MAX_MULTI_FILTERS];
+    BD_ADDR           rcvd_mcast_range_end[BNEP_MAX_MULTI_FILTERS];
+
     UINT16            bad_pkts_rcvd;
     UINT8             re_transmits;
     UINT16            handle;
@@ -240,6 +253,8 @@ extern void        bnep_sec_check_complete (BD_ADDR bd_addr, tBT_TRANSPORT trasn
                                                     void *p_ref_data, UINT8 result);
 extern tBNEP_RESULT bnep_is_packet_allowed (tBNEP_CONN *p_bcb, BD_ADDR p_dest_addr, UINT16 protocol,
                                                     BOOLEAN fw_ext_present, UINT8 *p_data);
+extern void        bnepu_compile_prot_filters (tBNEP_CONN *p_bcb);
+extern void        bnepu_compile_mcast_filters (tBNEP_CONN *p_bcb);
 extern UINT32      bnep_get_uuid32 (tBT_UUID *src_uuid);
 extern void        bnep_dump_status (void);
 
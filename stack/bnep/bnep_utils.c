@@ -967,6 +967,7 @@ void bnepu_process_peer_filter_set (tBNEP_CONN *p_bcb, UINT8 *p_filters, UINT16
         p_bcb->rcvd_prot_filter_start[xx] = start;
         p_bcb->rcvd_prot_filter_end[xx]   = end;
     }
+    bnepu_compile_prot_filters (p_bcb);
 
     bnepu_send_peer_filter_rsp (p_bcb, resp_code);
 #else
@@ -1154,6 +1155,8 @@ void bnepu_process_peer_multicast_filter_set (tBNEP_CONN *p_bcb, UINT8 *p_filter
         }
     }
 
+    bnepu_compile_mcast_filters (p_bcb);
+
     BNEP_TRACE_EVENT ("BNEP multicast filters %d", p_bcb->rcvd_mcast_filters);
     bnepu_send_peer_multicast_filter_rsp (p_bcb, resp_code);
 
@@ -1307,12 +1310,162 @@ void bnep_sec_check_complete (BD_ADDR bd_addr, tBT_TRANSPORT trasnport,
 }
 
 
+/*******************************************************************************
+**
+** Function         bnepu_common_prot_bit
+**
+** Description      This function maps the EtherTypes seen on almost every
+**                  packet to a bit of the compiled protocol filter bitmap
+**
+** Returns          the bit, or 0 if the protocol is not a common one
+**
+*******************************************************************************/
+static UINT8 bnepu_common_prot_bit (UINT16 protocol)
+{
+    switch (protocol)
+    {
+    case 0x0800:
+        return BNEP_PROT_BIT_IPV4;
+    case 0x0806:
+        return BNEP_PROT_BIT_ARP;
+    case 0x86DD:
+        return BNEP_PROT_BIT_IPV6;
+    default:
+        return 0;
+    }
+}
+
+
+/*******************************************************************************
+**
+** Function         bnepu_compile_prot_filters
+**
+** Description      This function compiles the protocol filters received from
+**                  the peer into sorted, non-overlapping ranges and a bitmap
+**                  of the common EtherTypes they pass
+**
+** Returns          void
+**
+*******************************************************************************/
+void bnepu_compile_prot_filters (tBNEP_CONN *p_bcb)
+{
+    UINT16      xx, yy, num = 0;
+    UINT16      start, end;
+
+    for (xx = 0; xx < p_bcb->rcvd_num_filters; xx++)
+    {
+        start = p_bcb->rcvd_prot_filter_start[xx];
+        end   = p_bcb->rcvd_prot_filter_end[xx];
+
+        /* Insertion sort on the range start */
+        for (yy = num; (yy > 0) && (p_bcb->rcvd_prot_range_start[yy - 1] > start); yy--)
+        {
+            p_bcb->rcvd_prot_range_start[yy] = p_bcb->rcvd_prot_range_start[yy - 1];
+            p_bcb->rcvd_prot_range_end[yy]   = p_bcb->rcvd_prot_range_end[yy - 1];
+        }
+        p_bcb->rcvd_prot_range_start[yy] = start;
+        p_bcb->rcvd_prot_range_end[yy]   = end;
+        num++;
+    }
+
+    /* Merge overlapping and adjacent ranges */
+    p_bcb->rcvd_num_prot_ranges = 0;
+    for (xx = 0; xx < num; xx++)
+    {
+        yy = p_bcb->rcvd_num_prot_ranges;
+        if ((yy > 0) &&
+            ((UINT32)p_bcb->rcvd_prot_range_start[xx] <= (UINT32)p_bcb->rcvd_prot_range_end[yy - 1] + 1))
+        {
+            if (p_bcb->rcvd_prot_range_end[xx] > p_bcb->rcvd_prot_range_end[yy - 1])
+                p_bcb->rcvd_prot_range_end[yy - 1] = p_bcb->rcvd_prot_range_end[xx];
+            continue;
+        }
+        p_bcb->rcvd_prot_range_start[yy] = p_bcb->rcvd_prot_range_start[xx];
+        p_bcb->rcvd_prot_range_end[yy]   = p_bcb->rcvd_prot_range_end[xx];
+        p_bcb->rcvd_num_prot_ranges++;
+    }
+
+    p_bcb->rcvd_prot_common = 0;
+    for (xx = 0; xx < p_bcb->rcvd_num_prot_ranges; xx++)
+    {
+        start = p_bcb->rcvd_prot_range_start[xx];
+        end   = p_bcb->rcvd_prot_range_end[xx];
+
+        if ((start <= 0x0800) && (0x0800 <= end))
+            p_bcb->rcvd_prot_common |= BNEP_PROT_BIT_IPV4;
+        if ((start <= 0x0806) && (0x0806 <= end))
+            p_bcb->rcvd_prot_common |= BNEP_PROT_BIT_ARP;
+        if ((start <= 0x86DD) && (0x86DD <= end))
+            p_bcb->rcvd_prot_common |= BNEP_PROT_BIT_IPV6;
+    }
+
+    BNEP_TRACE_DEBUG ("BNEP compiled %d protocol filters into %d ranges, common 0x%x",
+                      p_bcb->rcvd_num_filters, p_bcb->rcvd_num_prot_ranges, p_bcb->rcvd_prot_common);
+}
+
+
+/*******************************************************************************
+**
+** Function         bnepu_compile_mcast_filters
+**
+** Description      This function compiles the multicast filters received from
+**                  the peer into sorted, non-overlapping address ranges
+**
+** Returns          void
+**
+*******************************************************************************/
+void bnepu_compile_mcast_filters (tBNEP_CONN *p_bcb)
+{
+    UINT16      xx, yy, num = 0;
+
+    p_bcb->rcvd_num_mcast_ranges = 0;
+    if (p_bcb->rcvd_mcast_filters == 0xFFFF)
+        return;
+
+    for (xx = 0; xx < p_bcb->rcvd_mcast_filters; xx++)
+    {
+        /* Insertion sort on the range start */
+        for (yy = num; (yy > 0) &&
+             (memcmp (p_bcb->rcvd_mcast_range_start[yy - 1], p_bcb->rcvd_mcast_filter_start[xx], BD_ADDR_LEN) > 0);
+             yy--)
+        {
+            memcpy (p_bcb->rcvd_mcast_range_start[yy], p_bcb->rcvd_mcast_range_start[yy - 1], BD_ADDR_LEN);
+            memcpy (p_bcb->rcvd_mcast_range_end[yy], p_bcb->rcvd_mcast_range_end[yy - 1], BD_ADDR_LEN);
+        }
+        memcpy (p_bcb->rcvd_mcast_range_start[yy], p_bcb->rcvd_mcast_filter_start[xx], BD_ADDR_LEN);
+        memcpy (p_bcb->rcvd_mcast_range_end[yy], p_bcb->rcvd_mcast_filter_end[xx], BD_ADDR_LEN);
+        num++;
+    }
+
+    /* Merge overlapping ranges */
+    for (xx = 0; xx < num; xx++)
+    {
+        yy = p_bcb->rcvd_num_mcast_ranges;
+        if ((yy > 0) &&
+            (memcmp (p_bcb->rcvd_mcast_range_start[xx], p_bcb->rcvd_mcast_range_end[yy - 1], BD_ADDR_LEN) <= 0))
+        {
+            if (memcmp (p_bcb->rcvd_mcast_range_end[xx], p_bcb->rcvd_mcast_range_end[yy - 1], BD_ADDR_LEN) > 0)
+                memcpy (p_bcb->rcvd_mcast_range_end[yy - 1], p_bcb->rcvd_mcast_range_end[xx], BD_ADDR_LEN);
+            continue;
+        }
+        if (yy != xx)
+        {
+            memcpy (p_bcb->rcvd_mcast_range_start[yy], p_bcb->rcvd_mcast_range_start[xx], BD_ADDR_LEN);
+            memcpy (p_bcb->rcvd_mcast_range_end[yy], p_bcb->rcvd_mcast_range_end[xx], BD_ADDR_LEN);
+        }
+        p_bcb->rcvd_num_mcast_ranges++;
+    }
+}
+
+
 /*******************************************************************************
 **
 ** Function         bnep_is_packet_allowed
 **
 ** Description      This function verifies whether the protocol passes through
-**                  the protocol filters set by the peer
+**                  the protocol filters set by the peer. Common EtherTypes are
+**                  checked against a bitmap, others by a binary search of the
+**                  compiled ranges.
 **
 ** Returns          BNEP_SUCCESS          - if the protocol is allowed
 **                  BNEP_IGNORE_CMD       - if the protocol is filtered out
@@ -1327,7 +1480,9 @@ tBNEP_RESULT bnep_is_packet_allowed (tBNEP_CONN *p_bcb,
 #if (defined (BNEP_SUPPORTS_PROT_FILTERS) && BNEP_SUPPORTS_PROT_FILTERS == TRUE)
     if (p_bcb->rcvd_num_filters)
     {
-        UINT16          i, proto;
+        UINT16          proto;
+        UINT8           bit;
+        BOOLEAN         allowed = FALSE;
 
         /* Findout the actual protocol to check for the filtering */
         proto = protocol;
@@ -1349,14 +1504,29 @@ tBNEP_RESULT bnep_is_packet_allowed (tBNEP_CONN *p_bcb,
             BE_STREAM_TO_UINT16 (proto, p_data);
         }
 
-        for (i=0; i<p_bcb->rcvd_num_filters; i++)
+        bit = bnepu_common_prot_bit (proto);
+        if (bit)
+            allowed = (p_bcb->rcvd_prot_common & bit) ? TRUE : FALSE;
+        else
         {
-            if ((p_bcb->rcvd_prot_filter_start[i] <= proto) &&
-                (proto <= p_bcb->rcvd_prot_filter_end[i]))
-                break;
+            INT16       lo = 0, hi = (INT16)p_bcb->rcvd_num_prot_ranges - 1, mid;
+
+            while (lo <= hi)
+            {
+                mid = (lo + hi) / 2;
+                if (proto < p_bcb->rcvd_prot_range_start[mid])
+                    hi = mid - 1;
+                else if (proto > p_bcb->rcvd_prot_range_end[mid])
+                    lo = mid + 1;
+                else
+                {
+                    allowed = TRUE;
+                    break;
+                }
+            }
         }
 
-        if (i == p_bcb->rcvd_num_filters)
+        if (!allowed)
         {
             BNEP_TRACE_DEBUG ("Ignoring protocol 0x%x in BNEP data write", proto);
             return BNEP_IGNORE_CMD;
@@ -1369,17 +1539,26 @@ tBNEP_RESULT bnep_is_packet_allowed (tBNEP_CONN *p_bcb,
     if ((p_dest_addr[0] & 0x01) &&
         p_bcb->rcvd_mcast_filters)
     {
-        UINT16          i;
+        BOOLEAN         allowed = FALSE;
 
         /* Check if every multicast should be filtered */
         if (p_bcb->rcvd_mcast_filters != 0xFFFF)
         {
+            INT16       lo = 0, hi = (INT16)p_bcb->rcvd_num_mcast_ranges - 1, mid;
+
             /* Check if the address is mentioned in the filter range */
-            for (i = 0; i < p_bcb->rcvd_mcast_filters; i++)
+            while (lo <= hi)
             {
-                if ((memcmp (p_bcb->rcvd_mcast_filter_start[i], p_dest_addr, BD_ADDR_LEN) <= 0) &&
-                    (memcmp (p_bcb->rcvd_mcast_filter_end[i], p_dest_addr, BD_ADDR_LEN) >= 0))
+                mid = (lo + hi) / 2;
+                if (memcmp (p_dest_addr, p_bcb->rcvd_mcast_range_start[mid], BD_ADDR_LEN) < 0)
+                    hi = mid - 1;
+                else if (memcmp (p_dest_addr, p_bcb->rcvd_mcast_range_end[mid], BD_ADDR_LEN) > 0)
+                    lo = mid + 1;
+                else
+                {
+                    allowed = TRUE;
                     break;
+                }
             }
         }
 
@@ -1387,7 +1566,7 @@ tBNEP_RESULT bnep_is_packet_allowed (tBNEP_CONN *p_bcb,
         ** If every multicast should be filtered or the address is not in the filter range
         ** drop the packet
         */
-        if ((p_bcb->rcvd_mcast_filters == 0xFFFF) || (i == p_bcb->rcvd_mcast_filters))
+        if (!allowed)
         {
             BNEP_TRACE_DEBUG ("Ignoring multicast address %x.%x.%x.%x.%x.%x in BNEP data write",
                 p_dest_addr[0], p_dest_addr[1], p_dest_addr[2],
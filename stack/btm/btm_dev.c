@@ -162,6 +162,41 @@ BOOLEAN BTM_SecAddDevice (BD_ADDR bd_addr, DEV_CLASS dev_class, BD_NAME bd_name,
     return(TRUE);
 }
 
+/*******************************************************************************
+**
+** Function         BTM_SecAddLinkKey
+**
+** Description      Restore the stored link key of a bonded device whose
+**                  record was not added at startup. Unlike BTM_SecAddDevice
+**                  the rest of the record (name, features, IO caps) is left
+**                  as learned on the current connection.
+**
+** Returns          TRUE if added OK, else FALSE
+**
+*******************************************************************************/
+BOOLEAN BTM_SecAddLinkKey (BD_ADDR bd_addr, LINK_KEY link_key, UINT8 key_type, UINT8 pin_len)
+{
+    tBTM_SEC_DEV_REC  *p_dev_rec = btm_find_or_alloc_dev (bd_addr);
+
+    BTM_TRACE_API("%s, link key type:%x", __FUNCTION__, key_type);
+    if (!p_dev_rec)
+        return(FALSE);
+
+    p_dev_rec->sec_flags |= BTM_SEC_LINK_KEY_KNOWN;
+    memcpy (p_dev_rec->link_key, link_key, LINK_KEY_LEN);
+    p_dev_rec->link_key_type = key_type;
+    p_dev_rec->pin_key_len = pin_len;
+
+#if defined(BTIF_MIXED_MODE_INCLUDED) && (BTIF_MIXED_MODE_INCLUDED == TRUE)
+    if (key_type  < BTM_MAX_PRE_SM4_LKEY_TYPE)
+        p_dev_rec->sm4 = BTM_SM4_KNOWN;
+    else
+        p_dev_rec->sm4 = BTM_SM4_TRUE;
+#endif
+
+    return(TRUE);
+}
+
 
 /*******************************************************************************
 **
@@ -270,6 +270,35 @@ void btm_sco_check_send_pkts (UINT16 sco_inx)
 }
 #endif /* BTM_SCO_HCI_INCLUDED == TRUE */
 
+#if (BTM_SCO_HCI_INCLUDED == TRUE) && (BTU_DATA_INCLUDED == TRUE)
+/*******************************************************************************
+**
+** Function         btm_sco_fast_data_ind
+**
+** Description      Route received SCO data on the BTU data thread, the way
+**                  btm_route_sco_data does on BTU.
+**
+** Returns          TRUE if the data callback took the buffer
+**
+*******************************************************************************/
+static BOOLEAN btm_sco_fast_data_ind (UINT16 cid, BT_HDR *p_msg)
+{
+    tBTM_SCO_DATA_CB *p_data_cb = btm_cb.sco_cb.p_data_cb;
+    UINT8            *p = (UINT8 *)(p_msg + 1) + p_msg->offset;
+    UINT16           sco_inx, handle;
+    UNUSED(cid);
+
+    STREAM_TO_UINT16 (handle, p);
+
+    if (!p_data_cb
+     || (sco_inx = btm_find_scb_by_handle (HCID_GET_HANDLE (handle))) == BTM_MAX_SCO_LINKS)
+        return FALSE;
+
+    (*p_data_cb)(sco_inx, p_msg, (tBTM_SCO_DATA_FLAG) HCID_GET_EVENT (handle));
+    return TRUE;
+}
+#endif
+
 /*******************************************************************************
 **
 ** Function         btm_route_sco_data
@@ -989,6 +1018,11 @@ void btm_sco_connected (UINT8 hci_status, BD_ADDR bda, UINT16 hci_handle,
             p->state = SCO_ST_CONNECTED;
             p->hci_handle = hci_handle;
 
+#if (BTM_SCO_HCI_INCLUDED == TRUE) && (BTU_DATA_INCLUDED == TRUE)
+            /* SCO data skips BTU when the data thread runs */
+            btu_data_route_add (hci_handle, BTU_DATA_SCO_CID, btm_sco_fast_data_ind);
+#endif
+
             if (!btm_cb.sco_cb.esco_supported)
             {
                 p->esco.data.link_type = BTM_LINK_TYPE_SCO;
@@ -1149,6 +1183,9 @@ void btm_sco_removed (UINT16 hci_handle, UINT8 reason)
     {
         if ((p->state != SCO_ST_UNUSED) && (p->state != SCO_ST_LISTENING) && (p->hci_handle == hci_handle))
         {
+#if (BTM_SCO_HCI_INCLUDED == TRUE) && (BTU_DATA_INCLUDED == TRUE)
+            btu_data_route_remove (hci_handle, BTU_DATA_SCO_CID);
+#endif
             btm_sco_flush_sco_data(xx);
 
             p->state = SCO_ST_UNUSED;
@@ -1189,6 +1226,10 @@ void btm_sco_acl_removed (BD_ADDR bda)
         {
             if ((!bda) || (!memcmp (p->esco.data.bd_addr, bda, BD_ADDR_LEN) && p->rem_bd_known))
             {
+#if (BTM_SCO_HCI_INCLUDED == TRUE) && (BTU_DATA_INCLUDED == TRUE)
+                if (p->state == SCO_ST_CONNECTED)
+                    btu_data_route_remove (p->hci_handle, BTU_DATA_SCO_CID);
+#endif
                 btm_sco_flush_sco_data(xx);
 
                 p->state = SCO_ST_UNUSED;
@@ -0,0 +1,426 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  The BTU data thread. It takes the received data of a few channels off
+ *  BTU, so that a slow control plane handler on BTU does not delay it.
+ *
+ *  BTU registers a route for an L2CAP channel (L2CA_SetFastDataPath) or an
+ *  SCO link. The HCI reader checks each received packet against the routes
+ *  and sends the packets of routed channels to the mailbox of this thread,
+ *  everything else to BTU as before. The data thread strips the HCI and
+ *  L2CAP headers and calls the route callback.
+ *
+ *  The routes are the only state the two threads share, and the handoff
+ *  points are:
+ *  - the data thread calls a callback only with btu_data_lock held, and
+ *    btu_data_route_remove takes that lock. Once the remove returns, the
+ *    callback of the route is not running and will not be called again,
+ *    so BTU may tear down what the callback uses.
+ *  - a packet whose route is gone by the time the data thread sees it, or
+ *    whose callback declines it, goes to BTU unchanged, and L2CAP or BTM
+ *    handle it there as if it had never left.
+ *  - a route keeps its packets in order. Once it has handed one back to
+ *    BTU, its later packets follow the same way until BTU has handled all
+ *    of them (btu_data_drained), and only then does the callback get
+ *    packets again. Removing a route is meant for taking the channel down;
+ *    packets that come after it go to BTU directly.
+ *
+ *  Callbacks run on the data thread. They may read, but must not change,
+ *  l2cb or btm_cb, and must not call back into this file.
+ *
+ ******************************************************************************/
+
+#include <pthread.h>
+#include <string.h>
+#include <sys/prctl.h>
+
+#include "bt_target.h"
+#include "gki.h"
+#include "bt_types.h"
+#include "hcidefs.h"
+#include "hcimsgs.h"
+#include "l2cdefs.h"
+#include "btu.h"
+#include "bt_utils.h"
+#include "bt_trace.h"
+
+#if (BTU_DATA_INCLUDED == TRUE)
+
+/* A used route: the HCI handle and the CID, with a bit set so that handle 0
+** of an SCO link is not mistaken for a free slot */
+#define BTU_DATA_KEY(handle, cid)   (0x80000000 | ((UINT32)(handle) << 16) | (cid))
+
+typedef struct
+{
+    UINT32              key;            /* BTU_DATA_KEY, 0 if free */
+    tBTU_DATA_CBACK     *p_cback;
+    UINT16              pending;        /* handed back and not yet handled by BTU */
+} tBTU_DATA_ROUTE;
+
+typedef struct
+{
+    tBTU_DATA_ROUTE     route[BTU_DATA_MAX_ROUTES];
+    UINT8               num_routes;     /* written under lock, read by the HCI reader */
+    BOOLEAN             running;
+    UINT32              routed;         /* packets sent to the data thread */
+    UINT32              delivered;      /* packets taken by a callback */
+    UINT32              returned;       /* packets handed back to BTU */
+} tBTU_DATA_CB;
+
+static tBTU_DATA_CB     btu_data_cb;
+static pthread_mutex_t  btu_data_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+**
+** Function         btu_data_find
+**
+** Description      Find the route of a channel. Safe without the lock as a
+**                  hint; the callback of the route may only be read with
+**                  the lock held.
+**
+** Returns          the route, NULL if the channel has none
+**
+*******************************************************************************/
+static tBTU_DATA_ROUTE *btu_data_find (UINT32 key)
+{
+    int xx;
+
+    for (xx = 0; xx < BTU_DATA_MAX_ROUTES; xx++)
+    {
+        if (__atomic_load_n (&btu_data_cb.route[xx].key, __ATOMIC_RELAXED) == key)
+            return &btu_data_cb.route[xx];
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         btu_data_route_add
+**
+** Description      Route the received data of a channel to the data thread,
+**                  or change the callback of a routed channel. Called on BTU.
+**
+** Parameters       handle  - HCI handle of the ACL or SCO link
+**                  cid     - local CID, BTU_DATA_SCO_CID for an SCO link
+**                  p_cback - callback for the received data
+**
+** Returns          TRUE if the channel is routed, FALSE if the data thread
+**                  is not running or every route is taken
+**
+*******************************************************************************/
+BOOLEAN btu_data_route_add (UINT16 handle, UINT16 cid, tBTU_DATA_CBACK *p_cback)
+{
+    tBTU_DATA_ROUTE *p_route;
+    UINT32          key = BTU_DATA_KEY (handle, cid);
+
+    if (!__atomic_load_n (&btu_data_cb.running, __ATOMIC_ACQUIRE))
+        return FALSE;
+
+    pthread_mutex_lock (&btu_data_lock);
+
+    if ((p_route = btu_data_find (key)) == NULL && (p_route = btu_data_find (0)) != NULL)
+    {
+        p_route->p_cback = p_cback;
+        p_route->pending = 0;
+        __atomic_store_n (&p_route->key, key, __ATOMIC_RELEASE);
+        __atomic_store_n (&btu_data_cb.num_routes, btu_data_cb.num_routes + 1, __ATOMIC_RELEASE);
+    }
+    else if (p_route != NULL)
+    {
+        p_route->p_cback = p_cback;
+    }
+
+    pthread_mutex_unlock (&btu_data_lock);
+
+    if (p_route == NULL)
+        BT_TRACE (TRACE_LAYER_BTU, TRACE_TYPE_WARNING,
+                  "btu_data: no route left for handle 0x%04x cid 0x%04x", handle, cid);
+    return (p_route != NULL);
+}
+
+/*******************************************************************************
+**
+** Function         btu_data_route_remove
+**
+** Description      Take a channel off the data thread. Called on BTU. When
+**                  this returns, the callback of the channel is not running
+**                  and is not called again; packets still on their way go
+**                  to BTU.
+**
+** Returns          void
+**
+*******************************************************************************/
+void btu_data_route_remove (UINT16 handle, UINT16 cid)
+{
+    tBTU_DATA_ROUTE *p_route;
+
+    pthread_mutex_lock (&btu_data_lock);
+
+    if ((p_route = btu_data_find (BTU_DATA_KEY (handle, cid))) != NULL)
+    {
+        __atomic_store_n (&p_route->key, 0, __ATOMIC_RELAXED);
+        p_route->p_cback = NULL;
+        p_route->pending = 0;
+        __atomic_store_n (&btu_data_cb.num_routes, btu_data_cb.num_routes - 1, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_unlock (&btu_data_lock);
+}
+
+/*******************************************************************************
+**
+** Function         btu_data_rcv
+**
+** Description      Called by the HCI reader for every received packet. The
+**                  packets of a routed channel are sent to the data thread.
+**                  Only complete and start fragments can be recognized,
+**                  which is all HCI passes up as it reassembles L2CAP
+**                  frames.
+**
+** Returns          TRUE if the packet was taken, FALSE to send it to BTU
+**
+*******************************************************************************/
+BOOLEAN btu_data_rcv (BT_HDR *p_msg)
+{
+    UINT8   *p = (UINT8 *)(p_msg + 1) + p_msg->offset;
+    UINT16  handle, cid;
+
+    if (!__atomic_load_n (&btu_data_cb.running, __ATOMIC_ACQUIRE)
+        || __atomic_load_n (&btu_data_cb.num_routes, __ATOMIC_RELAXED) == 0)
+        return FALSE;
+
+    switch (p_msg->event & BT_EVT_MASK)
+    {
+#if (L2CAP_HOST_FLOW_CTRL == FALSE)
+    /* with host flow control BTU must see every ACL packet to acknowledge it */
+    case BT_EVT_TO_BTU_HCI_ACL:
+        if (p_msg->len < HCI_DATA_PREAMBLE_SIZE + L2CAP_PKT_OVERHEAD)
+            return FALSE;
+
+        STREAM_TO_UINT16 (handle, p);
+        if (HCID_GET_EVENT (handle) == L2CAP_PKT_CONTINUE)
+            return FALSE;
+
+        /* skip the HCI and L2CAP lengths */
+        p += 4;
+        STREAM_TO_UINT16 (cid, p);
+        if (cid < L2CAP_BASE_APPL_CID)
+            return FALSE;
+        break;
+#endif
+
+#if (BTM_SCO_HCI_INCLUDED == TRUE)
+    case BT_EVT_TO_BTU_HCI_SCO:
+        if (p_msg->len < HCI_SCO_PREAMBLE_SIZE)
+            return FALSE;
+
+        STREAM_TO_UINT16 (handle, p);
+        cid = BTU_DATA_SCO_CID;
+        break;
+#endif
+
+    default:
+        return FALSE;
+    }
+
+    if (btu_data_find (BTU_DATA_KEY (HCID_GET_HANDLE (handle), cid)) == NULL)
+        return FALSE;
+
+    __atomic_add_fetch (&btu_data_cb.routed, 1, __ATOMIC_RELAXED);
+    GKI_send_msg (BTU_DATA_TASK, BTU_DATA_RCV_MBOX, p_msg);
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         btu_data_deliver
+**
+** Description      Pass a received packet to the callback of its channel, or
+**                  on to BTU. ACL packets are checked the way
+**                  l2c_rcv_acl_data checks them; BTU gets to drop the bad
+**                  ones. While BTU has packets of the route to handle, the
+**                  packet is queued behind them instead of passed up.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btu_data_deliver (BT_HDR *p_msg)
+{
+    UINT8           *p = (UINT8 *)(p_msg + 1) + p_msg->offset;
+    UINT16          offset = p_msg->offset;
+    UINT16          len = p_msg->len;
+    UINT16          handle, hci_len, l2cap_len;
+    UINT16          cid = BTU_DATA_SCO_CID;
+    tBTU_DATA_ROUTE *p_route;
+    BOOLEAN         valid = TRUE;
+    BOOLEAN         taken = FALSE;
+
+    STREAM_TO_UINT16 (handle, p);
+    handle = HCID_GET_HANDLE (handle);
+
+    if ((p_msg->event & BT_EVT_MASK) == BT_EVT_TO_BTU_HCI_ACL)
+    {
+        STREAM_TO_UINT16 (hci_len, p);
+        STREAM_TO_UINT16 (l2cap_len, p);
+        STREAM_TO_UINT16 (cid, p);
+
+        valid = (hci_len >= L2CAP_PKT_OVERHEAD && l2cap_len == hci_len - L2CAP_PKT_OVERHEAD);
+
+        p_msg->offset += HCI_DATA_PREAMBLE_SIZE + L2CAP_PKT_OVERHEAD;
+        p_msg->len     = l2cap_len;
+    }
+
+    pthread_mutex_lock (&btu_data_lock);
+    if ((p_route = btu_data_find (BTU_DATA_KEY (handle, cid))) != NULL)
+    {
+        if (valid && p_route->pending == 0)
+            taken = (*p_route->p_cback) (cid, p_msg);
+
+        if (!taken)
+        {
+            p_route->pending++;
+            p_msg->event |= BTU_DATA_RETURNED;
+        }
+    }
+    pthread_mutex_unlock (&btu_data_lock);
+
+    if (taken)
+    {
+        btu_data_cb.delivered++;
+        return;
+    }
+
+    p_msg->offset = offset;
+    p_msg->len    = len;
+    btu_data_cb.returned++;
+    GKI_send_msg (BTU_TASK, BTU_HCI_RCV_MBOX, p_msg);
+}
+
+/*******************************************************************************
+**
+** Function         btu_data_returned
+**
+** Description      Called by BTU for a received ACL or SCO packet before it
+**                  handles it. If the data thread handed the packet back,
+**                  the mark is cleared and the route is kept waiting until
+**                  BTU calls btu_data_drained with the returned value.
+**
+** Returns          the route to pass to btu_data_drained, 0 if the packet
+**                  came straight from HCI
+**
+*******************************************************************************/
+UINT32 btu_data_returned (BT_HDR *p_msg)
+{
+    UINT8   *p = (UINT8 *)(p_msg + 1) + p_msg->offset;
+    UINT16  handle;
+    UINT16  cid = BTU_DATA_SCO_CID;
+
+    if ((p_msg->event & BTU_DATA_RETURNED) == 0)
+        return 0;
+
+    p_msg->event &= ~BTU_DATA_RETURNED;
+
+    STREAM_TO_UINT16 (handle, p);
+    if ((p_msg->event & BT_EVT_MASK) == BT_EVT_TO_BTU_HCI_ACL)
+    {
+        /* skip the HCI and L2CAP lengths */
+        p += 4;
+        STREAM_TO_UINT16 (cid, p);
+    }
+    return BTU_DATA_KEY (HCID_GET_HANDLE (handle), cid);
+}
+
+/*******************************************************************************
+**
+** Function         btu_data_drained
+**
+** Description      Called by BTU once it has handled a packet the data thread
+**                  handed back. When BTU has handled every such packet of
+**                  the route, the callback gets the packets that follow.
+**
+** Parameters       ret_key - what btu_data_returned returned for the packet
+**
+** Returns          void
+**
+*******************************************************************************/
+void btu_data_drained (UINT32 ret_key)
+{
+    tBTU_DATA_ROUTE *p_route;
+
+    if (ret_key == 0)
+        return;
+
+    pthread_mutex_lock (&btu_data_lock);
+
+    /* a route removed meanwhile has nothing left to wait for */
+    if ((p_route = btu_data_find (ret_key)) != NULL && p_route->pending > 0)
+        p_route->pending--;
+
+    pthread_mutex_unlock (&btu_data_lock);
+}
+
+/*******************************************************************************
+**
+** Function         btu_data_task
+**
+** Description      The BTU data thread.
+**
+** Returns          0 when the task is destroyed
+**
+*******************************************************************************/
+UINT32 btu_data_task (UINT32 param)
+{
+    UINT16  event;
+    BT_HDR  *p_msg;
+    UNUSED(param);
+
+    prctl (PR_SET_NAME, (unsigned long)"BTU DATA", 0, 0, 0);
+    raise_priority_a2dp (TASK_HIGH_BTU_DATA);
+
+    memset (&btu_data_cb, 0, sizeof (btu_data_cb));
+    __atomic_store_n (&btu_data_cb.running, TRUE, __ATOMIC_RELEASE);
+
+    for (;;)
+    {
+        event = GKI_wait (0xFFFF, 0);
+
+        if (event & TASK_MBOX_0_EVT_MASK)
+        {
+            while ((p_msg = (BT_HDR *) GKI_read_mbox (BTU_DATA_RCV_MBOX)) != NULL)
+                btu_data_deliver (p_msg);
+        }
+
+        if (event & EVENT_MASK (GKI_SHUTDOWN_EVT))
+            break;
+    }
+
+    __atomic_store_n (&btu_data_cb.running, FALSE, __ATOMIC_RELEASE);
+
+    /* BTU is stopped right after this task, with HCI already down */
+    while ((p_msg = (BT_HDR *) GKI_read_mbox (BTU_DATA_RCV_MBOX)) != NULL)
+        GKI_freebuf (p_msg);
+
+    BT_TRACE (TRACE_LAYER_BTU, TRACE_TYPE_EVENT,
+              "btu_data: routed %u delivered %u returned to BTU %u",
+              btu_data_cb.routed, btu_data_cb.delivered, btu_data_cb.returned);
+    return 0;
+}
+
+#endif /* BTU_DATA_INCLUDED == TRUE */
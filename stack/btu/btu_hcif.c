@@ -28,6 +28,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "gki.h"
 #include "bt_types.h"
@@ -61,6 +62,10 @@ extern void btm_ble_test_command_complete(UINT8 *p);
 //Counter to track number of HCI command timeout
 static int num_hci_cmds_timed_out;
 
+/* Per-opcode command statistics, open addressed by opcode */
+#define BTU_CMD_STATS_SIZE      64
+static tBTU_CMD_STATS btu_cmd_stats[BTU_CMD_STATS_SIZE];
+
 /********************************************************************************/
 /*              L O C A L    F U N C T I O N     P R O T O T Y P E S            */
 /********************************************************************************/
@@ -144,6 +149,344 @@ static void btu_hcif_encryption_key_refresh_cmpl_evt (UINT8 *p);
 static void btu_ble_rc_param_req_evt(UINT8 *p);
 #endif
     #endif
+/*******************************************************************************
+**
+** Function         btu_hcif_now_ms
+**
+** Description      Monotonic time in milliseconds, truncated to 16 bits. Used
+**                  to time command round trips shorter than a minute.
+**
+** Returns          UINT16
+**
+*******************************************************************************/
+static UINT16 btu_hcif_now_ms (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (UINT16)((ts.tv_sec * 1000) + (ts.tv_nsec / 1000000));
+}
+
+/*******************************************************************************
+**
+** Function         btu_hcif_cmd_stats
+**
+** Description      Find, or create, the statistics entry of an opcode.
+**
+** Returns          pointer to the entry, or NULL if the table is full
+**
+*******************************************************************************/
+static tBTU_CMD_STATS *btu_hcif_cmd_stats (UINT16 opcode, BOOLEAN create)
+{
+    UINT16          xx;
+    tBTU_CMD_STATS  *p_stats;
+
+    for (xx = 0; xx < BTU_CMD_STATS_SIZE; xx++)
+    {
+        p_stats = &btu_cmd_stats[(opcode + xx) % BTU_CMD_STATS_SIZE];
+
+        if (p_stats->opcode == opcode)
+            return p_stats;
+
+        if (p_stats->opcode == HCI_COMMAND_NONE)
+        {
+            if (!create)
+                return NULL;
+
+            p_stats->opcode = opcode;
+            return p_stats;
+        }
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         btu_hcif_cmd_answered
+**
+** Description      Account the round trip of a stored command that got its
+**                  command complete or command status event.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btu_hcif_cmd_answered (UINT16 opcode, BT_HDR *p_cmd)
+{
+    tBTU_CMD_STATS  *p_stats = btu_hcif_cmd_stats (opcode, TRUE);
+    UINT16          rtt = (UINT16)(btu_hcif_now_ms () - p_cmd->layer_specific);
+
+    if (p_stats == NULL)
+        return;
+
+    p_stats->count++;
+    p_stats->total_ms += rtt;
+    if (rtt > p_stats->max_ms)
+        p_stats->max_ms = rtt;
+}
+
+/*******************************************************************************
+**
+** Function         btu_hcif_cmd_class
+**
+** Description      Pick the transmit queue of a command. Until the controller
+**                  is set up every command goes to the normal queue, so that
+**                  the init sequence is sent in order.
+**
+** Returns          BTU_CMD_CLASS_xxx
+**
+*******************************************************************************/
+static UINT8 btu_hcif_cmd_class (UINT16 opcode)
+{
+#if (BTU_HCI_CMD_SCHEDULING == TRUE)
+    if (btm_cb.devcb.state != BTM_DEV_STATE_READY)
+        return BTU_CMD_CLASS_NORMAL;
+
+    switch (opcode)
+    {
+        /* The controller is waiting on these, or a link or a SCO is being set up */
+        case HCI_ACCEPT_CONNECTION_REQUEST:
+        case HCI_REJECT_CONNECTION_REQUEST:
+        case HCI_LINK_KEY_REQUEST_REPLY:
+        case HCI_LINK_KEY_REQUEST_NEG_REPLY:
+        case HCI_PIN_CODE_REQUEST_REPLY:
+        case HCI_PIN_CODE_REQUEST_NEG_REPLY:
+        case HCI_IO_CAPABILITY_RESPONSE:
+        case HCI_USER_CONF_REQUEST_REPLY:
+        case HCI_USER_CONF_VALUE_NEG_REPLY:
+        case HCI_USER_PASSKEY_REQ_REPLY:
+        case HCI_USER_PASSKEY_REQ_NEG_REPLY:
+        case HCI_REM_OOB_DATA_REQ_REPLY:
+        case HCI_REM_OOB_DATA_REQ_NEG_REPLY:
+        case HCI_ADD_SCO_CONNECTION:
+        case HCI_SETUP_ESCO_CONNECTION:
+        case HCI_ACCEPT_ESCO_CONNECTION:
+        case HCI_REJECT_ESCO_CONNECTION:
+        /* the SCO setup above must not overtake the voice setting for it */
+        case HCI_WRITE_VOICE_SETTINGS:
+#if BLE_INCLUDED == TRUE
+        case HCI_BLE_UPD_LL_CONN_PARAMS:
+        case HCI_BLE_START_ENC:
+        case HCI_BLE_LTK_REQ_REPLY:
+        case HCI_BLE_LTK_REQ_NEG_REPLY:
+        case HCI_BLE_RC_PARAM_REQ_REPLY:
+        case HCI_BLE_RC_PARAM_REQ_NEG_REPLY:
+#endif
+            return BTU_CMD_CLASS_URGENT;
+
+#if BLE_INCLUDED == TRUE
+        /* SMP waits on these */
+        case HCI_BLE_RAND:
+        case HCI_BLE_ENCRYPT:
+            return BTU_CMD_CLASS_NORMAL;
+
+        case HCI_BLE_MULTI_ADV_OCF:
+        case HCI_BLE_BATCH_SCAN_OCF:
+        case HCI_BLE_ADV_FILTER_OCF:
+        case HCI_BLE_TRACK_ADV_OCF:
+        case HCI_BLE_ENERGY_INFO_OCF:
+            return BTU_CMD_CLASS_BULK;
+#endif
+
+        default:
+            break;
+    }
+
+#if BLE_INCLUDED == TRUE
+    /* The rest of the LE commands depend on each other (scan, white list,
+    ** random address, advertising) and must stay in order, so they share
+    ** one queue */
+    if ((opcode & HCI_GRP_VENDOR_SPECIFIC) == HCI_GRP_BLE_CMDS)
+        return BTU_CMD_CLASS_BULK;
+#endif
+#else
+    UNUSED(opcode);
+#endif
+    return BTU_CMD_CLASS_NORMAL;
+}
+
+/*******************************************************************************
+**
+** Function         btu_hcif_cmd_supersedes
+**
+** Description      Check if a command only sets state, so that a newer one
+**                  makes a still queued older one useless. None of these have
+**                  a command complete handler.
+**
+** Returns          TRUE if the older command can be dropped
+**
+*******************************************************************************/
+static BOOLEAN btu_hcif_cmd_supersedes (UINT16 opcode)
+{
+#if (BTU_HCI_CMD_SCHEDULING == TRUE)
+    switch (opcode)
+    {
+        case HCI_WRITE_SCAN_ENABLE:
+#if BLE_INCLUDED == TRUE
+        case HCI_BLE_WRITE_SCAN_ENABLE:
+        case HCI_BLE_WRITE_SCAN_PARAMS:
+        case HCI_BLE_WRITE_ADV_PARAMS:
+        case HCI_BLE_WRITE_ADV_DATA:
+        case HCI_BLE_WRITE_SCAN_RSP_DATA:
+#endif
+            return TRUE;
+
+        default:
+            break;
+    }
+#else
+    UNUSED(opcode);
+#endif
+    return FALSE;
+}
+
+/*******************************************************************************
+**
+** Function         btu_hcif_enqueue_cmd
+**
+** Description      Put a command on the transmit queue of its class. If the
+**                  last command waiting there has the same opcode and only
+**                  sets state, it is replaced. Only the last one is checked,
+**                  so a command is never moved across another one that may
+**                  depend on it.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btu_hcif_enqueue_cmd (tHCI_CMD_CB *p_hci_cmd_cb, BT_HDR *p_buf)
+{
+    UINT8           *p = (UINT8 *)(p_buf + 1) + p_buf->offset;
+    UINT16          opcode, last_opcode;
+    BUFFER_Q        *p_q;
+    BT_HDR          *p_last;
+    tBTU_CMD_STATS  *p_stats;
+
+    STREAM_TO_UINT16 (opcode, p);
+    p_q = &p_hci_cmd_cb->cmd_xmit_q[btu_hcif_cmd_class (opcode)];
+
+    if ( (btu_hcif_cmd_supersedes (opcode))
+      && ((p_last = (BT_HDR *)GKI_getlast (p_q)) != NULL) )
+    {
+        p = (UINT8 *)(p_last + 1) + p_last->offset;
+        STREAM_TO_UINT16 (last_opcode, p);
+
+        if (last_opcode == opcode)
+        {
+            GKI_remove_from_queue (p_q, p_last);
+            GKI_freebuf (p_last);
+
+            if ((p_stats = btu_hcif_cmd_stats (opcode, TRUE)) != NULL)
+                p_stats->superseded++;
+        }
+    }
+
+    GKI_enqueue (p_q, p_buf);
+}
+
+/*******************************************************************************
+**
+** Function         btu_hcif_dequeue_cmd
+**
+** Description      Take the next command to send. Urgent commands go first.
+**                  Normal commands go ahead of bulk ones, but a waiting bulk
+**                  command is sent after BTU_CMD_BULK_MAX_SKIP normal ones.
+**
+** Returns          the command, or NULL if nothing is queued
+**
+*******************************************************************************/
+static BT_HDR *btu_hcif_dequeue_cmd (tHCI_CMD_CB *p_hci_cmd_cb)
+{
+    BUFFER_Q    *p_q = p_hci_cmd_cb->cmd_xmit_q;
+
+    if (!GKI_queue_is_empty (&p_q[BTU_CMD_CLASS_URGENT]))
+        return (BT_HDR *)GKI_dequeue (&p_q[BTU_CMD_CLASS_URGENT]);
+
+    if (GKI_queue_is_empty (&p_q[BTU_CMD_CLASS_BULK]))
+    {
+        p_hci_cmd_cb->cmd_bulk_skips = 0;
+        return (BT_HDR *)GKI_dequeue (&p_q[BTU_CMD_CLASS_NORMAL]);
+    }
+
+    if ( (!GKI_queue_is_empty (&p_q[BTU_CMD_CLASS_NORMAL]))
+      && (p_hci_cmd_cb->cmd_bulk_skips < BTU_CMD_BULK_MAX_SKIP) )
+    {
+        p_hci_cmd_cb->cmd_bulk_skips++;
+        return (BT_HDR *)GKI_dequeue (&p_q[BTU_CMD_CLASS_NORMAL]);
+    }
+
+    p_hci_cmd_cb->cmd_bulk_skips = 0;
+    return (BT_HDR *)GKI_dequeue (&p_q[BTU_CMD_CLASS_BULK]);
+}
+
+/*******************************************************************************
+**
+** Function         btu_hcif_cmd_xmit_q_empty
+**
+** Description      Check if no command is waiting to be sent to a controller.
+**
+** Returns          TRUE if all transmit queues are empty
+**
+*******************************************************************************/
+BOOLEAN btu_hcif_cmd_xmit_q_empty (UINT8 controller_id)
+{
+    tHCI_CMD_CB *p_hci_cmd_cb = &(btu_cb.hci_cmd_cb[controller_id]);
+    UINT8       xx;
+
+    for (xx = 0; xx < BTU_CMD_NUM_CLASS; xx++)
+    {
+        if (!GKI_queue_is_empty (&p_hci_cmd_cb->cmd_xmit_q[xx]))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         btu_hcif_get_cmd_stats
+**
+** Description      Read the statistics collected for an HCI command opcode.
+**
+** Returns          TRUE if the opcode has been seen
+**
+*******************************************************************************/
+BOOLEAN btu_hcif_get_cmd_stats (UINT16 opcode, tBTU_CMD_STATS *p_stats)
+{
+    tBTU_CMD_STATS  *p_entry = btu_hcif_cmd_stats (opcode, FALSE);
+
+    if (p_entry == NULL)
+        return FALSE;
+
+    memcpy (p_stats, p_entry, sizeof (tBTU_CMD_STATS));
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         btu_hcif_log_cmd_stats
+**
+** Description      Log the statistics of every HCI command opcode seen.
+**
+** Returns          void
+**
+*******************************************************************************/
+void btu_hcif_log_cmd_stats (void)
+{
+    UINT16          xx;
+    tBTU_CMD_STATS  *p_stats;
+
+    for (xx = 0; xx < BTU_CMD_STATS_SIZE; xx++)
+    {
+        p_stats = &btu_cmd_stats[xx];
+
+        if (p_stats->opcode == HCI_COMMAND_NONE)
+            continue;
+
+        HCI_TRACE_EVENT ("HCI cmd 0x%04x: count %u avg %u ms max %u ms superseded %u timeouts %u",
+                         p_stats->opcode, p_stats->count,
+                         p_stats->count ? p_stats->total_ms / p_stats->count : 0,
+                         p_stats->max_ms, p_stats->superseded, p_stats->timeouts);
+    }
+}
+
 /*******************************************************************************
 **
 ** Function         btu_hcif_store_cmd
@@ -201,6 +544,9 @@ static void btu_hcif_store_cmd (UINT8 controller_id, BT_HDR *p_buf)
     memcpy ((UINT8 *)(p_cmd + 1) + p_cmd->offset,
             (UINT8 *)(p_buf + 1) + p_buf->offset, p_buf->len);
 
+    /* The copy never goes down, its layer_specific holds the send time */
+    p_cmd->layer_specific = btu_hcif_now_ms ();
+
     /* queue copy of cmd */
     GKI_enqueue(&(p_hci_cmd_cb->cmd_cmpl_q), p_cmd);
 
@@ -460,64 +806,51 @@ void btu_hcif_send_cmd (UINT8 controller_id, BT_HDR *p_buf)
     UINT16 code;
 #endif
 
-    /* If there are already commands in the queue, then enqueue this command */
-    if ((p_buf) && (p_hci_cmd_cb->cmd_xmit_q.count))
-    {
-        GKI_enqueue (&(p_hci_cmd_cb->cmd_xmit_q), p_buf);
-        p_buf = NULL;
-    }
+    /* Queue the command behind those already waiting in its class */
+    if (p_buf)
+        btu_hcif_enqueue_cmd (p_hci_cmd_cb, p_buf);
 
     /* Allow for startup case, where no acks may be received */
     if ( ((controller_id == LOCAL_BR_EDR_CONTROLLER_ID)
          && (p_hci_cmd_cb->cmd_window == 0)
          && (btm_cb.devcb.state == BTM_DEV_STATE_WAIT_RESET_CMPLT)) )
     {
-        p_hci_cmd_cb->cmd_window = p_hci_cmd_cb->cmd_xmit_q.count + 1;
+        p_hci_cmd_cb->cmd_window = p_hci_cmd_cb->cmd_xmit_q[BTU_CMD_CLASS_NORMAL].count + 1;
     }
 
     /* See if we can send anything */
     while (p_hci_cmd_cb->cmd_window != 0)
     {
-        if (!p_buf)
-            p_buf = (BT_HDR *)GKI_dequeue (&(p_hci_cmd_cb->cmd_xmit_q));
+        if ((p_buf = btu_hcif_dequeue_cmd (p_hci_cmd_cb)) == NULL)
+            break;
 
-        if (p_buf)
-        {
-            btu_hcif_store_cmd(controller_id, p_buf);
+        btu_hcif_store_cmd(controller_id, p_buf);
 
 #if ((L2CAP_HOST_FLOW_CTRL == TRUE)||defined(HCI_TESTER))
-            pp = (UINT8 *)(p_buf + 1) + p_buf->offset;
+        pp = (UINT8 *)(p_buf + 1) + p_buf->offset;
 
-            STREAM_TO_UINT16 (code, pp);
+        STREAM_TO_UINT16 (code, pp);
 
-            /*
-             * We do not need to decrease window for host flow control,
-             * host flow control does not receive an event back from controller
-             */
-            if (code != HCI_HOST_NUM_PACKETS_DONE)
+        /*
+         * We do not need to decrease window for host flow control,
+         * host flow control does not receive an event back from controller
+         */
+        if (code != HCI_HOST_NUM_PACKETS_DONE)
 #endif
-                p_hci_cmd_cb->cmd_window--;
+            p_hci_cmd_cb->cmd_window--;
 
-            if (controller_id == LOCAL_BR_EDR_CONTROLLER_ID)
-            {
-                HCI_CMD_TO_LOWER(p_buf);
-            }
-            else
-            {
-                /* Unknown controller */
-                HCI_TRACE_WARNING("BTU HCI(ctrl id=%d) controller ID not recognized", controller_id);
-                GKI_freebuf(p_buf);;
-            }
-
-            p_buf = NULL;
+        if (controller_id == LOCAL_BR_EDR_CONTROLLER_ID)
+        {
+            HCI_CMD_TO_LOWER(p_buf);
         }
         else
-            break;
+        {
+            /* Unknown controller */
+            HCI_TRACE_WARNING("BTU HCI(ctrl id=%d) controller ID not recognized", controller_id);
+            GKI_freebuf(p_buf);;
+        }
     }
 
-    if (p_buf)
-        GKI_enqueue (&(p_hci_cmd_cb->cmd_xmit_q), p_buf);
-
 #if (defined(HCILP_INCLUDED) && HCILP_INCLUDED == TRUE)
     if (controller_id == LOCAL_BR_EDR_CONTROLLER_ID)
     {
@@ -1254,6 +1587,7 @@ static void btu_hcif_command_complete_evt (UINT8 controller_id, UINT8 *p, UINT16
                 continue;
             }
             GKI_remove_from_queue(&p_hci_cmd_cb->cmd_cmpl_q, p_cmd);
+            btu_hcif_cmd_answered (opcode_dequeued, p_cmd);
 
             /* If command was a VSC, then extract command_complete callback */
             if ((cc_opcode & HCI_GRP_VENDOR_SPECIFIC) == HCI_GRP_VENDOR_SPECIFIC
@@ -1520,6 +1854,7 @@ static void btu_hcif_command_status_evt (UINT8 controller_id, UINT8 *p)
             else
             {
                 GKI_remove_from_queue(&p_hci_cmd_cb->cmd_cmpl_q, p_cmd);
+                btu_hcif_cmd_answered (cmd_opcode, p_cmd);
 
                 /* If command was a VSC, then extract command_status callback */
                  if ((cmd_opcode & HCI_GRP_VENDOR_SPECIFIC) == HCI_GRP_VENDOR_SPECIFIC)
@@ -1578,6 +1913,7 @@ static void btu_hcif_command_status_evt (UINT8 controller_id, UINT8 *p)
 void btu_hcif_cmd_timeout (UINT8 controller_id)
 {
     tHCI_CMD_CB * p_hci_cmd_cb = &(btu_cb.hci_cmd_cb[controller_id]);
+    tBTU_CMD_STATS *p_stats;
     BT_HDR  *p_cmd;
     UINT8   *p;
     void    *p_cplt_cback = NULL;
@@ -1640,6 +1976,9 @@ void btu_hcif_cmd_timeout (UINT8 controller_id)
     /* get opcode from stored command */
     STREAM_TO_UINT16 (opcode, p);
 
+    if ((p_stats = btu_hcif_cmd_stats (opcode, TRUE)) != NULL)
+        p_stats->timeouts++;
+
 // btla-specific ++
 #if (defined(ANDROID_APP_INCLUDED) && (ANDROID_APP_INCLUDED == TRUE))
     ALOGE("######################################################################");
@@ -2264,7 +2603,7 @@ void btu_hcif_flush_cmd_queue(void)
     {
         GKI_freebuf (p_cmd);
     }
-    while ((p_cmd = (BT_HDR *) GKI_dequeue (&btu_cb.hci_cmd_cb[0].cmd_xmit_q)) != NULL)
+    while ((p_cmd = btu_hcif_dequeue_cmd (&btu_cb.hci_cmd_cb[0])) != NULL)
     {
         GKI_freebuf (p_cmd);
     }
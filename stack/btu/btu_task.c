@@ -167,6 +167,9 @@ BTU_API UINT32 btu_task (UINT32 param)
     UINT8            i;
     UINT16           mask;
     BOOLEAN          handled;
+#if (BTU_DATA_INCLUDED == TRUE)
+    UINT32           ret_key;
+#endif
     UNUSED(param);
 
 #if (defined(HCISU_H4_INCLUDED) && HCISU_H4_INCLUDED == TRUE)
@@ -240,8 +243,14 @@ BTU_API UINT32 btu_task (UINT32 param)
                 switch (p_msg->event & BT_EVT_MASK)
                 {
                     case BT_EVT_TO_BTU_HCI_ACL:
+#if (BTU_DATA_INCLUDED == TRUE)
+                        ret_key = btu_data_returned (p_msg);
+#endif
                         /* All Acl Data goes to L2CAP */
                         l2c_rcv_acl_data (p_msg);
+#if (BTU_DATA_INCLUDED == TRUE)
+                        btu_data_drained (ret_key);
+#endif
                         break;
 
                     case BT_EVT_TO_BTU_L2C_SEG_XMIT:
@@ -251,7 +260,13 @@ BTU_API UINT32 btu_task (UINT32 param)
 
                     case BT_EVT_TO_BTU_HCI_SCO:
 #if BTM_SCO_INCLUDED == TRUE
+#if (BTU_DATA_INCLUDED == TRUE)
+                        ret_key = btu_data_returned (p_msg);
+#endif
                         btm_route_sco_data (p_msg);
+#if (BTU_DATA_INCLUDED == TRUE)
+                        btu_data_drained (ret_key);
+#endif
                         break;
 #endif
 
@@ -631,6 +646,8 @@ BTU_API UINT32 btu_task (UINT32 param)
             break;
     }
 
+    btu_hcif_log_cmd_stats ();
+
     return(0);
 }
 
@@ -845,6 +862,13 @@ void process_quick_timer_evt(TIMER_LIST_Q *p_tlq)
                 l2c_process_timeout (p_tle);
                 break;
 
+            case BTU_TTYPE_USER_FUNC:
+                {
+                    tUSER_TIMEOUT_FUNC  *p_uf = (tUSER_TIMEOUT_FUNC *)p_tle->param;
+                    (*p_uf)(p_tle);
+                }
+                break;
+
             default:
                 break;
         }
@@ -920,7 +944,7 @@ void btu_stop_timer_oneshot(TIMER_LIST_ENT *p_tle) {
 void btu_check_bt_sleep (void)
 {
     if ((btu_cb.hci_cmd_cb[LOCAL_BR_EDR_CONTROLLER_ID].cmd_cmpl_q.count == 0)
-        &&(btu_cb.hci_cmd_cb[LOCAL_BR_EDR_CONTROLLER_ID].cmd_xmit_q.count == 0))
+        &&(btu_hcif_cmd_xmit_q_empty (LOCAL_BR_EDR_CONTROLLER_ID)))
     {
         if (l2cb.controller_xmit_window == l2cb.num_lm_acl_bufs)
         {
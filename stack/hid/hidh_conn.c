@@ -58,6 +58,9 @@ static void hidh_l2cif_disconnect_ind (UINT16 l2cap_cid, BOOLEAN ack_needed);
 static void hidh_l2cif_data_ind (UINT16 l2cap_cid, BT_HDR *p_msg);
 static void hidh_l2cif_disconnect_cfm (UINT16 l2cap_cid, UINT16 result);
 static void hidh_l2cif_cong_ind (UINT16 l2cap_cid, BOOLEAN congested);
+#if (BTU_DATA_INCLUDED == TRUE)
+static BOOLEAN hidh_l2cif_fast_data_ind (UINT16 l2cap_cid, BT_HDR *p_msg);
+#endif
 
 static const tL2CAP_APPL_INFO hst_reg_info =
 {
@@ -593,6 +596,10 @@ static void hidh_l2cif_config_ind (UINT16 l2cap_cid, tL2CAP_CFG_INFO *p_cfg)
         p_hcon->disc_reason = HID_SUCCESS;
 
         hh_cb.devices[dhandle].state = HID_DEV_CONNECTED;
+#if (BTU_DATA_INCLUDED == TRUE)
+        /* input reports skip BTU when the data thread runs */
+        L2CA_SetFastDataPath (p_hcon->intr_cid, hidh_l2cif_fast_data_ind);
+#endif
         hh_cb.callback( dhandle,  hh_cb.devices[dhandle].addr, HID_HDEV_EVT_OPEN, 0, NULL ) ;
     }
 }
@@ -673,6 +680,10 @@ static void hidh_l2cif_config_cfm (UINT16 l2cap_cid, tL2CAP_CFG_INFO *p_cfg)
         p_hcon->disc_reason = HID_SUCCESS;
 
         hh_cb.devices[dhandle].state = HID_DEV_CONNECTED;
+#if (BTU_DATA_INCLUDED == TRUE)
+        /* input reports skip BTU when the data thread runs */
+        L2CA_SetFastDataPath (p_hcon->intr_cid, hidh_l2cif_fast_data_ind);
+#endif
         hh_cb.callback( dhandle, hh_cb.devices[dhandle].addr, HID_HDEV_EVT_OPEN, 0, NULL ) ;
     }
 }
@@ -715,7 +726,12 @@ static void hidh_l2cif_disconnect_ind (UINT16 l2cap_cid, BOOLEAN ack_needed)
     if (l2cap_cid == p_hcon->ctrl_cid)
         p_hcon->ctrl_cid = 0;
     else
+    {
+#if (BTU_DATA_INCLUDED == TRUE)
+        L2CA_SetFastDataPath (l2cap_cid, NULL);
+#endif
         p_hcon->intr_cid = 0;
+    }
 
     if ((p_hcon->ctrl_cid == 0) && (p_hcon->intr_cid == 0))
     {
@@ -950,6 +966,40 @@ static void hidh_l2cif_data_ind (UINT16 l2cap_cid, BT_HDR *p_msg)
 
 }
 
+#if (BTU_DATA_INCLUDED == TRUE)
+/*******************************************************************************
+**
+** Function         hidh_l2cif_fast_data_ind
+**
+** Description      This function is called on the BTU data thread with data
+**                  received on an interrupt channel. Input reports go up
+**                  from there; anything else is left to hidh_l2cif_data_ind
+**                  on BTU.
+**
+** Returns          TRUE if the buffer was taken
+**
+*******************************************************************************/
+static BOOLEAN hidh_l2cif_fast_data_ind (UINT16 l2cap_cid, BT_HDR *p_msg)
+{
+    UINT8   *p_data = (UINT8 *)(p_msg + 1) + p_msg->offset;
+    UINT8   dhandle, rep_type;
+
+    if ((dhandle = find_conn_by_cid (l2cap_cid)) >= HID_HOST_MAX_DEVICES
+        || hh_cb.devices[dhandle].conn.intr_cid != l2cap_cid
+        || p_msg->len == 0 || HID_GET_TRANS_FROM_HDR (*p_data) != HID_TRANS_DATA)
+        return (FALSE);
+
+    rep_type = HID_GET_PARAM_FROM_HDR (*p_data) & HID_PAR_REP_TYPE_MASK;
+
+    /* Get rid of the data type */
+    p_msg->len--;
+    p_msg->offset++;
+
+    hh_cb.callback (dhandle, hh_cb.devices[dhandle].addr, HID_HDEV_EVT_INTR_DATA, rep_type, p_msg);
+    return (TRUE);
+}
+#endif
+
 /*******************************************************************************
 **
 ** Function         hidh_conn_snd_data
@@ -370,6 +370,30 @@ BNEP_API extern tBNEP_RESULT  BNEP_Write (UINT16 handle,
                                         UINT8 *p_src_addr,
                                         BOOLEAN fw_ext_present);
 
+/*******************************************************************************
+**
+** Function         BNEP_IsPacketAllowed
+**
+** Description      This function checks a packet against the filters set by
+**                  the peer, so callers can drop it before building a buffer
+**
+** Parameters:      handle       - handle of the connection to write
+**                  p_dest_addr  - BD_ADDR/Ethernet addr of the destination
+**                  protocol     - protocol type of the packet
+**                  fw_ext_present - forwarded extensions present
+**                  p_data       - pointer to data start
+**
+** Returns:         BNEP_WRONG_HANDLE       - if passed handle is not valid
+**                  BNEP_IGNORE_CMD         - If the packet is filtered out
+**                  BNEP_SUCCESS            - If the packet is allowed
+**
+*******************************************************************************/
+BNEP_API extern tBNEP_RESULT  BNEP_IsPacketAllowed (UINT16 handle,
+                                                  UINT8 *p_dest_addr,
+                                                  UINT16 protocol,
+                                                  BOOLEAN fw_ext_present,
+                                                  UINT8 *p_data);
+
 /*******************************************************************************
 **
 ** Function         BNEP_SetProtocolFilters
@@ -1065,6 +1065,7 @@ typedef UINT8 tBTM_SCO_DATA_FLAG;
 **  SCO Callback Functions
 ****************************/
 typedef void (tBTM_SCO_CB) (UINT16 sco_inx);
+/* Called on the BTU data thread instead of BTU when BTU_DATA_INCLUDED and it runs */
 typedef void (tBTM_SCO_DATA_CB) (UINT16 sco_inx, BT_HDR *p_data, tBTM_SCO_DATA_FLAG status);
 
 /******************
@@ -3945,6 +3946,21 @@ BTM_API extern tBTM_STATUS BTM_SetWBSCodec (tBTM_SCO_CODEC_TYPE codec_type);
                                              UINT8 key_type, tBTM_IO_CAP io_cap,
                                              UINT8 pin_len);
 
+/*******************************************************************************
+**
+** Function         BTM_SecAddLinkKey
+**
+** Description      Restore the stored link key of a bonded device whose
+**                  record was not added at startup. Unlike BTM_SecAddDevice
+**                  the rest of the record (name, features, IO caps) is left
+**                  as learned on the current connection.
+**
+** Returns          TRUE if added OK, else FALSE
+**
+*******************************************************************************/
+    BTM_API extern BOOLEAN BTM_SecAddLinkKey (BD_ADDR bd_addr, LINK_KEY link_key,
+                                              UINT8 key_type, UINT8 pin_len);
+
 
 /*******************************************************************************
 **
@@ -35,11 +35,27 @@
 #define BTU_HCI_RCV_MBOX        TASK_MBOX_0     /* Messages from HCI  */
 #define BTU_BTIF_MBOX           TASK_MBOX_1     /* Messages to BTIF   */
 
+/* Mailbox of the BTU data thread */
+#define BTU_DATA_RCV_MBOX       TASK_MBOX_0     /* Data packets from HCI */
+
 /* callbacks
 */
 typedef void (*tBTU_TIMER_CALLBACK)(TIMER_LIST_ENT *p_tle);
 typedef void (*tBTU_EVENT_CALLBACK)(BT_HDR *p_hdr);
 
+/* Receive callback of a channel served by the BTU data thread. It runs on
+** that thread. An L2CAP channel gets the payload, its offset past the L2CAP
+** header; an SCO link (cid BTU_DATA_SCO_CID) gets the packet as HCI passed
+** it. Returning FALSE hands the packet, as it was, to BTU instead.
+*/
+typedef BOOLEAN (tBTU_DATA_CBACK)(UINT16 cid, BT_HDR *p_buf);
+
+#define BTU_DATA_SCO_CID        0
+
+/* Set in the sub event of an ACL or SCO packet the data thread handed back
+** to BTU; see btu_data_returned */
+#define BTU_DATA_RETURNED       0x0080
+
 
 /* Define the timer types maintained by BTU
 */
@@ -210,12 +226,30 @@ typedef struct
 #define NFC_CONTROLLER_ID       (1)
 #define BTU_MAX_LOCAL_CTRLS     (1 + NFC_MAX_LOCAL_CTRLS) /* only BR/EDR */
 
+/* HCI command scheduling classes, served in this order */
+#define BTU_CMD_CLASS_URGENT    0       /* replies to controller requests, SCO and conn param setup */
+#define BTU_CMD_CLASS_NORMAL    1       /* everything else */
+#define BTU_CMD_CLASS_BULK      2       /* LE scan, advertising and filter configuration */
+#define BTU_CMD_NUM_CLASS       3
+
+/* Per-opcode HCI command statistics */
+typedef struct
+{
+    UINT16           opcode;
+    UINT32           count;                 /* commands answered by the controller */
+    UINT32           superseded;            /* commands replaced while still queued */
+    UINT32           timeouts;              /* commands that got no response */
+    UINT32           total_ms;              /* sum of round-trip times */
+    UINT16           max_ms;                /* worst round-trip time */
+} tBTU_CMD_STATS;
+
 /* AMP HCI control block */
 typedef struct
 {
-    BUFFER_Q         cmd_xmit_q;
+    BUFFER_Q         cmd_xmit_q[BTU_CMD_NUM_CLASS];
     BUFFER_Q         cmd_cmpl_q;
     UINT16           cmd_window;
+    UINT8            cmd_bulk_skips;        /* normal commands sent while bulk waited */
     TIMER_LIST_ENT   cmd_cmpl_timer;        /* Command complete timer */
 #if (defined(BTU_CMD_CMPL_TOUT_DOUBLE_CHECK) && BTU_CMD_CMPL_TOUT_DOUBLE_CHECK == TRUE)
     BOOLEAN          checked_hcisu;
@@ -300,6 +334,9 @@ BTU_API extern void  btu_hcif_process_event (UINT8 controller_id, BT_HDR *p_buf)
 BTU_API extern void  btu_hcif_send_cmd (UINT8 controller_id, BT_HDR *p_msg);
 BTU_API extern void  btu_hcif_send_host_rdy_for_data(void);
 BTU_API extern void  btu_hcif_cmd_timeout (UINT8 controller_id);
+BTU_API extern BOOLEAN btu_hcif_cmd_xmit_q_empty (UINT8 controller_id);
+BTU_API extern BOOLEAN btu_hcif_get_cmd_stats (UINT16 opcode, tBTU_CMD_STATS *p_stats);
+BTU_API extern void  btu_hcif_log_cmd_stats (void);
 
 /* Functions provided by btu_core.c
 ************************************
@@ -309,6 +346,18 @@ BTU_API extern void  BTE_Init(void);
 BTU_API extern UINT16 BTU_AclPktSize(void);
 BTU_API extern UINT16 BTU_BleAclPktSize(void);
 
+#if (BTU_DATA_INCLUDED == TRUE)
+/* Functions provided by btu_data.c
+************************************
+*/
+BTU_API extern UINT32  btu_data_task (UINT32 param);
+BTU_API extern BOOLEAN btu_data_rcv (BT_HDR *p_msg);
+BTU_API extern BOOLEAN btu_data_route_add (UINT16 handle, UINT16 cid, tBTU_DATA_CBACK *p_cback);
+BTU_API extern void    btu_data_route_remove (UINT16 handle, UINT16 cid);
+BTU_API extern UINT32  btu_data_returned (BT_HDR *p_msg);
+BTU_API extern void    btu_data_drained (UINT32 ret_key);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
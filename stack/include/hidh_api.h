@@ -62,6 +62,9 @@ HID_HDEV_EVT_IN_REPORT  Device sent an input report     Data=Report Type pdata=
                                                         (GKI buffer having report data.)
 HID_HDEV_EVT_HANDSHAKE  Device sent SET_REPORT          Data=Result-code pdata=NA.
 HID_HDEV_EVT_VC_UNPLUG  Device sent Virtual Unplug      Data=NA. pdata=NA.
+
+With the BTU data thread running (BTU_DATA_INCLUDED), HID_HDEV_EVT_INTR_DATA
+may be called on that thread instead of on BTU.
 */
 
 enum
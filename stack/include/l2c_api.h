@@ -69,6 +69,16 @@ typedef UINT8 tL2CAP_CHNL_PRIORITY;
 
 typedef UINT8 tL2CAP_CHNL_DATA_RATE;
 
+/* Values for lat_class parameter to L2CA_SetTxLatencyClass, most urgent first */
+#define L2CAP_LATENCY_CLASS_MEDIA       0
+#define L2CAP_LATENCY_CLASS_HID         1
+#define L2CAP_LATENCY_CLASS_ATT         2
+#define L2CAP_LATENCY_CLASS_BULK        3
+#define L2CAP_NUM_LATENCY_CLASS         4
+#define L2CAP_LATENCY_CLASS_AUTO        0xFF    /* derived from the channel PSM */
+
+typedef UINT8 tL2CAP_LATENCY_CLASS;
+
 /* Data Packet Flags  (bits 2-15 are reserved) */
 /* layer specific 14-15 bits are used for FCR SAR */
 #define L2CAP_FLUSHABLE_MASK        0x0003
@@ -240,6 +250,16 @@ typedef void (tL2CA_QOS_VIOLATION_IND_CB) (BD_ADDR);
 */
 typedef void (tL2CA_DATA_IND_CB) (UINT16, BT_HDR *);
 
+/* Data received callback of L2CA_SetFastDataPath, called on the BTU data
+** thread. Parameters are
+**              Local CID
+**              Address of buffer
+** Returns FALSE to pass the buffer, untouched, to the tL2CA_DATA_IND_CB on BTU.
+** The packets after it then go the same way until BTU has caught up, so
+** the channel keeps its order.
+*/
+typedef BOOLEAN (tL2CA_FAST_DATA_CB) (UINT16, BT_HDR *);
+
 
 /* Echo response callback prototype. Note that this is not included in the
 ** registration information, but is passed to L2CAP as part of the API to
@@ -661,6 +681,36 @@ L2C_API extern BOOLEAN L2CA_SendTestSFrame (UINT16 cid, UINT8 sup_type,
 *******************************************************************************/
 L2C_API extern BOOLEAN L2CA_SetTxPriority (UINT16 cid, tL2CAP_CHNL_PRIORITY priority);
 
+/*******************************************************************************
+**
+** Function         L2CA_SetTxLatencyClass
+**
+** Description      Sets the latency class the transmit scheduler serves a
+**                  channel in. By default it is derived from the PSM.
+**
+** Returns          TRUE if a valid channel, else FALSE
+**
+*******************************************************************************/
+L2C_API extern BOOLEAN L2CA_SetTxLatencyClass (UINT16 cid, tL2CAP_LATENCY_CLASS lat_class);
+
+/*******************************************************************************
+**
+** Function         L2CA_SetFastDataPath
+**
+** Description      Has the received data of an open basic mode channel
+**                  passed to p_cb on the BTU data thread, instead of to the
+**                  data indication callback on BTU. p_cb returns FALSE for
+**                  a packet it leaves to the data indication callback. NULL
+**                  moves the channel back to BTU; the data path is also
+**                  removed when the channel is released. Once this returns
+**                  after a change, the previous callback is not running.
+**
+** Returns          TRUE if the channel is on the data thread, FALSE if not,
+**                  e.g. when the data thread is not enabled
+**
+*******************************************************************************/
+L2C_API extern BOOLEAN L2CA_SetFastDataPath (UINT16 cid, tL2CA_FAST_DATA_CB *p_cb);
+
 /*******************************************************************************
 **
 ** Function         L2CA_RegForNoCPEvt
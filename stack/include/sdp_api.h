@@ -138,6 +138,8 @@ typedef struct
     UINT16          num_attr_filters;           /* Number of attribute filters  */
     UINT16          attr_filters[SDP_MAX_ATTR_FILTERS]; /* Attributes to filter */
     UINT8           *p_free_mem;                /* Pointer to free memory       */
+    UINT32          grow_size;                  /* Memory the DB may still add, 0 if it may not grow */
+    void            *p_ext_mem;                 /* Memory added, freed by SDP_FreeDiscoveryDb */
 #if (SDP_RAW_DATA_INCLUDED == TRUE)
     UINT8           *raw_data;                  /* Received record from server. allocated/released by client  */
     UINT32          raw_size;                   /* size of raw_data */
@@ -207,6 +209,19 @@ SDP_API extern BOOLEAN SDP_InitDiscoveryDb (tSDP_DISCOVERY_DB *p_db, UINT32 len,
                                             UINT16 num_attr,
                                             UINT16 *p_attr_list);
 
+/*******************************************************************************
+**
+** Function         SDP_FreeDiscoveryDb
+**
+** Description      This function frees a discovery database, with the memory
+**                  it added while it was filled. A database whose grow_size
+**                  was set after SDP_InitDiscoveryDb must be freed with it.
+**
+** Returns          void
+**
+*******************************************************************************/
+SDP_API extern void SDP_FreeDiscoveryDb (tSDP_DISCOVERY_DB *p_db);
+
 /*******************************************************************************
 **
 ** Function         SDP_CancelServiceSearch
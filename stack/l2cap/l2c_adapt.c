@@ -0,0 +1,122 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the adaptive ACL buffer allocation policy. It knows
+ *  nothing about LCBs so it can also be driven by test/l2cap_adapt_sim.
+ *
+ *  The links hand in the quotas they hold. Each link gets back its floor:
+ *  the fair share minimum, or the packets it still has in the controller if
+ *  that is more, since those buffers stay taken whatever the quota says. The
+ *  rest goes, one buffer at a time, to the link furthest below its demand.
+ *
+ ******************************************************************************/
+
+#include "bt_target.h"
+#include "bt_types.h"
+#include "l2c_adapt.h"
+
+/*******************************************************************************
+**
+** Function         l2c_adapt_rebalance
+**
+** Description      Samples the demand of every link and redistributes the
+**                  quotas they hold between them.
+**
+**                  A link's demand is the average of its link queue depth plus
+**                  packets in flight; a link that filled its quota asks for
+**                  double, so a bulk transfer grows quickly. A link with
+**                  packets in flight but no completions is stalled (sniff,
+**                  peer flow off) and asks for nothing beyond its floor. What
+**                  nobody asks for is spread evenly.
+**
+**                  The sum of the quotas never changes, and no quota drops
+**                  below the buffers its link still holds, so the links never
+**                  hold more controller buffers than the pool they share.
+**
+** Returns          TRUE if the quotas were recomputed
+**
+*******************************************************************************/
+BOOLEAN l2c_adapt_rebalance (tL2C_ADAPT_LINK *p_link, int num, UINT16 min_quota)
+{
+    tL2C_ADAPT_LINK *p;
+    UINT32  pool = 0, reserved = 0, spare;
+    UINT16  sample, gap, best_gap;
+    int     xx, best;
+
+    for (xx = 0, p = p_link; xx < num; xx++, p++)
+    {
+        sample = p->sent_not_acked + p->queued;
+        if (p->sent_not_acked >= p->quota)
+            sample += p->quota;
+        if (sample > 0x0FFF)
+            sample = 0x0FFF;
+
+        p->demand = (p->demand + (sample << 4)) / 2;
+
+        p->need = 0;
+        if ((p->completed != 0) || (p->sent_not_acked == 0))
+            p->need = (p->demand + 15) >> 4;
+
+        pool     += p->quota;
+        reserved += (p->sent_not_acked > min_quota) ? p->sent_not_acked : min_quota;
+    }
+
+    if ((num < 2) || (pool <= reserved))
+        return FALSE;
+
+    spare = pool - reserved;
+
+    for (xx = 0, p = p_link; xx < num; xx++, p++)
+        p->quota = (p->sent_not_acked > min_quota) ? p->sent_not_acked : min_quota;
+
+    /* Fill the link furthest below its need first */
+    while (spare > 0)
+    {
+        best     = -1;
+        best_gap = 0;
+        for (xx = 0, p = p_link; xx < num; xx++, p++)
+        {
+            if (p->need <= p->quota)
+                continue;
+
+            gap = p->need - p->quota;
+            if (gap > best_gap)
+            {
+                best     = xx;
+                best_gap = gap;
+            }
+        }
+
+        if (best < 0)
+            break;
+
+        p_link[best].quota++;
+        spare--;
+    }
+
+    /* Nobody wants the rest, do not strand it */
+    for (xx = 0; spare > 0; xx = (xx + 1) % num)
+    {
+        p_link[xx].quota++;
+        spare--;
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,51 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the policy that moves controller ACL buffers between
+ *  normal priority links according to their demand
+ *
+ ******************************************************************************/
+#ifndef L2C_ADAPT_H
+#define L2C_ADAPT_H
+
+#include "bt_types.h"
+
+/* A normal priority link offered to l2c_adapt_rebalance */
+typedef struct
+{
+    UINT16      quota;          /* in: current quota, out: new quota */
+    UINT16      demand;         /* in/out: queued + unacked pkts, running average (x16) */
+    UINT16      sent_not_acked; /* packets holding controller buffers */
+    UINT16      queued;         /* packets waiting in the link queue */
+    UINT16      completed;      /* packets completed since the last rebalance */
+    UINT16      need;           /* out: buffers the link asked for, 0 if stalled */
+} tL2C_ADAPT_LINK;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern BOOLEAN l2c_adapt_rebalance (tL2C_ADAPT_LINK *p_link, int num, UINT16 min_quota);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* L2C_ADAPT_H */
@@ -34,6 +34,7 @@
 #include "l2c_int.h"
 #include "btu.h"
 #include "btm_api.h"
+#include "bt_utils.h"
 
 /*******************************************************************************
 **
@@ -1042,6 +1043,41 @@ BOOLEAN L2CA_SetTxPriority (UINT16 cid, tL2CAP_CHNL_PRIORITY priority)
     return (TRUE);
 }
 
+/*******************************************************************************
+**
+** Function         L2CA_SetTxLatencyClass
+**
+** Description      Sets the latency class the transmit scheduler serves a
+**                  channel in. By default it is derived from the PSM.
+**
+** Returns          TRUE if a valid channel, else FALSE
+**
+*******************************************************************************/
+BOOLEAN L2CA_SetTxLatencyClass (UINT16 cid, tL2CAP_LATENCY_CLASS lat_class)
+{
+#if (L2CAP_DRR_CHANNEL_SERVICE == TRUE)
+    tL2C_CCB        *p_ccb;
+
+    L2CAP_TRACE_API ("L2CA_SetTxLatencyClass()  CID: 0x%04x, class:%d", cid, lat_class);
+
+    if ((lat_class >= L2CAP_NUM_LATENCY_CLASS) && (lat_class != L2CAP_LATENCY_CLASS_AUTO))
+        return (FALSE);
+
+    if ((p_ccb = l2cu_find_ccb_by_cid (NULL, cid)) == NULL)
+    {
+        L2CAP_TRACE_WARNING ("L2CAP - no CCB for L2CA_SetTxLatencyClass, CID: %d", cid);
+        return (FALSE);
+    }
+
+    p_ccb->drr.lat_class = lat_class;
+    return (TRUE);
+#else
+    UNUSED(cid);
+    UNUSED(lat_class);
+    return (FALSE);
+#endif
+}
+
 /*******************************************************************************
 **
 ** Function         L2CA_SetChnlDataRate
@@ -1073,6 +1109,55 @@ BOOLEAN L2CA_SetChnlDataRate (UINT16 cid, tL2CAP_CHNL_DATA_RATE tx, tL2CAP_CHNL_
     return(TRUE);
 }
 
+/*******************************************************************************
+**
+** Function         L2CA_SetFastDataPath
+**
+** Description      Has the received data of an open basic mode channel
+**                  passed to p_cb on the BTU data thread. NULL moves the
+**                  channel back to BTU.
+**
+** Returns          TRUE if the channel is on the data thread, else FALSE
+**
+*******************************************************************************/
+BOOLEAN L2CA_SetFastDataPath (UINT16 cid, tL2CA_FAST_DATA_CB *p_cb)
+{
+#if (BTU_DATA_INCLUDED == TRUE)
+    tL2C_CCB        *p_ccb;
+
+    L2CAP_TRACE_API ("L2CA_SetFastDataPath()  CID: 0x%04x, on: %d", cid, p_cb != NULL);
+
+    /* a released channel is already off the data thread */
+    if ((p_ccb = l2cu_find_ccb_by_cid (NULL, cid)) == NULL)
+    {
+        if (p_cb != NULL)
+            L2CAP_TRACE_WARNING ("L2CAP - no CCB for L2CA_SetFastDataPath, CID: %d", cid);
+        return (FALSE);
+    }
+
+    if (p_cb == NULL)
+    {
+        if (p_ccb->fast_data)
+            btu_data_route_remove (p_ccb->p_lcb->handle, cid);
+        p_ccb->fast_data = FALSE;
+        return (FALSE);
+    }
+
+    /* eRTM and streaming mode need the FCR state in l2cb; fixed channels
+       are dispatched by l2c_rcv_acl_data itself */
+    if (cid < L2CAP_BASE_APPL_CID || p_ccb->chnl_state != CST_OPEN
+     || p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_BASIC_MODE)
+        return (FALSE);
+
+    p_ccb->fast_data = btu_data_route_add (p_ccb->p_lcb->handle, cid, p_cb);
+    return (p_ccb->fast_data);
+#else
+    UNUSED(cid);
+    UNUSED(p_cb);
+    return (FALSE);
+#endif
+}
+
 /*******************************************************************************
 **
 ** Function         L2CA_SetFlushTimeout
@@ -0,0 +1,216 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the deficit round robin channel scheduler. It knows
+ *  nothing about CCBs so it can also be driven by test/l2cap_drr_sim.
+ *
+ *  Each channel with data to send earns a byte quantum per round and is
+ *  charged the size of every packet it sends. Within a round the latency
+ *  classes are served in order (media, HID, ATT) ahead of bulk, and channels
+ *  of the same class take turns by channel id.
+ *
+ ******************************************************************************/
+
+#include "bt_target.h"
+#include "bt_types.h"
+#include "l2c_drr.h"
+
+/*******************************************************************************
+**
+** Function         l2c_drr_class_for_psm
+**
+** Description      Default latency class of a channel on the given PSM
+**
+** Returns          latency class
+**
+*******************************************************************************/
+tL2CAP_LATENCY_CLASS l2c_drr_class_for_psm (UINT16 psm)
+{
+    switch (psm)
+    {
+        case BT_PSM_AVDTP:
+            return L2CAP_LATENCY_CLASS_MEDIA;
+
+        case BT_PSM_HIDC:
+        case BT_PSM_HIDI:
+            return L2CAP_LATENCY_CLASS_HID;
+
+        case BT_PSM_ATT:
+            return L2CAP_LATENCY_CLASS_ATT;
+
+        default:
+            return L2CAP_LATENCY_CLASS_BULK;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         l2c_drr_quantum
+**
+** Description      Bytes per round for a channel of the given class. Bulk
+**                  channels are further weighted by their channel priority.
+**
+** Returns          quantum in bytes
+**
+*******************************************************************************/
+UINT16 l2c_drr_quantum (tL2CAP_LATENCY_CLASS lat_class, tL2CAP_CHNL_PRIORITY priority)
+{
+    switch (lat_class)
+    {
+        case L2CAP_LATENCY_CLASS_MEDIA:
+            return L2C_DRR_QUANTUM_MEDIA;
+
+        case L2CAP_LATENCY_CLASS_HID:
+            return L2C_DRR_QUANTUM_HID;
+
+        case L2CAP_LATENCY_CLASS_ATT:
+            return L2C_DRR_QUANTUM_ATT;
+
+        default:
+            if (priority > L2CAP_CHNL_PRIORITY_LOW)
+                priority = L2CAP_CHNL_PRIORITY_LOW;
+            return (UINT16)(L2C_DRR_QUANTUM_BULK << (L2CAP_CHNL_PRIORITY_LOW - priority));
+    }
+}
+
+/*******************************************************************************
+**
+** Function         l2c_drr_select
+**
+** Description      Picks the channel to send next among those with data.
+**                  When no channel has credit left a new round starts; rounds
+**                  in which nobody could send are skipped in one step.
+**
+** Returns          index into p_ent, or -1 if num is 0
+**
+*******************************************************************************/
+int l2c_drr_select (tL2C_DRR *p_drr, tL2C_DRR_ENTRY *p_ent, int num, UINT32 now)
+{
+    int     pass, i, best, first;
+    UINT8   cls;
+    INT32   rounds, need;
+
+    /* a channel that just got data starts with its quantum rather than
+    ** waiting for the current round to end */
+    for (i = 0; i < num; i++)
+    {
+        if (!p_ent[i].p_chnl->backlogged)
+        {
+            p_ent[i].p_chnl->backlogged = TRUE;
+            p_ent[i].p_chnl->wait_start = now;
+            p_ent[i].p_chnl->deficit += p_ent[i].quantum;
+            if (p_ent[i].p_chnl->deficit > p_ent[i].quantum)
+                p_ent[i].p_chnl->deficit = p_ent[i].quantum;
+        }
+    }
+
+    for (pass = 0; (pass < 2) && (num > 0); pass++)
+    {
+        for (cls = 0; cls < L2CAP_NUM_LATENCY_CLASS; cls++)
+        {
+            best = first = -1;
+
+            for (i = 0; i < num; i++)
+            {
+                if ((p_ent[i].lat_class != cls) || (p_ent[i].p_chnl->deficit <= 0))
+                    continue;
+
+                /* next id after the one served last, else wrap to the lowest */
+                if ((p_ent[i].id > p_drr->last_id[cls])
+                  &&((best < 0) || (p_ent[i].id < p_ent[best].id)))
+                    best = i;
+
+                if ((first < 0) || (p_ent[i].id < p_ent[first].id))
+                    first = i;
+            }
+
+            if (best < 0)
+                best = first;
+
+            if (best >= 0)
+            {
+                p_drr->last_id[cls] = p_ent[best].id;
+                return best;
+            }
+        }
+
+        /* every channel has used its share: start as many rounds as it takes
+        ** for the first of them to be allowed to send again */
+        rounds = 0;
+        for (i = 0; i < num; i++)
+        {
+            need = (-p_ent[i].p_chnl->deficit) / p_ent[i].quantum + 1;
+            if ((rounds == 0) || (need < rounds))
+                rounds = need;
+        }
+
+        for (i = 0; i < num; i++)
+        {
+            p_ent[i].p_chnl->deficit += rounds * p_ent[i].quantum;
+            if (p_ent[i].p_chnl->deficit > p_ent[i].quantum)
+                p_ent[i].p_chnl->deficit = p_ent[i].quantum;
+        }
+    }
+
+    return (-1);
+}
+
+/*******************************************************************************
+**
+** Function         l2c_drr_idle
+**
+** Description      Called for a channel that has nothing to send. Unused
+**                  credit is not carried over; a debt from an oversized
+**                  packet is.
+**
+** Returns          void
+**
+*******************************************************************************/
+void l2c_drr_idle (tL2C_DRR_CHNL *p_chnl)
+{
+    p_chnl->backlogged = FALSE;
+
+    if (p_chnl->deficit > 0)
+        p_chnl->deficit = 0;
+}
+
+/*******************************************************************************
+**
+** Function         l2c_drr_charge
+**
+** Description      Accounts a packet of len bytes sent on the channel and the
+**                  time it waited for its turn.
+**
+** Returns          void
+**
+*******************************************************************************/
+void l2c_drr_charge (tL2C_DRR_CHNL *p_chnl, UINT16 len, UINT32 now)
+{
+    UINT32 delay = now - p_chnl->wait_start;
+
+    p_chnl->deficit -= len;
+    p_chnl->served++;
+    p_chnl->delay_total += delay;
+    if (delay > p_chnl->delay_max)
+        p_chnl->delay_max = delay;
+
+    /* if more is queued it waits from now */
+    p_chnl->wait_start = now;
+}
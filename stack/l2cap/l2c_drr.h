@@ -0,0 +1,92 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the deficit round robin channel scheduler used to pick
+ *  the next channel to send on an ACL link
+ *
+ ******************************************************************************/
+#ifndef L2C_DRR_H
+#define L2C_DRR_H
+
+#include "l2c_api.h"
+
+/* Bytes a channel of each latency class may send per round. Latency classes
+** are served before bulk in every round, so a bulk channel can delay them by
+** at most one packet.
+*/
+#ifndef L2C_DRR_QUANTUM_MEDIA
+#define L2C_DRR_QUANTUM_MEDIA       4096
+#endif
+
+#ifndef L2C_DRR_QUANTUM_HID
+#define L2C_DRR_QUANTUM_HID         512
+#endif
+
+#ifndef L2C_DRR_QUANTUM_ATT
+#define L2C_DRR_QUANTUM_ATT         1024
+#endif
+
+/* Bulk quantum for a low priority channel; doubled per channel priority step */
+#ifndef L2C_DRR_QUANTUM_BULK
+#define L2C_DRR_QUANTUM_BULK        1024
+#endif
+
+/* Per channel scheduler state */
+typedef struct
+{
+    INT32                   deficit;        /* bytes left this round, may go below zero */
+    BOOLEAN                 backlogged;     /* has data waiting to be sent */
+    tL2CAP_LATENCY_CLASS    lat_class;      /* L2CAP_LATENCY_CLASS_AUTO derives it from the PSM */
+    UINT32                  wait_start;     /* tick the channel started waiting to be served */
+    UINT32                  served;         /* packets sent */
+    UINT32                  delay_total;    /* sum of queueing delays in ticks */
+    UINT32                  delay_max;      /* largest queueing delay in ticks */
+} tL2C_DRR_CHNL;
+
+/* A channel with data to send, offered to l2c_drr_select */
+typedef struct
+{
+    tL2C_DRR_CHNL           *p_chnl;
+    UINT16                  id;             /* channel id, orders the round robin */
+    tL2CAP_LATENCY_CLASS    lat_class;      /* resolved class */
+    UINT16                  quantum;
+} tL2C_DRR_ENTRY;
+
+/* Per link scheduler state */
+typedef struct
+{
+    UINT16                  last_id[L2CAP_NUM_LATENCY_CLASS];   /* channel served last, per class */
+} tL2C_DRR;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern tL2CAP_LATENCY_CLASS l2c_drr_class_for_psm (UINT16 psm);
+extern UINT16 l2c_drr_quantum (tL2CAP_LATENCY_CLASS lat_class, tL2CAP_CHNL_PRIORITY priority);
+extern int    l2c_drr_select (tL2C_DRR *p_drr, tL2C_DRR_ENTRY *p_ent, int num, UINT32 now);
+extern void   l2c_drr_idle (tL2C_DRR_CHNL *p_chnl);
+extern void   l2c_drr_charge (tL2C_DRR_CHNL *p_chnl, UINT16 len, UINT32 now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* L2C_DRR_H */
@@ -28,6 +28,7 @@
 #include "l2cdefs.h"
 #include "gki.h"
 #include "btm_api.h"
+#include "l2c_drr.h"
 
 #define L2CAP_MIN_MTU   48      /* Minimum acceptable MTU is 48 bytes */
 
@@ -319,6 +320,9 @@ typedef struct t_l2c_ccb
     tL2CAP_CHNL_PRIORITY ccb_priority;          /* Channel priority                 */
     tL2CAP_CHNL_DATA_RATE tx_data_rate;         /* Channel Tx data rate             */
     tL2CAP_CHNL_DATA_RATE rx_data_rate;         /* Channel Rx data rate             */
+#if (L2CAP_DRR_CHANNEL_SERVICE == TRUE)
+    tL2C_DRR_CHNL       drr;                    /* Transmit scheduler state         */
+#endif
 
     /* Fields used for eL2CAP */
     tL2CAP_ERTM_INFO    ertm_info;
@@ -342,6 +346,10 @@ typedef struct t_l2c_ccb
     UINT16              fixed_chnl_idle_tout;   /* Idle timeout to use for the fixed channel       */
 #endif
 
+#if (BTU_DATA_INCLUDED == TRUE)
+    BOOLEAN             fast_data;              /* Rx data goes to the BTU data thread */
+#endif
+
 } tL2C_CCB;
 
 /***********************************************************************
@@ -404,6 +412,10 @@ typedef struct t_l2c_linkcb
 
     UINT16              link_xmit_quota;            /* Num outstanding pkts allowed     */
     UINT16              sent_not_acked;             /* Num packets sent but not acked   */
+#if (L2CAP_ADAPTIVE_ACL_ALLOC == TRUE)
+    UINT16              xmit_demand;                /* Queued + unacked pkts, avg (x16) */
+    UINT16              xmit_completed;             /* Pkts completed since rebalance   */
+#endif
 
     BOOLEAN             partial_segment_being_sent; /* Set TRUE when a partial segment  */
                                                     /* is being sent.                   */
@@ -456,6 +468,9 @@ typedef struct t_l2c_linkcb
     /* round robin service for the same priority channels */
     tL2C_RR_SERV        rr_serv[L2CAP_NUM_CHNL_PRIORITY];
     UINT8               rr_pri;                             /* current serving priority group */
+#endif
+#if (L2CAP_DRR_CHANNEL_SERVICE == TRUE)
+    tL2C_DRR            drr;                                /* deficit round robin state */
 #endif
     BOOLEAN             is_collision;
 } tL2C_LCB;
@@ -471,6 +486,11 @@ typedef struct
     UINT16          round_robin_unacked;            /* Round-robin unacked              */
     BOOLEAN         check_round_robin;              /* Do a round robin check           */
 
+#if (L2CAP_ADAPTIVE_ACL_ALLOC == TRUE)
+    UINT16          adapt_floor;                    /* Min quota per normal pri link, 0 = static */
+    UINT32          adapt_ticks;                    /* Tick of the last quota rebalance */
+#endif
+
     BOOLEAN         is_cong_cback_context;
 
     tL2C_LCB        lcb_pool[MAX_L2CAP_LINKS];      /* Link Control Block pool          */
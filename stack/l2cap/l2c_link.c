@@ -35,6 +35,7 @@
 #include "l2cdefs.h"
 #include "l2c_int.h"
 #include "l2c_api.h"
+#include "l2c_adapt.h"
 #include "btu.h"
 #include "btm_api.h"
 #include "btm_int.h"
@@ -741,9 +742,11 @@ void l2c_info_timeout (tL2C_LCB *p_lcb)
 **                  to calculate the amount of packets each link may send to
 **                  the HCI without an ack coming back.
 **
-**                  Currently, this is a simple allocation, dividing the
-**                  number of Controller Packets by the number of links. In
-**                  the future, QOS configuration should be examined.
+**                  This is a simple allocation, dividing the number of
+**                  Controller Packets by the number of links. With
+**                  L2CAP_ADAPTIVE_ACL_ALLOC it is only the starting point:
+**                  l2c_link_rebalance_allocation later moves buffers between
+**                  normal priority links according to their demand.
 **
 ** Returns          void
 **
@@ -819,6 +822,16 @@ void l2c_link_adjust_allocation (void)
         qq = qq_remainder = 1;
     }
 
+#if (L2CAP_ADAPTIVE_ACL_ALLOC == TRUE)
+    /* Normal priority links may trade buffers only if each one keeps half of */
+    /* its fair share; high priority quotas are never touched                 */
+    if ((l2cb.round_robin_quota == 0) && (num_lowpri_links > 1))
+        l2cb.adapt_floor = (qq > 1) ? qq / 2 : 1;
+    else
+        l2cb.adapt_floor = 0;
+    l2cb.adapt_ticks = GKI_get_os_tick_count();
+#endif
+
     L2CAP_TRACE_EVENT ("l2c_link_adjust_allocation  num_hipri: %u  num_lowpri: %u  low_quota: %u  round_robin_quota: %u  qq: %u",
                         num_hipri_links, num_lowpri_links, low_quota,
                         l2cb.round_robin_quota, qq);
@@ -869,6 +882,94 @@ void l2c_link_adjust_allocation (void)
 
 }
 
+#if (L2CAP_ADAPTIVE_ACL_ALLOC == TRUE)
+/*******************************************************************************
+**
+** Function         l2c_link_is_adaptive
+**
+** Description      Check if the quota of a link may be moved by the adaptive
+**                  allocator: a connected BR/EDR link of normal priority that
+**                  is not in round-robin service.
+**
+** Returns          TRUE if the link takes part in rebalancing
+**
+*******************************************************************************/
+static BOOLEAN l2c_link_is_adaptive (tL2C_LCB *p_lcb)
+{
+    return ( (p_lcb->in_use)
+          && (p_lcb->transport == BT_TRANSPORT_BR_EDR)
+          && (p_lcb->acl_priority != L2CAP_PRIORITY_HIGH)
+          && (p_lcb->link_xmit_quota != 0) );
+}
+
+/*******************************************************************************
+**
+** Function         l2c_link_rebalance_allocation
+**
+** Description      This function is called from the number-of-completed-packets
+**                  path. At most once per L2CAP_ADAPTIVE_ACL_INTERVAL_MS it
+**                  lets l2c_adapt_rebalance redistribute the buffers held by
+**                  the normal priority links. Each link keeps at least
+**                  l2cb.adapt_floor buffers, and never fewer than it has in
+**                  the controller. The total is unchanged, so high priority
+**                  quotas and their headroom are never used.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void l2c_link_rebalance_allocation (void)
+{
+    tL2C_LCB        *p_lcb;
+    tL2C_ADAPT_LINK link[MAX_L2CAP_LINKS];
+    tL2C_LCB        *p_link_lcb[MAX_L2CAP_LINKS];
+    UINT16          old_quota;
+    UINT32          now = GKI_get_os_tick_count();
+    int             xx, num_links = 0;
+
+    if ( (l2cb.adapt_floor == 0)
+      || ((now - l2cb.adapt_ticks) < GKI_MS_TO_TICKS (L2CAP_ADAPTIVE_ACL_INTERVAL_MS)) )
+        return;
+
+    l2cb.adapt_ticks = now;
+
+    for (xx = 0, p_lcb = &l2cb.lcb_pool[0]; xx < MAX_L2CAP_LINKS; xx++, p_lcb++)
+    {
+        if (!l2c_link_is_adaptive (p_lcb))
+            continue;
+
+        link[num_links].quota          = p_lcb->link_xmit_quota;
+        link[num_links].demand         = p_lcb->xmit_demand;
+        link[num_links].sent_not_acked = p_lcb->sent_not_acked;
+        link[num_links].queued         = p_lcb->link_xmit_data_q.count;
+        link[num_links].completed      = p_lcb->xmit_completed;
+        p_link_lcb[num_links++]        = p_lcb;
+    }
+
+    l2c_adapt_rebalance (link, num_links, l2cb.adapt_floor);
+
+    for (xx = 0; xx < num_links; xx++)
+    {
+        p_lcb = p_link_lcb[xx];
+        old_quota = p_lcb->link_xmit_quota;
+
+        p_lcb->xmit_demand     = link[xx].demand;
+        p_lcb->xmit_completed  = 0;
+        p_lcb->link_xmit_quota = link[xx].quota;
+
+        if (link[xx].quota == old_quota)
+            continue;
+
+        L2CAP_TRACE_DEBUG ("l2c_link_rebalance_allocation LCB %d  Demand: %d/16  XmitQuota: %d -> %d",
+                            (int)(p_lcb - l2cb.lcb_pool), p_lcb->xmit_demand, old_quota, p_lcb->link_xmit_quota);
+
+        /* A link that gained buffers may have been waiting on its quota */
+        if ( (p_lcb->link_xmit_quota > old_quota)
+          && (p_lcb->sent_not_acked < p_lcb->link_xmit_quota) )
+            l2c_link_check_send_pkts (p_lcb, NULL, NULL);
+    }
+}
+#endif
+
 /*******************************************************************************
 **
 ** Function         l2c_link_adjust_chnl_allocation
@@ -1542,6 +1643,14 @@ void l2c_link_process_num_completed_pkts (UINT8 *p)
             else
                 p_lcb->sent_not_acked = 0;
 
+#if (L2CAP_ADAPTIVE_ACL_ALLOC == TRUE)
+            if (p_lcb->transport == BT_TRANSPORT_BR_EDR)
+            {
+                p_lcb->xmit_completed += num_sent;
+                l2c_link_rebalance_allocation ();
+            }
+#endif
+
             l2c_link_check_send_pkts (p_lcb, NULL, NULL);
 
             /* If we were doing round-robin for low priority links, check 'em */
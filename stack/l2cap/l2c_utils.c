@@ -1595,9 +1595,17 @@ tL2C_CCB *l2cu_allocate_ccb (tL2C_LCB *p_lcb, UINT16 cid)
 
     p_ccb->chnl_state   = CST_CLOSED;
     p_ccb->flags        = 0;
+#if (BTU_DATA_INCLUDED == TRUE)
+    p_ccb->fast_data    = FALSE;
+#endif
     p_ccb->tx_data_rate = L2CAP_CHNL_DATA_RATE_LOW;
     p_ccb->rx_data_rate = L2CAP_CHNL_DATA_RATE_LOW;
 
+#if (L2CAP_DRR_CHANNEL_SERVICE == TRUE)
+    memset (&p_ccb->drr, 0, sizeof (tL2C_DRR_CHNL));
+    p_ccb->drr.lat_class = L2CAP_LATENCY_CLASS_AUTO;
+#endif
+
 #if (L2CAP_NON_FLUSHABLE_PB_INCLUDED == TRUE)
     p_ccb->is_flushable = FALSE;
 #endif
@@ -1693,6 +1701,24 @@ void l2cu_release_ccb (tL2C_CCB *p_ccb)
 
     btm_sec_clr_temp_auth_service (p_lcb->remote_bd_addr);
 
+#if (L2CAP_DRR_CHANNEL_SERVICE == TRUE)
+    if (p_ccb->drr.served)
+    {
+        L2CAP_TRACE_DEBUG ("l2cu_release_ccb: cid 0x%04x sent %u, queueing delay avg %u max %u ticks",
+                            p_ccb->local_cid, p_ccb->drr.served,
+                            p_ccb->drr.delay_total / p_ccb->drr.served, p_ccb->drr.delay_max);
+    }
+#endif
+
+#if (BTU_DATA_INCLUDED == TRUE)
+    /* waits out a receive callback running on the data thread */
+    if (p_ccb->fast_data)
+    {
+        btu_data_route_remove (p_lcb->handle, p_ccb->local_cid);
+        p_ccb->fast_data = FALSE;
+    }
+#endif
+
     /* Stop the timer */
     btu_stop_timer (&p_ccb->timer_entry);
 
@@ -3090,7 +3116,85 @@ tL2C_CCB *l2cu_find_ccb_by_cid (tL2C_LCB *p_lcb, UINT16 local_cid)
     return (p_ccb);
 }
 
-#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
+#if (L2CAP_DRR_CHANNEL_SERVICE == TRUE)
+
+/******************************************************************************
+**
+** Function         l2cu_get_next_channel_in_drr
+**
+** Description      get the next channel to send on a link using the deficit
+**                  round robin scheduler. Channels that cannot send right now
+**                  (closed, flow controlled, nothing queued) are left out.
+**
+** Returns          pointer to CCB or NULL
+**
+*******************************************************************************/
+static tL2C_CCB *l2cu_get_next_channel_in_drr(tL2C_LCB *p_lcb)
+{
+    tL2C_DRR_ENTRY  ent[MAX_L2CAP_CHANNELS];
+    tL2C_CCB        *p_ccb_of[MAX_L2CAP_CHANNELS];
+    tL2C_CCB        *p_ccb;
+    BOOLEAN         ready;
+    int             num = 0, idx;
+
+    for (p_ccb = p_lcb->ccb_queue.p_first_ccb; p_ccb; p_ccb = p_ccb->p_next_ccb)
+    {
+        ready = FALSE;
+
+        if (p_ccb->chnl_state == CST_OPEN)
+        {
+            /* eL2CAP option in use */
+            if (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_BASIC_MODE)
+            {
+                if (p_ccb->fcrb.wait_ack || p_ccb->fcrb.remote_busy)
+                    ready = FALSE;
+                else if (p_ccb->fcrb.retrans_q.count != 0)
+                    ready = TRUE;
+                else if (p_ccb->xmit_hold_q.count == 0)
+                    ready = FALSE;
+                /* If using the common pool, should be at least 10% free. */
+                else if ( (p_ccb->ertm_info.fcr_tx_pool_id == HCI_ACL_POOL_ID) && (GKI_poolutilization (HCI_ACL_POOL_ID) > 90) )
+                    ready = FALSE;
+                /* If in eRTM mode, check for window closure */
+                else if ( (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE) && (l2c_fcr_is_flow_controlled (p_ccb)) )
+                    ready = FALSE;
+                else
+                    ready = TRUE;
+            }
+            else
+            {
+                ready = (p_ccb->xmit_hold_q.count != 0);
+            }
+        }
+
+        if (!ready || (num == MAX_L2CAP_CHANNELS))
+        {
+            /* flow controlled channels keep waiting; idle ones stop */
+            if (p_ccb->xmit_hold_q.count == 0 && p_ccb->fcrb.retrans_q.count == 0)
+                l2c_drr_idle (&p_ccb->drr);
+            continue;
+        }
+
+        ent[num].p_chnl    = &p_ccb->drr;
+        ent[num].id        = p_ccb->local_cid;
+        ent[num].lat_class = p_ccb->drr.lat_class;
+        if (ent[num].lat_class == L2CAP_LATENCY_CLASS_AUTO)
+            ent[num].lat_class = p_ccb->p_rcb ? l2c_drr_class_for_psm (p_ccb->p_rcb->psm)
+                                              : L2CAP_LATENCY_CLASS_BULK;
+        ent[num].quantum   = l2c_drr_quantum (ent[num].lat_class, p_ccb->ccb_priority);
+        p_ccb_of[num++]    = p_ccb;
+    }
+
+    if ((idx = l2c_drr_select (&p_lcb->drr, ent, num, GKI_get_os_tick_count())) < 0)
+        return NULL;
+
+    L2CAP_TRACE_DEBUG("DRR service class=%d, deficit=%d, lcid=0x%04x",
+                        ent[idx].lat_class, ent[idx].p_chnl->deficit, p_ccb_of[idx]->local_cid);
+
+    return p_ccb_of[idx];
+}
+
+#elif (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
 
 /******************************************************************************
 **
@@ -3197,7 +3301,7 @@ static tL2C_CCB *l2cu_get_next_channel_in_rr(tL2C_LCB *p_lcb)
     return p_serve_ccb;
 }
 
-#else /* (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE) */
+#else /* (L2CAP_DRR_CHANNEL_SERVICE == TRUE) */
 
 /******************************************************************************
 **
@@ -3243,7 +3347,7 @@ static tL2C_CCB *l2cu_get_next_channel(tL2C_LCB *p_lcb)
 
     return NULL;
 }
-#endif /* (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE) */
+#endif /* (L2CAP_DRR_CHANNEL_SERVICE == TRUE) */
 
 /******************************************************************************
 **
@@ -3315,7 +3419,10 @@ BT_HDR *l2cu_get_next_buffer_to_send (tL2C_LCB *p_lcb)
     }
 #endif
 
-#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
+#if (L2CAP_DRR_CHANNEL_SERVICE == TRUE)
+    /* get next serving channel by deficit round-robin */
+    p_ccb  = l2cu_get_next_channel_in_drr( p_lcb );
+#elif (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
     /* get next serving channel in round-robin */
     p_ccb  = l2cu_get_next_channel_in_rr( p_lcb );
 #else
@@ -3341,6 +3448,10 @@ BT_HDR *l2cu_get_next_buffer_to_send (tL2C_LCB *p_lcb)
         }
     }
 
+#if (L2CAP_DRR_CHANNEL_SERVICE == TRUE)
+    l2c_drr_charge (&p_ccb->drr, p_buf->len, GKI_get_os_tick_count());
+#endif
+
     if ( p_ccb->p_rcb && p_ccb->p_rcb->api.pL2CA_TxComplete_Cb && (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_ERTM_MODE) )
         (*p_ccb->p_rcb->api.pL2CA_TxComplete_Cb)(p_ccb->local_cid, 1);
 
@@ -572,6 +572,30 @@ tPAN_RESULT PAN_Write(UINT16 handle, BD_ADDR dst, BD_ADDR src, UINT16 protocol,
         return PAN_SUCCESS;
     }
 
+    // Drop frames the peer has filtered out before copying them. Frames with
+    // extension headers still go through BNEP since the headers are forwarded.
+    if (!ext) {
+        tPAN_CONN *pcb = NULL;
+        if (pan_cb.active_role == PAN_ROLE_CLIENT) {
+            int i;
+            for (i = 0; i < MAX_PAN_CONNS; ++i) {
+                if (pan_cb.pcb[i].con_state == PAN_STATE_CONNECTED &&
+                    pan_cb.pcb[i].src_uuid == UUID_SERVCLASS_PANU) {
+                    pcb = &pan_cb.pcb[i];
+                    break;
+                }
+            }
+        } else {
+            pcb = pan_get_pcb_by_handle(handle);
+        }
+
+        if (pcb && pcb->con_state == PAN_STATE_CONNECTED &&
+            BNEP_IsPacketAllowed(pcb->handle, dst, protocol, FALSE, p_data) == BNEP_IGNORE_CMD) {
+            PAN_TRACE_DEBUG("%s frame filtered out by peer.", __func__);
+            return PAN_IGNORE_CMD;
+        }
+    }
+
     buffer = (BT_HDR *)GKI_getpoolbuf(PAN_POOL_ID);
     if (!buffer) {
         PAN_TRACE_ERROR("%s unable to acquire buffer from pool.", __func__);
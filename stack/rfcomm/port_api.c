@@ -1552,63 +1552,88 @@ int PORT_WriteDataCO (UINT16 handle, int* p_len)
 
     PORT_SCHEDULE_UNLOCK;
 
-    //int max_read = length < p_port->peer_mtu ? length : p_port->peer_mtu;
-
-    //max_read = available < max_read ? available : max_read;
+    if (p_port->peer_mtu < length)
+        length = p_port->peer_mtu;
 
     while (available)
     {
-        /* if we're over buffer high water mark, we're done */
-        if ((p_port->tx.queue_size  > PORT_TX_HIGH_WM)
-         || (p_port->tx.queue.count > PORT_TX_BUF_HIGH_WM))
+        BT_HDR  *bufs[PORT_DATA_VEC_MAX];
+        UINT16  buf_cnt = 0;
+        int     batch = 0;
+        UINT16  xx;
+
+        /* Build a chain of buffers sized to the peer MTU so that the call-out */
+        /* can fill all of them with a single scatter read from the socket     */
+        while ((buf_cnt < PORT_DATA_VEC_MAX) && (batch < available))
         {
+            /* if we're over buffer high water mark, stop growing the chain */
+            if ((p_port->tx.queue_size + batch > PORT_TX_HIGH_WM)
+             || (p_port->tx.queue.count + buf_cnt > PORT_TX_BUF_HIGH_WM))
+                break;
+
+            p_buf = (BT_HDR *)GKI_getpoolbuf (RFCOMM_DATA_POOL_ID);
+            if (!p_buf)
+                break;
+
+            p_buf->offset         = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
+            p_buf->layer_specific = handle;
+            p_buf->event          = BT_EVT_TO_BTU_SP_DATA;
+            p_buf->len            = length;
+            if (available - batch < (int)length)
+                p_buf->len = (UINT16)(available - batch);
+
+            bufs[buf_cnt++] = p_buf;
+            batch += p_buf->len;
+        }
+
+        if (!buf_cnt)
+        {
+            /* we're over buffer high water mark or out of buffers, we're done */
             port_flow_control_user(p_port);
             event |= PORT_EV_FC;
             debug("tx queue is full,tx.queue_size:%d,tx.queue.count:%d,available:%d",
                     p_port->tx.queue_size, p_port->tx.queue.count, available);
             break;
-         }
-
-        /* continue with rfcomm data write */
-        p_buf = (BT_HDR *)GKI_getpoolbuf (RFCOMM_DATA_POOL_ID);
-        if (!p_buf)
-            break;
-
-        p_buf->offset         = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
-        p_buf->layer_specific = handle;
-
-        if (p_port->peer_mtu < length)
-            length = p_port->peer_mtu;
-        if (available < (int)length)
-            length = (UINT16)available;
-        p_buf->len = length;
-        p_buf->event          = BT_EVT_TO_BTU_SP_DATA;
+        }
 
-        //memcpy ((UINT8 *)(p_buf + 1) + p_buf->offset, p_data, length);
-        //if(recv(fd, (UINT8 *)(p_buf + 1) + p_buf->offset, (int)length, 0) != (int)length)
-        if(p_port->p_data_co_callback(handle, (UINT8 *)(p_buf + 1) + p_buf->offset, length,
-                                      DATA_CO_CALLBACK_TYPE_OUTGOING) == FALSE)
+        if(p_port->p_data_co_callback(handle, (UINT8 *)bufs, buf_cnt,
+                                      DATA_CO_CALLBACK_TYPE_OUTGOING_VEC) == FALSE)
         {
-            error("p_data_co_callback DATA_CO_CALLBACK_TYPE_OUTGOING failed, length:%d", length);
+            error("p_data_co_callback DATA_CO_CALLBACK_TYPE_OUTGOING_VEC failed, count:%d, length:%d",
+                    buf_cnt, batch);
+            for (xx = 0; xx < buf_cnt; xx++)
+                GKI_freebuf (bufs[xx]);
             return (PORT_UNKNOWN_ERROR);
         }
 
+        RFCOMM_TRACE_EVENT ("PORT_WriteDataCO %d bytes in %d buffers", batch, buf_cnt);
 
-        RFCOMM_TRACE_EVENT ("PORT_WriteData %d bytes", length);
+        for (xx = 0; xx < buf_cnt; xx++)
+        {
+            UINT16 buf_len = bufs[xx]->len;
 
-        rc = port_write (p_port, p_buf);
+            rc = port_write (p_port, bufs[xx]);
 
-        /* If queue went below the threashold need to send flow control */
-        event |= port_flow_control_user (p_port);
+            /* If queue went below the threashold need to send flow control */
+            event |= port_flow_control_user (p_port);
 
-        if (rc == PORT_SUCCESS)
-            event |= PORT_EV_TXCHAR;
+            if (rc == PORT_SUCCESS)
+                event |= PORT_EV_TXCHAR;
+
+            if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING))
+            {
+                /* port_write() released the failed buffer, drop the rest of the chain */
+                while (++xx < buf_cnt)
+                    GKI_freebuf (bufs[xx]);
+                break;
+            }
+
+            *p_len  += buf_len;
+            available -= (int)buf_len;
+        }
 
         if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING))
             break;
-
-        *p_len  += length;
-        available -= (int)length;
     }
     if (!available && (rc != PORT_CMD_PENDING) && (rc != PORT_TX_QUEUE_DISABLED))
         event |= PORT_EV_TXEMPTY;
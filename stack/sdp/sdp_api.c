@@ -110,6 +110,27 @@ BOOLEAN SDP_InitDiscoveryDb (tSDP_DISCOVERY_DB *p_db, UINT32 len, UINT16 num_uui
 
 
 
+/*******************************************************************************
+**
+** Function         SDP_FreeDiscoveryDb
+**
+** Description      This function frees a discovery database, with the memory
+**                  it added while it was filled.
+**
+** Returns          void
+**
+*******************************************************************************/
+void SDP_FreeDiscoveryDb (tSDP_DISCOVERY_DB *p_db)
+{
+    if (p_db == NULL)
+        return;
+
+#if SDP_CLIENT_ENABLED == TRUE
+    sdp_db_free_ext_mem (p_db);
+#endif
+    GKI_freebuf (p_db);
+}
+
 /*******************************************************************************
 **
 ** Function         SDP_CancelServiceSearch
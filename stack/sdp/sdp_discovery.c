@@ -46,15 +46,8 @@
 /********************************************************************************/
 #if SDP_CLIENT_ENABLED == TRUE
 static void          process_service_search_rsp (tCONN_CB *p_ccb, UINT8 *p_reply);
-static void          process_service_attr_rsp (tCONN_CB *p_ccb, UINT8 *p_reply);
-static void          process_service_search_attr_rsp (tCONN_CB *p_ccb, UINT8 *p_reply);
-static UINT8         *save_attr_seq (tCONN_CB *p_ccb, UINT8 *p, UINT8 *p_msg_end);
-static tSDP_DISC_REC *add_record (tSDP_DISCOVERY_DB *p_db, BD_ADDR p_bda);
-static UINT8         *add_attr (UINT8 *p, tSDP_DISCOVERY_DB *p_db, tSDP_DISC_REC *p_rec,
-                                UINT16 attr_id, tSDP_DISC_ATTR *p_parent_attr, UINT8 nest_level);
-
-/* Safety check in case we go crazy */
-#define MAX_NEST_LEVELS     5
+static void          process_service_attr_rsp (tCONN_CB *p_ccb, UINT8 *p_reply, UINT8 *p_reply_end);
+static void          process_service_search_attr_rsp (tCONN_CB *p_ccb, UINT8 *p_reply, UINT8 *p_reply_end);
 
 
 /*******************************************************************************
@@ -219,7 +212,7 @@ void sdp_disc_connected (tCONN_CB *p_ccb)
     {
         p_ccb->disc_state = SDP_DISC_WAIT_SEARCH_ATTR;
 
-        process_service_search_attr_rsp (p_ccb, NULL);
+        process_service_search_attr_rsp (p_ccb, NULL, NULL);
     }
     else
     {
@@ -245,7 +238,7 @@ void sdp_disc_connected (tCONN_CB *p_ccb)
 *******************************************************************************/
 void sdp_disc_server_rsp (tCONN_CB *p_ccb, BT_HDR *p_msg)
 {
-    UINT8           *p, rsp_pdu;
+    UINT8           *p, *p_end, rsp_pdu;
     BOOLEAN         invalid_pdu = TRUE;
 
 #if (SDP_DEBUG_RAW == TRUE)
@@ -272,6 +265,7 @@ void sdp_disc_server_rsp (tCONN_CB *p_ccb, BT_HDR *p_msg)
 
     /* Got a reply!! Check what we got back */
     p = (UINT8 *)(p_msg + 1) + p_msg->offset;
+    p_end = p + p_msg->len;
 
     BE_STREAM_TO_UINT8 (rsp_pdu, p);
 
@@ -290,7 +284,7 @@ void sdp_disc_server_rsp (tCONN_CB *p_ccb, BT_HDR *p_msg)
     case SDP_PDU_SERVICE_ATTR_RSP:
         if (p_ccb->disc_state == SDP_DISC_WAIT_ATTR)
         {
-            process_service_attr_rsp (p_ccb, p);
+            process_service_attr_rsp (p_ccb, p, p_end);
             invalid_pdu = FALSE;
         }
         break;
@@ -298,7 +292,7 @@ void sdp_disc_server_rsp (tCONN_CB *p_ccb, BT_HDR *p_msg)
     case SDP_PDU_SERVICE_SEARCH_ATTR_RSP:
         if (p_ccb->disc_state == SDP_DISC_WAIT_SEARCH_ATTR)
         {
-            process_service_search_attr_rsp (p_ccb, p);
+            process_service_search_attr_rsp (p_ccb, p, p_end);
             invalid_pdu = FALSE;
         }
         break;
@@ -367,65 +361,71 @@ static void process_service_search_rsp (tCONN_CB *p_ccb, UINT8 *p_reply)
         p_ccb->disc_state = SDP_DISC_WAIT_ATTR;
 
         /* Kick off the first attribute request */
-        process_service_attr_rsp (p_ccb, NULL);
+        process_service_attr_rsp (p_ccb, NULL, NULL);
     }
 }
 
 /*******************************************************************************
 **
-** Function         sdp_copy_raw_data
-**
-** Description      copy the raw data
+** Function         sdp_disc_parse_rsp
 **
+** Description      This function passes the attribute list bytes of an
+**                  attribute response, or of a search attribute response,
+**                  to the parser of the CCB.
 **
-** Returns          void
+** Returns          pointer to the continuation state of the response, or
+**                  NULL if the discovery was disconnected on an error
 **
 *******************************************************************************/
-#if (SDP_RAW_DATA_INCLUDED == TRUE)
-static void sdp_copy_raw_data (tCONN_CB *p_ccb, BOOLEAN offset)
+static UINT8 *sdp_disc_parse_rsp (tCONN_CB *p_ccb, UINT8 *p_reply, UINT8 *p_reply_end)
 {
-    unsigned int    cpy_len;
-    UINT32          list_len;
-    UINT8           *p;
-    UINT8           * p_temp;
-    UINT8           type;
-    UINT32          delta_len = 0;
+    UINT16          list_byte_count;
+    UINT16          status;
 
+    if (p_reply_end - p_reply < 6)
+    {
+        sdp_disconnect (p_ccb, SDP_INVALID_PDU_SIZE);
+        return (NULL);
+    }
 #if (SDP_DEBUG_RAW == TRUE)
-    UINT8 num_array[SDP_MAX_LIST_BYTE_COUNT];
-    UINT32 i;
+    SDP_TRACE_WARNING("ID & len: 0x%02x-%02x-%02x-%02x",
+        p_reply[0], p_reply[1], p_reply[2], p_reply[3]);
+#endif
+    /* Skip transaction ID and length */
+    p_reply += 4;
 
-    for (i = 0; i < p_ccb->list_len; i++)
+    BE_STREAM_TO_UINT16 (list_byte_count, p_reply);
+#if (SDP_DEBUG_RAW == TRUE)
+    SDP_TRACE_WARNING("list_byte_count:%d, parsed: %d", list_byte_count, p_ccb->parse.offset);
+#endif
+
+    /* The lists and the continuation state must be in the response, and within the limit */
+    if (list_byte_count >= p_reply_end - p_reply
+     || p_ccb->parse.offset + list_byte_count > SDP_MAX_LIST_BYTE_COUNT)
     {
-        sprintf((char *)&num_array[i*2],"%02X",(UINT8)(p_ccb->rsp_list[i]));
+        sdp_disconnect (p_ccb, SDP_INVALID_PDU_SIZE);
+        return (NULL);
     }
-    SDP_TRACE_WARNING("result :%s",num_array);
-#endif
 
-    if(p_ccb->p_db->raw_data)
+    /* Parse the lists right away; what is not complete is finished by the next response */
+    if ((status = sdp_parse_data (&p_ccb->parse, p_reply, list_byte_count)) != SDP_SUCCESS)
     {
-        cpy_len = p_ccb->p_db->raw_size - p_ccb->p_db->raw_used;
-        list_len = p_ccb->list_len;
-        p_temp = p = &p_ccb->rsp_list[0];
+        sdp_disconnect (p_ccb, status);
+        return (NULL);
+    }
+    p_reply += list_byte_count;
 
-        if(offset)
-        {
-            type = *p++;
-            p = sdpu_get_len_from_type (p, type, &list_len);
-        }
-        if(list_len && list_len < cpy_len )
-        {
-            cpy_len = list_len;
-        }
 #if (SDP_DEBUG_RAW == TRUE)
-        SDP_TRACE_WARNING("list_len :%d cpy_len:%d raw_size:%d raw_used:%d",
-            list_len, cpy_len, p_ccb->p_db->raw_size, p_ccb->p_db->raw_used);
+    SDP_TRACE_WARNING("*p_reply:%d(%d)", *p_reply, SDP_MAX_CONTINUATION_LEN);
 #endif
-        memcpy (&p_ccb->p_db->raw_data[p_ccb->p_db->raw_used], p, cpy_len);
-        p_ccb->p_db->raw_used += cpy_len;
+    if (*p_reply > SDP_MAX_CONTINUATION_LEN || *p_reply >= p_reply_end - p_reply)
+    {
+        sdp_disconnect (p_ccb, SDP_INVALID_CONT_STATE);
+        return (NULL);
     }
+
+    return (p_reply);
 }
-#endif
 
 /*******************************************************************************
 **
@@ -437,10 +437,10 @@ static void sdp_copy_raw_data (tCONN_CB *p_ccb, BOOLEAN offset)
 ** Returns          void
 **
 *******************************************************************************/
-static void process_service_attr_rsp (tCONN_CB *p_ccb, UINT8 *p_reply)
+static void process_service_attr_rsp (tCONN_CB *p_ccb, UINT8 *p_reply, UINT8 *p_reply_end)
 {
     UINT8           *p_start, *p_param_len;
-    UINT16          param_len, list_byte_count;
+    UINT16          param_len;
     BOOLEAN         cont_request_needed = FALSE;
 
 #if (SDP_DEBUG_RAW == TRUE)
@@ -450,72 +450,22 @@ static void process_service_attr_rsp (tCONN_CB *p_ccb, UINT8 *p_reply)
     /* If p_reply is NULL, we were called after the records handles were read */
     if (p_reply)
     {
-#if (SDP_DEBUG_RAW == TRUE)
-        SDP_TRACE_WARNING("ID & len: 0x%02x-%02x-%02x-%02x",
-            p_reply[0], p_reply[1], p_reply[2], p_reply[3]);
-#endif
-        /* Skip transaction ID and length */
-        p_reply += 4;
-
-        BE_STREAM_TO_UINT16 (list_byte_count, p_reply);
-#if (SDP_DEBUG_RAW == TRUE)
-        SDP_TRACE_WARNING("list_byte_count:%d", list_byte_count);
-#endif
-
-        /* Copy the response to the scratchpad. First, a safety check on the length */
-        if ((p_ccb->list_len + list_byte_count) > SDP_MAX_LIST_BYTE_COUNT)
-        {
-            sdp_disconnect (p_ccb, SDP_INVALID_PDU_SIZE);
+        if ((p_reply = sdp_disc_parse_rsp (p_ccb, p_reply, p_reply_end)) == NULL)
             return;
-        }
-
-#if (SDP_DEBUG_RAW == TRUE)
-        SDP_TRACE_WARNING("list_len: %d, list_byte_count: %d",
-            p_ccb->list_len, list_byte_count);
-#endif
-        if (p_ccb->rsp_list == NULL)
-        {
-            p_ccb->rsp_list = (UINT8 *)GKI_getbuf (SDP_MAX_LIST_BYTE_COUNT);
-            if (p_ccb->rsp_list == NULL)
-            {
-                SDP_TRACE_ERROR ("SDP - no gki buf to save rsp");
-                sdp_disconnect (p_ccb, SDP_NO_RESOURCES);
-                return;
-            }
-        }
-        memcpy (&p_ccb->rsp_list[p_ccb->list_len], p_reply, list_byte_count);
-        p_ccb->list_len += list_byte_count;
-        p_reply         += list_byte_count;
-#if (SDP_DEBUG_RAW == TRUE)
-        SDP_TRACE_WARNING("list_len: %d(attr_rsp)", p_ccb->list_len);
 
         /* Check if we need to request a continuation */
-        SDP_TRACE_WARNING("*p_reply:%d(%d)", *p_reply, SDP_MAX_CONTINUATION_LEN);
-#endif
         if (*p_reply)
         {
-            if (*p_reply > SDP_MAX_CONTINUATION_LEN)
-            {
-                sdp_disconnect (p_ccb, SDP_INVALID_CONT_STATE);
-                return;
-            }
             cont_request_needed = TRUE;
         }
         else
         {
-
-#if (SDP_RAW_DATA_INCLUDED == TRUE)
-            SDP_TRACE_WARNING("process_service_attr_rsp");
-            sdp_copy_raw_data (p_ccb, FALSE);
-#endif
-
-            /* Save the response in the database. Stop on any error */
-            if (!save_attr_seq (p_ccb, &p_ccb->rsp_list[0], &p_ccb->rsp_list[p_ccb->list_len]))
+            /* The attribute list must be complete */
+            if (!sdp_parse_done (&p_ccb->parse))
             {
                 sdp_disconnect (p_ccb, SDP_DB_FULL);
                 return;
             }
-            p_ccb->list_len = 0;
             p_ccb->cur_handle++;
         }
     }
@@ -532,6 +482,10 @@ static void process_service_attr_rsp (tCONN_CB *p_ccb, UINT8 *p_reply)
             return;
         }
 
+        /* The attribute list of the next record starts */
+        if (!cont_request_needed)
+            sdp_parse_init (&p_ccb->parse, p_ccb->p_db, p_ccb->device_address, FALSE);
+
         p_msg->offset = L2CAP_MIN_OFFSET;
         p = p_start = (UINT8 *)(p_msg + 1) + L2CAP_MIN_OFFSET;
 
@@ -595,12 +549,10 @@ static void process_service_attr_rsp (tCONN_CB *p_ccb, UINT8 *p_reply)
 ** Returns          void
 **
 *******************************************************************************/
-static void process_service_search_attr_rsp (tCONN_CB *p_ccb, UINT8 *p_reply)
+static void process_service_search_attr_rsp (tCONN_CB *p_ccb, UINT8 *p_reply, UINT8 *p_reply_end)
 {
-    UINT8           *p, *p_start, *p_end, *p_param_len;
-    UINT8           type;
-    UINT32          seq_len;
-    UINT16          param_len, lists_byte_count = 0;
+    UINT8           *p_start, *p_param_len;
+    UINT16          param_len;
     BOOLEAN         cont_request_needed = FALSE;
 
 #if (SDP_DEBUG_RAW == TRUE)
@@ -609,58 +561,16 @@ static void process_service_search_attr_rsp (tCONN_CB *p_ccb, UINT8 *p_reply)
     /* If p_reply is NULL, we were called for the initial read */
     if (p_reply)
     {
-#if (SDP_DEBUG_RAW == TRUE)
-        SDP_TRACE_WARNING("ID & len: 0x%02x-%02x-%02x-%02x",
-            p_reply[0], p_reply[1], p_reply[2], p_reply[3]);
-#endif
-        /* Skip transaction ID and length */
-        p_reply += 4;
-
-        BE_STREAM_TO_UINT16 (lists_byte_count, p_reply);
-#if (SDP_DEBUG_RAW == TRUE)
-        SDP_TRACE_WARNING("lists_byte_count:%d", lists_byte_count);
-#endif
-
-        /* Copy the response to the scratchpad. First, a safety check on the length */
-        if ((p_ccb->list_len + lists_byte_count) > SDP_MAX_LIST_BYTE_COUNT)
-        {
-            sdp_disconnect (p_ccb, SDP_INVALID_PDU_SIZE);
+        if ((p_reply = sdp_disc_parse_rsp (p_ccb, p_reply, p_reply_end)) == NULL)
             return;
-        }
-
-#if (SDP_DEBUG_RAW == TRUE)
-        SDP_TRACE_WARNING("list_len: %d, list_byte_count: %d",
-            p_ccb->list_len, lists_byte_count);
-#endif
-        if (p_ccb->rsp_list == NULL)
-        {
-            p_ccb->rsp_list = (UINT8 *)GKI_getbuf (SDP_MAX_LIST_BYTE_COUNT);
-            if (p_ccb->rsp_list == NULL)
-            {
-                SDP_TRACE_ERROR ("SDP - no gki buf to save rsp");
-                sdp_disconnect (p_ccb, SDP_NO_RESOURCES);
-                return;
-            }
-        }
-        memcpy (&p_ccb->rsp_list[p_ccb->list_len], p_reply, lists_byte_count);
-        p_ccb->list_len += lists_byte_count;
-        p_reply         += lists_byte_count;
-#if (SDP_DEBUG_RAW == TRUE)
-        SDP_TRACE_WARNING("list_len: %d(search_attr_rsp)", p_ccb->list_len);
 
         /* Check if we need to request a continuation */
-        SDP_TRACE_WARNING("*p_reply:%d(%d)", *p_reply, SDP_MAX_CONTINUATION_LEN);
-#endif
         if (*p_reply)
-        {
-            if (*p_reply > SDP_MAX_CONTINUATION_LEN)
-            {
-                sdp_disconnect (p_ccb, SDP_INVALID_CONT_STATE);
-                return;
-            }
-
             cont_request_needed = TRUE;
-        }
+    }
+    else
+    {
+        sdp_parse_init (&p_ccb->parse, p_ccb->p_db, p_ccb->device_address, TRUE);
     }
 
 #if (SDP_DEBUG_RAW == TRUE)
@@ -736,396 +646,14 @@ static void process_service_search_attr_rsp (tCONN_CB *p_ccb, UINT8 *p_reply)
     /* We now have the full response, which is a sequence of sequences */
     /*******************************************************************/
 
-#if (SDP_RAW_DATA_INCLUDED == TRUE)
-    SDP_TRACE_WARNING("process_service_search_attr_rsp");
-    sdp_copy_raw_data (p_ccb, TRUE);
-#endif
-
-    p = &p_ccb->rsp_list[0];
-
-    /* The contents is a sequence of attribute sequences */
-    type = *p++;
-
-    if ((type >> 3) != DATA_ELE_SEQ_DESC_TYPE)
-    {
-        SDP_TRACE_WARNING ("SDP - Wrong type: 0x%02x in attr_rsp", type);
-        return;
-    }
-    p = sdpu_get_len_from_type (p, type, &seq_len);
-
-    p_end = &p_ccb->rsp_list[p_ccb->list_len];
-
-    if ((p + seq_len) != p_end)
+    if (!sdp_parse_done (&p_ccb->parse))
     {
         sdp_disconnect (p_ccb, SDP_INVALID_CONT_STATE);
         return;
     }
 
-    while (p < p_end)
-    {
-        p = save_attr_seq (p_ccb, p, &p_ccb->rsp_list[p_ccb->list_len]);
-        if (!p)
-        {
-            sdp_disconnect (p_ccb, SDP_DB_FULL);
-            return;
-        }
-    }
-
     /* Since we got everything we need, disconnect the call */
     sdp_disconnect (p_ccb, SDP_SUCCESS);
 }
 
-/*******************************************************************************
-**
-** Function         save_attr_seq
-**
-** Description      This function is called when there is a response from
-**                  the server.
-**
-** Returns          pointer to next byte or NULL if error
-**
-*******************************************************************************/
-static UINT8 *save_attr_seq (tCONN_CB *p_ccb, UINT8 *p, UINT8 *p_msg_end)
-{
-    UINT32      seq_len, attr_len;
-    UINT16      attr_id;
-    UINT8       type, *p_seq_end;
-    tSDP_DISC_REC *p_rec;
-
-    type = *p++;
-
-    if ((type >> 3) != DATA_ELE_SEQ_DESC_TYPE)
-    {
-        SDP_TRACE_WARNING ("SDP - Wrong type: 0x%02x in attr_rsp", type);
-        return (NULL);
-    }
-
-    p = sdpu_get_len_from_type (p, type, &seq_len);
-    if ((p + seq_len) > p_msg_end)
-    {
-        SDP_TRACE_WARNING ("SDP - Bad len in attr_rsp %d", seq_len);
-        return (NULL);
-    }
-
-    /* Create a record */
-    p_rec = add_record (p_ccb->p_db, p_ccb->device_address);
-    if (!p_rec)
-    {
-        SDP_TRACE_WARNING ("SDP - DB full add_record");
-        return (NULL);
-    }
-
-    p_seq_end = p + seq_len;
-
-    while (p < p_seq_end)
-    {
-        /* First get the attribute ID */
-        type = *p++;
-        p = sdpu_get_len_from_type (p, type, &attr_len);
-        if (((type >> 3) != UINT_DESC_TYPE) || (attr_len != 2))
-        {
-            SDP_TRACE_WARNING ("SDP - Bad type: 0x%02x or len: %d in attr_rsp", type, attr_len);
-            return (NULL);
-        }
-        BE_STREAM_TO_UINT16 (attr_id, p);
-
-        /* Now, add the attribute value */
-        p = add_attr (p, p_ccb->p_db, p_rec, attr_id, NULL, 0);
-
-        if (!p)
-        {
-            SDP_TRACE_WARNING ("SDP - DB full add_attr");
-            return (NULL);
-        }
-    }
-
-    return (p);
-}
-
-
-/*******************************************************************************
-**
-** Function         add_record
-**
-** Description      This function allocates space for a record from the DB.
-**
-** Returns          pointer to next byte in data stream
-**
-*******************************************************************************/
-tSDP_DISC_REC *add_record (tSDP_DISCOVERY_DB *p_db, BD_ADDR p_bda)
-{
-    tSDP_DISC_REC   *p_rec;
-
-    /* See if there is enough space in the database */
-    if (p_db->mem_free < sizeof (tSDP_DISC_REC))
-        return (NULL);
-
-    p_rec = (tSDP_DISC_REC *) p_db->p_free_mem;
-    p_db->p_free_mem += sizeof (tSDP_DISC_REC);
-    p_db->mem_free   -= sizeof (tSDP_DISC_REC);
-
-    p_rec->p_first_attr = NULL;
-    p_rec->p_next_rec   = NULL;
-
-    memcpy (p_rec->remote_bd_addr, p_bda, BD_ADDR_LEN);
-
-    /* Add the record to the end of chain */
-    if (!p_db->p_first_rec)
-        p_db->p_first_rec = p_rec;
-    else
-    {
-        tSDP_DISC_REC   *p_rec1 = p_db->p_first_rec;
-
-        while (p_rec1->p_next_rec)
-            p_rec1 = p_rec1->p_next_rec;
-
-        p_rec1->p_next_rec = p_rec;
-    }
-
-    return (p_rec);
-}
-
-#define SDP_ADDITIONAL_LIST_MASK        0x80
-/*******************************************************************************
-**
-** Function         add_attr
-**
-** Description      This function allocates space for an attribute from the DB
-**                  and copies the data into it.
-**
-** Returns          pointer to next byte in data stream
-**
-*******************************************************************************/
-static UINT8 *add_attr (UINT8 *p, tSDP_DISCOVERY_DB *p_db, tSDP_DISC_REC *p_rec,
-                        UINT16 attr_id, tSDP_DISC_ATTR *p_parent_attr, UINT8 nest_level)
-{
-    tSDP_DISC_ATTR  *p_attr;
-    UINT32          attr_len;
-    UINT32          total_len;
-    UINT16          attr_type;
-    UINT16          id;
-    UINT8           type;
-    UINT8           *p_end;
-    UINT8           is_additional_list = nest_level & SDP_ADDITIONAL_LIST_MASK;
-
-    nest_level &= ~(SDP_ADDITIONAL_LIST_MASK);
-
-    type = *p++;
-    p = sdpu_get_len_from_type (p, type, &attr_len);
-
-    attr_len &= SDP_DISC_ATTR_LEN_MASK;
-    attr_type = (type >> 3) & 0x0f;
-
-    /* See if there is enough space in the database */
-    if (attr_len > 4)
-        total_len = attr_len - 4 + (UINT16)sizeof (tSDP_DISC_ATTR);
-    else
-        total_len = sizeof (tSDP_DISC_ATTR);
-
-    /* Ensure it is a multiple of 4 */
-    total_len = (total_len + 3) & ~3;
-
-    /* See if there is enough space in the database */
-    if (p_db->mem_free < total_len)
-        return (NULL);
-
-    p_attr                = (tSDP_DISC_ATTR *) p_db->p_free_mem;
-    p_attr->attr_id       = attr_id;
-    p_attr->attr_len_type = (UINT16)attr_len | (attr_type << 12);
-    p_attr->p_next_attr = NULL;
-
-    /* Store the attribute value */
-    switch (attr_type)
-    {
-    case UINT_DESC_TYPE:
-        if( (is_additional_list != 0) && (attr_len == 2) )
-        {
-            BE_STREAM_TO_UINT16 (id, p);
-            if(id != ATTR_ID_PROTOCOL_DESC_LIST)
-                p -= 2;
-            else
-            {
-                /* Reserve the memory for the attribute now, as we need to add sub-attributes */
-                p_db->p_free_mem += sizeof (tSDP_DISC_ATTR);
-                p_db->mem_free   -= sizeof (tSDP_DISC_ATTR);
-                p_end             = p + attr_len;
-                total_len         = 0;
-
-                /* SDP_TRACE_DEBUG ("SDP - attr nest level:%d(list)", nest_level); */
-                if (nest_level >= MAX_NEST_LEVELS)
-                {
-                    SDP_TRACE_ERROR ("SDP - attr nesting too deep");
-                    return (p_end);
-                }
-
-                /* Now, add the list entry */
-                p = add_attr (p, p_db, p_rec, ATTR_ID_PROTOCOL_DESC_LIST, p_attr, (UINT8)(nest_level + 1));
-
-                break;
-            }
-        }
-        /* Case falls through */
-
-    case TWO_COMP_INT_DESC_TYPE:
-        switch (attr_len)
-        {
-        case 1:
-            p_attr->attr_value.v.u8 = *p++;
-            break;
-        case 2:
-            BE_STREAM_TO_UINT16 (p_attr->attr_value.v.u16, p);
-            break;
-        case 4:
-            BE_STREAM_TO_UINT32 (p_attr->attr_value.v.u32, p);
-            break;
-        default:
-            BE_STREAM_TO_ARRAY (p, p_attr->attr_value.v.array, (INT32)attr_len);
-            break;
-        }
-        break;
-
-    case UUID_DESC_TYPE:
-        switch (attr_len)
-        {
-        case 2:
-            BE_STREAM_TO_UINT16 (p_attr->attr_value.v.u16, p);
-            break;
-        case 4:
-            BE_STREAM_TO_UINT32 (p_attr->attr_value.v.u32, p);
-            if (p_attr->attr_value.v.u32 < 0x10000)
-            {
-                attr_len = 2;
-                p_attr->attr_len_type = (UINT16)attr_len | (attr_type << 12);
-                p_attr->attr_value.v.u16 = (UINT16) p_attr->attr_value.v.u32;
-
-            }
-            break;
-        case 16:
-            /* See if we can compress his UUID down to 16 or 32bit UUIDs */
-            if (sdpu_is_base_uuid (p))
-            {
-                if ((p[0] == 0) && (p[1] == 0))
-                {
-                    p_attr->attr_len_type = (p_attr->attr_len_type & ~SDP_DISC_ATTR_LEN_MASK) | 2;
-                    p += 2;
-                    BE_STREAM_TO_UINT16 (p_attr->attr_value.v.u16, p);
-                    p += MAX_UUID_SIZE - 4;
-                }
-                else
-                {
-                    p_attr->attr_len_type = (p_attr->attr_len_type & ~SDP_DISC_ATTR_LEN_MASK) | 4;
-                    BE_STREAM_TO_UINT32 (p_attr->attr_value.v.u32, p);
-                    p += MAX_UUID_SIZE - 4;
-                }
-            }
-            else
-            {
-                 /* coverity[overrun-local] */
-                 /*
-                    Event overrun-local: Overrun of static array "p_attr->attr_value.v.array" of size 4 at position 15 with index variable "ijk"
-                    False-positive: SDP uses scratch buffer to hold the attribute value.
-                    The actual size of tSDP_DISC_ATVAL does not matter.
-                    If the array size in tSDP_DISC_ATVAL is increase, we would increase the system RAM usage unnecessarily
-                */
-                BE_STREAM_TO_ARRAY (p, p_attr->attr_value.v.array, (INT32)attr_len);
-            }
-            break;
-        default:
-            SDP_TRACE_WARNING ("SDP - bad len in UUID attr: %d", attr_len);
-            return (p + attr_len);
-        }
-        break;
-
-    case DATA_ELE_SEQ_DESC_TYPE:
-    case DATA_ELE_ALT_DESC_TYPE:
-        /* Reserve the memory for the attribute now, as we need to add sub-attributes */
-        p_db->p_free_mem += sizeof (tSDP_DISC_ATTR);
-        p_db->mem_free   -= sizeof (tSDP_DISC_ATTR);
-        p_end             = p + attr_len;
-        total_len         = 0;
-
-        /* SDP_TRACE_DEBUG ("SDP - attr nest level:%d", nest_level); */
-        if (nest_level >= MAX_NEST_LEVELS)
-        {
-            SDP_TRACE_ERROR ("SDP - attr nesting too deep");
-            return (p_end);
-        }
-        if(is_additional_list != 0 || attr_id == ATTR_ID_ADDITION_PROTO_DESC_LISTS)
-            nest_level |= SDP_ADDITIONAL_LIST_MASK;
-        /* SDP_TRACE_DEBUG ("SDP - attr nest level:0x%x(finish)", nest_level); */
-
-        while (p < p_end)
-        {
-            /* Now, add the list entry */
-            p = add_attr (p, p_db, p_rec, 0, p_attr, (UINT8)(nest_level + 1));
-
-            if (!p)
-                return (NULL);
-        }
-        break;
-
-    case TEXT_STR_DESC_TYPE:
-    case URL_DESC_TYPE:
-        BE_STREAM_TO_ARRAY (p, p_attr->attr_value.v.array, (INT32)attr_len);
-        break;
-
-    case BOOLEAN_DESC_TYPE:
-        switch (attr_len)
-        {
-        case 1:
-            p_attr->attr_value.v.u8 = *p++;
-            break;
-        default:
-            SDP_TRACE_WARNING ("SDP - bad len in boolean attr: %d", attr_len);
-            return (p + attr_len);
-        }
-        break;
-
-    default:    /* switch (attr_type) */
-        break;
-    }
-
-    p_db->p_free_mem += total_len;
-    p_db->mem_free   -= total_len;
-
-    /* Add the attribute to the end of the chain */
-    if (!p_parent_attr)
-    {
-        if (!p_rec->p_first_attr)
-            p_rec->p_first_attr = p_attr;
-        else
-        {
-            tSDP_DISC_ATTR  *p_attr1 = p_rec->p_first_attr;
-
-            while (p_attr1->p_next_attr)
-                p_attr1 = p_attr1->p_next_attr;
-
-            p_attr1->p_next_attr = p_attr;
-        }
-    }
-    else
-    {
-        if (!p_parent_attr->attr_value.v.p_sub_attr)
-        {
-            p_parent_attr->attr_value.v.p_sub_attr = p_attr;
-            /* SDP_TRACE_DEBUG ("parent:0x%x(id:%d), ch:0x%x(id:%d)",
-                p_parent_attr, p_parent_attr->attr_id, p_attr, p_attr->attr_id); */
-        }
-        else
-        {
-            tSDP_DISC_ATTR  *p_attr1 = p_parent_attr->attr_value.v.p_sub_attr;
-            /* SDP_TRACE_DEBUG ("parent:0x%x(id:%d), ch1:0x%x(id:%d)",
-                p_parent_attr, p_parent_attr->attr_id, p_attr1, p_attr1->attr_id); */
-
-            while (p_attr1->p_next_attr)
-                p_attr1 = p_attr1->p_next_attr;
-
-            p_attr1->p_next_attr = p_attr;
-            /* SDP_TRACE_DEBUG ("new ch:0x%x(id:%d)", p_attr, p_attr->attr_id); */
-        }
-    }
-
-    return (p);
-}
-
 #endif  /* CLIENT_ENABLED == TRUE */
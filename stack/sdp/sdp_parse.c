@@ -0,0 +1,709 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the parser of the attribute lists an SDP server
+ *  returns to a discovery. Each response is parsed as it arrives, also if
+ *  a data element goes on in the next response, and attribute values are
+ *  copied straight into the discovery database. The database may add
+ *  memory of its own when it is full, as far as its owner allows.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "bt_target.h"
+#include "bt_utils.h"
+#include "gki.h"
+#include "sdp_api.h"
+#include "sdpint.h"
+
+#if SDP_CLIENT_ENABLED == TRUE
+
+#define SDP_PARSE_HDR       0       /* reading the header of a data element */
+#define SDP_PARSE_VALUE     1       /* reading the value of a data element */
+#define SDP_PARSE_END       2       /* the list is complete */
+#define SDP_PARSE_FAILED    3
+
+/* Memory the database adds, when it may grow, follows a link to the previous chunk */
+typedef struct sdp_db_chunk
+{
+    struct sdp_db_chunk     *p_next;
+    UINT32                  align;
+} tSDP_DB_CHUNK;
+
+/*******************************************************************************
+**
+** Function         sdp_db_alloc
+**
+** Description      This function takes memory for a record or an attribute
+**                  from the DB, adding a chunk to it if the DB is full and
+**                  may still grow.
+**
+** Returns          pointer to the memory, or NULL if the DB is full
+**
+*******************************************************************************/
+static void *sdp_db_alloc (tSDP_DISCOVERY_DB *p_db, UINT32 len)
+{
+    tSDP_DB_CHUNK   *p_chunk;
+    UINT32          size;
+    void            *p_mem;
+
+    if (p_db->mem_free < len)
+    {
+        size = (len > SDP_DB_CHUNK_SIZE) ? len : SDP_DB_CHUNK_SIZE;
+        if (size > p_db->grow_size || size > GKI_MAX_BUF_SIZE - sizeof (tSDP_DB_CHUNK))
+            return (NULL);
+
+        if ((p_chunk = (tSDP_DB_CHUNK *) GKI_getbuf ((UINT16)(sizeof (tSDP_DB_CHUNK) + size))) == NULL)
+            return (NULL);
+
+        /* Records and attributes expect memory the DB gives out to be cleared */
+        memset (p_chunk + 1, 0, size);
+
+        p_chunk->p_next = (tSDP_DB_CHUNK *) p_db->p_ext_mem;
+        p_db->p_ext_mem = p_chunk;
+        p_db->grow_size -= size;
+
+        p_db->p_free_mem = (UINT8 *)(p_chunk + 1);
+        p_db->mem_free   = size;
+    }
+
+    p_mem = p_db->p_free_mem;
+    p_db->p_free_mem += len;
+    p_db->mem_free   -= len;
+
+    return (p_mem);
+}
+
+/*******************************************************************************
+**
+** Function         sdp_db_free_ext_mem
+**
+** Description      This function frees the chunks a DB added.
+**
+** Returns          void
+**
+*******************************************************************************/
+void sdp_db_free_ext_mem (tSDP_DISCOVERY_DB *p_db)
+{
+    tSDP_DB_CHUNK   *p_chunk, *p_next;
+
+    for (p_chunk = (tSDP_DB_CHUNK *) p_db->p_ext_mem; p_chunk != NULL; p_chunk = p_next)
+    {
+        p_next = p_chunk->p_next;
+        GKI_freebuf (p_chunk);
+    }
+    p_db->p_ext_mem = NULL;
+    p_db->mem_free  = 0;
+}
+
+/*******************************************************************************
+**
+** Function         sdp_parse_fail
+**
+** Description      This function stops the parser on an error.
+**
+** Returns          the error
+**
+*******************************************************************************/
+static UINT16 sdp_parse_fail (tSDP_PARSE *p_ps, UINT16 status)
+{
+    p_ps->state  = SDP_PARSE_FAILED;
+    p_ps->status = status;
+    return (status);
+}
+
+/*******************************************************************************
+**
+** Function         sdp_parse_next
+**
+** Description      This function is called when a data element is complete.
+**                  It closes the sequences that end with it.
+**
+** Returns          SDP_SUCCESS, or the error
+**
+*******************************************************************************/
+static UINT16 sdp_parse_next (tSDP_PARSE *p_ps)
+{
+    while (p_ps->depth)
+    {
+        if (p_ps->offset < p_ps->level[p_ps->depth - 1].end)
+        {
+            p_ps->state = SDP_PARSE_HDR;
+            return (SDP_SUCCESS);
+        }
+
+        /* a record must not end between an attribute ID and its value */
+        if (p_ps->depth - 1 == p_ps->rec_depth && !p_ps->expect_id)
+        {
+            SDP_TRACE_WARNING ("SDP - attr 0x%04x without value in attr_rsp", p_ps->attr_id);
+            return (sdp_parse_fail (p_ps, SDP_DB_FULL));
+        }
+
+        /* the sequence that ended is the value of an attribute in the record */
+        if (--p_ps->depth && p_ps->depth - 1 == p_ps->rec_depth)
+            p_ps->expect_id = TRUE;
+    }
+
+    p_ps->state = SDP_PARSE_END;
+    return (SDP_SUCCESS);
+}
+
+/*******************************************************************************
+**
+** Function         sdp_parse_push
+**
+** Description      This function opens a sequence of the given length.
+**
+** Returns          SDP_SUCCESS, or the error
+**
+*******************************************************************************/
+static UINT16 sdp_parse_push (tSDP_PARSE *p_ps, UINT32 len, tSDP_DISC_ATTR *p_attr)
+{
+    tSDP_PARSE_LEVEL *p_lvl = &p_ps->level[p_ps->depth++];
+
+    p_lvl->end    = p_ps->offset + len;
+    p_lvl->p_attr = p_attr;
+    p_lvl->p_last = NULL;
+
+    return (sdp_parse_next (p_ps));
+}
+
+/*******************************************************************************
+**
+** Function         sdp_parse_add_record
+**
+** Description      This function adds a record to the end of the DB.
+**
+** Returns          pointer to the record, or NULL if the DB is full
+**
+*******************************************************************************/
+static tSDP_DISC_REC *sdp_parse_add_record (tSDP_PARSE *p_ps)
+{
+    tSDP_DISCOVERY_DB   *p_db = p_ps->p_db;
+    tSDP_DISC_REC       *p_rec, *p_rec1;
+
+    if ((p_rec = (tSDP_DISC_REC *) sdp_db_alloc (p_db, sizeof (tSDP_DISC_REC))) == NULL)
+        return (NULL);
+
+    memcpy (p_rec->remote_bd_addr, p_ps->bd_addr, BD_ADDR_LEN);
+
+    if (!p_db->p_first_rec)
+        p_db->p_first_rec = p_rec;
+    else
+    {
+        for (p_rec1 = p_db->p_first_rec; p_rec1->p_next_rec; p_rec1 = p_rec1->p_next_rec)
+            ;
+        p_rec1->p_next_rec = p_rec;
+    }
+
+    return (p_rec);
+}
+
+/*******************************************************************************
+**
+** Function         sdp_parse_add_attr
+**
+** Description      This function takes space for an attribute from the DB and
+**                  adds it to the end of the record, or of the sequence it is
+**                  in. The value is filled in as it arrives.
+**
+** Returns          pointer to the attribute, or NULL if the DB is full
+**
+*******************************************************************************/
+static tSDP_DISC_ATTR *sdp_parse_add_attr (tSDP_PARSE *p_ps, UINT8 attr_type, UINT32 attr_len,
+                                           UINT32 total_len)
+{
+    tSDP_PARSE_LEVEL    *p_lvl = &p_ps->level[p_ps->depth - 1];
+    tSDP_DISC_ATTR      *p_attr;
+
+    /* Ensure it is a multiple of 4 */
+    total_len = (total_len + 3) & ~3;
+
+    if ((p_attr = (tSDP_DISC_ATTR *) sdp_db_alloc (p_ps->p_db, total_len)) == NULL)
+        return (NULL);
+
+    p_attr->attr_id       = p_ps->attr_id;
+    p_attr->attr_len_type = (UINT16)(attr_len & SDP_DISC_ATTR_LEN_MASK) | (attr_type << 12);
+
+    if (p_lvl->p_last)
+        p_lvl->p_last->p_next_attr = p_attr;
+    else if (p_lvl->p_attr)
+        p_lvl->p_attr->attr_value.v.p_sub_attr = p_attr;
+    else
+        p_ps->p_rec->p_first_attr = p_attr;
+    p_lvl->p_last = p_attr;
+
+    return (p_attr);
+}
+
+/*******************************************************************************
+**
+** Function         sdp_parse_value
+**
+** Description      This function starts on the value of an attribute, or of
+**                  an element of a sequence in it.
+**
+** Returns          SDP_SUCCESS, or the error
+**
+*******************************************************************************/
+static UINT16 sdp_parse_value (tSDP_PARSE *p_ps, UINT8 type, UINT32 len)
+{
+    tSDP_DISC_ATTR  *p_attr;
+    UINT8           attr_type = (type >> 3) & 0x0f;
+    UINT32          total_len;
+
+    p_ps->p_attr  = NULL;
+    p_ps->p_val   = NULL;
+    p_ps->val_len = len;
+    p_ps->val_got = 0;
+
+    /* Elements of sequences within the attribute have no ID */
+    if (p_ps->depth - 1 > p_ps->rec_depth)
+        p_ps->attr_id = 0;
+
+    switch (attr_type)
+    {
+    case DATA_ELE_SEQ_DESC_TYPE:
+    case DATA_ELE_ALT_DESC_TYPE:
+        if (p_ps->depth - 1 - p_ps->rec_depth >= MAX_NEST_LEVELS)
+        {
+            SDP_TRACE_ERROR ("SDP - attr nesting too deep");
+            break;
+        }
+        if ((p_attr = sdp_parse_add_attr (p_ps, attr_type, len, sizeof (tSDP_DISC_ATTR))) == NULL)
+            return (sdp_parse_fail (p_ps, SDP_DB_FULL));
+
+        return (sdp_parse_push (p_ps, len, p_attr));
+
+    case UUID_DESC_TYPE:
+        if (len != 2 && len != 4 && len != MAX_UUID_SIZE)
+        {
+            SDP_TRACE_WARNING ("SDP - bad len in UUID attr: %d", len);
+            break;
+        }
+        /* Falls through */
+
+    case BOOLEAN_DESC_TYPE:
+        if (attr_type == BOOLEAN_DESC_TYPE && len != 1)
+        {
+            SDP_TRACE_WARNING ("SDP - bad len in boolean attr: %d", len);
+            break;
+        }
+        /* Falls through */
+
+    default:
+        /* The length of a value must fit the attribute */
+        if (len > SDP_DISC_ATTR_LEN_MASK)
+        {
+            SDP_TRACE_WARNING ("SDP - attr too long: %d", len);
+            break;
+        }
+
+        /* See if there is enough space in the database */
+        if (len > 4)
+            total_len = len - 4 + (UINT32)sizeof (tSDP_DISC_ATTR);
+        else
+            total_len = sizeof (tSDP_DISC_ATTR);
+
+        if ((p_ps->p_attr = sdp_parse_add_attr (p_ps, attr_type, len, total_len)) == NULL)
+            return (sdp_parse_fail (p_ps, SDP_DB_FULL));
+
+        switch (attr_type)
+        {
+        case UINT_DESC_TYPE:
+        case TWO_COMP_INT_DESC_TYPE:
+            p_ps->p_val = (len == 1 || len == 2 || len == 4) ? p_ps->val
+                                                             : p_ps->p_attr->attr_value.v.array;
+            break;
+
+        case UUID_DESC_TYPE:
+        case BOOLEAN_DESC_TYPE:
+            p_ps->p_val = p_ps->val;
+            break;
+
+        case TEXT_STR_DESC_TYPE:
+        case URL_DESC_TYPE:
+            p_ps->p_val = p_ps->p_attr->attr_value.v.array;
+            break;
+        }
+        break;
+    }
+
+    p_ps->state = SDP_PARSE_VALUE;
+    return (SDP_SUCCESS);
+}
+
+/*******************************************************************************
+**
+** Function         sdp_parse_value_done
+**
+** Description      This function is called when the value of an element is
+**                  complete. Numbers and UUIDs are stored in host order, and
+**                  UUIDs built on the base UUID shortened.
+**
+** Returns          SDP_SUCCESS, or the error
+**
+*******************************************************************************/
+static UINT16 sdp_parse_value_done (tSDP_PARSE *p_ps)
+{
+    tSDP_DISC_ATTR  *p_attr = p_ps->p_attr;
+    UINT8           *p = p_ps->val;
+
+    if (p_ps->depth - 1 == p_ps->rec_depth && p_ps->expect_id)
+    {
+        BE_STREAM_TO_UINT16 (p_ps->attr_id, p);
+        p_ps->expect_id = FALSE;
+        return (sdp_parse_next (p_ps));
+    }
+
+    if (p_attr != NULL && p_ps->p_val == p_ps->val)
+    {
+        switch (SDP_DISC_ATTR_TYPE(p_attr->attr_len_type))
+        {
+        case UINT_DESC_TYPE:
+        case TWO_COMP_INT_DESC_TYPE:
+        case BOOLEAN_DESC_TYPE:
+            switch (p_ps->val_len)
+            {
+            case 1:
+                p_attr->attr_value.v.u8 = *p;
+                break;
+            case 2:
+                BE_STREAM_TO_UINT16 (p_attr->attr_value.v.u16, p);
+                break;
+            case 4:
+                BE_STREAM_TO_UINT32 (p_attr->attr_value.v.u32, p);
+                break;
+            }
+            break;
+
+        case UUID_DESC_TYPE:
+            switch (p_ps->val_len)
+            {
+            case 2:
+                BE_STREAM_TO_UINT16 (p_attr->attr_value.v.u16, p);
+                break;
+            case 4:
+                BE_STREAM_TO_UINT32 (p_attr->attr_value.v.u32, p);
+                if (p_attr->attr_value.v.u32 < 0x10000)
+                {
+                    p_attr->attr_len_type = (UINT16)2 | (UUID_DESC_TYPE << 12);
+                    p_attr->attr_value.v.u16 = (UINT16) p_attr->attr_value.v.u32;
+                }
+                break;
+            case MAX_UUID_SIZE:
+                /* See if we can compress his UUID down to 16 or 32bit UUIDs */
+                if (sdpu_is_base_uuid (p))
+                {
+                    if ((p[0] == 0) && (p[1] == 0))
+                    {
+                        p_attr->attr_len_type = (UINT16)2 | (UUID_DESC_TYPE << 12);
+                        p += 2;
+                        BE_STREAM_TO_UINT16 (p_attr->attr_value.v.u16, p);
+                    }
+                    else
+                    {
+                        p_attr->attr_len_type = (UINT16)4 | (UUID_DESC_TYPE << 12);
+                        BE_STREAM_TO_UINT32 (p_attr->attr_value.v.u32, p);
+                    }
+                }
+                else
+                    memcpy (p_attr->attr_value.v.array, p, MAX_UUID_SIZE);
+                break;
+            }
+            break;
+        }
+    }
+
+    if (p_ps->depth - 1 == p_ps->rec_depth)
+        p_ps->expect_id = TRUE;
+
+    return (sdp_parse_next (p_ps));
+}
+
+/*******************************************************************************
+**
+** Function         sdp_parse_element
+**
+** Description      This function is called with the type and length of each
+**                  data element once its header is complete.
+**
+** Returns          SDP_SUCCESS, or the error
+**
+*******************************************************************************/
+static UINT16 sdp_parse_element (tSDP_PARSE *p_ps, UINT8 type, UINT32 len)
+{
+    UINT16 status;
+
+    if (p_ps->depth == 0)
+    {
+        /* The attribute list, or the list of them */
+        if ((type >> 3) != DATA_ELE_SEQ_DESC_TYPE || p_ps->offset + len < p_ps->offset)
+        {
+            SDP_TRACE_WARNING ("SDP - Wrong type: 0x%02x in attr_rsp", type);
+            return (sdp_parse_fail (p_ps, p_ps->rec_depth ? SDP_INVALID_CONT_STATE : SDP_DB_FULL));
+        }
+    }
+    else if (p_ps->offset > p_ps->level[p_ps->depth - 1].end
+          || len > p_ps->level[p_ps->depth - 1].end - p_ps->offset)
+    {
+        SDP_TRACE_WARNING ("SDP - Bad len in attr_rsp %d", len);
+        return (sdp_parse_fail (p_ps, SDP_DB_FULL));
+    }
+
+    if (p_ps->depth < p_ps->rec_depth)
+        return (sdp_parse_push (p_ps, len, NULL));
+
+    if (p_ps->depth == p_ps->rec_depth)
+    {
+        /* An attribute list, the record */
+        if ((type >> 3) != DATA_ELE_SEQ_DESC_TYPE)
+        {
+            SDP_TRACE_WARNING ("SDP - Wrong type: 0x%02x in attr_rsp", type);
+            return (sdp_parse_fail (p_ps, SDP_DB_FULL));
+        }
+        if ((p_ps->p_rec = sdp_parse_add_record (p_ps)) == NULL)
+        {
+            SDP_TRACE_WARNING ("SDP - DB full add_record");
+            return (sdp_parse_fail (p_ps, SDP_DB_FULL));
+        }
+        p_ps->expect_id = TRUE;
+        return (sdp_parse_push (p_ps, len, NULL));
+    }
+
+    if (p_ps->depth - 1 == p_ps->rec_depth && p_ps->expect_id)
+    {
+        /* First get the attribute ID */
+        if (((type >> 3) != UINT_DESC_TYPE) || (len != 2))
+        {
+            SDP_TRACE_WARNING ("SDP - Bad type: 0x%02x or len: %d in attr_rsp", type, len);
+            return (sdp_parse_fail (p_ps, SDP_DB_FULL));
+        }
+        p_ps->p_attr  = NULL;
+        p_ps->p_val   = p_ps->val;
+        p_ps->val_len = len;
+        p_ps->val_got = 0;
+        p_ps->state   = SDP_PARSE_VALUE;
+        return (SDP_SUCCESS);
+    }
+
+    if ((status = sdp_parse_value (p_ps, type, len)) != SDP_SUCCESS)
+    {
+        SDP_TRACE_WARNING ("SDP - DB full add_attr");
+        return (status);
+    }
+
+    /* Nothing to wait for if the value is empty */
+    if (p_ps->state == SDP_PARSE_VALUE && p_ps->val_len == 0)
+        return (sdp_parse_value_done (p_ps));
+
+    return (SDP_SUCCESS);
+}
+
+/*******************************************************************************
+**
+** Function         sdp_parse_hdr_size
+**
+** Description      This function gets the size of a data element header from
+**                  its first byte.
+**
+** Returns          header size in bytes
+**
+*******************************************************************************/
+static UINT8 sdp_parse_hdr_size (UINT8 type)
+{
+    switch (type & 7)
+    {
+    case SIZE_IN_NEXT_BYTE:
+        return (2);
+    case SIZE_IN_NEXT_WORD:
+        return (3);
+    case SIZE_IN_NEXT_LONG:
+        return (5);
+    default:
+        return (1);
+    }
+}
+
+/*******************************************************************************
+**
+** Function         sdp_parse_raw
+**
+** Description      This function keeps the bytes parsed in the raw data of
+**                  the DB, as far as they fit.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void sdp_parse_raw (tSDP_PARSE *p_ps, UINT8 *p, UINT32 len)
+{
+#if (SDP_RAW_DATA_INCLUDED == TRUE)
+    tSDP_DISCOVERY_DB   *p_db = p_ps->p_db;
+
+    if (p_db->raw_data == NULL)
+        return;
+
+    if (len > p_db->raw_size - p_db->raw_used)
+        len = p_db->raw_size - p_db->raw_used;
+
+    memcpy (&p_db->raw_data[p_db->raw_used], p, len);
+    p_db->raw_used += len;
+#else
+    UNUSED(p_ps);
+    UNUSED(p);
+    UNUSED(len);
+#endif
+}
+
+/*******************************************************************************
+**
+** Function         sdp_parse_init
+**
+** Description      This function prepares the parser for the response to a
+**                  service search attribute request (a list of attribute
+**                  lists, is_list TRUE), or to a service attribute request.
+**
+** Returns          void
+**
+*******************************************************************************/
+void sdp_parse_init (tSDP_PARSE *p_ps, tSDP_DISCOVERY_DB *p_db, BD_ADDR bd_addr, BOOLEAN is_list)
+{
+    memset (p_ps, 0, sizeof (tSDP_PARSE));
+
+    p_ps->p_db      = p_db;
+    p_ps->rec_depth = is_list ? 1 : 0;
+    p_ps->state     = SDP_PARSE_HDR;
+    memcpy (p_ps->bd_addr, bd_addr, BD_ADDR_LEN);
+}
+
+/*******************************************************************************
+**
+** Function         sdp_parse_data
+**
+** Description      This function parses the attribute list bytes of one
+**                  response. Elements may go on in the next response.
+**
+** Returns          SDP_SUCCESS, or the error that stopped the parser
+**
+*******************************************************************************/
+UINT16 sdp_parse_data (tSDP_PARSE *p_ps, UINT8 *p, UINT32 len)
+{
+    UINT32  cpy_len;
+    UINT16  status = SDP_SUCCESS;
+    UINT8   type;
+    UINT8   *p_hdr;
+    UINT32  elem_len;
+
+
+    while (len && status == SDP_SUCCESS)
+    {
+        switch (p_ps->state)
+        {
+        case SDP_PARSE_HDR:
+            /* The raw data leaves out the header of the list of attribute lists */
+            if (p_ps->depth >= p_ps->rec_depth)
+                sdp_parse_raw (p_ps, p, 1);
+
+            p_ps->hdr[p_ps->hdr_len++] = *p++;
+            p_ps->offset++;
+            len--;
+
+            if (p_ps->hdr_len < sdp_parse_hdr_size (p_ps->hdr[0]))
+                break;
+
+            type = p_ps->hdr[0];
+            p_hdr = &p_ps->hdr[1];
+            p_ps->hdr_len = 0;
+
+            /* A nil element has no value, whatever its size index says */
+            if ((type >> 3) == NULL_DESC_TYPE)
+                elem_len = 0;
+            else
+            {
+                switch (type & 7)
+                {
+                case SIZE_IN_NEXT_BYTE:
+                    BE_STREAM_TO_UINT8 (elem_len, p_hdr);
+                    break;
+                case SIZE_IN_NEXT_WORD:
+                    BE_STREAM_TO_UINT16 (elem_len, p_hdr);
+                    break;
+                case SIZE_IN_NEXT_LONG:
+                    BE_STREAM_TO_UINT32 (elem_len, p_hdr);
+                    break;
+                default:
+                    elem_len = 1 << (type & 7);
+                    break;
+                }
+            }
+            status = sdp_parse_element (p_ps, type, elem_len);
+            break;
+
+        case SDP_PARSE_VALUE:
+            cpy_len = p_ps->val_len - p_ps->val_got;
+            if (len < cpy_len)
+                cpy_len = len;
+
+            if (p_ps->p_val)
+                memcpy (p_ps->p_val + p_ps->val_got, p, cpy_len);
+            sdp_parse_raw (p_ps, p, cpy_len);
+            p_ps->val_got += cpy_len;
+            p_ps->offset  += cpy_len;
+            p             += cpy_len;
+            len           -= cpy_len;
+
+            if (p_ps->val_got == p_ps->val_len)
+                status = sdp_parse_value_done (p_ps);
+            break;
+
+        case SDP_PARSE_END:
+            /* Nothing may follow the list of attribute lists. A single
+            ** attribute list ends the response, whatever follows it. */
+            if (p_ps->rec_depth)
+                status = sdp_parse_fail (p_ps, SDP_INVALID_CONT_STATE);
+            else
+                len = 0;
+            break;
+
+        default:
+            status = p_ps->status;
+            break;
+        }
+    }
+
+    return (status);
+}
+
+/*******************************************************************************
+**
+** Function         sdp_parse_done
+**
+** Description      This function is called after the last response.
+**
+** Returns          TRUE if the parser got to the end of the list
+**
+*******************************************************************************/
+BOOLEAN sdp_parse_done (tSDP_PARSE *p_ps)
+{
+    return (p_ps->state == SDP_PARSE_END);
+}
+
+#endif  /* SDP_CLIENT_ENABLED == TRUE */
@@ -34,6 +34,9 @@
 #define SDP_CONTINUATION_LEN        2
 #define SDP_MAX_CONTINUATION_LEN    16          /* As per the spec */
 
+/* Safety check in case we go crazy */
+#define MAX_NEST_LEVELS     5
+
 /* Timeout definitions. */
 #define SDP_INACT_TIMEOUT       30              /* Inactivity timeout         */
 
@@ -165,6 +168,39 @@ typedef struct
 } tSDP_CONT_INFO;
 #endif  /* SDP_SERVER_ENABLED == TRUE */
 
+#if SDP_CLIENT_ENABLED == TRUE
+/* A sequence the response parser is in */
+typedef struct
+{
+    UINT32            end;                      /* offset the sequence ends at */
+    tSDP_DISC_ATTR    *p_attr;                  /* attribute of the sequence, NULL outside attributes */
+    tSDP_DISC_ATTR    *p_last;                  /* last attribute added within it */
+} tSDP_PARSE_LEVEL;
+
+/* State of the parser of the attribute lists in the responses of a discovery */
+typedef struct
+{
+    tSDP_DISCOVERY_DB *p_db;
+    tSDP_DISC_REC     *p_rec;                   /* record being added */
+    tSDP_DISC_ATTR    *p_attr;                  /* attribute whose value is being read */
+    UINT8             *p_val;                   /* where the value goes, NULL to skip it */
+    UINT32            offset;                   /* bytes parsed so far */
+    UINT32            val_len;                  /* length of the value being read */
+    UINT32            val_got;                  /* bytes of it read so far */
+    UINT16            status;                   /* error that stopped the parser */
+    UINT16            attr_id;                  /* ID of the attribute being added */
+    UINT8             state;
+    UINT8             depth;                    /* sequences open */
+    UINT8             rec_depth;                /* depth of the attribute lists */
+    BOOLEAN           expect_id;                /* next in the record is an attribute ID */
+    UINT8             hdr_len;
+    UINT8             hdr[5];                   /* data element header read so far */
+    UINT8             val[MAX_UUID_SIZE];       /* numbers and UUIDs before conversion */
+    BD_ADDR           bd_addr;
+    tSDP_PARSE_LEVEL  level[MAX_NEST_LEVELS + 2];
+} tSDP_PARSE;
+#endif  /* SDP_CLIENT_ENABLED == TRUE */
+
 /* Define the SDP Connection Control Block */
 typedef struct
 {
@@ -187,6 +223,7 @@ typedef struct
     UINT8             *rsp_list;                /* pointer to GKI buffer holding response */
 
 #if SDP_CLIENT_ENABLED == TRUE
+    tSDP_PARSE        parse;                    /* Parser of the attribute lists received */
     tSDP_DISCOVERY_DB *p_db;                    /* Database to save info into   */
     tSDP_DISC_CMPL_CB *p_cb;                    /* Callback for discovery done  */
     tSDP_DISC_CMPL_CB2 *p_cb2;                   /* Callback for discovery done piggy back with the user data */
@@ -325,6 +362,15 @@ extern void sdp_disc_server_rsp (tCONN_CB *p_ccb, BT_HDR *p_msg);
 #define sdp_disc_server_rsp(p_ccb, p_msg)
 #endif
 
+/* Functions provided by sdp_parse.c
+*/
+#if SDP_CLIENT_ENABLED == TRUE
+extern void    sdp_parse_init (tSDP_PARSE *p_ps, tSDP_DISCOVERY_DB *p_db, BD_ADDR bd_addr, BOOLEAN is_list);
+extern UINT16  sdp_parse_data (tSDP_PARSE *p_ps, UINT8 *p, UINT32 len);
+extern BOOLEAN sdp_parse_done (tSDP_PARSE *p_ps);
+extern void    sdp_db_free_ext_mem (tSDP_DISCOVERY_DB *p_db);
+#endif
+
 
 
 #endif
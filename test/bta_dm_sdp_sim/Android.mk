@@ -0,0 +1,25 @@
+LOCAL_PATH:= $(call my-dir)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= bta_dm_sdp_sim.c \
+    ../../bta/dm/bta_dm_sdp_sched.c \
+    ../../bta/sys/bd.c
+
+LOCAL_C_INCLUDES += . \
+    $(LOCAL_PATH)/../../bta/include \
+    $(LOCAL_PATH)/../../bta/sys \
+    $(LOCAL_PATH)/../../bta/dm \
+    $(LOCAL_PATH)/../../stack/include \
+    $(LOCAL_PATH)/../../stack/btm \
+    $(LOCAL_PATH)/../../include \
+    $(LOCAL_PATH)/../../gki/ulinux \
+    $(LOCAL_PATH)/../../gki/common \
+    $(LOCAL_PATH)/../../utils/include \
+    $(bdroid_C_INCLUDES)
+
+LOCAL_CFLAGS += $(bdroid_CFLAGS)
+LOCAL_MODULE_TAGS := debug optional
+LOCAL_MODULE:= bta_dm_sdp_sim
+
+include $(BUILD_HOST_EXECUTABLE)
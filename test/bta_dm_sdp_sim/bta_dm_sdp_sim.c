@@ -0,0 +1,655 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      bta_dm_sdp_sim.c
+ *
+ *  Description:   Runs the service search of BTA_DmSearch over a simulated
+ *                 controller and reports the total time for N devices, with
+ *                 the SDP scheduler (bta/dm/bta_dm_sdp_sched.c) and without.
+ *                 The search is done the way bta_dm_act.c does it, one
+ *                 device at a time; SDP, the inquiry database and the ACL
+ *                 links are simulated.
+ *
+ ***********************************************************************************/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bt_target.h"
+#include "bt_types.h"
+#include "gki.h"
+#include "bta_sys.h"
+#include "bta_api.h"
+#include "bta_dm_int.h"
+#include "btm_api.h"
+#include "sdp_api.h"
+#include "utl.h"
+#include "bd.h"
+
+#define SIM_MAX_DEV         100
+#define SIM_MAX_EVT         (4 * SIM_MAX_DEV)
+#define SIM_MAX_CCB         SDP_MAX_CONNECTIONS
+
+#define SIM_PAGE_SCAN_MS    1280    /* page scan interval R1 */
+#define SIM_PAGE_TOUT_MS    5120    /* default page timeout */
+#define SIM_CONN_MS         30      /* link setup once the page is answered */
+#define SIM_NAME_MS         60      /* remote name request on a link */
+#define SIM_SDP_MS          250     /* L2CAP connect, SDP transaction and disconnect */
+#define SIM_IDLE_MS         (L2CAP_LINK_INACTIVITY_TOUT * 1000)
+
+enum
+{
+    SIM_EVT_PAGE_DONE,
+    SIM_EVT_NAME_DONE,
+    SIM_EVT_SDP_DONE,
+    SIM_EVT_ACL_IDLE,
+    SIM_EVT_SDP_RESULT,             /* BTA_DM_SDP_RESULT_EVT to the search */
+    SIM_EVT_WAIT_TOUT               /* the search timer waiting for the link to go */
+};
+
+typedef struct
+{
+    UINT32  time;
+    int     type;
+    int     arg;
+    UINT32  gen;
+} sim_evt_t;
+
+typedef struct
+{
+    BOOLEAN present;
+    UINT32  page_ms;                /* time the device takes to answer a page */
+    BOOLEAN acl_up;
+    int     users;                  /* SDP channels and name requests on the link */
+    UINT32  idle_gen;
+} sim_dev_t;
+
+/* SDP client connection, stands in for tCONN_CB */
+typedef struct
+{
+    BOOLEAN             in_use;
+    BOOLEAN             connected;
+    BOOLEAN             cancelled;
+    int                 dev;
+    tSDP_DISCOVERY_DB   *p_db;
+    tSDP_DISC_CMPL_CB   *p_cb;
+    tSDP_DISC_CMPL_CB2  *p_cb2;
+    void                *user_data;
+} sim_ccb_t;
+
+/* what the pager does: a page for an SDP connection or a name request */
+typedef struct
+{
+    int     dev;
+    int     ccb;                    /* -1 for the name request of the search */
+} sim_page_t;
+
+static sim_evt_t        sim_evt[SIM_MAX_EVT];
+static int              sim_num_evt;
+static UINT32           sim_now;
+
+static sim_dev_t        sim_dev[SIM_MAX_DEV];
+static tBTM_INQ_INFO    sim_inq[SIM_MAX_DEV];
+static int              sim_num_dev = 30;
+static sim_ccb_t        sim_ccb[SIM_MAX_CCB];
+
+static sim_page_t       sim_pager[SIM_MAX_DEV + SIM_MAX_CCB];
+static int              sim_num_pages;
+static BOOLEAN          sim_paging;
+
+static BOOLEAN          sim_sched;
+static BOOLEAN          sim_names;
+static int              sim_cur;            /* device the search works on */
+static BOOLEAN          sim_search_done;
+static int              sim_wrong_db;
+static int              sim_found;
+static int              sim_from_sched;
+static int              sim_bufs;
+
+UINT8                   appl_trace_level = 0;
+tBTA_DM_SEARCH_CB       bta_dm_search_cb;
+UINT8                   g_disc_raw_data_buf[MAX_DISC_RAW_DATA_BUF];
+
+void LogMsg (UINT32 trace_set_mask, const char *fmt_str, ...)
+{
+    va_list ap;
+
+    (void)trace_set_mask;
+    va_start (ap, fmt_str);
+    vfprintf (stderr, fmt_str, ap);
+    va_end (ap);
+    fputc ('\n', stderr);
+}
+
+/******************************************************************************
+**  Event queue
+******************************************************************************/
+static void sim_post (UINT32 delay, int type, int arg, UINT32 gen)
+{
+    sim_evt_t *p = &sim_evt[sim_num_evt++];
+
+    if (sim_num_evt > SIM_MAX_EVT)
+    {
+        fprintf (stderr, "event queue full\n");
+        exit (2);
+    }
+    p->time = sim_now + delay;
+    p->type = type;
+    p->arg  = arg;
+    p->gen  = gen;
+}
+
+static BOOLEAN sim_next (sim_evt_t *p_evt)
+{
+    int xx, first = 0;
+
+    if (sim_num_evt == 0)
+        return FALSE;
+
+    for (xx = 1; xx < sim_num_evt; xx++)
+    {
+        if (sim_evt[xx].time < sim_evt[first].time)
+            first = xx;
+    }
+    *p_evt = sim_evt[first];
+    sim_evt[first] = sim_evt[--sim_num_evt];
+    sim_now = p_evt->time;
+    return TRUE;
+}
+
+/******************************************************************************
+**  Controller: one page at a time, links that drop when idle
+******************************************************************************/
+static void sim_page_start (void)
+{
+    sim_dev_t *p_dev;
+
+    if (sim_paging || sim_num_pages == 0)
+        return;
+
+    sim_paging = TRUE;
+    p_dev = &sim_dev[sim_pager[0].dev];
+    sim_post (p_dev->present ? p_dev->page_ms + SIM_CONN_MS : SIM_PAGE_TOUT_MS,
+              SIM_EVT_PAGE_DONE, 0, 0);
+}
+
+static void sim_page (int dev, int ccb)
+{
+    sim_pager[sim_num_pages].dev = dev;
+    sim_pager[sim_num_pages].ccb = ccb;
+    sim_num_pages++;
+    sim_page_start ();
+}
+
+static void sim_link_use (int dev)
+{
+    sim_dev[dev].users++;
+    sim_dev[dev].idle_gen++;
+}
+
+static void sim_link_release (int dev)
+{
+    if (--sim_dev[dev].users == 0)
+        sim_post (SIM_IDLE_MS, SIM_EVT_ACL_IDLE, dev, ++sim_dev[dev].idle_gen);
+}
+
+/******************************************************************************
+**  Stack functions the scheduler calls
+******************************************************************************/
+void *GKI_getbuf (UINT16 size)
+{
+    sim_bufs++;
+    return calloc (1, size);
+}
+
+void GKI_freebuf (void *p_buf)
+{
+    sim_bufs--;
+    free (p_buf);
+}
+
+void utl_freebuf (void **p)
+{
+    if (*p != NULL)
+    {
+        GKI_freebuf (*p);
+        *p = NULL;
+    }
+}
+
+BOOLEAN SDP_InitDiscoveryDb (tSDP_DISCOVERY_DB *p_db, UINT32 len, UINT16 num_uuid,
+                             tSDP_UUID *p_uuid_list, UINT16 num_attr, UINT16 *p_attr_list)
+{
+    (void)p_attr_list;
+    memset (p_db, 0, len);
+    p_db->mem_size = len;
+    p_db->num_uuid_filters = num_uuid;
+    memcpy (p_db->uuid_filters, p_uuid_list, num_uuid * sizeof (tSDP_UUID));
+    p_db->num_attr_filters = num_attr;
+    return TRUE;
+}
+
+void SDP_FreeDiscoveryDb (tSDP_DISCOVERY_DB *p_db)
+{
+    if (p_db != NULL)
+        GKI_freebuf (p_db);
+}
+
+static int sim_dev_index (UINT8 *p_bd_addr)
+{
+    return p_bd_addr[4] << 8 | p_bd_addr[5];
+}
+
+static BOOLEAN sim_sdp_request (UINT8 *p_bd_addr, tSDP_DISCOVERY_DB *p_db,
+                                tSDP_DISC_CMPL_CB *p_cb, tSDP_DISC_CMPL_CB2 *p_cb2,
+                                void *user_data)
+{
+    sim_ccb_t *p_ccb;
+    int       xx, dev = sim_dev_index (p_bd_addr);
+
+    for (xx = 0, p_ccb = sim_ccb; xx < SIM_MAX_CCB; xx++, p_ccb++)
+    {
+        if (!p_ccb->in_use)
+            break;
+    }
+    if (xx == SIM_MAX_CCB)
+        return FALSE;
+
+    memset (p_ccb, 0, sizeof (sim_ccb_t));
+    p_ccb->in_use    = TRUE;
+    p_ccb->dev       = dev;
+    p_ccb->p_db      = p_db;
+    p_ccb->p_cb      = p_cb;
+    p_ccb->p_cb2     = p_cb2;
+    p_ccb->user_data = user_data;
+
+    if (sim_dev[dev].acl_up)
+    {
+        p_ccb->connected = TRUE;
+        sim_link_use (dev);
+        sim_post (SIM_SDP_MS, SIM_EVT_SDP_DONE, xx, 0);
+    }
+    else
+    {
+        sim_page (dev, xx);
+    }
+    return TRUE;
+}
+
+BOOLEAN SDP_ServiceSearchAttributeRequest2 (UINT8 *p_bd_addr, tSDP_DISCOVERY_DB *p_db,
+                                            tSDP_DISC_CMPL_CB2 *p_cb2, void *user_data)
+{
+    return sim_sdp_request (p_bd_addr, p_db, NULL, p_cb2, user_data);
+}
+
+static void sim_sdp_cback (sim_ccb_t *p_ccb, UINT16 result)
+{
+    p_ccb->in_use = FALSE;
+    if (p_ccb->p_cb)
+        (*p_ccb->p_cb) (result);
+    else
+        (*p_ccb->p_cb2) (result, p_ccb->user_data);
+}
+
+BOOLEAN SDP_CancelServiceSearch (tSDP_DISCOVERY_DB *p_db)
+{
+    sim_ccb_t *p_ccb;
+    int       xx;
+
+    for (xx = 0, p_ccb = sim_ccb; xx < SIM_MAX_CCB; xx++, p_ccb++)
+    {
+        if (p_ccb->in_use && p_ccb->p_db == p_db)
+            break;
+    }
+    if (xx == SIM_MAX_CCB)
+        return FALSE;
+
+    /* as sdp_disconnect: the callback comes right away during link setup */
+    if (!p_ccb->connected)
+    {
+        for (xx = 0; xx < sim_num_pages; xx++)
+        {
+            if (&sim_ccb[sim_pager[xx].ccb] == p_ccb && (xx > 0 || !sim_paging))
+            {
+                memmove (&sim_pager[xx], &sim_pager[xx + 1], (sim_num_pages - xx - 1) * sizeof (sim_page_t));
+                sim_num_pages--;
+                break;
+            }
+        }
+        p_ccb->cancelled = TRUE;
+        sim_sdp_cback (p_ccb, SDP_CANCEL);
+        return TRUE;
+    }
+    p_ccb->cancelled = TRUE;
+    return TRUE;
+}
+
+tBTM_INQ_INFO *BTM_InqDbNext (tBTM_INQ_INFO *p_cur)
+{
+    return (p_cur + 1 < &sim_inq[sim_num_dev]) ? p_cur + 1 : NULL;
+}
+
+UINT16 BTM_GetNumAclLinks (void)
+{
+    int xx, num = 0;
+
+    for (xx = 0; xx < sim_num_dev; xx++)
+        num += sim_dev[xx].acl_up;
+    return (UINT16)num;
+}
+
+BOOLEAN BTM_IsAclConnectionUp (BD_ADDR remote_bda, tBT_TRANSPORT transport)
+{
+    (void)transport;
+    return sim_dev[sim_dev_index (remote_bda)].acl_up;
+}
+
+/* what bta_dm_act.c would search for first: every device runs an L2CAP browse */
+BOOLEAN bta_dm_sdp_first_uuid (tBTM_INQ_INFO *p_inq_info, tSDP_UUID *p_uuid)
+{
+    (void)p_inq_info;
+    memset (p_uuid, 0, sizeof (tSDP_UUID));
+    p_uuid->len = LEN_UUID_16;
+    p_uuid->uu.uuid16 = UUID_PROTOCOL_L2CAP;
+    return TRUE;
+}
+
+void bta_dm_sdp_callback (UINT16 sdp_status)
+{
+    sim_post (0, SIM_EVT_SDP_RESULT, sdp_status, 0);
+}
+
+/******************************************************************************
+**  The search, after bta_dm_discover_device and bta_dm_find_services
+******************************************************************************/
+static void sim_find_services (void)
+{
+    tSDP_UUID uuid;
+    UINT8     *p_bd_addr = sim_inq[sim_cur].results.remote_bd_addr;
+
+    bta_dm_search_cb.wait_disc = !sim_dev[sim_cur].acl_up;
+
+    bta_dm_sdp_first_uuid (&sim_inq[sim_cur], &uuid);
+    bta_dm_search_cb.p_sdp_db = (tSDP_DISCOVERY_DB *)GKI_getbuf (BTA_DM_SDP_DB_SIZE);
+    SDP_InitDiscoveryDb (bta_dm_search_cb.p_sdp_db, BTA_DM_SDP_DB_SIZE, 1, &uuid, 0, NULL);
+    bta_dm_search_cb.p_sdp_db->raw_data = g_disc_raw_data_buf;
+    bta_dm_search_cb.p_sdp_db->raw_size = MAX_DISC_RAW_DATA_BUF;
+
+    if (sim_sched && bta_dm_sdp_sched_take (p_bd_addr, &uuid))
+    {
+        sim_from_sched++;
+        return;
+    }
+
+    if (!sim_sdp_request (p_bd_addr, bta_dm_search_cb.p_sdp_db, bta_dm_sdp_callback, NULL, NULL))
+        bta_dm_sdp_callback (SDP_NO_RESOURCES);
+}
+
+static void sim_discover_device (void)
+{
+    bdcpy (bta_dm_search_cb.peer_bdaddr, sim_inq[sim_cur].results.remote_bd_addr);
+
+    if (sim_names)
+    {
+        if (sim_dev[sim_cur].acl_up)
+        {
+            sim_link_use (sim_cur);
+            sim_post (SIM_NAME_MS, SIM_EVT_NAME_DONE, sim_cur, 1);
+        }
+        else
+        {
+            sim_page (sim_cur, -1);
+        }
+        return;
+    }
+    sim_find_services ();
+}
+
+static void sim_discover_next_device (void)
+{
+    if (sim_sched)
+        bta_dm_sdp_sched_drop (bta_dm_search_cb.peer_bdaddr);
+
+    if ((bta_dm_search_cb.p_btm_inq_info = BTM_InqDbNext (bta_dm_search_cb.p_btm_inq_info)) != NULL)
+    {
+        sim_cur++;
+        if (sim_sched)
+            bta_dm_sdp_sched_fill ();
+        sim_discover_device ();
+    }
+    else
+    {
+        if (sim_sched)
+            bta_dm_sdp_sched_stop ();
+        sim_search_done = TRUE;
+    }
+}
+
+/* bta_dm_sdp_result and bta_dm_search_result */
+static void sim_sdp_result (UINT16 sdp_result)
+{
+    tSDP_DISCOVERY_DB *p_db = bta_dm_search_cb.p_sdp_db;
+
+    if (sdp_result == SDP_SUCCESS)
+    {
+        sim_found++;
+        if (p_db->raw_used != 2 || p_db->raw_data != g_disc_raw_data_buf
+         || (g_disc_raw_data_buf[0] << 8 | g_disc_raw_data_buf[1]) != sim_cur)
+            sim_wrong_db++;
+    }
+    else if (sdp_result == SDP_CONN_FAILED)
+    {
+        bta_dm_search_cb.wait_disc = FALSE;
+    }
+    SDP_FreeDiscoveryDb (bta_dm_search_cb.p_sdp_db);
+    bta_dm_search_cb.p_sdp_db = NULL;
+
+    if (bta_dm_search_cb.wait_disc && sim_dev[sim_cur].acl_up)
+        sim_post (1000 * (L2CAP_LINK_INACTIVITY_TOUT + 1), SIM_EVT_WAIT_TOUT, sim_cur, 0);
+    else
+        sim_discover_next_device ();
+}
+
+/******************************************************************************
+**  Event handling
+******************************************************************************/
+static void sim_page_done (void)
+{
+    sim_page_t page = sim_pager[0];
+    sim_dev_t  *p_dev = &sim_dev[page.dev];
+    sim_ccb_t  *p_ccb = (page.ccb >= 0) ? &sim_ccb[page.ccb] : NULL;
+
+    memmove (&sim_pager[0], &sim_pager[1], --sim_num_pages * sizeof (sim_page_t));
+    sim_paging = FALSE;
+    sim_page_start ();
+
+    if (p_ccb == NULL)
+    {
+        /* the name request of the search, on a connection that leaves no ACL link */
+        if (p_dev->present)
+            sim_post (SIM_NAME_MS, SIM_EVT_NAME_DONE, page.dev, 0);
+        else
+            sim_find_services ();
+        return;
+    }
+
+    if (p_dev->present)
+        p_dev->acl_up = TRUE;
+
+    if (p_ccb->cancelled)
+    {
+        if (p_dev->present)
+        {
+            sim_link_use (page.dev);
+            sim_link_release (page.dev);
+        }
+        return;
+    }
+
+    if (!p_dev->present)
+    {
+        sim_sdp_cback (p_ccb, SDP_CONN_FAILED);
+        return;
+    }
+
+    p_ccb->connected = TRUE;
+    sim_link_use (page.dev);
+    sim_post (SIM_SDP_MS, SIM_EVT_SDP_DONE, page.ccb, 0);
+}
+
+static void sim_sdp_done (int ccb)
+{
+    sim_ccb_t *p_ccb = &sim_ccb[ccb];
+
+    /* the record the device returns names it */
+    if (!p_ccb->cancelled && p_ccb->p_db->raw_size >= 2)
+    {
+        p_ccb->p_db->raw_data[0] = (UINT8)(p_ccb->dev >> 8);
+        p_ccb->p_db->raw_data[1] = (UINT8)p_ccb->dev;
+        p_ccb->p_db->raw_used = 2;
+    }
+
+    sim_link_release (p_ccb->dev);
+    sim_sdp_cback (p_ccb, p_ccb->cancelled ? SDP_CANCEL : SDP_SUCCESS);
+}
+
+static void sim_run (void)
+{
+    sim_evt_t evt;
+
+    while (sim_next (&evt))
+    {
+        switch (evt.type)
+        {
+        case SIM_EVT_PAGE_DONE:
+            sim_page_done ();
+            break;
+
+        case SIM_EVT_NAME_DONE:
+            if (evt.gen)
+                sim_link_release (evt.arg);
+            sim_find_services ();
+            break;
+
+        case SIM_EVT_SDP_DONE:
+            sim_sdp_done (evt.arg);
+            break;
+
+        case SIM_EVT_ACL_IDLE:
+            if (evt.gen != sim_dev[evt.arg].idle_gen)
+                break;
+            sim_dev[evt.arg].acl_up = FALSE;
+            if (sim_sched)
+                bta_dm_sdp_sched_fill ();
+            /* bta_dm_acl_change: the link the search waits for is gone */
+            if (!sim_search_done && evt.arg == sim_cur && bta_dm_search_cb.wait_disc)
+            {
+                bta_dm_search_cb.wait_disc = FALSE;
+                sim_discover_next_device ();
+            }
+            break;
+
+        case SIM_EVT_SDP_RESULT:
+            sim_sdp_result ((UINT16)evt.arg);
+            break;
+
+        case SIM_EVT_WAIT_TOUT:
+            if (!sim_search_done && evt.arg == sim_cur && bta_dm_search_cb.wait_disc)
+            {
+                bta_dm_search_cb.wait_disc = FALSE;
+                sim_discover_next_device ();
+            }
+            break;
+        }
+    }
+}
+
+static void usage (const char *p_name)
+{
+    fprintf (stderr, "usage: %s [-n devices] [-a absent] [-s seed] [-r] [-p]\n", p_name);
+    fprintf (stderr, "  -n  devices found by the inquiry, default 30, max %d\n", SIM_MAX_DEV);
+    fprintf (stderr, "  -a  every a-th device does not answer pages, default 5, 0 for none\n");
+    fprintf (stderr, "  -s  seed of the page response times, default 1\n");
+    fprintf (stderr, "  -r  read the remote name of every device first\n");
+    fprintf (stderr, "  -p  run the SDP scheduler, BTA_DM_SDP_SCHED_MAX %d\n", BTA_DM_SDP_SCHED_MAX);
+}
+
+int main (int argc, char **argv)
+{
+    unsigned    seed = 1;
+    int         absent = 5;
+    int         opt, xx;
+
+    while ((opt = getopt (argc, argv, "n:a:s:rp")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':   sim_num_dev = atoi (optarg);    break;
+            case 'a':   absent = atoi (optarg);         break;
+            case 's':   seed = (unsigned)atoi (optarg); break;
+            case 'r':   sim_names = TRUE;               break;
+            case 'p':   sim_sched = TRUE;               break;
+            default:    usage (argv[0]);                return 1;
+        }
+    }
+
+    if (sim_num_dev <= 0 || sim_num_dev > SIM_MAX_DEV || absent < 0)
+    {
+        usage (argv[0]);
+        return 1;
+    }
+
+    srand (seed);
+    for (xx = 0; xx < sim_num_dev; xx++)
+    {
+        sim_dev[xx].present = !(absent && xx % absent == absent - 1);
+        sim_dev[xx].page_ms = (UINT32)(rand () % SIM_PAGE_SCAN_MS);
+        sim_inq[xx].results.remote_bd_addr[4] = (UINT8)(xx >> 8);
+        sim_inq[xx].results.remote_bd_addr[5] = (UINT8)xx;
+    }
+
+    memset (&bta_dm_search_cb, 0, sizeof (bta_dm_search_cb));
+    bta_dm_search_cb.services = BTA_ALL_SERVICE_MASK;
+    bta_dm_search_cb.p_btm_inq_info = &sim_inq[0];
+
+    /* bta_dm_inq_cmpl */
+    if (sim_sched)
+        bta_dm_sdp_sched_start ();
+    sim_discover_device ();
+    sim_run ();
+
+    printf ("%d devices, %d absent, %s, %s\n", sim_num_dev,
+            absent ? sim_num_dev / absent : 0,
+            sim_names ? "remote names read" : "names known",
+            sim_sched ? "SDP scheduler" : "one device at a time");
+    printf ("search done after %u.%03u s, %d services found, %d taken from the scheduler\n",
+            sim_now / 1000, sim_now % 1000, sim_found, sim_from_sched);
+
+    if (!sim_search_done || sim_wrong_db || sim_bufs)
+    {
+        printf ("FAILED: search %s, %d results of the wrong device, %d buffers left\n",
+                sim_search_done ? "done" : "stuck", sim_wrong_db, sim_bufs);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+LOCAL_PATH:= $(call my-dir)
+
+bta_metrics_C_INCLUDES := . \
+    $(LOCAL_PATH)/../../include \
+    $(LOCAL_PATH)/../../stack/include \
+    $(LOCAL_PATH)/../../gki/ulinux \
+    $(LOCAL_PATH)/../../gki/common \
+    $(LOCAL_PATH)/../../utils/include \
+    $(LOCAL_PATH)/../../bta/include \
+    $(LOCAL_PATH)/../../bta/sys \
+    $(bdroid_C_INCLUDES)
+
+#
+# bta_metrics_print
+#
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= bta_metrics_print.c \
+    ../../bta/sys/bta_sys_metrics_fmt.c
+
+LOCAL_C_INCLUDES += $(bta_metrics_C_INCLUDES)
+LOCAL_CFLAGS += $(bdroid_CFLAGS)
+LOCAL_MODULE_TAGS := debug optional
+LOCAL_MODULE:= bta_metrics_print
+
+include $(BUILD_HOST_EXECUTABLE)
+
+#
+# bta_metrics_bench
+#
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= bta_metrics_bench.c \
+    ../../bta/sys/bta_sys_metrics.c \
+    ../../bta/sys/bta_sys_metrics_fmt.c
+
+LOCAL_C_INCLUDES += $(bta_metrics_C_INCLUDES)
+LOCAL_CFLAGS += $(bdroid_CFLAGS)
+LOCAL_LDLIBS += -lpthread -lrt
+LOCAL_MODULE_TAGS := debug optional
+LOCAL_MODULE:= bta_metrics_bench
+
+include $(BUILD_HOST_EXECUTABLE)
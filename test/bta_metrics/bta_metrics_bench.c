@@ -0,0 +1,153 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      bta_metrics_bench.c
+ *
+ *  Description:   Measures what the dispatch metrics add to each message
+ *                 bta_sys_event handles: the stamp in bta_sys_sendmsg, the
+ *                 two clock reads around the handler and the update. A
+ *                 second thread may take snapshots meanwhile, as a dump
+ *                 request would.
+ *
+ ***********************************************************************************/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bt_target.h"
+#include "gki.h"
+#include "bta_sys_metrics.h"
+
+UINT8 appl_trace_level = 0;
+
+void LogMsg (UINT32 trace_set_mask, const char *fmt_str, ...)
+{
+    (void)trace_set_mask;
+    (void)fmt_str;
+}
+
+void *GKI_os_malloc (UINT32 size)
+{
+    return malloc (size);
+}
+
+void GKI_os_free (void *p_mem)
+{
+    free (p_mem);
+}
+
+static volatile int snapping;
+static UINT32       snaps;
+
+static UINT64 now_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (UINT64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void *snap_thread (void *p_arg)
+{
+    tBTA_SYS_METRICS *p_snap = malloc (sizeof (tBTA_SYS_METRICS));
+
+    (void)p_arg;
+    while (snapping)
+    {
+        bta_sys_metrics_snapshot (p_snap);
+        snaps++;
+    }
+    free (p_snap);
+    return NULL;
+}
+
+static void usage (const char *p_name)
+{
+    fprintf (stderr, "usage: %s [-n messages] [-s] [-f metrics_file]\n", p_name);
+    fprintf (stderr, "  -n  messages to account, default 1000000\n");
+    fprintf (stderr, "  -s  take snapshots from a second thread meanwhile\n");
+    fprintf (stderr, "  -f  save the metrics to a file for bta_metrics_print\n");
+}
+
+int main (int argc, char **argv)
+{
+    const char  *p_file = NULL;
+    pthread_t   thread;
+    UINT32      num = 1000000;
+    UINT32      i, start, sent, seed = 1;
+    UINT16      event;
+    UINT64      t0, t1;
+    int         snap = 0;
+    int         opt;
+
+    while ((opt = getopt (argc, argv, "n:sf:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':   num = (UINT32)atoi (optarg);    break;
+            case 's':   snap = 1;                       break;
+            case 'f':   p_file = optarg;                break;
+            default:    usage (argv[0]);                return 1;
+        }
+    }
+
+    bta_sys_metrics_init ();
+
+    if (snap)
+    {
+        snapping = 1;
+        pthread_create (&thread, NULL, snap_thread, NULL);
+    }
+
+    /* events of 8 subsystems, 16 codes each, as the handler ids come */
+    t0 = now_ns ();
+    for (i = 0; i < num; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        event = (UINT16)((((seed >> 16) & 7) + 1) << 8 | ((seed >> 8) & 15));
+
+        sent = bta_sys_metrics_now ();
+        start = bta_sys_metrics_now ();
+        bta_sys_metrics_count (event, TRUE, start - sent, bta_sys_metrics_now () - start);
+    }
+    t1 = now_ns ();
+
+    if (snap)
+    {
+        snapping = 0;
+        pthread_join (thread, NULL);
+    }
+
+    printf ("%u messages, %.1f ns/message", num, (double)(t1 - t0) / num);
+    if (snap)
+        printf (", %u snapshots taken meanwhile", snaps);
+    printf ("\n");
+
+    if (p_file && !bta_sys_metrics_save (p_file))
+    {
+        fprintf (stderr, "unable to write %s\n", p_file);
+        return 1;
+    }
+    return 0;
+}
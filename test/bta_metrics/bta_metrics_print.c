@@ -0,0 +1,62 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      bta_metrics_print.c
+ *
+ *  Description:   Prints a BTA dispatch metrics snapshot saved by the stack
+ *                 with BtaMetricsFile set
+ *
+ ***********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bta_sys_metrics.h"
+
+int main (int argc, char **argv)
+{
+    static tBTA_SYS_METRICS snap;
+    FILE                    *p_file;
+    size_t                  n;
+
+    if (argc != 2)
+    {
+        fprintf (stderr, "usage: %s metrics_file\n", argv[0]);
+        return 1;
+    }
+
+    if ((p_file = fopen (argv[1], "rb")) == NULL)
+    {
+        perror (argv[1]);
+        return 1;
+    }
+
+    n = fread (&snap, 1, sizeof (snap), p_file);
+    fclose (p_file);
+
+    if (n != sizeof (snap))
+    {
+        fprintf (stderr, "%s: %zu bytes, expected %zu\n", argv[1], n, sizeof (snap));
+        return 1;
+    }
+
+    bta_sys_metrics_print (1, &snap);
+    return 0;
+}
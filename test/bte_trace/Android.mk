@@ -0,0 +1,41 @@
+LOCAL_PATH:= $(call my-dir)
+
+bte_trace_C_INCLUDES := . \
+    $(LOCAL_PATH)/../../include \
+    $(LOCAL_PATH)/../../stack/include \
+    $(LOCAL_PATH)/../../gki/ulinux \
+    $(LOCAL_PATH)/../../utils/include \
+    $(bdroid_C_INCLUDES)
+
+#
+# bte_trace_decode
+#
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= bte_trace_decode.c \
+    ../../main/bte_trace_fmt.c
+
+LOCAL_C_INCLUDES += $(bte_trace_C_INCLUDES)
+LOCAL_CFLAGS += $(bdroid_CFLAGS)
+LOCAL_MODULE_TAGS := debug optional
+LOCAL_MODULE:= bte_trace_decode
+
+include $(BUILD_HOST_EXECUTABLE)
+
+#
+# bte_trace_bench
+#
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= bte_trace_bench.c \
+    ../../main/bte_trace_bin.c \
+    ../../main/bte_trace_fmt.c
+
+LOCAL_C_INCLUDES += $(bte_trace_C_INCLUDES)
+# dl_iterate_phdr is a GNU extension in glibc
+LOCAL_CFLAGS += $(bdroid_CFLAGS) -D_GNU_SOURCE
+LOCAL_LDLIBS += -lpthread -lrt
+LOCAL_MODULE_TAGS := debug optional
+LOCAL_MODULE:= bte_trace_bench
+
+include $(BUILD_HOST_EXECUTABLE)
@@ -0,0 +1,222 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      bte_trace_bench.c
+ *
+ *  Description:   Measures the cost of a trace call on the calling thread,
+ *                 text tracing against binary deferred tracing
+ *
+ ***********************************************************************************/
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bt_types.h"
+#include "bt_utils.h"
+#include "bte_trace_bin.h"
+
+#define TRACE_MASK  (TRACE_CTRL_GENERAL | TRACE_LAYER_L2CAP | TRACE_ORG_STACK | TRACE_TYPE_DEBUG)
+
+static int      null_fd;
+static BOOLEAN  binary;
+static int      num_calls = 100000;
+static int      burst = 500;
+static int      num_written;
+
+/* Drainer output when no file is given: same cost as text output */
+void bte_log_write (UINT32 trace_set_mask, const char *p_msg)
+{
+    UNUSED(trace_set_mask);
+    if (strncmp (p_msg, "bte_trace:", 10) != 0)
+        num_written++;
+    if (write (null_fd, p_msg, strlen (p_msg)) < 0)
+        return;
+}
+
+/* What LogMsg does, without the logcat call */
+static void bench_log (UINT32 trace_set_mask, const char *fmt_str, ...)
+{
+    char    buffer[BTE_TRACE_BIN_MAX_REC];
+    va_list ap;
+    int     n;
+
+    va_start (ap, fmt_str);
+    if (binary && bte_trace_bin_record (trace_set_mask, fmt_str, ap))
+    {
+        va_end (ap);
+        return;
+    }
+    va_end (ap);
+
+    va_start (ap, fmt_str);
+    n = vsnprintf (buffer, sizeof (buffer), fmt_str, ap);
+    va_end (ap);
+
+    if (write (null_fd, buffer, n) < 0)
+        return;
+}
+
+static int64_t now_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void *bench_thread (void *p_arg)
+{
+    int64_t         *p_ns = (int64_t *)p_arg;
+    int64_t         start;
+    struct timespec pause;
+    int             xx;
+
+    /* Bursts that fit in the ring, the drain pause between them not timed */
+    pause.tv_sec  = 0;
+    pause.tv_nsec = 2 * BTE_TRACE_BIN_DRAIN_MS * 1000000L;
+
+    *p_ns = 0;
+    start = now_ns ();
+    for (xx = 0; xx < num_calls; xx++)
+    {
+        if (xx && (xx % burst) == 0)
+        {
+            *p_ns += now_ns () - start;
+            nanosleep (&pause, NULL);
+            start = now_ns ();
+        }
+
+        switch (xx & 3)
+        {
+            case 0:
+                bench_log (TRACE_MASK, "l2c_link_check_send_pkts: handle 0x%04x quota %d sent %d",
+                           xx & 0x0FFF, 8, xx & 7);
+                break;
+            case 1:
+                bench_log (TRACE_MASK, "L2CAP - rcv_cid CID: 0x%04x  len %u  seq %lu",
+                           0x0040 + (xx & 15), 672, (unsigned long)xx);
+                break;
+            case 2:
+                bench_log (TRACE_MASK, "btm_sec_execute_procedure: state: %s flags: 0x%x",
+                           "AUTHENTICATING", xx);
+                break;
+            default:
+                bench_log (TRACE_MASK, "%s p_ccb %p rx %d tx %d", "l2c_csm_execute",
+                           p_arg, xx, xx >> 1);
+                break;
+        }
+    }
+    *p_ns += now_ns () - start;
+    return NULL;
+}
+
+static int64_t run (int num_threads)
+{
+    pthread_t   threads[64];
+    int64_t     ns[64];
+    int64_t     total = 0;
+    int         xx;
+
+    for (xx = 0; xx < num_threads; xx++)
+        pthread_create (&threads[xx], NULL, bench_thread, &ns[xx]);
+    for (xx = 0; xx < num_threads; xx++)
+    {
+        pthread_join (threads[xx], NULL);
+        total += ns[xx];
+    }
+    return total / num_threads;
+}
+
+static void usage (const char *p_name)
+{
+    fprintf (stderr, "usage: %s [-n calls] [-b burst] [-t threads] [-f trace_file]\n", p_name);
+    fprintf (stderr, "  -n  trace calls per thread, default 100000\n");
+    fprintf (stderr, "  -b  calls between drain pauses, default 500\n");
+    fprintf (stderr, "  -t  tracing threads, default 1, max 64\n");
+    fprintf (stderr, "  -f  binary trace file, default is to format in the drainer\n");
+}
+
+int main (int argc, char **argv)
+{
+    const char  *p_path = NULL;
+    int         num_threads = 1;
+    int64_t     text_ns, bin_ns;
+    int         opt;
+
+    while ((opt = getopt (argc, argv, "n:b:t:f:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                num_calls = atoi (optarg);
+                break;
+            case 'b':
+                burst = atoi (optarg);
+                break;
+            case 't':
+                num_threads = atoi (optarg);
+                break;
+            case 'f':
+                p_path = optarg;
+                break;
+            default:
+                usage (argv[0]);
+                return 1;
+        }
+    }
+
+    if (num_calls <= 0 || burst <= 0 || num_threads <= 0 || num_threads > 64)
+    {
+        usage (argv[0]);
+        return 1;
+    }
+
+    if ((null_fd = open ("/dev/null", O_WRONLY)) < 0)
+    {
+        perror ("/dev/null");
+        return 1;
+    }
+
+    binary = FALSE;
+    text_ns = run (num_threads);
+
+    if (!bte_trace_bin_init (p_path))
+    {
+        fprintf (stderr, "bte_trace_bin_init failed\n");
+        return 1;
+    }
+    binary = TRUE;
+    bin_ns = run (num_threads);
+    bte_trace_bin_cleanup ();
+
+    printf ("%d threads x %d calls in bursts of %d, %s\n", num_threads, num_calls, burst,
+            p_path ? p_path : "formatted by the drainer");
+    printf ("text     %7.1f ns/call\n", (double)text_ns / num_calls);
+    printf ("binary   %7.1f ns/call\n", (double)bin_ns / num_calls);
+    if (p_path == NULL)
+        printf ("drained  %d of %d traces\n", num_written, num_threads * num_calls);
+    return 0;
+}
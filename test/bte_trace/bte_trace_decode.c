@@ -0,0 +1,192 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      bte_trace_decode.c
+ *
+ *  Description:   Prints a binary trace file written by the stack with
+ *                 TraceBinary=true and TraceBinaryFile set
+ *
+ ***********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bt_types.h"
+#include "bte_trace_bin.h"
+
+/* A format string seen in a definition record */
+typedef struct
+{
+    char    *p_fmt;
+    UINT8   num_args;
+    UINT8   types[BTE_TRACE_BIN_MAX_ARGS];
+} tDECODE_FMT;
+
+static tDECODE_FMT fmts[BTE_TRACE_BIN_MAX_FMT];
+
+static void usage (const char *p_name)
+{
+    fprintf (stderr, "usage: %s [-m] trace_file\n", p_name);
+    fprintf (stderr, "  -m  print the raw CLOCK_MONOTONIC timestamps\n");
+}
+
+static char type_char (UINT32 trace_set_mask)
+{
+    switch (TRACE_GET_TYPE (trace_set_mask))
+    {
+        case TRACE_TYPE_ERROR:      return 'E';
+        case TRACE_TYPE_WARNING:    return 'W';
+        case TRACE_TYPE_API:        return 'A';
+        case TRACE_TYPE_EVENT:      return 'I';
+        case TRACE_TYPE_DEBUG:      return 'D';
+        default:                    return '?';
+    }
+}
+
+static void define_fmt (const tBTE_TRACE_REC *p_rec, const UINT8 *p, size_t len)
+{
+    UINT16      id = p_rec->fmt_id & ~BTE_TRACE_ID_DEF_FLAG;
+    tDECODE_FMT *p_entry;
+
+    if (id >= BTE_TRACE_BIN_MAX_FMT || len < 2 || p[0] > BTE_TRACE_BIN_MAX_ARGS
+     || len < (size_t)(1 + p[0] + 1) || p[len - 1] != 0)
+    {
+        fprintf (stderr, "bad format definition %u\n", id);
+        return;
+    }
+
+    p_entry = &fmts[id];
+    free (p_entry->p_fmt);
+    p_entry->num_args = p[0];
+    memcpy (p_entry->types, p + 1, p[0]);
+    p_entry->p_fmt = strdup ((const char *)p + 1 + p[0]);
+}
+
+int main (int argc, char **argv)
+{
+    tBTE_TRACE_FILE_HDR hdr;
+    tBTE_TRACE_REC      rec;
+    UINT8               payload[BTE_TRACE_BIN_MAX_REC];
+    char                msg[BTE_TRACE_BIN_MAX_REC];
+    BOOLEAN             monotonic = FALSE;
+    size_t              len;
+    UINT32              lost;
+    int64_t             ns;
+    time_t              sec;
+    struct tm           tm;
+    FILE                *fp;
+    int                 opt;
+
+    while ((opt = getopt (argc, argv, "m")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm':
+                monotonic = TRUE;
+                break;
+            default:
+                usage (argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind != argc - 1)
+    {
+        usage (argv[0]);
+        return 1;
+    }
+
+    if ((fp = fopen (argv[optind], "rb")) == NULL)
+    {
+        perror (argv[optind]);
+        return 1;
+    }
+
+    if (fread (&hdr, sizeof (hdr), 1, fp) != 1
+     || hdr.magic != BTE_TRACE_FILE_MAGIC || hdr.version != BTE_TRACE_FILE_VERSION)
+    {
+        fprintf (stderr, "%s: not a bte trace file\n", argv[optind]);
+        fclose (fp);
+        return 1;
+    }
+
+    while (fread (&rec, sizeof (rec), 1, fp) == 1)
+    {
+        if (rec.len < sizeof (rec) || BTE_TRACE_REC_ALIGN (rec.len) - sizeof (rec) > sizeof (payload))
+        {
+            fprintf (stderr, "bad record length %u\n", rec.len);
+            break;
+        }
+
+        len = rec.len - sizeof (rec);
+        if (fread (payload, BTE_TRACE_REC_ALIGN (rec.len) - sizeof (rec), 1, fp) != 1
+         && BTE_TRACE_REC_ALIGN (rec.len) != sizeof (rec))
+        {
+            fprintf (stderr, "truncated record\n");
+            break;
+        }
+
+        if (rec.fmt_id & BTE_TRACE_ID_DEF_FLAG)
+        {
+            define_fmt (&rec, payload, len);
+            continue;
+        }
+
+        if (rec.fmt_id == BTE_TRACE_ID_DROPPED)
+        {
+            memcpy (&lost, payload, sizeof (lost));
+            printf ("---- %u traces lost by thread %u\n", lost, rec.tid);
+            continue;
+        }
+
+        if (rec.fmt_id >= BTE_TRACE_BIN_MAX_FMT || fmts[rec.fmt_id].p_fmt == NULL)
+        {
+            fprintf (stderr, "record with undefined format %u\n", rec.fmt_id);
+            continue;
+        }
+
+        bte_trace_bin_format (msg, sizeof (msg), fmts[rec.fmt_id].p_fmt,
+                              fmts[rec.fmt_id].types, fmts[rec.fmt_id].num_args, payload, len);
+
+        if (monotonic)
+        {
+            printf ("%6u.%06u", rec.ts_sec, rec.ts_nsec / 1000);
+        }
+        else
+        {
+            /* wall clock from the offset between both clocks at file creation */
+            ns  = ((int64_t)rec.ts_sec - hdr.mono_sec + hdr.real_sec) * 1000000000LL
+                + (int64_t)rec.ts_nsec - hdr.mono_nsec + hdr.real_nsec;
+            sec = (time_t)(ns / 1000000000LL);
+            localtime_r (&sec, &tm);
+            printf ("%02d-%02d %02d:%02d:%02d.%06u", tm.tm_mon + 1, tm.tm_mday,
+                    tm.tm_hour, tm.tm_min, tm.tm_sec, (unsigned)(ns % 1000000000LL) / 1000);
+        }
+
+        printf (" %5u %3u %c %s\n", rec.tid, TRACE_GET_LAYER (rec.trace_set_mask),
+                type_char (rec.trace_set_mask), msg);
+    }
+
+    fclose (fp);
+    return 0;
+}
@@ -0,0 +1,19 @@
+LOCAL_PATH:= $(call my-dir)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= btsnoop_net_stress.c \
+    ../../hci/src/btsnoop_net.c
+
+LOCAL_C_INCLUDES += . \
+    $(LOCAL_PATH)/../../hci/include \
+    $(LOCAL_PATH)/../../osi/include \
+    $(bdroid_C_INCLUDES)
+
+LOCAL_CFLAGS += $(bdroid_CFLAGS) -std=c99 -D_GNU_SOURCE
+LOCAL_STATIC_LIBRARIES += liblog
+LOCAL_LDLIBS += -lpthread -lrt
+LOCAL_MODULE_TAGS := debug optional
+LOCAL_MODULE:= btsnoop_net_stress
+
+include $(BUILD_HOST_EXECUTABLE)
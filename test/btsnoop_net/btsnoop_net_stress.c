@@ -0,0 +1,287 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Drives hci/src/btsnoop_net.c the way btsnoop_write_packet does and checks
+// what its clients receive: every client must see a valid btsnoop stream,
+// the packets it asked for in order, and gaps that match the drops field.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOCALHOST_ 0x7F000001
+#define LISTEN_PORT_ 8872
+#define PACKET_SIZE_ 64
+#define MAX_CLIENTS_ 3
+
+void btsnoop_net_open();
+void btsnoop_net_close();
+void btsnoop_net_write(const uint8_t *header, const uint8_t *packet, size_t length);
+
+typedef struct {
+  const char *name;
+  const char *filter;         // filter line sent on connect, or NULL
+  int handle;                 // only ACL on this handle expected, or -1
+  unsigned delay_us;          // time spent per read, to make a slow client
+  pthread_t thread;
+  int socket;
+  uint32_t records;
+  uint32_t drops;
+  uint32_t missing;
+  bool failed;
+} client_t;
+
+static client_t clients_[MAX_CLIENTS_] = {
+  { "fast", NULL, -1, 0 },
+  { "filtered", "acl handle=0x40\n", 0x40, 0 },
+  { "slow", NULL, -1, 200 },
+};
+
+static uint32_t packets_ = 200000;
+static unsigned interval_us_ = 10;
+static bool closing_;
+
+static uint64_t now_us_(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int cmp_u32_(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static bool read_full_(int fd, void *buffer, size_t length) {
+  uint8_t *p = buffer;
+  while (length) {
+    ssize_t ret = recv(fd, p, length, 0);
+    if (ret <= 0)
+      return false;
+    p += ret;
+    length -= ret;
+  }
+  return true;
+}
+
+static void fail_(client_t *client, const char *what, uint32_t value) {
+  if (!client->failed)
+    printf("%s: %s (%u)\n", client->name, what, value);
+  client->failed = true;
+}
+
+// Per stream sequence numbers: one for ACL on each handle, one for events
+// and one for the SCO packets written while the server closes.
+static int stream_(uint8_t type, const uint8_t *packet) {
+  if (type == 4)
+    return 2;
+  if (type == 3)
+    return 3;
+  return (packet[0] | packet[1] << 8) == 0x40 ? 0 : 1;
+}
+
+static void *client_fn_(void *context) {
+  client_t *client = context;
+  uint8_t header[25];
+  uint8_t packet[PACKET_SIZE_];
+  uint32_t next_seq[4] = { 0 };
+  uint32_t last_drops = 0;
+
+  if (!read_full_(client->socket, header, 16) || memcmp(header, "btsnoop\0", 8)) {
+    fail_(client, "bad file header", 0);
+    return NULL;
+  }
+
+  while (read_full_(client->socket, header, sizeof(header))) {
+    uint32_t length = ntohl(*(uint32_t *)header);
+    uint32_t drops = ntohl(*(uint32_t *)(header + 12));
+    if (length != ntohl(*(uint32_t *)(header + 4)) || length < 5 || length > sizeof(packet) + 1) {
+      fail_(client, "bad record length", length);
+      break;
+    }
+    if (!read_full_(client->socket, packet, length - 1))
+      break;
+    if (drops < last_drops)
+      fail_(client, "drops went backwards", drops);
+
+    uint8_t type = header[24];
+    if (client->handle >= 0 &&
+        (type != 2 || (packet[0] | packet[1] << 8) != client->handle))
+      fail_(client, "filtered packet received", type);
+
+    // Each dropped record skips one sequence number in some stream, so the
+    // gaps seen here may never exceed the drops the server reported.
+    int stream = stream_(type, packet);
+    uint32_t seq;
+    memcpy(&seq, packet + 4, sizeof(seq));
+    if (seq < next_seq[stream])
+      fail_(client, "packet out of order", seq);
+    else
+      client->missing += seq - next_seq[stream];
+    next_seq[stream] = seq + 1;
+    if (client->missing > drops)
+      fail_(client, "packets lost without drops", client->missing - drops);
+
+    // Packets written while the server closes are checked, not counted.
+    last_drops = drops;
+    if (type != 3) {
+      ++client->records;
+      client->drops = drops;
+    }
+    if (client->delay_us)
+      usleep(client->delay_us);
+  }
+  return NULL;
+}
+
+static int connect_(void) {
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(LOCALHOST_);
+  addr.sin_port = htons(LISTEN_PORT_);
+
+  for (int i = 0; i < 100; ++i) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+      return fd;
+    close(fd);
+    usleep(20000);
+  }
+  return -1;
+}
+
+static void write_packet_(uint8_t type, uint16_t handle, uint32_t seq, uint32_t *latency) {
+  uint8_t header[25] = { 0 };
+  uint8_t packet[PACKET_SIZE_] = { 0 };
+  size_t length = type == 4 ? 16 : PACKET_SIZE_;
+  uint32_t be_length = htonl(length + 1);
+
+  memcpy(header, &be_length, 4);
+  memcpy(header + 4, &be_length, 4);
+  header[24] = type;
+  packet[0] = handle & 0xFF;
+  packet[1] = handle >> 8;
+  memcpy(packet + 4, &seq, sizeof(seq));
+
+  uint64_t start = now_us_();
+  btsnoop_net_write(header, packet, length);
+  *latency = now_us_() - start;
+}
+
+// Keeps writing, as the HCI threads do, while btsnoop_net_close runs.
+static void *closing_writer_fn_(void *context) {
+  uint32_t seq = 0;
+  uint32_t latency;
+  while (!__atomic_load_n(&closing_, __ATOMIC_RELAXED))
+    write_packet_(3, 0x10, seq++, &latency);
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  int opt;
+  while ((opt = getopt(argc, argv, "n:i:")) != -1) {
+    switch (opt) {
+      case 'n': packets_ = strtoul(optarg, NULL, 0); break;
+      case 'i': interval_us_ = strtoul(optarg, NULL, 0); break;
+      default:
+        fprintf(stderr, "usage: %s [-n packets] [-i us]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  btsnoop_net_open();
+  for (int i = 0; i < MAX_CLIENTS_; ++i) {
+    client_t *client = &clients_[i];
+    client->socket = connect_();
+    if (client->socket < 0) {
+      printf("cannot connect to port %d\n", LISTEN_PORT_);
+      return 1;
+    }
+    if (client->filter)
+      send(client->socket, client->filter, strlen(client->filter), 0);
+    pthread_create(&client->thread, NULL, client_fn_, client);
+  }
+  // Let the server accept everyone and read the filter line.
+  usleep(200000);
+
+  uint32_t *latency = calloc(packets_, sizeof(*latency));
+  uint32_t seq[3] = { 0 };
+  uint64_t start = now_us_();
+  for (uint32_t i = 0; i < packets_; ++i) {
+    if (i % 10 == 9)
+      write_packet_(4, 0, seq[2]++, &latency[i]);
+    else if (i & 1)
+      write_packet_(2, 0x41, seq[1]++, &latency[i]);
+    else
+      write_packet_(2, 0x40, seq[0]++, &latency[i]);
+    if (interval_us_)
+      usleep(interval_us_);
+  }
+  uint64_t elapsed = now_us_() - start;
+
+  // Give the clients time to drain, then close the server under them.
+  sleep(2);
+  pthread_t closing_writer;
+  pthread_create(&closing_writer, NULL, closing_writer_fn_, NULL);
+  usleep(1000);
+  btsnoop_net_close();
+  usleep(1000);
+  __atomic_store_n(&closing_, true, __ATOMIC_RELAXED);
+  pthread_join(closing_writer, NULL);
+
+  bool failed = false;
+  for (int i = 0; i < MAX_CLIENTS_; ++i) {
+    client_t *client = &clients_[i];
+    pthread_join(client->thread, NULL);
+    close(client->socket);
+    printf("%-8s records %7u  drops %7u  missing %7u  %s\n", client->name,
+           client->records, client->drops, client->missing, client->failed ? "FAIL" : "ok");
+    failed |= client->failed;
+  }
+  // Clients that keep up with a paced producer must not lose anything; with
+  // -i 0 the producer outruns every client and drops are expected.
+  if (interval_us_ && (clients_[0].drops || clients_[1].drops)) {
+    printf("fast client dropped packets\n");
+    failed = true;
+  }
+  if (interval_us_ && clients_[0].records != packets_) {
+    printf("fast client got %u of %u records\n", clients_[0].records, packets_);
+    failed = true;
+  }
+
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < packets_; ++i)
+    sum += latency[i];
+  qsort(latency, packets_, sizeof(*latency), cmp_u32_);
+  printf("%u packets in %llu ms, write latency mean %.2f us, p99 %u us, max %u us\n",
+         packets_, (unsigned long long)elapsed / 1000, (double)sum / packets_,
+         latency[packets_ * 99 / 100], latency[packets_ - 1]);
+  free(latency);
+
+  printf("%s\n", failed ? "FAIL" : "PASS");
+  return failed;
+}
@@ -0,0 +1,27 @@
+LOCAL_PATH:= $(call my-dir)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= btu_data_stress.c \
+    ../../stack/btu/btu_data.c \
+    ../../gki/common/gki_buffer.c \
+    ../../gki/common/gki_debug.c \
+    ../../gki/common/gki_time.c \
+    ../../gki/ulinux/gki_ulinux.c
+
+LOCAL_C_INCLUDES += . \
+    $(LOCAL_PATH)/../../gki/common \
+    $(LOCAL_PATH)/../../gki/ulinux \
+    $(LOCAL_PATH)/../../include \
+    $(LOCAL_PATH)/../../stack/include \
+    $(LOCAL_PATH)/../../utils/include \
+    $(LOCAL_PATH)/../../hci/include \
+    $(bdroid_C_INCLUDES)
+
+LOCAL_CFLAGS += $(bdroid_CFLAGS) -std=c99
+LOCAL_MODULE_TAGS := debug optional
+LOCAL_MODULE:= btu_data_stress
+LOCAL_SHARED_LIBRARIES += libcutils liblog
+LOCAL_MULTILIB := 32
+
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,354 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      btu_data_stress.c
+ *
+ *  Description:   Feeds media and control ACL packets from an HCI reader
+ *                 thread to a stand-in BTU task with a slow control handler,
+ *                 and reports the latency of the media packets, with or
+ *                 without the BTU data thread. Every media packet must
+ *                 arrive exactly once and in order, also when the route
+ *                 callback declines media while BTU handles a control
+ *                 packet.
+ *
+ ***********************************************************************************/
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <hardware/bluetooth.h>
+
+#include "bt_target.h"
+#include "gki.h"
+#include "bt_types.h"
+#include "hcidefs.h"
+#include "l2cdefs.h"
+#include "btu.h"
+#include "bt_utils.h"
+
+#define ACL_HANDLE      0x0001
+#define MEDIA_CID       0x0041
+#define CTRL_CID        0x0042
+
+#define MEDIA_LEN       600
+
+typedef struct
+{
+    UINT64  sent_ns;
+    UINT32  seq;
+} tPAYLOAD;
+
+static int              num_media = 5000;
+static int              media_us = 2000;
+static int              ctrl_every = 5;
+static int              ctrl_us = 3000;
+static int              use_thread;
+static int              decline;
+static volatile int     ctrl_busy;
+
+static UINT64           *p_lat;
+static UINT8            *p_seen;
+static int              num_seen;
+static int              num_dup;
+static int              num_reorder;
+static UINT32           next_seq;
+static int              via_thread;
+
+static pthread_mutex_t  seen_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t  done_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   done_cond = PTHREAD_COND_INITIALIZER;
+
+/* Used by the GKI timer alarm, which this test does not start */
+bt_os_callouts_t        *bt_os_callouts;
+
+/* GKI and stack traces, normally provided by main/bte_logmsg.c */
+void LogMsg (UINT32 trace_set_mask, const char *fmt_str, ...)
+{
+    va_list ap;
+    UNUSED(trace_set_mask);
+
+    va_start (ap, fmt_str);
+    vfprintf (stderr, fmt_str, ap);
+    va_end (ap);
+    fputc ('\n', stderr);
+}
+
+/* Normally provided by libbt-utils */
+void raise_priority_a2dp (tHIGH_PRIORITY_TASK high_task)
+{
+    UNUSED(high_task);
+}
+
+static UINT64 now_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (UINT64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void spin_us (int us)
+{
+    UINT64 end = now_ns () + (UINT64)us * 1000;
+
+    while (now_ns () < end)
+        ;
+}
+
+/* Accounts a media packet, its L2CAP payload at p */
+static void media_rcvd (UINT8 *p, BOOLEAN on_thread)
+{
+    tPAYLOAD pl;
+
+    memcpy (&pl, p, sizeof (pl));
+
+    pthread_mutex_lock (&seen_lock);
+    if (p_seen[pl.seq]++)
+        num_dup++;
+    if (pl.seq < next_seq)
+        num_reorder++;
+    else
+        next_seq = pl.seq + 1;
+    p_lat[pl.seq] = now_ns () - pl.sent_ns;
+    if (on_thread)
+        via_thread++;
+    if (++num_seen == num_media)
+    {
+        pthread_mutex_lock (&done_lock);
+        pthread_cond_signal (&done_cond);
+        pthread_mutex_unlock (&done_lock);
+    }
+    pthread_mutex_unlock (&seen_lock);
+}
+
+/* The route callback, on the data thread. With -r it leaves media to BTU
+** during the first half of a control packet, as AVDTP does with media that
+** comes before BTU has processed the start of the stream. */
+static BOOLEAN media_cback (UINT16 cid, BT_HDR *p_buf)
+{
+    UNUSED(cid);
+
+    if (decline && ctrl_busy)
+        return FALSE;
+
+    media_rcvd ((UINT8 *)(p_buf + 1) + p_buf->offset, TRUE);
+    GKI_freebuf (p_buf);
+    return TRUE;
+}
+
+/* Stands in for btu_task and l2c_rcv_acl_data */
+static void btu_stub_task (UINT32 params)
+{
+    BT_HDR  *p_buf;
+    UINT8   *p;
+    UINT16  cid;
+    UINT16  evt;
+    UINT32  ret_key;
+    UNUSED(params);
+
+    for (;;)
+    {
+        evt = GKI_wait (0xFFFF, 0);
+
+        if (evt & TASK_MBOX_0_EVT_MASK)
+        {
+            while ((p_buf = (BT_HDR *) GKI_read_mbox (BTU_HCI_RCV_MBOX)) != NULL)
+            {
+                ret_key = btu_data_returned (p_buf);
+
+                p = (UINT8 *)(p_buf + 1) + p_buf->offset + HCI_DATA_PREAMBLE_SIZE + 2;
+                STREAM_TO_UINT16 (cid, p);
+
+                if (cid == MEDIA_CID)
+                {
+                    media_rcvd (p, FALSE);
+                }
+                else
+                {
+                    /* media is declined for the first half, as before a start
+                       response, and queued behind. In the second half it is
+                       taken again, and must still wait for what was queued */
+                    ctrl_busy = 1;
+                    spin_us (ctrl_us / 2);
+                    ctrl_busy = 0;
+                    spin_us (ctrl_us - ctrl_us / 2);
+                }
+                GKI_freebuf (p_buf);
+                btu_data_drained (ret_key);
+            }
+        }
+
+        if (evt & EVENT_MASK(GKI_SHUTDOWN_EVT))
+            break;
+    }
+}
+
+/* Builds a start packet of an L2CAP frame as HCI passes it up */
+static BT_HDR *make_acl (UINT16 cid, UINT16 len)
+{
+    BT_HDR  *p_buf = (BT_HDR *) GKI_getbuf (sizeof (BT_HDR) + HCI_DATA_PREAMBLE_SIZE
+                                            + L2CAP_PKT_OVERHEAD + len);
+    UINT8   *p = (UINT8 *)(p_buf + 1);
+
+    p_buf->event = BT_EVT_TO_BTU_HCI_ACL;
+    p_buf->offset = 0;
+    p_buf->len = HCI_DATA_PREAMBLE_SIZE + L2CAP_PKT_OVERHEAD + len;
+    p_buf->layer_specific = 0;
+
+    UINT16_TO_STREAM (p, ACL_HANDLE | (L2CAP_PKT_START << L2CAP_PKT_TYPE_SHIFT));
+    UINT16_TO_STREAM (p, L2CAP_PKT_OVERHEAD + len);
+    UINT16_TO_STREAM (p, len);
+    UINT16_TO_STREAM (p, cid);
+    memset (p, 0, len);
+    return p_buf;
+}
+
+/* The HCI reader, passing packets on the way data_ind does */
+static void *reader_thread (void *p_arg)
+{
+    struct timespec pause = { 0, media_us * 1000 };
+    tPAYLOAD        pl;
+    BT_HDR          *p_buf;
+    int             xx;
+    UNUSED(p_arg);
+
+    for (xx = 0; xx < num_media; xx++)
+    {
+        if (xx % ctrl_every == 0)
+        {
+            p_buf = make_acl (CTRL_CID, 32);
+            if (!btu_data_rcv (p_buf))
+                GKI_send_msg (BTU_TASK, BTU_HCI_RCV_MBOX, p_buf);
+        }
+
+        p_buf = make_acl (MEDIA_CID, MEDIA_LEN);
+        pl.seq = xx;
+        pl.sent_ns = now_ns ();
+        memcpy ((UINT8 *)(p_buf + 1) + HCI_DATA_PREAMBLE_SIZE + L2CAP_PKT_OVERHEAD, &pl, sizeof (pl));
+        if (!btu_data_rcv (p_buf))
+            GKI_send_msg (BTU_TASK, BTU_HCI_RCV_MBOX, p_buf);
+
+        nanosleep (&pause, NULL);
+    }
+    return NULL;
+}
+
+static int cmp_u64 (const void *p_a, const void *p_b)
+{
+    UINT64 a = *(const UINT64 *)p_a;
+    UINT64 b = *(const UINT64 *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+static void usage (const char *p_name)
+{
+    fprintf (stderr, "usage: %s [-d] [-r] [-n packets] [-i us] [-c every] [-s us]\n", p_name);
+    fprintf (stderr, "  -d  run the BTU data thread and route the media channel\n");
+    fprintf (stderr, "  -r  the route declines media during the first half of a control packet\n");
+    fprintf (stderr, "  -n  media packets, default 5000\n");
+    fprintf (stderr, "  -i  interval of the media packets, default 2000 us\n");
+    fprintf (stderr, "  -c  a control packet before every c-th media packet, default 5\n");
+    fprintf (stderr, "  -s  time BTU takes for a control packet, default 3000 us\n");
+}
+
+int main (int argc, char **argv)
+{
+    pthread_t   reader;
+    UINT64      total = 0;
+    int         opt, xx;
+
+    while ((opt = getopt (argc, argv, "drn:i:c:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'd':   use_thread = 1;                 break;
+            case 'r':   decline = 1;                    break;
+            case 'n':   num_media = atoi (optarg);      break;
+            case 'i':   media_us = atoi (optarg);       break;
+            case 'c':   ctrl_every = atoi (optarg);     break;
+            case 's':   ctrl_us = atoi (optarg);        break;
+            default:    usage (argv[0]);                return 1;
+        }
+    }
+
+    if (num_media <= 0 || media_us <= 0 || media_us >= 1000000 || ctrl_every <= 0
+        || ctrl_us < 0 || (decline && !use_thread))
+    {
+        usage (argv[0]);
+        return 1;
+    }
+
+    p_lat = calloc (num_media, sizeof (UINT64));
+    p_seen = calloc (num_media, 1);
+
+    GKI_init ();
+    GKI_create_task (btu_stub_task, BTU_TASK, (INT8 *)"BTU", NULL, 0);
+
+    if (use_thread)
+    {
+        GKI_create_task ((TASKPTR)btu_data_task, BTU_DATA_TASK, (INT8 *)"BTU DATA", NULL, 0);
+        while (!btu_data_route_add (ACL_HANDLE, MEDIA_CID, media_cback))
+            usleep (1000);
+    }
+
+    pthread_create (&reader, NULL, reader_thread, NULL);
+    pthread_join (reader, NULL);
+
+    pthread_mutex_lock (&done_lock);
+    pthread_mutex_lock (&seen_lock);
+    while (num_seen < num_media)
+    {
+        pthread_mutex_unlock (&seen_lock);
+        pthread_cond_wait (&done_cond, &done_lock);
+        pthread_mutex_lock (&seen_lock);
+    }
+    pthread_mutex_unlock (&seen_lock);
+    pthread_mutex_unlock (&done_lock);
+
+    if (use_thread)
+        GKI_destroy_task (BTU_DATA_TASK);
+    GKI_destroy_task (BTU_TASK);
+
+    for (xx = 0; xx < num_media; xx++)
+        total += p_lat[xx];
+    qsort (p_lat, num_media, sizeof (UINT64), cmp_u64);
+
+    printf ("%s, %d media packets every %d us, a %d us control packet every %d\n",
+            use_thread ? (decline ? "data thread, declining" : "data thread") : "BTU only",
+            num_media, media_us, ctrl_us, ctrl_every);
+    printf ("media latency us  mean %.1f  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+            total / 1000.0 / num_media,
+            p_lat[num_media / 2] / 1000.0,
+            p_lat[num_media * 9 / 10] / 1000.0,
+            p_lat[num_media * 99 / 100] / 1000.0,
+            p_lat[num_media - 1] / 1000.0);
+    printf ("delivered on the data thread %d, on BTU %d, duplicates %d, out of order %d\n",
+            via_thread, num_media - via_thread, num_dup, num_reorder);
+
+    free (p_lat);
+    free (p_seen);
+    return (num_dup || num_reorder) ? 1 : 0;
+}
@@ -0,0 +1,47 @@
+LOCAL_PATH:= $(call my-dir)
+
+gki_pingpong_SRC_FILES := gki_pingpong.c \
+    ../../gki/common/gki_buffer.c \
+    ../../gki/common/gki_debug.c \
+    ../../gki/common/gki_time.c \
+    ../../gki/ulinux/gki_ulinux.c
+
+gki_pingpong_C_INCLUDES := . \
+    $(LOCAL_PATH)/../../gki/common \
+    $(LOCAL_PATH)/../../gki/ulinux \
+    $(LOCAL_PATH)/../../include \
+    $(LOCAL_PATH)/../../stack/include \
+    $(LOCAL_PATH)/../../utils/include \
+    $(bdroid_C_INCLUDES)
+
+#
+# gki_pingpong: mailboxes as built in the stack
+#
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= $(gki_pingpong_SRC_FILES)
+LOCAL_C_INCLUDES += $(gki_pingpong_C_INCLUDES)
+LOCAL_CFLAGS += $(bdroid_CFLAGS) -std=c99
+LOCAL_MODULE_TAGS := debug optional
+LOCAL_MODULE:= gki_pingpong
+LOCAL_SHARED_LIBRARIES += libcutils liblog
+LOCAL_STATIC_LIBRARIES += libbt-utils
+LOCAL_MULTILIB := 32
+
+include $(BUILD_EXECUTABLE)
+
+#
+# gki_pingpong_locked: the same with the mailboxes under GKI_disable()
+#
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= $(gki_pingpong_SRC_FILES)
+LOCAL_C_INCLUDES += $(gki_pingpong_C_INCLUDES)
+LOCAL_CFLAGS += $(bdroid_CFLAGS) -std=c99 -DGKI_LOCKFREE_MBOX=FALSE
+LOCAL_MODULE_TAGS := debug optional
+LOCAL_MODULE:= gki_pingpong_locked
+LOCAL_SHARED_LIBRARIES += libcutils liblog
+LOCAL_STATIC_LIBRARIES += libbt-utils
+LOCAL_MULTILIB := 32
+
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,250 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      gki_pingpong.c
+ *
+ *  Description:   Bounces a buffer between two GKI tasks through their
+ *                 mailboxes and reports the round trip latency, optionally
+ *                 with other threads sending to the same tasks
+ *
+ ***********************************************************************************/
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <hardware/bluetooth.h>
+
+#include "gki.h"
+#include "bt_utils.h"
+
+#ifndef GKI_SHUTDOWN_EVT
+#define GKI_SHUTDOWN_EVT    APPL_EVT_7
+#endif
+
+#define PING_TASK       0
+#define PONG_TASK       1
+
+#define PING_MBOX       0
+#define NOISE_MBOX      1
+
+#define MAX_NOISE       8
+
+static int              num_trips = 100000;
+static int              num_noise;
+static UINT64           *p_rtt;
+static UINT64           taskid_ns;
+static volatile int     running = 1;
+
+/* Used by the GKI timer alarm, which this test does not start */
+bt_os_callouts_t        *bt_os_callouts;
+
+static pthread_mutex_t  done_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   done_cond = PTHREAD_COND_INITIALIZER;
+static int              done;
+
+/* GKI traces, normally provided by main/bte_logmsg.c */
+void LogMsg (UINT32 trace_set_mask, const char *fmt_str, ...)
+{
+    va_list ap;
+    UNUSED(trace_set_mask);
+
+    va_start (ap, fmt_str);
+    vfprintf (stderr, fmt_str, ap);
+    va_end (ap);
+    fputc ('\n', stderr);
+}
+
+static UINT64 now_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (UINT64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Echoes every buffer of its PING_MBOX back, frees what arrives in NOISE_MBOX */
+static void pong_task (UINT32 params)
+{
+    UINT16  evt;
+    void    *p_buf;
+    UNUSED(params);
+
+    for (;;)
+    {
+        evt = GKI_wait (0xFFFF, 0);
+
+        if (evt & EVENT_MASK(GKI_SHUTDOWN_EVT))
+            break;
+
+        if (evt & TASK_MBOX_0_EVT_MASK)
+        {
+            while ((p_buf = GKI_read_mbox (PING_MBOX)) != NULL)
+                GKI_send_msg (PING_TASK, PING_MBOX, p_buf);
+        }
+
+        if (evt & TASK_MBOX_1_EVT_MASK)
+        {
+            while ((p_buf = GKI_read_mbox (NOISE_MBOX)) != NULL)
+                GKI_freebuf (p_buf);
+        }
+    }
+}
+
+static void ping_task (UINT32 params)
+{
+    UINT64  start;
+    UINT16  evt;
+    void    *p_buf;
+    int     xx;
+    UNUSED(params);
+
+    start = now_ns ();
+    for (xx = 0; xx < 1000000; xx++)
+        GKI_get_taskid ();
+    taskid_ns = now_ns () - start;
+
+    for (xx = 0; xx < num_trips; xx++)
+    {
+        p_buf = GKI_getbuf (sizeof (BT_HDR));
+
+        start = now_ns ();
+        GKI_send_msg (PONG_TASK, PING_MBOX, p_buf);
+
+        while ((p_buf = GKI_read_mbox (PING_MBOX)) == NULL)
+        {
+            evt = GKI_wait (TASK_MBOX_0_EVT_MASK | EVENT_MASK(GKI_SHUTDOWN_EVT), 0);
+            if (evt & EVENT_MASK(GKI_SHUTDOWN_EVT))
+                return;
+        }
+        p_rtt[xx] = now_ns () - start;
+
+        GKI_freebuf (p_buf);
+    }
+
+    pthread_mutex_lock (&done_lock);
+    done = 1;
+    pthread_cond_signal (&done_cond);
+    pthread_mutex_unlock (&done_lock);
+
+    while (!(GKI_wait (EVENT_MASK(GKI_SHUTDOWN_EVT), 0) & EVENT_MASK(GKI_SHUTDOWN_EVT)))
+        ;
+}
+
+/* A thread that is not a GKI task, like the HCI reader or a JNI thread */
+static void *noise_thread (void *p_arg)
+{
+    struct timespec pause = { 0, 20000 };
+    void            *p_buf;
+    UNUSED(p_arg);
+
+    while (running)
+    {
+        if ((p_buf = GKI_getbuf (sizeof (BT_HDR))) != NULL)
+            GKI_send_msg (PONG_TASK, NOISE_MBOX, p_buf);
+        nanosleep (&pause, NULL);
+    }
+    return NULL;
+}
+
+static int cmp_u64 (const void *p_a, const void *p_b)
+{
+    UINT64 a = *(const UINT64 *)p_a;
+    UINT64 b = *(const UINT64 *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+static void usage (const char *p_name)
+{
+    fprintf (stderr, "usage: %s [-n round_trips] [-s senders]\n", p_name);
+    fprintf (stderr, "  -n  round trips, default 100000\n");
+    fprintf (stderr, "  -s  extra threads sending to the pong task, default 0, max %d\n", MAX_NOISE);
+}
+
+int main (int argc, char **argv)
+{
+    pthread_t   noise[MAX_NOISE];
+    UINT64      total = 0;
+    int         opt, xx;
+
+    while ((opt = getopt (argc, argv, "n:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                num_trips = atoi (optarg);
+                break;
+            case 's':
+                num_noise = atoi (optarg);
+                break;
+            default:
+                usage (argv[0]);
+                return 1;
+        }
+    }
+
+    if (num_trips <= 0 || num_noise < 0 || num_noise > MAX_NOISE)
+    {
+        usage (argv[0]);
+        return 1;
+    }
+
+    p_rtt = calloc (num_trips, sizeof (UINT64));
+
+    GKI_init ();
+    GKI_create_task (pong_task, PONG_TASK, (INT8 *)"PONG", NULL, 0);
+    GKI_create_task (ping_task, PING_TASK, (INT8 *)"PING", NULL, 0);
+
+    for (xx = 0; xx < num_noise; xx++)
+        pthread_create (&noise[xx], NULL, noise_thread, NULL);
+
+    pthread_mutex_lock (&done_lock);
+    while (!done)
+        pthread_cond_wait (&done_cond, &done_lock);
+    pthread_mutex_unlock (&done_lock);
+
+    running = 0;
+    for (xx = 0; xx < num_noise; xx++)
+        pthread_join (noise[xx], NULL);
+
+    GKI_shutdown ();
+
+    for (xx = 0; xx < num_trips; xx++)
+        total += p_rtt[xx];
+    qsort (p_rtt, num_trips, sizeof (UINT64), cmp_u64);
+
+    printf ("%s mailboxes, %d round trips, %d extra senders\n",
+            (GKI_LOCKFREE_MBOX == TRUE) ? "lock-free" : "locked", num_trips, num_noise);
+    printf ("GKI_get_taskid  %6.1f ns\n", taskid_ns / 1000000.0);
+    printf ("round trip us   mean %.1f  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+            total / 1000.0 / num_trips,
+            p_rtt[num_trips / 2] / 1000.0,
+            p_rtt[num_trips * 9 / 10] / 1000.0,
+            p_rtt[num_trips * 99 / 100] / 1000.0,
+            p_rtt[num_trips - 1] / 1000.0);
+
+    free (p_rtt);
+    return 0;
+}
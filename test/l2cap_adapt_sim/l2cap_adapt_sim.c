@@ -0,0 +1,375 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      l2cap_adapt_sim.c
+ *
+ *  Description:   Drives several ACL links sharing the controller buffers
+ *                 through the adaptive ACL allocation policy and reports per
+ *                 link throughput, against the static even split
+ *
+ ***********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bt_target.h"
+#include "l2c_adapt.h"
+
+#define SIM_MAX_QUEUE       256
+#define SIM_BULK_BACKLOG    32      /* packets a saturating source keeps queued */
+#define SIM_MAX_INFLIGHT    64
+#define SIM_SNIFF_WINDOW_US 2500    /* time a packet may start in after each sniff anchor */
+#define SIM_HI_QUOTA        L2CAP_HIGH_PRI_MIN_XMIT_QUOTA
+
+typedef struct
+{
+    const char  *name;
+    BOOLEAN     high_pri;
+    UINT16      pkt_len;
+    UINT32      air_us;         /* time one packet takes on the air */
+    UINT32      period_us;      /* 0 for a saturating source */
+    UINT16      burst;          /* packets queued per period */
+    UINT32      sniff_us;       /* sniff interval, 0 when active */
+
+    /* run time state */
+    UINT32      next_us;
+    UINT32      queue[SIM_MAX_QUEUE];   /* enqueue times */
+    int         q_head, q_count;
+    UINT16      in_ctrl;        /* handed to the controller, not on the air yet */
+    UINT16      sent_not_acked;
+    UINT16      quota;
+    UINT16      completed;
+    UINT16      demand;
+    UINT32      *p_delay;
+    int         num_delay, max_delay;
+    UINT32      dropped;
+    UINT64      bytes;
+} sim_link_t;
+
+static sim_link_t sim_link[] =
+{
+    /* name        hi     len   air    period  burst  sniff */
+    { "a2dp",      TRUE,  660,  2500,  20000,  1,     0      },
+    { "pan bulk",  FALSE, 1021, 3750,  0,      1,     0      },
+    { "hid",       FALSE, 12,   1250,  100000, 1,     0      },
+    { "sniffed",   FALSE, 200,  1250,  500000, 4,     100000 },
+};
+
+#define SIM_NUM_LINK  (int)(sizeof(sim_link) / sizeof(sim_link[0]))
+
+/* packets whose completion the host has not been told about yet */
+typedef struct
+{
+    UINT32  due_us;
+    int     link;
+} sim_done_t;
+
+static sim_done_t sim_done[SIM_MAX_INFLIGHT];
+static int sim_num_done;
+
+static void enqueue(sim_link_t *p, UINT32 now)
+{
+    if (p->q_count == SIM_MAX_QUEUE)
+    {
+        p->dropped++;
+        return;
+    }
+    p->queue[(p->q_head + p->q_count++) % SIM_MAX_QUEUE] = now;
+}
+
+static void record(sim_link_t *p, UINT32 delay)
+{
+    if (p->num_delay == p->max_delay)
+    {
+        p->max_delay = p->max_delay ? p->max_delay * 2 : 1024;
+        p->p_delay = realloc(p->p_delay, p->max_delay * sizeof(UINT32));
+        if (!p->p_delay)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    p->p_delay[p->num_delay++] = delay;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    UINT32 x = *(const UINT32 *)a, y = *(const UINT32 *)b;
+    return (x > y) - (x < y);
+}
+
+static UINT32 percentile(const sim_link_t *p, int pct)
+{
+    int idx;
+
+    if (p->num_delay == 0)
+        return 0;
+    idx = (p->num_delay * pct) / 100;
+    if (idx >= p->num_delay)
+        idx = p->num_delay - 1;
+    return p->p_delay[idx];
+}
+
+/* hands packets to the controller while the quota and the window allow */
+static void send_pkts(sim_link_t *p, UINT16 *p_window, UINT32 now)
+{
+    while (p->q_count && *p_window && p->sent_not_acked < p->quota)
+    {
+        record(p, now - p->queue[p->q_head]);
+        p->q_head = (p->q_head + 1) % SIM_MAX_QUEUE;
+        p->q_count--;
+        p->in_ctrl++;
+        p->sent_not_acked++;
+        (*p_window)--;
+    }
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-t seconds] [-b acl_bufs] [-d ack_ms] [-s]\n"
+                    "  -t  simulated time, default 10\n"
+                    "  -b  controller ACL buffers, default 10\n"
+                    "  -d  time from the end of a packet on the air to its completion\n"
+                    "      reaching the host, default 5\n"
+                    "  -s  static: keep the even split, no rebalancing\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    tL2C_ADAPT_LINK adapt[SIM_NUM_LINK];
+    int             adapt_of[SIM_NUM_LINK];
+    UINT32          now, end, busy_until = 0, last_rebalance = 0;
+    UINT32          seconds = 10, ack_us = 5000, hi_blocked_us = 0;
+    UINT16          num_bufs = 10, window, floor, qq, rem, pool = 0, held, max_held = 0;
+    int             adaptive = 1, opt, i, num_low = 0, on_air = -1, rr = 0;
+
+    while ((opt = getopt(argc, argv, "t:b:d:s")) != -1)
+    {
+        switch (opt)
+        {
+            case 't': seconds = atoi(optarg); break;
+            case 'b': num_bufs = atoi(optarg); break;
+            case 'd': ack_us = atoi(optarg) * 1000; break;
+            case 's': adaptive = 0; break;
+            default:  usage(argv[0]); return 1;
+        }
+    }
+
+    for (i = 0; i < SIM_NUM_LINK; i++)
+        num_low += !sim_link[i].high_pri;
+
+    if (seconds == 0 || seconds > 3600 || num_bufs < SIM_HI_QUOTA + num_low ||
+        num_bufs > SIM_MAX_INFLIGHT)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    /* the split l2c_link_adjust_allocation makes, and the floor it sets */
+    qq    = (num_bufs - (SIM_NUM_LINK - num_low) * SIM_HI_QUOTA) / num_low;
+    rem   = (num_bufs - (SIM_NUM_LINK - num_low) * SIM_HI_QUOTA) % num_low;
+    floor = (qq > 1) ? qq / 2 : 1;
+
+    for (i = 0; i < SIM_NUM_LINK; i++)
+    {
+        sim_link_t *p = &sim_link[i];
+
+        if (p->high_pri)
+        {
+            p->quota = SIM_HI_QUOTA;
+            continue;
+        }
+        p->quota = qq;
+        if (rem > 0)
+        {
+            p->quota++;
+            rem--;
+        }
+        pool += p->quota;
+    }
+
+    window = num_bufs;
+    end = seconds * 1000000;
+
+    /* time advances in 100us steps; one packet is on the air at a time */
+    for (now = 0; now < end; now += 100)
+    {
+        BOOLEAN completed = FALSE;
+
+        for (i = 0; i < SIM_NUM_LINK; i++)
+        {
+            sim_link_t *p = &sim_link[i];
+            int n;
+
+            if (p->period_us == 0)
+            {
+                while (p->q_count < SIM_BULK_BACKLOG)
+                    enqueue(p, now);
+            }
+            else if (now >= p->next_us)
+            {
+                for (n = 0; n < p->burst; n++)
+                    enqueue(p, now);
+                p->next_us += p->period_us;
+            }
+        }
+
+        /* the packet on the air is done */
+        if (on_air >= 0 && now >= busy_until)
+        {
+            sim_done[sim_num_done].due_us = now + ack_us;
+            sim_done[sim_num_done++].link = on_air;
+            on_air = -1;
+        }
+
+        /* number of completed packets reaches the host */
+        for (i = 0; i < sim_num_done; )
+        {
+            if (sim_done[i].due_us > now)
+            {
+                i++;
+                continue;
+            }
+            sim_link[sim_done[i].link].sent_not_acked--;
+            sim_link[sim_done[i].link].completed++;
+            sim_link[sim_done[i].link].bytes += sim_link[sim_done[i].link].pkt_len;
+            window++;
+            sim_done[i] = sim_done[--sim_num_done];
+            completed = TRUE;
+        }
+
+        if (adaptive && completed && (now - last_rebalance) >= L2CAP_ADAPTIVE_ACL_INTERVAL_MS * 1000)
+        {
+            int n = 0;
+
+            last_rebalance = now;
+            for (i = 0; i < SIM_NUM_LINK; i++)
+            {
+                sim_link_t *p = &sim_link[i];
+
+                if (p->high_pri)
+                    continue;
+                adapt[n].quota          = p->quota;
+                adapt[n].demand         = p->demand;
+                adapt[n].sent_not_acked = p->sent_not_acked;
+                adapt[n].queued         = p->q_count;
+                adapt[n].completed      = p->completed;
+                adapt_of[n++]           = i;
+            }
+
+            l2c_adapt_rebalance(adapt, n, floor);
+
+            for (i = 0; i < n; i++)
+            {
+                sim_link[adapt_of[i]].quota     = adapt[i].quota;
+                sim_link[adapt_of[i]].demand    = adapt[i].demand;
+                sim_link[adapt_of[i]].completed = 0;
+            }
+        }
+
+        /* the host serves the high priority link first */
+        for (i = 0; i < SIM_NUM_LINK; i++)
+        {
+            if (sim_link[i].high_pri)
+            {
+                if (sim_link[i].q_count && sim_link[i].sent_not_acked < sim_link[i].quota &&
+                    window == 0)
+                    hi_blocked_us += 100;
+                send_pkts(&sim_link[i], &window, now);
+            }
+        }
+        for (i = 0; i < SIM_NUM_LINK; i++)
+        {
+            if (!sim_link[i].high_pri)
+                send_pkts(&sim_link[i], &window, now);
+        }
+
+        held = 0;
+        for (i = 0; i < SIM_NUM_LINK; i++)
+        {
+            if (!sim_link[i].high_pri)
+                held += sim_link[i].sent_not_acked;
+        }
+        if (held > max_held)
+            max_held = held;
+
+        /* the controller serves its links round robin; a sniffing link is
+           only reachable in a short window at each anchor, which is kept
+           free for it while it has data */
+        if (on_air < 0)
+        {
+            UINT32 next_anchor = end;
+
+            for (i = 0; i < SIM_NUM_LINK; i++)
+            {
+                sim_link_t *p = &sim_link[i];
+
+                if (p->in_ctrl == 0 || p->sniff_us == 0)
+                    continue;
+                if ((now % p->sniff_us) < SIM_SNIFF_WINDOW_US)
+                {
+                    on_air = i;
+                    break;
+                }
+                if (now - (now % p->sniff_us) + p->sniff_us < next_anchor)
+                    next_anchor = now - (now % p->sniff_us) + p->sniff_us;
+            }
+            for (i = 0; on_air < 0 && i < SIM_NUM_LINK; i++)
+            {
+                sim_link_t *p = &sim_link[(rr + i) % SIM_NUM_LINK];
+
+                if (p->in_ctrl && !p->sniff_us && now + p->air_us <= next_anchor)
+                {
+                    on_air = (rr + i) % SIM_NUM_LINK;
+                    rr = on_air + 1;
+                }
+            }
+            if (on_air >= 0)
+            {
+                sim_link[on_air].in_ctrl--;
+                busy_until = now + sim_link[on_air].air_us;
+            }
+        }
+    }
+
+    printf("%u s, %u ACL buffers, %u ms to completion, %s\n\n", seconds, num_bufs,
+           ack_us / 1000, adaptive ? "adaptive" : "static split");
+    printf("%-10s %8s %8s %9s %9s %9s %6s\n",
+           "link", "packets", "kbps", "p50 ms", "p99 ms", "max ms", "quota");
+
+    for (i = 0; i < SIM_NUM_LINK; i++)
+    {
+        sim_link_t *p = &sim_link[i];
+
+        qsort(p->p_delay, p->num_delay, sizeof(UINT32), cmp_u32);
+        printf("%-10s %8d %8u %9.2f %9.2f %9.2f %6u\n", p->name, p->num_delay,
+               (UINT32)(p->bytes * 8 / 1000 / seconds),
+               percentile(p, 50) / 1000.0, percentile(p, 99) / 1000.0,
+               p->num_delay ? p->p_delay[p->num_delay - 1] / 1000.0 : 0.0, p->quota);
+        free(p->p_delay);
+    }
+
+    printf("\nnormal links held at most %u of their %u buffers\n", max_held, pool);
+    printf("a2dp waited %u ms for a controller buffer\n", hi_blocked_us / 1000);
+
+    return (max_held > pool) ? 1 : 0;
+}
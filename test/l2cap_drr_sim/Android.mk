@@ -0,0 +1,21 @@
+LOCAL_PATH:= $(call my-dir)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= l2cap_drr_sim.c \
+    ../../stack/l2cap/l2c_drr.c
+
+LOCAL_C_INCLUDES += . \
+    $(LOCAL_PATH)/../../stack/include \
+    $(LOCAL_PATH)/../../include \
+    $(LOCAL_PATH)/../../stack/l2cap \
+    $(LOCAL_PATH)/../../gki/ulinux \
+    $(LOCAL_PATH)/../../gki/common \
+    $(LOCAL_PATH)/../../utils/include \
+    $(bdroid_C_INCLUDES)
+
+LOCAL_CFLAGS += $(bdroid_CFLAGS)
+LOCAL_MODULE_TAGS := debug optional
+LOCAL_MODULE:= l2cap_drr_sim
+
+include $(BUILD_HOST_EXECUTABLE)
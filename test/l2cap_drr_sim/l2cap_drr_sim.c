@@ -0,0 +1,223 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      l2cap_drr_sim.c
+ *
+ *  Description:   Drives synthetic mixed traffic through the L2CAP deficit
+ *                 round robin scheduler and reports per channel queueing
+ *                 delay percentiles
+ *
+ ***********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "l2c_drr.h"
+
+#define SIM_MAX_QUEUE       64
+#define SIM_BULK_BACKLOG    8       /* packets a saturating source keeps queued */
+
+typedef struct
+{
+    const char              *name;
+    UINT16                  cid;
+    UINT16                  psm;
+    tL2CAP_CHNL_PRIORITY    priority;
+    UINT16                  pkt_len;
+    UINT32                  period_us;  /* 0 for a saturating source */
+
+    /* run time state */
+    tL2C_DRR_CHNL           drr;
+    UINT32                  next_us;
+    UINT32                  queue[SIM_MAX_QUEUE];   /* enqueue times */
+    int                     q_head, q_count;
+    UINT32                  *p_delay;
+    int                     num_delay, max_delay;
+    UINT32                  dropped;
+    UINT64                  bytes;
+} sim_chnl_t;
+
+static sim_chnl_t sim_chnl[] =
+{
+    /* name         cid     psm             priority                    len   period */
+    { "avdtp media", 0x0040, BT_PSM_AVDTP,  L2CAP_CHNL_PRIORITY_HIGH,   660,  20000 },
+    { "hid intr",    0x0041, BT_PSM_HIDI,   L2CAP_CHNL_PRIORITY_HIGH,    12,   8000 },
+    { "att",         0x0042, BT_PSM_ATT,    L2CAP_CHNL_PRIORITY_MEDIUM,  40, 100000 },
+    { "obex bulk",   0x0043, 0x1001,        L2CAP_CHNL_PRIORITY_LOW,    990,      0 },
+    { "pan bulk",    0x0044, BT_PSM_BNEP,   L2CAP_CHNL_PRIORITY_LOW,   1500,      0 },
+};
+
+#define SIM_NUM_CHNL  (int)(sizeof(sim_chnl) / sizeof(sim_chnl[0]))
+
+static void enqueue(sim_chnl_t *p, UINT32 now)
+{
+    if (p->q_count == SIM_MAX_QUEUE)
+    {
+        p->dropped++;
+        return;
+    }
+    p->queue[(p->q_head + p->q_count++) % SIM_MAX_QUEUE] = now;
+}
+
+static void record(sim_chnl_t *p, UINT32 delay)
+{
+    if (p->num_delay == p->max_delay)
+    {
+        p->max_delay = p->max_delay ? p->max_delay * 2 : 1024;
+        p->p_delay = realloc(p->p_delay, p->max_delay * sizeof(UINT32));
+        if (!p->p_delay)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    p->p_delay[p->num_delay++] = delay;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    UINT32 x = *(const UINT32 *)a, y = *(const UINT32 *)b;
+    return (x > y) - (x < y);
+}
+
+static UINT32 percentile(const sim_chnl_t *p, int pct)
+{
+    int idx;
+
+    if (p->num_delay == 0)
+        return 0;
+    idx = (p->num_delay * pct) / 100;
+    if (idx >= p->num_delay)
+        idx = p->num_delay - 1;
+    return p->p_delay[idx];
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-t seconds] [-r link_kbps] [-f]\n"
+                    "  -t  simulated time, default 10\n"
+                    "  -r  ACL throughput available to the link, default 1400\n"
+                    "  -f  flat: put every channel in the bulk class\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    tL2C_DRR        drr;
+    tL2C_DRR_ENTRY  ent[SIM_NUM_CHNL];
+    sim_chnl_t      *p_of[SIM_NUM_CHNL];
+    UINT32          now = 0, end, busy_until = 0;
+    UINT32          seconds = 10, kbps = 1400;
+    int             flat = 0, opt, i, num, idx;
+
+    while ((opt = getopt(argc, argv, "t:r:f")) != -1)
+    {
+        switch (opt)
+        {
+            case 't': seconds = atoi(optarg); break;
+            case 'r': kbps = atoi(optarg); break;
+            case 'f': flat = 1; break;
+            default:  usage(argv[0]); return 1;
+        }
+    }
+    if (seconds == 0 || seconds > 3600 || kbps == 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    memset(&drr, 0, sizeof(drr));
+    end = seconds * 1000000;
+
+    /* time advances in 100us steps; one packet is on the air at a time */
+    for (now = 0; now < end; now += 100)
+    {
+        for (i = 0; i < SIM_NUM_CHNL; i++)
+        {
+            sim_chnl_t *p = &sim_chnl[i];
+
+            if (p->period_us == 0)
+            {
+                while (p->q_count < SIM_BULK_BACKLOG)
+                    enqueue(p, now);
+            }
+            else if (now >= p->next_us)
+            {
+                enqueue(p, now);
+                p->next_us += p->period_us;
+            }
+        }
+
+        if (now < busy_until)
+            continue;
+
+        num = 0;
+        for (i = 0; i < SIM_NUM_CHNL; i++)
+        {
+            sim_chnl_t *p = &sim_chnl[i];
+
+            if (p->q_count == 0)
+            {
+                l2c_drr_idle(&p->drr);
+                continue;
+            }
+            ent[num].p_chnl    = &p->drr;
+            ent[num].id        = p->cid;
+            ent[num].lat_class = flat ? L2CAP_LATENCY_CLASS_BULK : l2c_drr_class_for_psm(p->psm);
+            ent[num].quantum   = l2c_drr_quantum(ent[num].lat_class, p->priority);
+            p_of[num++]        = p;
+        }
+
+        if ((idx = l2c_drr_select(&drr, ent, num, now)) < 0)
+            continue;
+
+        {
+            sim_chnl_t *p = p_of[idx];
+
+            record(p, now - p->queue[p->q_head]);
+            p->q_head = (p->q_head + 1) % SIM_MAX_QUEUE;
+            p->q_count--;
+            p->bytes += p->pkt_len;
+
+            l2c_drr_charge(&p->drr, p->pkt_len, now);
+            busy_until = now + (UINT32)((UINT64)p->pkt_len * 8 * 1000 / kbps);
+        }
+    }
+
+    printf("%u s at %u kbps%s\n\n", seconds, kbps, flat ? ", no latency classes" : "");
+    printf("%-12s %8s %8s %9s %9s %9s %9s %8s\n",
+           "channel", "packets", "kbps", "p50 ms", "p90 ms", "p99 ms", "max ms", "dropped");
+
+    for (i = 0; i < SIM_NUM_CHNL; i++)
+    {
+        sim_chnl_t *p = &sim_chnl[i];
+
+        qsort(p->p_delay, p->num_delay, sizeof(UINT32), cmp_u32);
+        printf("%-12s %8d %8u %9.2f %9.2f %9.2f %9.2f %8u\n", p->name, p->num_delay,
+               (UINT32)(p->bytes * 8 / 1000 / seconds),
+               percentile(p, 50) / 1000.0, percentile(p, 90) / 1000.0,
+               percentile(p, 99) / 1000.0,
+               p->num_delay ? p->p_delay[p->num_delay - 1] / 1000.0 : 0.0, p->dropped);
+        free(p->p_delay);
+    }
+
+    return 0;
+}
@@ -0,0 +1,49 @@
+LOCAL_PATH:= $(call my-dir)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= msbc_bench.c \
+    ../../btif/src/btif_msbc.c \
+    ../../embdrv/sbc/encoder/srce/sbc_analysis.c \
+    ../../embdrv/sbc/encoder/srce/sbc_dct.c \
+    ../../embdrv/sbc/encoder/srce/sbc_dct_coeffs.c \
+    ../../embdrv/sbc/encoder/srce/sbc_enc_bit_alloc_mono.c \
+    ../../embdrv/sbc/encoder/srce/sbc_enc_bit_alloc_ste.c \
+    ../../embdrv/sbc/encoder/srce/sbc_enc_coeffs.c \
+    ../../embdrv/sbc/encoder/srce/sbc_encoder.c \
+    ../../embdrv/sbc/encoder/srce/sbc_packing.c \
+    ../../embdrv/sbc/decoder/srce/alloc.c \
+    ../../embdrv/sbc/decoder/srce/bitalloc.c \
+    ../../embdrv/sbc/decoder/srce/bitalloc-sbc.c \
+    ../../embdrv/sbc/decoder/srce/bitstream-decode.c \
+    ../../embdrv/sbc/decoder/srce/decoder-oina.c \
+    ../../embdrv/sbc/decoder/srce/decoder-private.c \
+    ../../embdrv/sbc/decoder/srce/decoder-sbc.c \
+    ../../embdrv/sbc/decoder/srce/dequant.c \
+    ../../embdrv/sbc/decoder/srce/framing.c \
+    ../../embdrv/sbc/decoder/srce/framing-sbc.c \
+    ../../embdrv/sbc/decoder/srce/oi_codec_version.c \
+    ../../embdrv/sbc/decoder/srce/synthesis-sbc.c \
+    ../../embdrv/sbc/decoder/srce/synthesis-dct8.c \
+    ../../embdrv/sbc/decoder/srce/synthesis-8-generated.c
+
+LOCAL_C_INCLUDES += . \
+    $(LOCAL_PATH)/../../btif/include \
+    $(LOCAL_PATH)/../../embdrv/sbc/encoder/include \
+    $(LOCAL_PATH)/../../embdrv/sbc/decoder/include \
+    $(LOCAL_PATH)/../../embdrv/sbc/decoder/srce \
+    $(LOCAL_PATH)/../../include \
+    $(LOCAL_PATH)/../../stack/include \
+    $(LOCAL_PATH)/../../gki/ulinux \
+    $(LOCAL_PATH)/../../gki/common \
+    $(LOCAL_PATH)/../../utils/include \
+    $(bdroid_C_INCLUDES)
+
+LOCAL_CFLAGS += $(bdroid_CFLAGS) -std=c99
+LOCAL_MODULE_TAGS := debug optional
+LOCAL_MODULE:= msbc_bench
+LOCAL_SHARED_LIBRARIES += libcutils liblog
+# the SBC codecs assume a 32 bit long
+LOCAL_MULTILIB := 32
+
+include $(BUILD_EXECUTABLE)
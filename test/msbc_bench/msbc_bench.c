@@ -0,0 +1,391 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  mSBC codec benchmark: per-frame encode, decode and concealment cost,
+ *  codec delay, concealment quality under packet loss, and the latency the
+ *  jitter buffer adds for a given SCO delivery jitter.
+ *
+ ******************************************************************************/
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bt_target.h"
+#include "bt_trace.h"
+#include "btif_msbc.h"
+
+/* Trace hooks of the stack */
+UINT8 appl_trace_level = BT_TRACE_LEVEL_ERROR;
+UINT8 btif_trace_level = BT_TRACE_LEVEL_ERROR;
+
+void LogMsg(UINT32 trace_set_mask, const char *fmt_str, ...)
+{
+    va_list ap;
+
+    (void)trace_set_mask;
+    va_start(ap, fmt_str);
+    vfprintf(stderr, fmt_str, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+#define MAX_FRAMES      100000
+#define MAX_DELAY       256     /* samples searched for the codec delay */
+#define JITTER_RUNS     16      /* audio clock phases simulated */
+
+static INT16 *p_input;          /* test signal */
+static INT16 *p_ref;            /* lossless decode of it */
+static INT16 *p_output;
+static UINT8 *p_stream;         /* encoded packets */
+
+static int num_frames = 20000;
+static int num_out;             /* frames of p_ref */
+static double delay_ms;         /* of the filter banks */
+static int sco_len = 60;
+
+static double now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Speech-like test signal: a glottal pulse train through two resonances,
+** with the pitch gliding between 100 and 250 Hz, plus some noise */
+static void make_signal(INT16 *p_pcm, int num)
+{
+    double  phase = 0, f0, y1 = 0, y2 = 0, z1 = 0, z2 = 0, x, y, z;
+    int     i;
+
+    srand(1);
+    for (i = 0; i < num; i++)
+    {
+        f0 = 175 + 75 * sin(2 * M_PI * i / 16000.0 * 0.7);
+        phase += f0 / 16000.0;
+        x = 0;
+        if (phase >= 1)
+        {
+            phase -= 1;
+            x = 8000;
+        }
+        x += (rand() % 200) - 100;
+
+        /* resonances around 700 Hz and 1800 Hz */
+        y = x + 1.80 * y1 - 0.94 * y2;
+        y2 = y1;
+        y1 = y;
+        z = y + 0.95 * z1 - 0.90 * z2;
+        z2 = z1;
+        z1 = z;
+
+        z /= 6;
+        p_pcm[i] = (INT16)(z > 32767 ? 32767 : (z < -32768 ? -32768 : z));
+    }
+}
+
+static double snr_db(const INT16 *p_sig, const INT16 *p_test, int num)
+{
+    double  s = 0, n = 0, d;
+    int     i;
+
+    for (i = 0; i < num; i++)
+    {
+        d = (double)p_test[i] - p_sig[i];
+        s += (double)p_sig[i] * p_sig[i];
+        n += d * d;
+    }
+    return 10 * log10(s / (n + 1));
+}
+
+/* Delay of the decoded signal behind the input, in samples */
+static int codec_delay(const INT16 *p_in, const INT16 *p_out, int num)
+{
+    double  corr, best_corr = -1e300;
+    int     lag, best = 0, i;
+
+    for (lag = 0; lag < MAX_DELAY; lag++)
+    {
+        corr = 0;
+        for (i = 0; i + lag < num; i++)
+            corr += (double)p_in[i] * p_out[i + lag];
+        if (corr > best_corr)
+        {
+            best_corr = corr;
+            best = lag;
+        }
+    }
+    return best;
+}
+
+static UINT8 pending[BTIF_MSBC_PKT_LEN * 2];
+static int num_pending;
+
+static void start(void)
+{
+    num_pending = 0;
+    btif_msbc_init(NULL);
+}
+
+/* Feed one packet to the receive side in SCO packets of sco_len bytes */
+static void deliver(const UINT8 *p_pkt, BOOLEAN bad)
+{
+    int off = 0;
+
+    memcpy(pending + num_pending, p_pkt, BTIF_MSBC_PKT_LEN);
+    num_pending += BTIF_MSBC_PKT_LEN;
+    while (num_pending - off >= sco_len)
+    {
+        btif_msbc_rx_data(pending + off, (UINT16)sco_len, bad);
+        off += sco_len;
+    }
+    memmove(pending, pending + off, num_pending - off);
+    num_pending -= off;
+}
+
+static void run_codec(void)
+{
+    tBTIF_MSBC_STATS    stats;
+    double              t0, enc_us, dec_us;
+    int                 delay, i, n;
+
+    start();
+
+    t0 = now_us();
+    for (i = 0; i < num_frames; i++)
+        btif_msbc_encode(p_input + i * BTIF_MSBC_SAMPLES, p_stream + i * BTIF_MSBC_PKT_LEN);
+    enc_us = (now_us() - t0) / num_frames;
+
+    /* one packet in, one frame out: the jitter buffer stays at its depth */
+    start();
+    dec_us = 0;
+    for (i = 0, n = 0; i < num_frames; i++)
+    {
+        deliver(p_stream + i * BTIF_MSBC_PKT_LEN, FALSE);
+        t0 = now_us();
+        if (btif_msbc_decode(p_ref + n * BTIF_MSBC_SAMPLES) != BTIF_MSBC_DECODED)
+            continue;
+        dec_us += now_us() - t0;
+        n++;
+    }
+    dec_us /= n;
+    num_out = n;
+
+    btif_msbc_get_stats(&stats);
+    delay = codec_delay(p_input, p_ref, n * BTIF_MSBC_SAMPLES);
+    delay_ms = delay / 16.0;
+
+    printf("codec, %d frames of %d samples, SCO packets of %d bytes\n",
+           num_frames, BTIF_MSBC_SAMPLES, sco_len);
+    printf("  encode            %6.2f us/frame  (%.2f%% of a 7.5 ms frame)\n",
+           enc_us, enc_us * 100 / BTIF_MSBC_FRAME_US);
+    printf("  align + decode    %6.2f us/frame  (%.2f%% of a 7.5 ms frame)\n",
+           dec_us, dec_us * 100 / BTIF_MSBC_FRAME_US);
+    printf("  decoded %u, errors %u, resync bytes %u\n",
+           stats.dec_frames, stats.dec_errors, stats.rx_resync);
+    printf("  codec delay       %d samples (%.2f ms), SNR %.1f dB\n", delay, delay_ms,
+           snr_db(p_input, p_ref + delay, n * BTIF_MSBC_SAMPLES - delay));
+}
+
+static void run_loss(int loss_pct)
+{
+    tBTIF_MSBC_STATS    stats;
+    double              t0, plc_us = 0;
+    INT16               *p_zero;
+    double              sig = 0, err = 0, d;
+    int                 num, num_plc = 0, i, n, c;
+    BOOLEAN             *p_lost;
+    tBTIF_MSBC_RESULT   result;
+
+    p_zero = malloc(num_out * BTIF_MSBC_SAMPLES * sizeof(INT16));
+    p_lost = calloc(num_frames, sizeof(BOOLEAN));
+
+    srand(loss_pct + 7);
+    for (i = 0; i < num_frames; i++)
+        p_lost[i] = (rand() % 100) < loss_pct;
+
+    start();
+    for (i = 0, n = 0; n < num_out && i < num_frames; i++)
+    {
+        deliver(p_stream + i * BTIF_MSBC_PKT_LEN, p_lost[i]);
+        t0 = now_us();
+        result = btif_msbc_decode(p_output + n * BTIF_MSBC_SAMPLES);
+        if (result == BTIF_MSBC_BUFFERING)
+            continue;
+        if (result == BTIF_MSBC_CONCEALED)
+        {
+            plc_us += now_us() - t0;
+            num_plc++;
+        }
+        n++;
+    }
+    btif_msbc_get_stats(&stats);
+    num = n * BTIF_MSBC_SAMPLES;
+
+    /* the same losses replaced by silence */
+    memcpy(p_zero, p_ref, num * sizeof(INT16));
+    for (i = 0; i < n; i++)
+    {
+        if (!p_lost[i])
+            continue;
+        memset(p_zero + i * BTIF_MSBC_SAMPLES, 0, BTIF_MSBC_SAMPLES * sizeof(INT16));
+        for (c = i * BTIF_MSBC_SAMPLES; c < (i + 1) * BTIF_MSBC_SAMPLES; c++)
+        {
+            d = (double)p_output[c] - p_ref[c];
+            sig += (double)p_ref[c] * p_ref[c];
+            err += d * d;
+        }
+    }
+
+    /* over the lost frames alone, silence scores 0 dB */
+    printf("  %3d%%  %6u  %8.2f  %7.1f dB  %7.1f dB  %7.1f dB\n", loss_pct, stats.concealed,
+           num_plc ? plc_us / num_plc : 0.0, 10 * log10(sig / (err + 1)),
+           snr_db(p_ref, p_output, num), snr_db(p_ref, p_zero, num));
+
+    free(p_zero);
+    free(p_lost);
+}
+
+static int cmp_double(const void *p_a, const void *p_b)
+{
+    double a = *(const double *)p_a, b = *(const double *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+/* Simulated clock: packet k leaves the peer at k * 7.5 ms and reaches the
+** host up to jitter_ms later, in order. The audio thread asks for a frame
+** every 7.5 ms, at a phase to the SCO clock that differs between runs. The
+** buffering delay of a packet runs from its arrival without jitter to its
+** playout. */
+static void run_jitter(double jitter_ms)
+{
+    tBTIF_MSBC_STATS    stats;
+    INT16               pcm[BTIF_MSBC_SAMPLES];
+    double              *p_delay, arrival, last_arrival, tick, sum = 0;
+    int                 run, k, played = 0, run_played;
+    int                 run_frames = num_frames / JITTER_RUNS;
+    UINT32              underruns = 0, concealed = 0;
+
+    p_delay = malloc(num_frames * sizeof(double));
+    srand((unsigned)(jitter_ms * 10) + 3);
+
+    for (run = 0; run < JITTER_RUNS; run++)
+    {
+        start();
+        k = 0;
+        run_played = 0;
+        arrival = last_arrival = 0;
+        tick = (double)run * BTIF_MSBC_FRAME_US / JITTER_RUNS;
+
+        while (run_played < run_frames - BTIF_MSBC_JITTER_SLOTS)
+        {
+            if (k < run_frames && arrival <= tick)
+            {
+                deliver(p_stream + k * BTIF_MSBC_PKT_LEN, FALSE);
+                k++;
+                arrival = (double)k * BTIF_MSBC_FRAME_US + (rand() / (RAND_MAX + 1.0)) * jitter_ms * 1000;
+                if (arrival < last_arrival)
+                    arrival = last_arrival;
+                last_arrival = arrival;
+                continue;
+            }
+
+            if (btif_msbc_decode(pcm) == BTIF_MSBC_DECODED)
+            {
+                btif_msbc_get_stats(&stats);
+                p_delay[played] = tick - (double)(stats.dec_frames - 1) * BTIF_MSBC_FRAME_US;
+                sum += p_delay[played];
+                played++;
+                run_played++;
+            }
+            tick += BTIF_MSBC_FRAME_US;
+        }
+
+        btif_msbc_get_stats(&stats);
+        underruns += stats.underruns;
+        concealed += stats.concealed;
+    }
+
+    qsort(p_delay, played, sizeof(double), cmp_double);
+    printf("  %5.1f ms  %7.2f ms  %7.2f ms  %7.2f ms  %9u  %9u  %7.2f ms\n", jitter_ms,
+           sum / played / 1000, p_delay[played / 2] / 1000, p_delay[played - 1] / 1000,
+           underruns, concealed, BTIF_MSBC_FRAME_US / 1000.0 + delay_ms + sum / played / 1000);
+    free(p_delay);
+}
+
+static void usage(const char *p_name)
+{
+    fprintf(stderr, "usage: %s [-n frames] [-s sco_packet_bytes]\n", p_name);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    static const int    loss[] = { 1, 5, 10, 20 };
+    static const double jitter[] = { 0, 2, 5, 7.5, 10, 15 };
+    int                 c, i;
+
+    while ((c = getopt(argc, argv, "n:s:")) != -1)
+    {
+        switch (c)
+        {
+            case 'n':
+                num_frames = atoi(optarg);
+                break;
+            case 's':
+                sco_len = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (num_frames < 100 || num_frames > MAX_FRAMES || sco_len < 1 || sco_len > BTIF_MSBC_PKT_LEN)
+        usage(argv[0]);
+
+    p_input = malloc(num_frames * BTIF_MSBC_SAMPLES * sizeof(INT16));
+    p_ref = malloc(num_frames * BTIF_MSBC_SAMPLES * sizeof(INT16));
+    p_output = malloc(num_frames * BTIF_MSBC_SAMPLES * sizeof(INT16));
+    p_stream = malloc(num_frames * BTIF_MSBC_PKT_LEN);
+    make_signal(p_input, num_frames * BTIF_MSBC_SAMPLES);
+
+    run_codec();
+
+    printf("\npacket loss, output against the lossless decode\n");
+    printf("        lost              SNR of    SNR of all frames\n");
+    printf("  loss  frames  us/frame  lost frames  concealed  silence\n");
+    for (i = 0; i < (int)(sizeof(loss) / sizeof(loss[0])); i++)
+        run_loss(loss[i]);
+
+    printf("\njitter buffer, depth %d packets\n", BTIF_MSBC_JITTER_DEPTH);
+    printf("            buffering delay                                       added\n");
+    printf("  jitter    mean        median      max         underruns  concealed  end to end\n");
+    for (i = 0; i < (int)(sizeof(jitter) / sizeof(jitter[0])); i++)
+        run_jitter(jitter[i]);
+    printf("  end to end: 7.5 ms to gather a frame, %.2f ms of filter banks and the mean\n"
+           "  buffering delay; the codec CPU time is below 0.01 ms\n", delay_ms);
+
+    return 0;
+}
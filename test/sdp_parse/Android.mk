@@ -0,0 +1,22 @@
+LOCAL_PATH:= $(call my-dir)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= sdp_parse_test.c \
+    ../../stack/sdp/sdp_parse.c
+
+LOCAL_C_INCLUDES += . \
+    $(LOCAL_PATH)/../../stack/include \
+    $(LOCAL_PATH)/../../stack/sdp \
+    $(LOCAL_PATH)/../../stack/btm \
+    $(LOCAL_PATH)/../../include \
+    $(LOCAL_PATH)/../../gki/ulinux \
+    $(LOCAL_PATH)/../../gki/common \
+    $(LOCAL_PATH)/../../utils/include \
+    $(bdroid_C_INCLUDES)
+
+LOCAL_CFLAGS += $(bdroid_CFLAGS)
+LOCAL_MODULE_TAGS := debug optional
+LOCAL_MODULE:= sdp_parse_test
+
+include $(BUILD_HOST_EXECUTABLE)
@@ -0,0 +1,775 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      sdp_parse_test.c
+ *
+ *  Description:   Runs the SDP response parser of stack/sdp/sdp_parse.c over
+ *                 the attribute lists of typical service records, cut into
+ *                 responses of random size, and checks that the discovery
+ *                 database comes out the same however they are cut. Then
+ *                 does the same with corrupted lists, which must not take
+ *                 the parser out of its buffers, and measures how fast it
+ *                 parses responses of the size the client asks for.
+ *
+ ***********************************************************************************/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bt_target.h"
+#include "bt_types.h"
+#include "bt_trace.h"
+#include "bt_utils.h"
+#include "gki.h"
+#include "sdp_api.h"
+#include "sdpint.h"
+
+#define MAX_LIST        (64 * 1024)
+#define MAX_DUMP        (256 * 1024)
+#define BIG_DB_SIZE     (128 * 1024)
+#define SEARCH_DB_SIZE  8000            /* BTA_DM_SDP_DB_SIZE */
+
+typedef struct
+{
+    UINT8   data[MAX_LIST];
+    int     len;
+} tBUILD;
+
+static BD_ADDR  peer_addr = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 };
+static int      num_bufs;
+static int      verbose;
+
+/* The parser traces through it, normally provided by sdp_main.c */
+tSDP_CB         sdp_cb;
+
+void LogMsg (UINT32 trace_set_mask, const char *fmt_str, ...)
+{
+    va_list ap;
+    UNUSED(trace_set_mask);
+
+    if (!verbose)
+        return;
+    va_start (ap, fmt_str);
+    vfprintf (stderr, fmt_str, ap);
+    va_end (ap);
+    fputc ('\n', stderr);
+}
+
+void *GKI_getbuf (UINT16 size)
+{
+    num_bufs++;
+    return malloc (size);
+}
+
+void GKI_freebuf (void *p_buf)
+{
+    num_bufs--;
+    free (p_buf);
+}
+
+/* Normally provided by sdp_utils.c */
+BOOLEAN sdpu_is_base_uuid (UINT8 *p_uuid)
+{
+    static const UINT8 base[MAX_UUID_SIZE] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+                                               0x80, 0x00, 0x00, 0x80, 0x5F, 0x9B, 0x34, 0xFB };
+
+    return (memcmp (p_uuid + 4, base + 4, MAX_UUID_SIZE - 4) == 0);
+}
+
+static double now_us (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/******************************************************************************
+**  Building attribute lists
+******************************************************************************/
+static void put_byte (tBUILD *p_b, UINT8 val)
+{
+    p_b->data[p_b->len++] = val;
+}
+
+static void put_uint (tBUILD *p_b, UINT8 type, int size, UINT32 val)
+{
+    int idx = (size == 1) ? SIZE_ONE_BYTE : (size == 2) ? SIZE_TWO_BYTES : SIZE_FOUR_BYTES;
+
+    put_byte (p_b, (type << 3) | idx);
+    while (size--)
+        put_byte (p_b, (UINT8)(val >> (size * 8)));
+}
+
+static void put_u8 (tBUILD *p_b, UINT8 val)     { put_uint (p_b, UINT_DESC_TYPE, 1, val); }
+static void put_u16 (tBUILD *p_b, UINT16 val)   { put_uint (p_b, UINT_DESC_TYPE, 2, val); }
+static void put_u32 (tBUILD *p_b, UINT32 val)   { put_uint (p_b, UINT_DESC_TYPE, 4, val); }
+static void put_uuid (tBUILD *p_b, UINT16 val)  { put_uint (p_b, UUID_DESC_TYPE, 2, val); }
+static void put_bool (tBUILD *p_b, BOOLEAN val) { put_byte (p_b, BOOLEAN_DESC_TYPE << 3); put_byte (p_b, val); }
+
+static void put_uuid128 (tBUILD *p_b, const UINT8 *p_uuid)
+{
+    put_byte (p_b, (UUID_DESC_TYPE << 3) | SIZE_SIXTEEN_BYTES);
+    memcpy (&p_b->data[p_b->len], p_uuid, MAX_UUID_SIZE);
+    p_b->len += MAX_UUID_SIZE;
+}
+
+static void put_bytes (tBUILD *p_b, UINT8 type, const UINT8 *p, int len)
+{
+    if (len < 256)
+    {
+        put_byte (p_b, (type << 3) | SIZE_IN_NEXT_BYTE);
+        put_byte (p_b, len);
+    }
+    else
+    {
+        put_byte (p_b, (type << 3) | SIZE_IN_NEXT_WORD);
+        put_byte (p_b, len >> 8);
+        put_byte (p_b, len);
+    }
+    memcpy (&p_b->data[p_b->len], p, len);
+    p_b->len += len;
+}
+
+static void put_text (tBUILD *p_b, const char *p_str)
+{
+    put_bytes (p_b, TEXT_STR_DESC_TYPE, (const UINT8 *)p_str, strlen (p_str));
+}
+
+/* A sequence is opened with room for a 16 bit length, and closed with
+** the shortest header that holds it, as servers do */
+static int seq_open (tBUILD *p_b)
+{
+    p_b->len += 3;
+    return p_b->len;
+}
+
+static void seq_close (tBUILD *p_b, int start)
+{
+    int len = p_b->len - start;
+
+    if (len < 256)
+    {
+        memmove (&p_b->data[start - 1], &p_b->data[start], len);
+        p_b->data[start - 3] = (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_BYTE;
+        p_b->data[start - 2] = len;
+        p_b->len--;
+    }
+    else
+    {
+        p_b->data[start - 3] = (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_WORD;
+        p_b->data[start - 2] = len >> 8;
+        p_b->data[start - 1] = len;
+    }
+}
+
+static void put_class (tBUILD *p_b, UINT16 uuid1, UINT16 uuid2)
+{
+    int s;
+
+    put_u16 (p_b, ATTR_ID_SERVICE_CLASS_ID_LIST);
+    s = seq_open (p_b);
+    put_uuid (p_b, uuid1);
+    if (uuid2)
+        put_uuid (p_b, uuid2);
+    seq_close (p_b, s);
+}
+
+/* L2CAP, then RFCOMM with the channel, or the PSM alone, then OBEX */
+static void put_proto (tBUILD *p_b, UINT16 psm, UINT8 scn, BOOLEAN obex)
+{
+    int s, s1;
+
+    put_u16 (p_b, ATTR_ID_PROTOCOL_DESC_LIST);
+    s = seq_open (p_b);
+    s1 = seq_open (p_b);
+    put_uuid (p_b, UUID_PROTOCOL_L2CAP);
+    if (psm)
+        put_u16 (p_b, psm);
+    seq_close (p_b, s1);
+    if (scn)
+    {
+        s1 = seq_open (p_b);
+        put_uuid (p_b, UUID_PROTOCOL_RFCOMM);
+        put_u8 (p_b, scn);
+        seq_close (p_b, s1);
+    }
+    if (obex)
+    {
+        s1 = seq_open (p_b);
+        put_uuid (p_b, UUID_PROTOCOL_OBEX);
+        seq_close (p_b, s1);
+    }
+    seq_close (p_b, s);
+}
+
+static void put_profile (tBUILD *p_b, UINT16 uuid, UINT16 version)
+{
+    int s, s1;
+
+    put_u16 (p_b, ATTR_ID_BT_PROFILE_DESC_LIST);
+    s = seq_open (p_b);
+    s1 = seq_open (p_b);
+    put_uuid (p_b, uuid);
+    put_u16 (p_b, version);
+    seq_close (p_b, s1);
+    seq_close (p_b, s);
+}
+
+static void put_common (tBUILD *p_b, UINT32 handle)
+{
+    int s;
+
+    put_u16 (p_b, ATTR_ID_SERVICE_RECORD_HDL);
+    put_u32 (p_b, handle);
+    put_u16 (p_b, ATTR_ID_BROWSE_GROUP_LIST);
+    s = seq_open (p_b);
+    put_uuid (p_b, UUID_SERVCLASS_PUBLIC_BROWSE_GROUP);
+    seq_close (p_b, s);
+}
+
+static void put_name (tBUILD *p_b, const char *p_name)
+{
+    put_u16 (p_b, ATTR_ID_SERVICE_NAME);
+    put_text (p_b, p_name);
+}
+
+/* The records a phone or a headset typically returns to a browse */
+static void put_records (tBUILD *p_b, int copy)
+{
+    static const UINT8 vendor_uuid[MAX_UUID_SIZE] = { 0x8c, 0xe2, 0x55, 0xc0, 0x20, 0x0a, 0x11, 0xe0,
+                                                      0xac, 0x64, 0x08, 0x00, 0x20, 0x0c, 0x9a, 0x66 };
+    static const UINT8 a2dp_uuid[MAX_UUID_SIZE]   = { 0x00, 0x00, 0x11, 0x0a, 0x00, 0x00, 0x10, 0x00,
+                                                      0x80, 0x00, 0x00, 0x80, 0x5f, 0x9b, 0x34, 0xfb };
+    UINT8   report_desc[220];
+    UINT32  handle = 0x00010000 + copy * 16;
+    int     r, s, s1, s2, xx;
+
+    for (xx = 0; xx < (int)sizeof (report_desc); xx++)
+        report_desc[xx] = (UINT8)(xx * 7 + copy);
+
+    /* PBAP server */
+    r = seq_open (p_b);
+    put_common (p_b, handle++);
+    put_class (p_b, UUID_SERVCLASS_PBAP_PSE, 0);
+    put_proto (p_b, 0, 19, TRUE);
+    put_profile (p_b, UUID_SERVCLASS_PHONE_ACCESS, 0x0101);
+    put_name (p_b, "OBEX Phonebook Access Server");
+    put_u16 (p_b, ATTR_ID_SUPPORTED_REPOSITORIES);
+    put_u8 (p_b, 0x03);
+    seq_close (p_b, r);
+
+    /* MAP server */
+    r = seq_open (p_b);
+    put_common (p_b, handle++);
+    put_class (p_b, UUID_SERVCLASS_MESSAGE_ACCESS, 0);
+    put_proto (p_b, 0, 20, TRUE);
+    put_profile (p_b, UUID_SERVCLASS_MAP_PROFILE, 0x0100);
+    put_name (p_b, "SMS/MMS Message Access");
+    put_u16 (p_b, ATTR_ID_MAS_INSTANCE_ID);
+    put_u8 (p_b, 0);
+    put_u16 (p_b, ATTR_ID_SUPPORTED_MSG_TYPE);
+    put_u8 (p_b, 0x0e);
+    seq_close (p_b, r);
+
+    /* HID keyboard, with a report descriptor and an additional protocol list */
+    r = seq_open (p_b);
+    put_common (p_b, handle++);
+    put_class (p_b, UUID_SERVCLASS_HUMAN_INTERFACE, 0);
+    put_proto (p_b, HID_PSM_CONTROL, 0, FALSE);
+    put_u16 (p_b, ATTR_ID_LANGUAGE_BASE_ATTR_ID_LIST);
+    s = seq_open (p_b);
+    put_u16 (p_b, 0x656e);
+    put_u16 (p_b, 0x006a);
+    put_u16 (p_b, 0x0100);
+    seq_close (p_b, s);
+    put_u16 (p_b, ATTR_ID_ADDITION_PROTO_DESC_LISTS);
+    s = seq_open (p_b);
+    s1 = seq_open (p_b);
+    s2 = seq_open (p_b);
+    put_uuid (p_b, UUID_PROTOCOL_L2CAP);
+    put_u16 (p_b, HID_PSM_INTERRUPT);
+    seq_close (p_b, s2);
+    s2 = seq_open (p_b);
+    put_uuid (p_b, UUID_PROTOCOL_HIDP);
+    seq_close (p_b, s2);
+    seq_close (p_b, s1);
+    seq_close (p_b, s);
+    put_profile (p_b, UUID_SERVCLASS_HUMAN_INTERFACE, 0x0101);
+    put_name (p_b, "Bluetooth Keyboard");
+    put_u16 (p_b, ATTR_ID_HID_DEVICE_RELNUM);
+    put_u16 (p_b, 0x0100);
+    put_u16 (p_b, ATTR_ID_HID_PARSER_VERSION);
+    put_u16 (p_b, 0x0111);
+    put_u16 (p_b, ATTR_ID_HID_DEVICE_SUBCLASS);
+    put_u8 (p_b, 0x40);
+    put_u16 (p_b, ATTR_ID_HID_COUNTRY_CODE);
+    put_u8 (p_b, 0x21);
+    put_u16 (p_b, ATTR_ID_HID_VIRTUAL_CABLE);
+    put_bool (p_b, TRUE);
+    put_u16 (p_b, ATTR_ID_HID_RECONNECT_INITIATE);
+    put_bool (p_b, TRUE);
+    put_u16 (p_b, ATTR_ID_HID_DESCRIPTOR_LIST);
+    s = seq_open (p_b);
+    s1 = seq_open (p_b);
+    put_u8 (p_b, 0x22);
+    put_bytes (p_b, TEXT_STR_DESC_TYPE, report_desc, sizeof (report_desc));
+    seq_close (p_b, s1);
+    seq_close (p_b, s);
+    put_u16 (p_b, ATTR_ID_HID_LANGUAGE_ID_BASE);
+    s = seq_open (p_b);
+    s1 = seq_open (p_b);
+    put_u16 (p_b, 0x0409);
+    put_u16 (p_b, 0x0100);
+    seq_close (p_b, s1);
+    seq_close (p_b, s);
+    put_u16 (p_b, ATTR_ID_HID_BOOT_DEVICE);
+    put_bool (p_b, TRUE);
+    put_u16 (p_b, ATTR_ID_HID_LINK_SUPERVISION_TO);
+    put_u16 (p_b, 0x0c80);
+    seq_close (p_b, r);
+
+    /* A2DP sink, its service class as a 128 bit UUID on the base UUID */
+    r = seq_open (p_b);
+    put_common (p_b, handle++);
+    put_u16 (p_b, ATTR_ID_SERVICE_CLASS_ID_LIST);
+    s = seq_open (p_b);
+    put_uuid128 (p_b, a2dp_uuid);
+    seq_close (p_b, s);
+    put_proto (p_b, 0x0019, 0, FALSE);
+    put_profile (p_b, UUID_SERVCLASS_ADV_AUDIO_DISTRIBUTION, 0x0103);
+    put_name (p_b, "Audio Sink");
+    put_u16 (p_b, ATTR_ID_SUPPORTED_FEATURES);
+    put_u16 (p_b, 0x000f);
+    seq_close (p_b, r);
+
+    /* Hands-free unit */
+    r = seq_open (p_b);
+    put_common (p_b, handle++);
+    put_class (p_b, UUID_SERVCLASS_HF_HANDSFREE, UUID_SERVCLASS_GENERIC_AUDIO);
+    put_proto (p_b, 0, 2, FALSE);
+    put_profile (p_b, UUID_SERVCLASS_HF_HANDSFREE, 0x0106);
+    put_name (p_b, "Hands-Free unit");
+    put_u16 (p_b, ATTR_ID_SUPPORTED_FEATURES);
+    put_u16 (p_b, 0x003f);
+    seq_close (p_b, r);
+
+    /* Device ID */
+    r = seq_open (p_b);
+    put_common (p_b, handle++);
+    put_class (p_b, UUID_SERVCLASS_PNP_INFORMATION, 0);
+    put_u16 (p_b, ATTR_ID_SPECIFICATION_ID);
+    put_u16 (p_b, 0x0103);
+    put_u16 (p_b, ATTR_ID_VENDOR_ID);
+    put_u16 (p_b, 0x000f);
+    put_u16 (p_b, ATTR_ID_PRODUCT_ID);
+    put_u16 (p_b, 0x1200);
+    put_u16 (p_b, ATTR_ID_PRODUCT_VERSION);
+    put_u16 (p_b, 0x1436);
+    put_u16 (p_b, ATTR_ID_PRIMARY_RECORD);
+    put_bool (p_b, TRUE);
+    put_u16 (p_b, ATTR_ID_VENDOR_ID_SOURCE);
+    put_u16 (p_b, 0x0001);
+    seq_close (p_b, r);
+
+    /* Object push, with its list of formats */
+    r = seq_open (p_b);
+    put_common (p_b, handle++);
+    put_class (p_b, UUID_SERVCLASS_OBEX_OBJECT_PUSH, 0);
+    put_proto (p_b, 0, 12, TRUE);
+    put_profile (p_b, UUID_SERVCLASS_OBEX_OBJECT_PUSH, 0x0102);
+    put_name (p_b, "OBEX Object Push");
+    put_u16 (p_b, ATTR_ID_SUPPORTED_FORMATS_LIST);
+    s = seq_open (p_b);
+    for (xx = 1; xx <= 6; xx++)
+        put_u8 (p_b, xx);
+    put_u8 (p_b, 0xff);
+    seq_close (p_b, s);
+    seq_close (p_b, r);
+
+    /* A vendor service, with a 32 bit UUID and a 64 bit number */
+    r = seq_open (p_b);
+    put_common (p_b, handle++);
+    put_u16 (p_b, ATTR_ID_SERVICE_CLASS_ID_LIST);
+    s = seq_open (p_b);
+    put_uuid128 (p_b, vendor_uuid);
+    put_uint (p_b, UUID_DESC_TYPE, 4, 0x00011101);
+    seq_close (p_b, s);
+    put_proto (p_b, 0, 5, FALSE);
+    put_name (p_b, "Vendor Sync");
+    put_u16 (p_b, 0x0301);
+    put_byte (p_b, (UINT_DESC_TYPE << 3) | SIZE_EIGHT_BYTES);
+    for (xx = 0; xx < 8; xx++)
+        put_byte (p_b, xx);
+    seq_close (p_b, r);
+}
+
+/* The list of attribute lists of a service search attribute response */
+static void build_list (tBUILD *p_b, int copies)
+{
+    static tBUILD   recs;
+    int             xx;
+
+    recs.len = 0;
+    for (xx = 0; xx < copies; xx++)
+        put_records (&recs, xx);
+
+    p_b->len = 0;
+    put_byte (p_b, (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_LONG);
+    for (xx = 3; xx >= 0; xx--)
+        put_byte (p_b, (UINT8)(recs.len >> (xx * 8)));
+    memcpy (&p_b->data[p_b->len], recs.data, recs.len);
+    p_b->len += recs.len;
+}
+
+/******************************************************************************
+**  The discovery database
+******************************************************************************/
+static tSDP_DISCOVERY_DB *db_new (UINT32 size, UINT32 grow_size, UINT8 *p_raw, UINT32 raw_size)
+{
+    tSDP_DISCOVERY_DB *p_db = (tSDP_DISCOVERY_DB *) malloc (size);
+
+    /* as SDP_InitDiscoveryDb leaves it */
+    memset (p_db, 0, size);
+    p_db->mem_size   = size - sizeof (tSDP_DISCOVERY_DB);
+    p_db->mem_free   = p_db->mem_size;
+    p_db->p_free_mem = (UINT8 *)(p_db + 1);
+    p_db->grow_size  = grow_size;
+    p_db->raw_data   = p_raw;
+    p_db->raw_size   = raw_size;
+    return p_db;
+}
+
+static void db_free (tSDP_DISCOVERY_DB *p_db)
+{
+    sdp_db_free_ext_mem (p_db);
+    free (p_db);
+}
+
+static int dump_attr (char *p_out, int pos, tSDP_DISC_ATTR *p_attr, int depth)
+{
+    UINT16  type, len, xx;
+
+    for (; p_attr != NULL && pos < MAX_DUMP - 128; p_attr = p_attr->p_next_attr)
+    {
+        type = SDP_DISC_ATTR_TYPE (p_attr->attr_len_type);
+        len  = SDP_DISC_ATTR_LEN (p_attr->attr_len_type);
+        pos += sprintf (p_out + pos, "%*s%04x %u/%u", depth * 2, "", p_attr->attr_id, type, len);
+
+        if (type == DATA_ELE_SEQ_DESC_TYPE || type == DATA_ELE_ALT_DESC_TYPE)
+        {
+            p_out[pos++] = '\n';
+            pos = dump_attr (p_out, pos, p_attr->attr_value.v.p_sub_attr, depth + 1);
+            continue;
+        }
+
+        if (type == TEXT_STR_DESC_TYPE || type == URL_DESC_TYPE || len > 4)
+        {
+            for (xx = 0; xx < len && pos < MAX_DUMP - 128; xx++)
+                pos += sprintf (p_out + pos, " %02x", p_attr->attr_value.v.array[xx]);
+        }
+        else if (len == 1)
+            pos += sprintf (p_out + pos, " %u", p_attr->attr_value.v.u8);
+        else if (len == 2)
+            pos += sprintf (p_out + pos, " %u", p_attr->attr_value.v.u16);
+        else if (len == 4)
+            pos += sprintf (p_out + pos, " %u", p_attr->attr_value.v.u32);
+        p_out[pos++] = '\n';
+    }
+    return pos;
+}
+
+/* Prints the records of the DB into p_out, returns the number of records */
+static int dump_db (tSDP_DISCOVERY_DB *p_db, char *p_out)
+{
+    tSDP_DISC_REC   *p_rec;
+    int             pos = 0, num = 0;
+
+    for (p_rec = p_db->p_first_rec; p_rec != NULL; p_rec = p_rec->p_next_rec, num++)
+    {
+        if (pos < MAX_DUMP - 128)
+            pos += sprintf (p_out + pos, "record %d\n", num);
+        pos = dump_attr (p_out, pos, p_rec->p_first_attr, 1);
+    }
+    p_out[pos] = 0;
+    return num;
+}
+
+/******************************************************************************
+**  Parsing
+******************************************************************************/
+typedef struct
+{
+    UINT16  status;
+    BOOLEAN done;
+    int     num_recs;
+    UINT32  raw_used;
+} tRESULT;
+
+static UINT8    raw_ref[SDP_MAX_LIST_BYTE_COUNT * 4], raw_got[SDP_MAX_LIST_BYTE_COUNT * 4];
+static char     dump_ref[MAX_DUMP], dump_got[MAX_DUMP];
+
+/* Parses p into a new DB in responses of 1 to max_frag bytes, 0 for one,
+** and leaves its dump and raw data in p_dump and p_raw */
+static tRESULT parse (UINT8 *p, int len, BOOLEAN is_list, int max_frag, UINT32 db_size,
+                      UINT32 grow_size, char *p_dump, UINT8 *p_raw)
+{
+    tSDP_DISCOVERY_DB   *p_db = db_new (db_size, grow_size, p_raw, sizeof (raw_ref));
+    tSDP_PARSE          ps;
+    tRESULT             res;
+    int                 off = 0, frag;
+
+    sdp_parse_init (&ps, p_db, peer_addr, is_list);
+
+    res.status = SDP_SUCCESS;
+    while (off < len && res.status == SDP_SUCCESS)
+    {
+        frag = max_frag ? 1 + rand () % max_frag : len;
+        if (frag > len - off)
+            frag = len - off;
+        res.status = sdp_parse_data (&ps, p + off, frag);
+        off += frag;
+    }
+
+    res.done     = sdp_parse_done (&ps);
+    res.num_recs = dump_db (p_db, p_dump);
+    res.raw_used = p_db->raw_used;
+    db_free (p_db);
+    return res;
+}
+
+static BOOLEAN same (tRESULT *p_a, tRESULT *p_b)
+{
+    return (p_a->status == p_b->status && p_a->done == p_b->done
+         && p_a->num_recs == p_b->num_recs && p_a->raw_used == p_b->raw_used
+         && !strcmp (dump_ref, dump_got) && !memcmp (raw_ref, raw_got, p_a->raw_used));
+}
+
+/* The list with random damage: bytes changed, inserted, removed or cut off */
+static int mutate (UINT8 *p_out, const UINT8 *p_in, int len)
+{
+    static const UINT8 hdrs[] = { 0x35, 0x36, 0x37, 0x3d, 0x09, 0x0a, 0x19, 0x1a, 0x1c,
+                                  0x25, 0x26, 0x27, 0x28, 0x00, 0xff };
+    int num = 1 + rand () % 4, pos;
+
+    memcpy (p_out, p_in, len);
+    while (num--)
+    {
+        pos = rand () % len;
+        switch (rand () % 6)
+        {
+        case 0:
+            p_out[pos] ^= 1 << (rand () % 8);
+            break;
+        case 1:
+            p_out[pos] = rand ();
+            break;
+        case 2:
+            p_out[pos] = hdrs[rand () % sizeof (hdrs)];
+            break;
+        case 3:
+            if (len < MAX_LIST)
+            {
+                memmove (p_out + pos + 1, p_out + pos, len - pos);
+                p_out[pos] = hdrs[rand () % sizeof (hdrs)];
+                len++;
+            }
+            break;
+        case 4:
+            if (len > 1)
+            {
+                memmove (p_out + pos, p_out + pos + 1, len - pos - 1);
+                len--;
+            }
+            break;
+        default:
+            len = 1 + pos;
+            break;
+        }
+    }
+    return len;
+}
+
+static const char *status_name (UINT16 status)
+{
+    switch (status)
+    {
+    case SDP_SUCCESS:               return "success";
+    case SDP_DB_FULL:               return "DB full";
+    case SDP_INVALID_CONT_STATE:    return "bad list";
+    default:                        return "other";
+    }
+}
+
+static void usage (const char *p_name)
+{
+    fprintf (stderr, "usage: %s [-c copies] [-f fragments] [-n fuzz] [-s seed] [-m bytes] [-v]\n", p_name);
+    fprintf (stderr, "  -c  copies of the record set in the list, default 4, max 20\n");
+    fprintf (stderr, "  -f  random cuttings of the list, default 2000\n");
+    fprintf (stderr, "  -n  corrupted lists, default 20000\n");
+    fprintf (stderr, "  -s  seed, default 1\n");
+    fprintf (stderr, "  -m  response size for the throughput, default %d\n", SDP_MTU_SIZE - 16);
+    fprintf (stderr, "  -v  show the traces of the parser\n");
+}
+
+int main (int argc, char **argv)
+{
+    static tBUILD   list, rec;
+    static UINT8    bad[MAX_LIST];
+    tRESULT         ref, got;
+    int             copies = 4, num_frag = 2000, num_fuzz = 20000, seed = 1;
+    int             rsp_size = SDP_MTU_SIZE - 16;
+    int             opt, xx, bad_len, errors = 0, rounds;
+    int             fuzz_status[4] = { 0 }, fuzz_done = 0;
+    double          start, elapsed;
+
+    while ((opt = getopt (argc, argv, "c:f:n:s:m:v")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c':   copies = atoi (optarg);     break;
+            case 'f':   num_frag = atoi (optarg);   break;
+            case 'n':   num_fuzz = atoi (optarg);   break;
+            case 's':   seed = atoi (optarg);       break;
+            case 'm':   rsp_size = atoi (optarg);   break;
+            case 'v':   verbose = 1;                break;
+            default:    usage (argv[0]);            return 1;
+        }
+    }
+    if (copies < 1 || copies > 20 || num_frag < 0 || num_fuzz < 0 || rsp_size < 1)
+    {
+        usage (argv[0]);
+        return 1;
+    }
+
+    srand (seed);
+    sdp_cb.trace_level = BT_TRACE_LEVEL_DEBUG;
+
+    build_list (&list, copies);
+    rec.len = 0;
+    put_records (&rec, 0);
+
+    /* the reference, the list in one piece into a DB that does not fill */
+    ref = parse (list.data, list.len, TRUE, 0, BIG_DB_SIZE, 0, dump_ref, raw_ref);
+    printf ("list of %d records, %d bytes: %s, %d records parsed, raw data %u bytes\n",
+            copies * 8, list.len, status_name (ref.status), ref.num_recs, ref.raw_used);
+    if (ref.status != SDP_SUCCESS || !ref.done || ref.num_recs != copies * 8
+     || (int)ref.raw_used != list.len - 5)
+    {
+        printf ("FAIL: reference parse\n");
+        return 1;
+    }
+    if (verbose)
+        fputs (dump_ref, stderr);
+
+    /* the 128 bit UUID of A2DP shortened, the HID report descriptor whole */
+    if (!strstr (dump_ref, "  0001 6/17\n    0000 3/2 4362\n")
+     || !strstr (dump_ref, "  0206 6/226\n    0000 6/224\n      0000 1/1 34\n      0000 4/220 00 07 0e "))
+    {
+        printf ("FAIL: reference values\n");
+        return 1;
+    }
+
+    /* the same DB in any cutting, also when the DB grows as it goes */
+    for (xx = 0; xx < num_frag; xx++)
+    {
+        got = parse (list.data, list.len, TRUE, 1 + rand () % (2 * rsp_size),
+                     (xx & 1) ? BIG_DB_SIZE : 1024, (xx & 1) ? 0 : BIG_DB_SIZE, dump_got, raw_got);
+        if (!same (&ref, &got))
+            errors++;
+    }
+    printf ("cut at random %d times: %d differ\n", num_frag, errors);
+
+    /* a DB that may not grow fills, one that may grows as far as allowed */
+    got = parse (list.data, list.len, TRUE, rsp_size, 1024, 0, dump_got, raw_got);
+    printf ("1 KB DB: %s, %d records", status_name (got.status), got.num_recs);
+    if (got.status != SDP_DB_FULL)
+        errors++;
+    xx = got.num_recs;
+    got = parse (list.data, list.len, TRUE, rsp_size, 1024, 4096, dump_got, raw_got);
+    printf ("; growing by 4 KB: %s, %d records\n", status_name (got.status), got.num_recs);
+    if (got.num_recs <= xx || num_bufs != 0)
+        errors++;
+
+    /* a single attribute list, as a service attribute response has it */
+    ref = parse (rec.data, rec.len, FALSE, 0, BIG_DB_SIZE, 0, dump_ref, raw_ref);
+    for (xx = 0; xx < num_frag / 10; xx++)
+    {
+        got = parse (rec.data, rec.len, FALSE, 1 + rand () % 64, BIG_DB_SIZE, 0, dump_got, raw_got);
+        if (!same (&ref, &got))
+            errors++;
+    }
+    if (ref.status != SDP_SUCCESS || !ref.done || ref.num_recs != 1)
+        errors++;
+    printf ("attribute lists of %d bytes, the first cut at random %d times: %s\n", rec.len, num_frag / 10,
+            errors ? "differ" : "same");
+
+    /* damaged lists: whatever the parser makes of them, it makes it in any cutting */
+    sdp_cb.trace_level = verbose ? BT_TRACE_LEVEL_DEBUG : BT_TRACE_LEVEL_NONE;
+    for (xx = 0; xx < num_fuzz; xx++)
+    {
+        bad_len = mutate (bad, list.data, list.len);
+        ref = parse (bad, bad_len, TRUE, 0, BIG_DB_SIZE, 0, dump_ref, raw_ref);
+        got = parse (bad, bad_len, TRUE, 1 + rand () % (2 * rsp_size),
+                     256 + rand () % 4096, BIG_DB_SIZE, dump_got, raw_got);
+        if (!same (&ref, &got))
+        {
+            if (errors++ < 5)
+                printf ("corrupted list %d: %s/%d in one piece, %s/%d cut\n", xx,
+                        status_name (ref.status), ref.num_recs, status_name (got.status), got.num_recs);
+        }
+        fuzz_status[ref.status == SDP_SUCCESS ? 0 : ref.status == SDP_DB_FULL ? 1
+                    : ref.status == SDP_INVALID_CONT_STATE ? 2 : 3]++;
+        if (ref.done)
+            fuzz_done++;
+    }
+    printf ("corrupted %d times: %d complete, %d success, %d DB full, %d bad list, %d other\n",
+            num_fuzz, fuzz_done, fuzz_status[0], fuzz_status[1], fuzz_status[2], fuzz_status[3]);
+    if (fuzz_status[3] || num_bufs != 0)
+        errors++;
+
+    /* throughput, in responses of the size the client asks for, into a DB
+    ** of the size the device search gives it, that grows as far as it needs */
+    rounds = 1 + 20000000 / list.len;
+    start = now_us ();
+    for (xx = 0; xx < rounds; xx++)
+    {
+        tSDP_DISCOVERY_DB   *p_db = db_new (SEARCH_DB_SIZE, BIG_DB_SIZE, raw_got, sizeof (raw_got));
+        tSDP_PARSE          ps;
+        int                 off;
+
+        sdp_parse_init (&ps, p_db, peer_addr, TRUE);
+        for (off = 0; off < list.len; off += rsp_size)
+            sdp_parse_data (&ps, list.data + off, (off + rsp_size < list.len) ? rsp_size : list.len - off);
+        if (!sdp_parse_done (&ps))
+            errors++;
+        db_free (p_db);
+    }
+    elapsed = now_us () - start;
+    printf ("throughput in %d byte responses: %.1f MB/s, %.2f us per record\n", rsp_size,
+            (double)list.len * rounds / elapsed, elapsed / rounds / (copies * 8));
+
+    printf ("%s\n", errors ? "FAIL" : "PASS");
+    return errors ? 1 : 0;
+}
@@ -31,6 +31,8 @@ typedef enum {
     TASK_HIGH_USERIAL_READ,
     TASK_UIPC_READ,
     TASK_JAVA_ALARM,
+    TASK_HIGH_HH_UHID,
+    TASK_HIGH_BTU_DATA,
     TASK_HIGH_MAX
 } tHIGH_PRIORITY_TASK;
 